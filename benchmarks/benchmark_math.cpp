@@ -10,8 +10,11 @@
 #include <QString>
 
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <memory>
 
 namespace {
 
@@ -42,6 +45,97 @@ bool envBoolTrue(const char* key) {
         upper == QByteArrayLiteral("YES") || upper == QByteArrayLiteral("ON");
 }
 
+/// Expression tree rebuilt from a compiled program, evaluated the way formulas
+/// were before compilation: a recursive std::function walk per point. Keeps
+/// the reference path in this binary so eval_speedup needs no stored figure.
+struct TreeNode {
+    ExprOp op{ExprOp::PushConst};
+    double value{0.0};
+    std::shared_ptr<TreeNode> left;
+    std::shared_ptr<TreeNode> right;
+};
+
+std::shared_ptr<TreeNode> treeFromProgram(const ExprProgram& program) {
+    std::vector<std::shared_ptr<TreeNode>> stack;
+    for (const ExprInstr& in : program.code) {
+        auto n = std::make_shared<TreeNode>();
+        n->op = in.op;
+        n->value = in.value;
+        switch (in.op) {
+        case ExprOp::PushConst:
+        case ExprOp::PushX:
+            break;
+        case ExprOp::Add:
+        case ExprOp::Sub:
+        case ExprOp::Mul:
+        case ExprOp::Div:
+        case ExprOp::Pow:
+            n->right = stack.back();
+            stack.pop_back();
+            n->left = stack.back();
+            stack.pop_back();
+            break;
+        case ExprOp::PowInt: {
+            // The tree had no integer-power node; x^n was a Pow over a constant.
+            n->op = ExprOp::Pow;
+            n->left = stack.back();
+            stack.pop_back();
+            n->right = std::make_shared<TreeNode>();
+            n->right->value = in.value;
+            break;
+        }
+        default:
+            n->left = stack.back();
+            stack.pop_back();
+            break;
+        }
+        stack.push_back(std::move(n));
+    }
+    return stack.size() == 1 ? stack.back() : nullptr;
+}
+
+double evalTree(const std::shared_ptr<TreeNode>& root, double x) {
+    std::function<double(const TreeNode*, double)> eval = [&](const TreeNode* n, double xv) -> double {
+        if (!n)
+            return qQNaN();
+        switch (n->op) {
+        case ExprOp::PushConst: return n->value;
+        case ExprOp::PushX: return xv;
+        case ExprOp::Neg: return -eval(n->left.get(), xv);
+        case ExprOp::Add: return eval(n->left.get(), xv) + eval(n->right.get(), xv);
+        case ExprOp::Sub: return eval(n->left.get(), xv) - eval(n->right.get(), xv);
+        case ExprOp::Mul: return eval(n->left.get(), xv) * eval(n->right.get(), xv);
+        case ExprOp::Div: {
+            const double d = eval(n->right.get(), xv);
+            if (qFuzzyIsNull(d))
+                return qQNaN();
+            return eval(n->left.get(), xv) / d;
+        }
+        case ExprOp::Pow:
+        case ExprOp::PowInt: return std::pow(eval(n->left.get(), xv), eval(n->right.get(), xv));
+        case ExprOp::Sin: return std::sin(eval(n->left.get(), xv));
+        case ExprOp::Cos: return std::cos(eval(n->left.get(), xv));
+        case ExprOp::Tan: return std::tan(eval(n->left.get(), xv));
+        case ExprOp::Exp: return std::exp(eval(n->left.get(), xv));
+        case ExprOp::Log: {
+            const double v = eval(n->left.get(), xv);
+            if (v <= 0.0)
+                return qQNaN();
+            return std::log(v);
+        }
+        case ExprOp::Sqrt: {
+            const double v = eval(n->left.get(), xv);
+            if (v < 0.0)
+                return qQNaN();
+            return std::sqrt(v);
+        }
+        case ExprOp::Abs: return std::fabs(eval(n->left.get(), xv));
+        }
+        return qQNaN();
+    };
+    return eval(root.get(), x);
+}
+
 } // namespace
 
 int main() {
@@ -75,10 +169,28 @@ int main() {
     }
     const auto tp2 = std::chrono::steady_clock::now();
 
+    const std::shared_ptr<TreeNode> tree =
+        exprCache.program ? treeFromProgram(*exprCache.program) : nullptr;
+    double treeAcc = 0.0;
+    for (int i = 0; i < evalRuns; ++i) {
+        const double x = (static_cast<double>(i % 200) / 17.0) - 3.0;
+        treeAcc += evalTree(tree, x);
+    }
+    const auto tp3 = std::chrono::steady_clock::now();
+
     const double parseMs =
         std::chrono::duration<double, std::milli>(tp1 - tp0).count();
     const double evalMs =
         std::chrono::duration<double, std::milli>(tp2 - tp1).count();
+    const double evalNsPerPoint =
+        evalRuns > 0 ? (evalMs * 1.0e6) / static_cast<double>(evalRuns) : 0.0;
+    const double treeMs =
+        std::chrono::duration<double, std::milli>(tp3 - tp2).count();
+    const double treeNsPerPoint =
+        evalRuns > 0 ? (treeMs * 1.0e6) / static_cast<double>(evalRuns) : 0.0;
+    const double speedup = treeNsPerPoint / qMax(1e-9, evalNsPerPoint);
+    const int programOps =
+        exprCache.program ? static_cast<int>(exprCache.program->code.size()) : 0;
 
     const bool md = envBoolTrue("GITHUB_ACTIONS");
     if (md) {
@@ -88,12 +200,21 @@ int main() {
         std::cout << "| parse_runs | " << parseRuns << " |\n";
         std::cout << "| eval_ms | " << evalMs << " |\n";
         std::cout << "| eval_runs | " << evalRuns << " |\n";
-        std::cout << "| eval_sum | " << acc << " |\n\n";
+        std::cout << "| eval_ns_per_point | " << evalNsPerPoint << " |\n";
+        std::cout << "| tree_eval_ns_per_point | " << treeNsPerPoint << " |\n";
+        std::cout << "| eval_speedup | " << speedup << "x |\n";
+        std::cout << "| program_ops | " << programOps << " |\n";
+        std::cout << "| eval_sum | " << acc << " |\n";
+        std::cout << "| tree_eval_sum | " << treeAcc << " |\n\n";
     } else {
         std::cout << "blop_benchmark_math"
                   << " parse_ms=" << parseMs << " parse_runs=" << parseRuns
                   << " eval_ms=" << evalMs << " eval_runs=" << evalRuns
-                  << " eval_sum=" << acc << '\n';
+                  << " eval_ns_per_point=" << evalNsPerPoint
+                  << " tree_eval_ns_per_point=" << treeNsPerPoint
+                  << " eval_speedup=" << speedup
+                  << " program_ops=" << programOps << " eval_sum=" << acc
+                  << " tree_eval_sum=" << treeAcc << '\n';
     }
 
     const double parseMax = envDouble("BLOP_BENCH_PARSE_MAX_MS", 0.0);
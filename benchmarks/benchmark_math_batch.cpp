@@ -0,0 +1,133 @@
+/**
+ * Throughput of MathEvaluator::evalMany (column-wise SIMD kernels) against the
+ * scalar evalAt loop, in points per second, for the curve shapes the graph
+ * plotter and root finder actually sample.
+ * Not linked into the main app — opt-in via -DBLOP_BUILD_AUTOMATION=ON.
+ */
+
+#include "MathBatchKernels.h"
+#include "MathEvaluator.h"
+#include "MathExpressionParser.h"
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QString>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+int envInt(const char* key, int fallback) {
+    const QByteArray v = qgetenv(key);
+    if (v.isEmpty())
+        return fallback;
+    bool ok = false;
+    const int i = QByteArray{v}.toInt(&ok);
+    return ok ? i : fallback;
+}
+
+double envDouble(const char* key, double fallback) {
+    const QByteArray v = qgetenv(key);
+    if (v.isEmpty())
+        return fallback;
+    bool ok = false;
+    const double d = QByteArray{v}.toDouble(&ok);
+    return ok ? d : fallback;
+}
+
+bool envBoolTrue(const char* key) {
+    const QByteArray v = qgetenv(key);
+    if (v.isEmpty())
+        return false;
+    QByteArray upper = v.toUpper();
+    return upper == QByteArrayLiteral("1") || upper == QByteArrayLiteral("TRUE") ||
+        upper == QByteArrayLiteral("YES") || upper == QByteArrayLiteral("ON");
+}
+
+struct Row {
+    const char* expr;
+    double scalarPps{0.0};
+    double batchPps{0.0};
+    double checksum{0.0};
+};
+
+void accumulate(Row& row, double y) {
+    if (qIsFinite(y))
+        row.checksum += y;
+}
+
+} // namespace
+
+int main() {
+    // Same grid size as GraphCanvasItem::paint; repeated like consecutive repaints.
+    const int points = envInt("BLOP_BENCH_BATCH_POINTS", 261);
+    const int rounds = envInt("BLOP_BENCH_BATCH_ROUNDS", 4000);
+
+    std::vector<Row> rows = {
+        {"sin(x)*x^2 + sqrt(abs(x))*log(x^2 + 1)"},
+        {"x^3 - 2*x + 1"},
+        {"exp(-x/4)*cos(3*x)"},
+        {"tan(x)"},
+        {"1/(x-1) + x^0.5"},
+    };
+
+    std::vector<double> xs(static_cast<size_t>(points));
+    std::vector<double> ys(static_cast<size_t>(points));
+    for (int i = 0; i < points; ++i)
+        xs[static_cast<size_t>(i)] = -10.0 + 20.0 * static_cast<double>(i) / qMax(1, points - 1);
+
+    for (Row& row : rows) {
+        const ParsedExpression expr = MathExpressionParser::parseFunctionExpression(QString::fromLatin1(row.expr));
+        if (!expr.ok) {
+            std::cerr << "parse_failed: " << row.expr << '\n';
+            return 2;
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (int i = 0; i < points; ++i)
+                ys[static_cast<size_t>(i)] = MathEvaluator::evalAt(expr, xs[static_cast<size_t>(i)]);
+            accumulate(row, ys[static_cast<size_t>(r % points)]);
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            MathEvaluator::evalMany(expr, xs.data(), ys.data(), xs.size());
+            accumulate(row, ys[static_cast<size_t>(r % points)]);
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+        const double total = static_cast<double>(points) * static_cast<double>(rounds);
+        row.scalarPps = total / qMax(1e-9, std::chrono::duration<double>(t1 - t0).count());
+        row.batchPps = total / qMax(1e-9, std::chrono::duration<double>(t2 - t1).count());
+    }
+
+    const char* kernels = mathBatchKernels().name;
+    const bool md = envBoolTrue("GITHUB_ACTIONS");
+    if (md) {
+        std::cout << "## Micro-benchmark `blop_benchmark_math_batch` (kernels: " << kernels << ")\n\n";
+        std::cout << "| Expression | scalar pts/s | batch pts/s | speedup |\n| --- | ---: | ---: | ---: |\n";
+        for (const Row& row : rows) {
+            std::cout << "| `" << row.expr << "` | " << row.scalarPps << " | " << row.batchPps << " | "
+                      << row.batchPps / qMax(1e-9, row.scalarPps) << "x |\n";
+        }
+        std::cout << '\n';
+    } else {
+        for (const Row& row : rows) {
+            std::cout << "blop_benchmark_math_batch kernels=" << kernels << " expr=\"" << row.expr << "\""
+                      << " scalar_pts_per_s=" << row.scalarPps << " batch_pts_per_s=" << row.batchPps
+                      << " checksum=" << row.checksum << '\n';
+        }
+    }
+
+    // Fails the run when any expression's batch throughput drops below the floor.
+    const double minPps = envDouble("BLOP_BENCH_BATCH_MIN_PTS_PER_S", 0.0);
+    for (const Row& row : rows) {
+        if (minPps > 0.0 && row.batchPps < minPps) {
+            std::cerr << "threshold_exceeded: batch_pts_per_s " << row.batchPps << " < " << minPps
+                      << " (" << row.expr << ")\n";
+            return 3;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/**
+ * v1 note JSON reads: QJsonDocument (DOM) against NoteJsonStream (pull
+ * parser), wall time and peak RSS, on synthetic 10k/100k-stroke notes.
+ * Every case runs in its own child process so peak RSS is not shared.
+ * Not linked into the main app — opt-in via -DBLOP_BUILD_AUTOMATION=ON.
+ */
+
+#include "Note.h"
+#include "notejsonstream.h"
+#include "notemanager.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtMath>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr int kPointsPerStroke = 32;
+constexpr int kStrokesPerPage = 400;
+
+/// "dom-write" only produces the v1 file the read cases load.
+const char* const kModes[] = {"dom-write", "dom-read", "stream-read"};
+
+bool envBoolTrue(const char* key) {
+    const QByteArray v = qgetenv(key);
+    if (v.isEmpty())
+        return false;
+    QByteArray upper = v.toUpper();
+    return upper == QByteArrayLiteral("1") || upper == QByteArrayLiteral("TRUE") ||
+        upper == QByteArrayLiteral("YES") || upper == QByteArrayLiteral("ON");
+}
+
+/// kB from /proc/self/status (-1 where unavailable).
+qint64 procStatusKb(const char* field) {
+    QFile f(QStringLiteral("/proc/self/status"));
+    if (!f.open(QIODevice::ReadOnly))
+        return -1;
+    const QByteArray prefix = QByteArray(field) + ':';
+    for (const QByteArray& line : f.readAll().split('\n')) {
+        if (line.startsWith(prefix))
+            return line.mid(prefix.size()).trimmed().split(' ').value(0).toLongLong();
+    }
+    return -1;
+}
+
+/// Resets VmHWM to the current RSS (Linux >= 4.0).
+void resetPeakRss() {
+    QFile f(QStringLiteral("/proc/self/clear_refs"));
+    if (f.open(QIODevice::WriteOnly))
+        f.write("5");
+}
+
+Note syntheticNote(int strokes) {
+    Note note;
+    note.id = QStringLiteral("bench");
+    note.title = QStringLiteral("Benchmark");
+    for (int k = 0; k < strokes; ++k) {
+        const int page = k / kStrokesPerPage;
+        note.ensurePage(page);
+        Stroke s;
+        s.width = 1.5 + (k % 5) * 0.5;
+        s.color = QColor::fromRgb(uint(0xFF000000u | (k * 2654435761u)));
+        const double ox = 40.0 + (k % 20) * 25.0;
+        const double oy = 60.0 + (k / 20 % kStrokesPerPage) * 3.0;
+        s.points.reserve(kPointsPerStroke);
+        for (int i = 0; i < kPointsPerStroke; ++i)
+            s.points.append(QPointF(ox + i * 0.7, oy + 6.0 * qSin(i * 0.4 + k)),
+                            0.35 + 0.5 * qAbs(qSin(i * 0.2)));
+        note.pages[page].strokes.push_back(std::move(s));
+    }
+    return note;
+}
+
+/// v1 writer as NoteManager::toJson had it: full DOM, then one serialized copy.
+bool domWrite(const Note& note, const QString& path) {
+    QJsonObject root;
+    root["id"] = note.id;
+    root["title"] = note.title;
+    QJsonArray pagesArr;
+    for (const NotePage& p : note.pages) {
+        QJsonArray strokesArr;
+        for (const Stroke& s : p.strokes) {
+            QJsonObject so;
+            so["w"] = s.width;
+            so["c"] = s.color.name();
+            so["e"] = s.isEraser;
+            so["h"] = s.isHighlighter;
+            QJsonArray pts;
+            const bool hasPressure = s.points.hasPressure();
+            for (auto it = s.points.begin(); it != s.points.end(); ++it) {
+                QJsonArray a;
+                a.append((*it).x());
+                a.append((*it).y());
+                if (hasPressure)
+                    a.append(it.pressure());
+                pts.append(a);
+            }
+            so["pts"] = pts;
+            strokesArr.append(so);
+        }
+        QJsonObject pageObj = NoteManager::pageObjectsToJson(p);
+        pageObj["strokes"] = strokesArr;
+        pageObj["bg"] = p.backgroundType;
+        pageObj["title"] = p.title;
+        pagesArr.append(pageObj);
+    }
+    root["pages"] = pagesArr;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+/// The former v1 load path: whole file, DOM, then the model.
+bool domRead(const QString& path, Note& out) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+    if (!doc.isObject())
+        return false;
+    const QJsonObject root = doc.object();
+    out.id = root.value("id").toString();
+    out.title = root.value("title").toString();
+    const QJsonArray pagesArr = root.value("pages").toArray();
+    out.pages.resize(pagesArr.size());
+    for (int i = 0; i < pagesArr.size(); ++i) {
+        const QJsonObject pageObj = pagesArr[i].toObject();
+        NotePage& page = out.pages[i];
+        page.backgroundType = pageObj.value("bg").toInt(2);
+        page.title = pageObj.value("title").toString();
+        for (const QJsonValue& sv : pageObj.value("strokes").toArray()) {
+            const QJsonObject so = sv.toObject();
+            Stroke s;
+            s.width = so.value("w").toDouble(2.0);
+            s.color = QColor(so.value("c").toString("#000000"));
+            for (const QJsonValue& pv : so.value("pts").toArray()) {
+                const QJsonArray a = pv.toArray();
+                if (a.size() < 2)
+                    continue;
+                s.points.append(QPointF(a[0].toDouble(), a[1].toDouble()),
+                                a.size() >= 3 ? a[2].toDouble(1.0) : 1.0);
+            }
+            page.strokes.push_back(std::move(s));
+        }
+        NoteManager::pageObjectsFromJson(pageObj, page);
+    }
+    return true;
+}
+
+bool streamRead(const QString& path, Note& out) {
+    QFile f(path);
+    return f.open(QIODevice::ReadOnly) && NoteJsonStream::read(f, out);
+}
+
+/// Child process: one mode, one file. Prints "<wall_ms> <peak_kb>".
+int runCase(const QString& mode, int strokes, const QString& path) {
+    const bool writing = mode.endsWith(QLatin1String("-write"));
+    Note note;
+    if (writing)
+        note = syntheticNote(strokes);
+    resetPeakRss();
+    const qint64 rssBefore = procStatusKb("VmRSS");
+    const auto t0 = std::chrono::steady_clock::now();
+    bool ok = false;
+    if (mode == QLatin1String("dom-write"))
+        ok = domWrite(note, path);
+    else if (mode == QLatin1String("dom-read"))
+        ok = domRead(path, note);
+    else if (mode == QLatin1String("stream-read"))
+        ok = streamRead(path, note);
+    const auto t1 = std::chrono::steady_clock::now();
+    const qint64 peak = procStatusKb("VmHWM");
+    if (!ok) {
+        std::cerr << "case_failed: " << mode.toStdString() << '\n';
+        return 2;
+    }
+    int readStrokes = 0;
+    for (const NotePage& p : note.pages)
+        readStrokes += p.strokes.size();
+    if (readStrokes != strokes) {
+        std::cerr << "stroke_count_mismatch: " << readStrokes << " != " << strokes << '\n';
+        return 2;
+    }
+    std::cout << std::chrono::duration<double, std::milli>(t1 - t0).count() << ' '
+              << (peak >= 0 && rssBefore >= 0 ? peak - rssBefore : -1) << '\n';
+    return 0;
+}
+
+struct Row {
+    int strokes{0};
+    QString mode;
+    double wallMs{0.0};
+    qint64 peakKb{-1};
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    if (args.size() == 5 && args[1] == QLatin1String("--case"))
+        return runCase(args[2], args[3].toInt(), args[4]);
+
+    QList<int> sizes;
+    const QByteArray env = qgetenv("BLOP_BENCH_JSON_STROKES");
+    for (const QByteArray& part : (env.isEmpty() ? QByteArray("10000,100000") : env).split(',')) {
+        bool ok = false;
+        const int n = part.trimmed().toInt(&ok);
+        if (ok && n > 0)
+            sizes.append(n);
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::cerr << "no_temp_dir\n";
+        return 2;
+    }
+    std::vector<Row> rows;
+    for (const int strokes : sizes) {
+        // The write case first; its output is the input of the read cases.
+        const QString path = dir.filePath(QStringLiteral("note_%1.json").arg(strokes));
+        for (const char* mode : kModes) {
+            QProcess child;
+            child.start(app.applicationFilePath(),
+                        {QStringLiteral("--case"), QString::fromLatin1(mode), QString::number(strokes), path});
+            if (!child.waitForFinished(-1) || child.exitCode() != 0) {
+                std::cerr << "child_failed: " << mode << ' ' << strokes << '\n'
+                          << child.readAllStandardError().constData();
+                return 2;
+            }
+            const QList<QByteArray> out = child.readAllStandardOutput().trimmed().split(' ');
+            Row row;
+            row.strokes = strokes;
+            row.mode = QString::fromLatin1(mode);
+            row.wallMs = out.value(0).toDouble();
+            row.peakKb = out.value(1).toLongLong();
+            rows.push_back(row);
+        }
+    }
+
+    const bool md = envBoolTrue("GITHUB_ACTIONS");
+    if (md) {
+        std::cout << "## Micro-benchmark `blop_benchmark_note_json`\n\n";
+        std::cout << "| Strokes | Mode | wall ms | peak RSS delta KiB |\n| ---: | --- | ---: | ---: |\n";
+        for (const Row& row : rows) {
+            std::cout << "| " << row.strokes << " | " << row.mode.toStdString() << " | " << row.wallMs
+                      << " | " << row.peakKb << " |\n";
+        }
+        std::cout << '\n';
+    } else {
+        for (const Row& row : rows) {
+            std::cout << "blop_benchmark_note_json strokes=" << row.strokes << " mode=" << row.mode.toStdString()
+                      << " wall_ms=" << row.wallMs << " peak_rss_delta_kb=" << row.peakKb << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,573 @@
+/**
+ * Rendering and I/O hot paths on synthetic notes (N pages x M strokes x K
+ * points, with or without pressure and a PDF-like page background):
+ * NoteManager::saveNote/loadNote, PageRender page and thumbnail rendering,
+ * the parallel image export, EraserTool sweeps (scene items and stroke
+ * model), hold-shape fitting and Douglas-Peucker, StrokeItem::paint, and
+ * one long pressure stroke drawn per segment vs. as its filled outline.
+ * Prints key=value lines, a Markdown table on GitHub Actions, and JSON to
+ * the file named by --json or BLOP_BENCH_JSON.
+ * Not linked into the main app — opt-in via -DBLOP_BUILD_AUTOMATION=ON.
+ */
+
+#include "EraserTool.h"
+#include "Note.h"
+#include "StrokeItem.h"
+#include "StrokeSpatialIndex.h"
+#include "imageexportjob.h"
+#include "notemanager.h"
+#include "pagerender.h"
+#include "strokegeometry.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QGraphicsScene>
+#include <QGraphicsSceneMouseEvent>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QStyleOptionGraphicsItem>
+#include <QTemporaryDir>
+#include <QtMath>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+int envInt(const char* key, int fallback) {
+    const QByteArray v = qgetenv(key);
+    if (v.isEmpty())
+        return fallback;
+    bool ok = false;
+    const int i = QByteArray{v}.toInt(&ok);
+    return ok ? i : fallback;
+}
+
+bool envBoolTrue(const char* key) {
+    const QByteArray v = qgetenv(key);
+    if (v.isEmpty())
+        return false;
+    QByteArray upper = v.toUpper();
+    return upper == QByteArrayLiteral("1") || upper == QByteArrayLiteral("TRUE") ||
+        upper == QByteArrayLiteral("YES") || upper == QByteArrayLiteral("ON");
+}
+
+/// What a synthetic note is made of.
+struct Shape {
+    int pages{8};
+    int strokes{200};  ///< per page
+    int points{48};    ///< per stroke
+    bool pressure{false};
+    bool background{false};
+
+    QString label() const {
+        QString s = QStringLiteral("ink");
+        if (pressure)
+            s += QStringLiteral("+pressure");
+        if (background)
+            s += QStringLiteral("+pdf");
+        return s;
+    }
+    QJsonObject toJson() const {
+        return QJsonObject{{"pages", pages},       {"strokes_per_page", strokes},
+                           {"points_per_stroke", points}, {"pressure", pressure},
+                           {"background", background}};
+    }
+};
+
+/// A scanned/imported page: grey "text lines" of random word lengths on
+/// white, at half page size like the previews PDF import keeps.
+QImage pdfLikeBackground(const QSize& size, quint32 seed) {
+    QImage img(size, QImage::Format_RGB32);
+    img.fill(Qt::white);
+    QPainter p(&img);
+    QRandomGenerator rng(seed);
+    const int line = qMax(6, size.height() / 48);
+    for (int y = line * 2; y < size.height() - line * 2; y += line) {
+        int x = size.width() / 12;
+        while (x < size.width() * 11 / 12) {
+            const int w = 6 + int(rng.bounded(40));
+            p.fillRect(QRect(x, y, w, line / 2), QColor(60, 60, 70));
+            x += w + 4;
+        }
+    }
+    return img;
+}
+
+Note syntheticNote(const Shape& shape, const QSize& pageSize) {
+    Note note;
+    note.id = QStringLiteral("bench");
+    note.title = QStringLiteral("Benchmark");
+    QRandomGenerator rng(42);
+    for (int pg = 0; pg < shape.pages; ++pg) {
+        note.ensurePage(pg);
+        NotePage& page = note.pages[pg];
+        if (shape.background)
+            page.backgroundImage = pdfLikeBackground(pageSize / 2, quint32(pg + 1));
+        const int cols = 12;
+        const int rows = qMax(1, (shape.strokes + cols - 1) / cols);
+        const qreal cellW = (pageSize.width() - 80.0) / cols;
+        const qreal cellH = (pageSize.height() - 120.0) / rows;
+        for (int k = 0; k < shape.strokes; ++k) {
+            Stroke s;
+            s.width = 1.5 + (k % 5) * 0.5;
+            s.color = QColor::fromRgb(uint(0xFF000000u | (k * 2654435761u)));
+            s.isHighlighter = (k % 17) == 0;
+            const qreal ox = 40.0 + (k % cols) * cellW;
+            const qreal oy = 60.0 + (k / cols) * cellH + cellH / 2;
+            const qreal step = cellW / qMax(1, shape.points);
+            s.points.reserve(shape.points);
+            for (int i = 0; i < shape.points; ++i) {
+                const QPointF pt(ox + i * step,
+                                 oy + cellH * 0.4 * qSin(i * 0.35 + k) + rng.generateDouble() * 0.8);
+                if (shape.pressure)
+                    s.points.append(pt, 0.35 + 0.5 * qAbs(qSin(i * 0.2)));
+                else
+                    s.points.append(pt);
+            }
+            page.strokes.push_back(std::move(s));
+        }
+    }
+    return note;
+}
+
+/// Items the view would create for the strokes of `page`.
+std::vector<StrokeItem*> strokeItems(const NotePage& page) {
+    std::vector<StrokeItem*> items;
+    items.reserve(size_t(page.strokes.size()));
+    for (const Stroke& s : page.strokes) {
+        const bool outline = StrokeGeometry::hasOutline(s);
+        auto* item = new StrokeItem(
+            StrokeGeometry::path(s), QPen(s.color, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin),
+            outline ? s.points : StrokePoints(),
+            s.isHighlighter ? StrokeItem::Highlighter : StrokeItem::Normal);
+        if (outline)
+            item->setOutline(StrokeGeometry::outline(s));
+        items.push_back(item);
+    }
+    return items;
+}
+
+/// A 500-point pressure stroke across the page, written in loops.
+Stroke longPressureStroke(const QSize& pageSize) {
+    Stroke s;
+    s.width = 3.0;
+    s.color = Qt::black;
+    for (int i = 0; i < 500; ++i) {
+        const qreal t = i * 0.08;
+        s.points.append(QPointF(60 + t * (pageSize.width() - 160) / 40.0 + 14 * qSin(t * 3),
+                                pageSize.height() / 2 + 20 * qCos(t * 2.1)),
+                        0.3 + 0.6 * qAbs(qSin(i * 0.05)));
+    }
+    return s;
+}
+
+/// Exposes the hold-shape recogniser of the drawing tools.
+class ShapeFitProbe : public AbstractStrokeTool {
+public:
+    ToolMode mode() const override { return ToolMode::Pen; }
+    QString name() const override { return QStringLiteral("probe"); }
+    QString iconName() const override { return QString(); }
+
+    bool fit(const QList<StrokePoint>& pts) const {
+        QPainterPath path;
+        QVector<StrokePoint> fitted;
+        qreal confidence = 0.0;
+        return fitHoldShape(pts, path, fitted, confidence) != HoldShapeKind::None;
+    }
+    using AbstractStrokeTool::douglasPeucker;
+
+protected:
+    QPen createPen() const override { return QPen(); }
+};
+
+/// Hand-drawn-ish circle, rectangle, triangle, line and scribble.
+QVector<QList<StrokePoint>> holdShapes(int points) {
+    QVector<QList<StrokePoint>> shapes;
+    QRandomGenerator rng(7);
+    auto jitter = [&]() { return (rng.generateDouble() - 0.5) * 2.0; };
+    auto polygon = [&](const QVector<QPointF>& corners) {
+        QList<StrokePoint> pts;
+        const int n = int(corners.size());
+        for (int i = 0; i < points; ++i) {
+            const qreal t = qreal(i) / (points - 1) * n;
+            const int a = qMin(int(t), n - 1);
+            const QPointF p = corners[a] + (corners[(a + 1) % n] - corners[a]) * (t - a);
+            pts.append({p + QPointF(jitter(), jitter()), 0.6});
+        }
+        return pts;
+    };
+    QList<StrokePoint> circle;
+    for (int i = 0; i < points; ++i) {
+        const qreal a = 2 * M_PI * i / (points - 1);
+        circle.append({QPointF(200 + 80 * qCos(a) + jitter(), 200 + 80 * qSin(a) + jitter()), 0.6});
+    }
+    shapes.append(circle);
+    shapes.append(polygon({{100, 100}, {300, 100}, {300, 220}, {100, 220}}));
+    shapes.append(polygon({{100, 300}, {220, 120}, {340, 300}}));
+    QList<StrokePoint> line;
+    for (int i = 0; i < points; ++i)
+        line.append({QPointF(100 + i * 4.0, 150 + i * 1.5 + jitter()), 0.6});
+    shapes.append(line);
+    QList<StrokePoint> scribble;
+    for (int i = 0; i < points; ++i)
+        scribble.append({QPointF(100 + i * 3.0, 200 + 40 * qSin(i * 0.9) + jitter()), 0.6});
+    shapes.append(scribble);
+    return shapes;
+}
+
+/// Eraser path across the page: a zigzag over the stroke rows.
+QVector<QPointF> eraserSweep(const QSize& pageSize, int steps) {
+    QVector<QPointF> pts;
+    pts.reserve(steps);
+    for (int i = 0; i < steps; ++i) {
+        const qreal t = qreal(i) / qMax(1, steps - 1);
+        pts.append(QPointF(40 + (pageSize.width() - 80) * (0.5 + 0.45 * qSin(t * 12 * M_PI)),
+                           60 + (pageSize.height() - 120) * t));
+    }
+    return pts;
+}
+
+struct Row {
+    QString name;
+    QString variant;
+    QJsonObject params;
+    int runs{0};
+    double minMs{0.0};
+    double medianMs{0.0};
+    double meanMs{0.0};
+};
+
+/// `run` returns the wall time of one iteration in ms, negative on failure.
+bool measure(std::vector<Row>& rows, const QString& name, const Shape& shape, int runs,
+             const std::function<double()>& run) {
+    std::vector<double> ms;
+    ms.reserve(size_t(runs));
+    for (int i = 0; i < runs; ++i) {
+        const double t = run();
+        if (t < 0.0) {
+            std::cerr << "case_failed: " << name.toStdString() << ' ' << shape.label().toStdString()
+                      << '\n';
+            return false;
+        }
+        ms.push_back(t);
+    }
+    std::sort(ms.begin(), ms.end());
+    Row row;
+    row.name = name;
+    row.variant = shape.label();
+    row.params = shape.toJson();
+    row.runs = runs;
+    row.minMs = ms.front();
+    row.medianMs = ms[ms.size() / 2];
+    row.meanMs = std::accumulate(ms.begin(), ms.end(), 0.0) / double(ms.size());
+    rows.push_back(row);
+    return true;
+}
+
+template <typename F>
+double timeMs(F&& work) {
+    const auto t0 = std::chrono::steady_clock::now();
+    const bool ok = work();
+    const auto t1 = std::chrono::steady_clock::now();
+    return ok ? std::chrono::duration<double, std::milli>(t1 - t0).count() : -1.0;
+}
+
+bool runShape(std::vector<Row>& rows, const Shape& shape, int runs, const QString& dir) {
+    const QSize pageSize = PageRender::a4Size();
+    const int pageW = pageSize.width();
+    const int pageH = pageSize.height();
+    const Note note = syntheticNote(shape, pageSize);
+    const QString path = dir + QStringLiteral("/bench_%1.bnote").arg(rows.size());
+
+    bool ok = measure(rows, QStringLiteral("save_note"), shape, runs, [&]() {
+        return timeMs([&]() { return NoteManager::saveNote(note, path); });
+    });
+    ok = ok && measure(rows, QStringLiteral("load_note"), shape, runs, [&]() {
+        Note out;
+        return timeMs([&]() { return NoteManager::loadNote(path, out); });
+    });
+    ok = ok && measure(rows, QStringLiteral("load_note_hydrated"), shape, runs, [&]() {
+        Note out;
+        return timeMs([&]() {
+            if (!NoteManager::loadNote(path, out))
+                return false;
+            for (NotePage& p : out.pages) {
+                if (!p.ensureLoaded())
+                    return false;
+            }
+            return true;
+        });
+    });
+    ok = ok && measure(rows, QStringLiteral("render_page"), shape, runs, [&]() {
+        return timeMs([&]() {
+            for (const NotePage& p : note.pages) {
+                if (PageRender::renderPage(p, pageW, pageH).isNull())
+                    return false;
+            }
+            return true;
+        });
+    });
+    ok = ok && measure(rows, QStringLiteral("render_thumbnail"), shape, runs, [&]() {
+        return timeMs([&]() {
+            for (const NotePage& p : note.pages) {
+                if (PageRender::renderThumbnail(p, pageW, pageH, QSize(180, 254)).isNull())
+                    return false;
+            }
+            return true;
+        });
+    });
+    ok = ok && measure(rows, QStringLiteral("export_images"), shape, runs, [&]() {
+        ImageExportJob::Options options;
+        options.pageSize = pageSize;
+        const QStringList paths = ImageExportJob::pagePaths(
+            dir + QStringLiteral("/export.png"), int(note.pages.size()), &options.format);
+        return timeMs([&]() { return ImageExportJob::run(note.pages, paths, options); });
+    });
+
+    const NotePage& first = note.pages.first();
+    const QVector<QPointF> sweep = eraserSweep(pageSize, 240);
+    ok = ok && measure(rows, QStringLiteral("eraser_scene"), shape, runs, [&]() {
+        QGraphicsScene scene;
+        auto index = std::make_unique<StrokeSpatialIndex>(&scene);
+        for (StrokeItem* item : strokeItems(first)) {
+            scene.addItem(item);
+            index->insert(item, 0);
+        }
+        EraserTool tool;
+        ToolConfig config;
+        config.penWidth = 24;
+        config.eraserMode = EraserMode::Pixel;
+        tool.setConfig(config);
+        QGraphicsSceneMouseEvent ev(QEvent::GraphicsSceneMouseMove);
+        const double t = timeMs([&]() {
+            for (const QPointF& pos : sweep) {
+                ev.setScenePos(pos);
+                tool.handleMouseMove(&ev, &scene);
+            }
+            return true;
+        });
+        // Before the scene deletes the remaining items.
+        index.reset();
+        return t;
+    });
+    ok = ok && measure(rows, QStringLiteral("eraser_model"), shape, runs, [&]() {
+        QVector<Stroke> strokes = first.strokes;
+        const qreal r = 12.0;
+        return timeMs([&]() {
+            for (const QPointF& pos : sweep) {
+                const QRectF disc(pos.x() - r, pos.y() - r, 2 * r, 2 * r);
+                QVector<Stroke> next;
+                next.reserve(strokes.size());
+                for (const Stroke& s : strokes) {
+                    QVector<Stroke> pieces;
+                    const qreal pad = s.width / 2;
+                    if (!s.points.boundingRect().adjusted(-pad, -pad, pad, pad).intersects(disc) ||
+                        !StrokeGeometry::eraseDisc(s, pos, r, &pieces)) {
+                        next.push_back(s);
+                        continue;
+                    }
+                    for (Stroke& piece : pieces)
+                        next.push_back(std::move(piece));
+                }
+                strokes = std::move(next);
+            }
+            return true;
+        });
+    });
+
+    ShapeFitProbe probe;
+    const QVector<QList<StrokePoint>> shapes = holdShapes(qMax(8, shape.points));
+    ok = ok && measure(rows, QStringLiteral("shape_fit"), shape, runs, [&]() {
+        int recognised = 0;
+        const double t = timeMs([&]() {
+            for (int i = 0; i < 40; ++i) {
+                for (const QList<StrokePoint>& pts : shapes)
+                    recognised += probe.fit(pts) ? 1 : 0;
+            }
+            return true;
+        });
+        return recognised > 0 ? t : -1.0;
+    });
+    QVector<QVector<QPointF>> polylines;
+    polylines.reserve(first.strokes.size());
+    for (const Stroke& s : first.strokes)
+        polylines.append(s.points.points());
+    ok = ok && measure(rows, QStringLiteral("douglas_peucker"), shape, runs, [&]() {
+        qsizetype kept = 0;
+        const double t = timeMs([&]() {
+            for (const QVector<QPointF>& pts : polylines)
+                kept += ShapeFitProbe::douglasPeucker(pts, 1.5).size();
+            return true;
+        });
+        return kept > 0 ? t : -1.0;
+    });
+    // Compact stroke storage: what reading every point back costs.
+    ok = ok && measure(rows, QStringLiteral("stroke_points_decode"), shape, runs, [&]() {
+        qsizetype decoded = 0;
+        const double t = timeMs([&]() {
+            for (const Stroke& s : first.strokes)
+                decoded += s.points.points().size();
+            return true;
+        });
+        return decoded > 0 ? t : -1.0;
+    });
+
+    std::vector<StrokeItem*> items = strokeItems(first);
+    ok = ok && measure(rows, QStringLiteral("stroke_item_paint"), shape, runs, [&]() {
+        QImage target(pageSize, QImage::Format_ARGB32_Premultiplied);
+        target.fill(Qt::white);
+        QPainter p(&target);
+        p.setRenderHint(QPainter::Antialiasing);
+        QStyleOptionGraphicsItem option;
+        return timeMs([&]() {
+            for (StrokeItem* item : items) {
+                p.save();
+                item->paint(&p, &option, nullptr);
+                p.restore();
+            }
+            return true;
+        });
+    });
+    qDeleteAll(items);
+
+    if (!shape.pressure)
+        return ok;
+    // One long pressure stroke: the per-segment pen drawing StrokeItem used
+    // before, the outline build (once per stroke) and the outline fill.
+    const Stroke longStroke = longPressureStroke(pageSize);
+    auto paintLong = [&](const std::function<void(QPainter&)>& draw) {
+        QImage target(pageSize, QImage::Format_ARGB32_Premultiplied);
+        target.fill(Qt::white);
+        QPainter p(&target);
+        p.setRenderHint(QPainter::Antialiasing);
+        return timeMs([&]() {
+            for (int i = 0; i < 50; ++i)
+                draw(p);
+            return true;
+        });
+    };
+    ok = ok && measure(rows, QStringLiteral("long_stroke_segments"), shape, runs, [&]() {
+        return paintLong([&](QPainter& p) {
+            QPen pen(longStroke.color, longStroke.width, Qt::SolidLine, Qt::RoundCap,
+                     Qt::RoundJoin);
+            const QVector<QPointF> pts = longStroke.points.points();
+            const QVector<qreal> pr = longStroke.points.pressures();
+            for (int i = 0; i + 1 < pts.size(); ++i) {
+                pen.setWidthF(longStroke.width * qMax<qreal>(0.1, (pr[i] + pr[i + 1]) / 2));
+                p.setPen(pen);
+                p.drawLine(pts[i], pts[i + 1]);
+            }
+        });
+    });
+    ok = ok && measure(rows, QStringLiteral("long_stroke_outline_build"), shape, runs, [&]() {
+        // pressureOutline() itself; StrokeGeometry::outline() would hit its cache.
+        const QVector<QPointF> pts = longStroke.points.points();
+        const QVector<qreal> pr = longStroke.points.pressures();
+        bool built = true;
+        const double t = timeMs([&]() {
+            for (int i = 0; i < 50; ++i)
+                built &= !StrokeGeometry::pressureOutline(pts.constData(), pr.constData(),
+                                                          int(pts.size()), longStroke.width)
+                              .isEmpty();
+            return true;
+        });
+        return built ? t : -1.0;
+    });
+    ok = ok && measure(rows, QStringLiteral("long_stroke_outline"), shape, runs, [&]() {
+        const QPainterPath outline = StrokeGeometry::outline(longStroke);
+        return paintLong([&](QPainter& p) { p.fillPath(outline, longStroke.color); });
+    });
+    return ok;
+}
+
+QJsonDocument toJson(const std::vector<Row>& rows) {
+    QJsonArray cases;
+    for (const Row& row : rows) {
+        cases.append(QJsonObject{{"name", row.name},
+                                 {"variant", row.variant},
+                                 {"params", row.params},
+                                 {"runs", row.runs},
+                                 {"min_ms", row.minMs},
+                                 {"median_ms", row.medianMs},
+                                 {"mean_ms", row.meanMs}});
+    }
+    return QJsonDocument(QJsonObject{{"benchmark", "blop_benchmark_render_io"},
+                                     {"qt", QString::fromLatin1(qVersion())},
+                                     {"cases", cases}});
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // QGraphicsScene needs a QApplication; no window is ever shown.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    QString jsonPath = QString::fromLocal8Bit(qgetenv("BLOP_BENCH_JSON"));
+    const int jsonArg = int(args.indexOf(QStringLiteral("--json")));
+    if (jsonArg > 0 && jsonArg + 1 < args.size())
+        jsonPath = args[jsonArg + 1];
+
+    Shape base;
+    base.pages = qMax(1, envInt("BLOP_BENCH_PAGES", base.pages));
+    base.strokes = qMax(1, envInt("BLOP_BENCH_STROKES", base.strokes));
+    base.points = qMax(2, envInt("BLOP_BENCH_POINTS", base.points));
+    const int runs = qMax(1, envInt("BLOP_BENCH_RUNS", 5));
+
+    Shape pressure = base;
+    pressure.pressure = true;
+    Shape pdf = pressure;
+    pdf.background = true;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::cerr << "no_temp_dir\n";
+        return 2;
+    }
+    std::vector<Row> rows;
+    for (const Shape& shape : {base, pressure, pdf}) {
+        if (!runShape(rows, shape, runs, dir.path()))
+            return 2;
+    }
+
+    if (!jsonPath.isEmpty()) {
+        QFile out(jsonPath);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            std::cerr << "cannot_write_json: " << jsonPath.toStdString() << '\n';
+            return 2;
+        }
+        out.write(toJson(rows).toJson(QJsonDocument::Indented));
+    }
+
+    const bool md = envBoolTrue("GITHUB_ACTIONS");
+    if (md) {
+        std::cout << "## Benchmark `blop_benchmark_render_io`\n\n";
+        std::cout << base.pages << " pages x " << base.strokes << " strokes x " << base.points
+                  << " points, " << runs << " runs\n\n";
+        std::cout << "| Case | Variant | median ms | min ms | mean ms |\n| --- | --- | ---: | ---: | ---: |\n";
+        for (const Row& row : rows) {
+            std::cout << "| " << row.name.toStdString() << " | " << row.variant.toStdString() << " | "
+                      << row.medianMs << " | " << row.minMs << " | " << row.meanMs << " |\n";
+        }
+        std::cout << '\n';
+    } else {
+        for (const Row& row : rows) {
+            std::cout << "blop_benchmark_render_io case=" << row.name.toStdString()
+                      << " variant=" << row.variant.toStdString() << " median_ms=" << row.medianMs
+                      << " min_ms=" << row.minMs << " mean_ms=" << row.meanMs << '\n';
+        }
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <QByteArray>
 #include <QString>
 #include <QStringList>
 #include <QList>
@@ -7,12 +8,14 @@
 #include <QPainterPath>
 #include <QColor>
 #include <QImage>
+#include <memory>
+#include "strokepoints.h"
 
 struct Stroke {
-    QVector<QPointF> points;
-    /// Per-point stylus pressure (parallel to points); empty = uniform width.
-    QVector<qreal> pressures;
-    QPainterPath path;
+    /// Points with their stylus pressures, compact and shared. The path and
+    /// the pressure outline are derived on demand (StrokeGeometry::path(),
+    /// StrokeGeometry::outline()).
+    StrokePoints points;
     qreal width{2.0};
     QColor color{Qt::black};
     bool isEraser{false};
@@ -70,6 +73,40 @@ struct TextObject {
     int fontPointSize{14};
 };
 
+/// PDF page behind an imported page: the document by content hash (see
+/// PdfStore) and the 0-based page in it.
+struct PdfPageRef {
+    QByteArray doc; // SHA-1, hex
+    int page{-1};
+
+    bool isValid() const { return !doc.isEmpty() && page >= 0; }
+    bool operator==(const PdfPageRef &o) const {
+        return doc == o.doc && page == o.page;
+    }
+    bool operator!=(const PdfPageRef &o) const { return !(*this == o); }
+};
+
+struct NotePage;
+
+/// Noch nicht gelesener Inhalt einer Seite aus einer .bnote-v2-Datei (Striche,
+/// Objekte, Hintergrundbild). Wird erst beim ersten Zugriff geladen, siehe
+/// NotePage::ensureLoaded() und BnoteFile.
+class NotePagePayload {
+public:
+    virtual ~NotePagePayload() = default;
+    virtual bool loadInto(NotePage &page) const = 0;
+    /// Strokes and objects only, no background image (search indexing).
+    virtual bool loadContent(NotePage &page) const { return loadInto(page); }
+    /// Identifies the stored content (e.g. chunk checksums); 0 = unknown.
+    virtual quint64 revision() const { return 0; }
+    /// Number of strokes in the stored content without loading it; -1 =
+    /// unknown.
+    virtual int strokeCount() const { return -1; }
+    /// PNG of a payload that is nothing but a background image (PDF import),
+    /// so savers copy it without decoding; empty for every other payload.
+    virtual QByteArray backgroundPng() const { return QByteArray(); }
+};
+
 struct NotePage {
     QString title;        // Seitenname
     QVector<Stroke> strokes;
@@ -77,6 +114,9 @@ struct NotePage {
     QVector<StickyNoteObject> stickies;
     QVector<TextObject> texts;
     QImage backgroundImage; // PDF-Import: Hintergrundbild (leer = nicht gesetzt)
+    /// PDF-Import: Vektorquelle des Hintergrunds. backgroundImage bleibt ein
+    /// Raster in voller Seitengröße (Thumbnails, Geräte ohne das Dokument).
+    PdfPageRef pdf;
     /// PageBackgroundType als int (0 Blank … 4 Legal); Standard = Grid (2)
     int backgroundType{2};
     /// Papierfarbe (Linien/Karo passen sich automatisch an)
@@ -85,6 +125,25 @@ struct NotePage {
     int rotationDegrees{0};
     /// Drawboard-style page bookmark (left-rail bookmarks list).
     bool bookmarked{false};
+    /// Set while strokes/graphs/stickies/texts/backgroundImage still live in
+    /// the file. Copies share it, so a duplicated page loads the same chunk.
+    std::shared_ptr<const NotePagePayload> pendingPayload;
+
+    bool isLoaded() const { return !pendingPayload; }
+
+    /// Reads the deferred content into this page (no-op once loaded). On a
+    /// read error the payload is kept, so a later save still copies the
+    /// original chunk instead of writing an empty page.
+    bool ensureLoaded() {
+        if (!pendingPayload)
+            return true;
+        const auto payload = pendingPayload;
+        pendingPayload.reset();
+        if (payload->loadInto(*this))
+            return true;
+        pendingPayload = payload;
+        return false;
+    }
 };
 
 struct Note {
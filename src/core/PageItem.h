@@ -6,6 +6,7 @@
 #include <QPainterPath>
 #include <QStyleOptionGraphicsItem>
 #include <QWidget>
+#include <memory>
 
 enum class PageBackgroundType {
     Blank,
@@ -15,6 +16,18 @@ enum class PageBackgroundType {
     Legal
 };
 
+/// Background drawn for the zoom it is shown at instead of a fixed image,
+/// e.g. a PDF page (PdfRenderPool). paint() returns false when `fallback`
+/// (the page's own image) is sharp enough at `scale`, device pixels per
+/// page unit, and draws nothing then.
+class PageBackgroundSource {
+public:
+    virtual ~PageBackgroundSource() = default;
+    virtual bool paint(QPainter *painter, const QRectF &target,
+                       const QRectF &exposed, qreal scale,
+                       const QImage &fallback) = 0;
+};
+
 class PageItem : public QGraphicsRectItem {
 public:
     PageItem(qreal x, qreal y, qreal w, qreal h, QGraphicsItem *parent = nullptr)
@@ -43,6 +56,23 @@ public:
     }
     const QImage &backgroundImage() const { return m_backgroundImage; }
 
+    /// Takes precedence over the image, which stays its fallback.
+    void setBackgroundSource(std::shared_ptr<PageBackgroundSource> source) {
+        m_backgroundSource = std::move(source);
+        // Tiles are only fetched for the exposed part of the page.
+        setFlag(QGraphicsItem::ItemUsesExtendedStyleOption,
+                m_backgroundSource != nullptr);
+#ifdef Q_OS_ANDROID
+        // The item cache would pin the source to cache resolution; it
+        // renders for the zoom itself, so the page paints uncached.
+        if (m_backgroundSource)
+            setCacheMode(QGraphicsItem::NoCache);
+        else
+            setCacheMode(QGraphicsItem::ItemCoordinateCache, QSize(800, 1100));
+#endif
+        update();
+    }
+
     void setPaperColor(const QColor &c) {
         m_paperColor = c.isValid() ? c : QColor(Qt::white);
         update();
@@ -50,7 +80,6 @@ public:
 
 protected:
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override {
-        Q_UNUSED(option);
         Q_UNUSED(widget);
 
         // 1. Schlagschatten
@@ -64,18 +93,29 @@ protected:
         painter->drawRect(rect());
 
         // 3. Hintergrundbild (z.B. importierte PDF-Seite)
-        if (!m_backgroundImage.isNull()) {
+        const bool hasBackground =
+            !m_backgroundImage.isNull() || m_backgroundSource;
+        if (hasBackground) {
 #ifndef Q_OS_ANDROID
             // Skip bilinear filtering on Android - the page is rendered
             // through DeviceCoordinateCache anyway, and SmoothPixmapTransform
             // burns measurable frame time on phones with no visible benefit.
             painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
 #endif
-            painter->drawImage(rect(), m_backgroundImage);
+            const qreal scale =
+                QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+                    painter->worldTransform()) *
+                painter->device()->devicePixelRatio();
+            const bool drawn =
+                m_backgroundSource &&
+                m_backgroundSource->paint(painter, rect(), option->exposedRect,
+                                          scale, m_backgroundImage);
+            if (!drawn && !m_backgroundImage.isNull())
+                painter->drawImage(rect(), m_backgroundImage);
         }
 
         // 4. Muster – nur wenn kein Hintergrundbild
-        if (m_backgroundImage.isNull()) {
+        if (!hasBackground) {
             const qreal left = rect().left();
             const qreal right = rect().right();
             const qreal top = rect().top();
@@ -126,6 +166,7 @@ protected:
 private:
     PageBackgroundType m_type{PageBackgroundType::Grid};
     QImage m_backgroundImage;
+    std::shared_ptr<PageBackgroundSource> m_backgroundSource;
     QColor m_paperColor{Qt::white};
 };
 
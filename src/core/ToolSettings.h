@@ -42,6 +42,8 @@ struct ToolConfig {
     // 1. PEN
     int smoothing = 0;
     bool pressureSensitivity = true;
+    /// Wet ink runs a few ms ahead of the pen (extrapolated).
+    bool inkPrediction = true;
 
     // 2. PENCIL
     int hardness = 50;
@@ -0,0 +1,157 @@
+#include "bnotecodec.h"
+#include "notemanager.h"
+#include <QBuffer>
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonObject>
+#include <algorithm>
+#include <array>
+
+namespace BnoteCodec {
+
+namespace {
+
+enum StrokeFlags : quint8 {
+  StrokeEraser = 1,
+  StrokeHighlighter = 2,
+  StrokePressure = 4,
+};
+
+bool hasObjects(const NotePage &page) {
+  return !page.graphs.isEmpty() || !page.stickies.isEmpty() ||
+         !page.texts.isEmpty();
+}
+
+} // namespace
+
+quint32 crc32(const QByteArray &data) {
+  static const std::array<quint32, 256> table = [] {
+    std::array<quint32, 256> t{};
+    for (quint32 i = 0; i < 256; ++i) {
+      quint32 c = i;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  quint32 c = 0xFFFFFFFFu;
+  for (const char ch : data)
+    c = table[(c ^ quint8(ch)) & 0xFFu] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFu;
+}
+
+QByteArray encodeObjects(const NotePage &page) {
+  if (!hasObjects(page))
+    return QByteArray();
+  return QCborMap::fromJsonObject(NoteManager::pageObjectsToJson(page))
+      .toCborValue()
+      .toCbor();
+}
+
+void decodeObjects(const QByteArray &cbor, NotePage &page) {
+  page.graphs.clear();
+  page.stickies.clear();
+  page.texts.clear();
+  if (!cbor.isEmpty())
+    NoteManager::pageObjectsFromJson(
+        QCborValue::fromCbor(cbor).toMap().toJsonObject(), page);
+}
+
+QByteArray encodeContent(const NotePage &page) {
+  if (page.strokes.isEmpty() && !hasObjects(page))
+    return QByteArray();
+
+  ByteWriter w;
+  qsizetype estimate = 8;
+  for (const Stroke &s : page.strokes)
+    estimate += 16 + s.points.size() * 12;
+  w.buf.reserve(estimate);
+
+  w.put<quint32>(quint32(page.strokes.size()));
+  for (const Stroke &s : page.strokes) {
+    const bool pressure = s.points.hasPressure();
+    quint8 flags = 0;
+    if (s.isEraser)
+      flags |= StrokeEraser;
+    if (s.isHighlighter)
+      flags |= StrokeHighlighter;
+    if (pressure)
+      flags |= StrokePressure;
+    w.putF32(s.width);
+    w.put<quint32>(s.color.rgba());
+    w.put<quint8>(flags);
+    w.put<quint32>(quint32(s.points.size()));
+    w.putPoints(s.points);
+    if (pressure)
+      w.putPressures(s.points);
+  }
+  w.putBytes(encodeObjects(page));
+  return w.buf;
+}
+
+bool decodeContent(const QByteArray &bytes, NotePage &page) {
+  page.strokes.clear();
+  page.graphs.clear();
+  page.stickies.clear();
+  page.texts.clear();
+  if (bytes.isEmpty())
+    return true;
+
+  ByteReader r(bytes.constData(), bytes.size());
+  quint32 strokeCount = 0;
+  if (!r.get(strokeCount))
+    return false;
+  page.strokes.reserve(int(qMin<quint32>(strokeCount, 1u << 20)));
+  for (quint32 k = 0; k < strokeCount; ++k) {
+    Stroke s;
+    float width = 2.0f;
+    quint32 rgba = 0;
+    quint8 flags = 0;
+    quint32 n = 0;
+    if (!r.getF32(width) || !r.get(rgba) || !r.get(flags) || !r.get(n))
+      return false;
+    s.width = width;
+    s.color = QColor::fromRgba(rgba);
+    s.isEraser = flags & StrokeEraser;
+    s.isHighlighter = flags & StrokeHighlighter;
+    const char *xy = r.take(qsizetype(n) * 8);
+    if (!xy)
+      return false;
+    const char *pr = nullptr;
+    if (flags & StrokePressure) {
+      pr = r.take(qsizetype(n) * 4);
+      if (!pr)
+        return false;
+    }
+    // Straight into the compact form; no QPointF arrays in between.
+    s.points.reserve(int(n));
+    for (quint32 i = 0; i < n; ++i, xy += 8) {
+      const QPointF p(readF32(xy), readF32(xy + 4));
+      if (pr) {
+        s.points.append(p, readF32(pr));
+        pr += 4;
+      } else {
+        s.points.append(p);
+      }
+    }
+    page.strokes.push_back(std::move(s));
+  }
+  QByteArray cbor;
+  if (!r.getBytes(cbor))
+    return false;
+  decodeObjects(cbor, page);
+  return true;
+}
+
+QByteArray encodeImage(const QImage &img) {
+  QByteArray bytes;
+  if (img.isNull())
+    return bytes;
+  QBuffer buf(&bytes);
+  if (!buf.open(QIODevice::WriteOnly) || !img.save(&buf, "PNG"))
+    bytes.clear();
+  return bytes;
+}
+
+} // namespace BnoteCodec
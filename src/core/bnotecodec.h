@@ -0,0 +1,128 @@
+#pragma once
+#include "Note.h"
+#include <QByteArray>
+#include <QImage>
+#include <QtEndian>
+#include <cstring>
+
+/// Little-endian building blocks shared by the .bnote container (BnoteFile)
+/// and its edit journal (NoteJournal).
+namespace BnoteCodec {
+
+quint32 crc32(const QByteArray &data);
+
+inline quint32 floatBits(float v) {
+    quint32 bits;
+    std::memcpy(&bits, &v, sizeof bits);
+    return bits;
+}
+
+inline float readF32(const char *p) {
+    const quint32 bits = qFromLittleEndian<quint32>(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof v);
+    return v;
+}
+
+class ByteWriter {
+public:
+    QByteArray buf;
+
+    template <typename T> void put(T v) {
+        const qsizetype at = buf.size();
+        buf.resize(at + qsizetype(sizeof(T)));
+        qToLittleEndian<T>(v, buf.data() + at);
+    }
+    void putF32(double v) { put<quint32>(floatBits(float(v))); }
+    void putBytes(const QByteArray &b) {
+        put<quint32>(quint32(b.size()));
+        buf.append(b);
+    }
+    void putString(const QString &s) { putBytes(s.toUtf8()); }
+
+    /// Packed float32 x/y pairs.
+    void putPoints(const StrokePoints &pts) {
+        const qsizetype at = buf.size();
+        buf.resize(at + pts.size() * 8);
+        char *d = buf.data() + at;
+        for (const QPointF &p : pts) {
+            qToLittleEndian<quint32>(floatBits(float(p.x())), d);
+            qToLittleEndian<quint32>(floatBits(float(p.y())), d + 4);
+            d += 8;
+        }
+    }
+    /// Packed float32 pressures, one per point.
+    void putPressures(const StrokePoints &pts) {
+        const qsizetype at = buf.size();
+        buf.resize(at + pts.size() * 4);
+        char *d = buf.data() + at;
+        for (auto it = pts.begin(); it != pts.end(); ++it) {
+            qToLittleEndian<quint32>(floatBits(float(it.pressure())), d);
+            d += 4;
+        }
+    }
+};
+
+class ByteReader {
+public:
+    ByteReader(const char *data, qsizetype size) : m_data(data), m_size(size) {}
+
+    template <typename T> bool get(T &v) {
+        const char *p = take(qsizetype(sizeof(T)));
+        if (!p)
+            return false;
+        v = qFromLittleEndian<T>(p);
+        return true;
+    }
+    bool getF32(float &v) {
+        quint32 bits = 0;
+        if (!get(bits))
+            return false;
+        std::memcpy(&v, &bits, sizeof v);
+        return true;
+    }
+    bool getBytes(QByteArray &out) {
+        quint32 n = 0;
+        if (!get(n))
+            return false;
+        const char *p = take(qsizetype(n));
+        if (!p)
+            return false;
+        out = QByteArray(p, qsizetype(n));
+        return true;
+    }
+    bool getString(QString &out) {
+        QByteArray raw;
+        if (!getBytes(raw))
+            return false;
+        out = QString::fromUtf8(raw);
+        return true;
+    }
+    /// Pointer to the next n bytes (nullptr if the buffer is too short).
+    const char *take(qsizetype n) {
+        if (n < 0 || m_size - m_pos < n)
+            return nullptr;
+        const char *p = m_data + m_pos;
+        m_pos += n;
+        return p;
+    }
+    bool atEnd() const { return m_pos >= m_size; }
+
+private:
+    const char *m_data;
+    qsizetype m_size;
+    qsizetype m_pos{0};
+};
+
+/// Page content chunk: strokes as packed float32 arrays, then graphs/stickies/
+/// texts as a length-prefixed CBOR blob. Empty page = empty chunk.
+QByteArray encodeContent(const NotePage &page);
+bool decodeContent(const QByteArray &bytes, NotePage &page);
+
+/// Only the CBOR object blob of a content chunk (empty if the page has none).
+QByteArray encodeObjects(const NotePage &page);
+void decodeObjects(const QByteArray &cbor, NotePage &page);
+
+QByteArray encodeImage(const QImage &img);
+
+} // namespace BnoteCodec
@@ -0,0 +1,553 @@
+#include "bnotefile.h"
+#include "bnotecodec.h"
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace {
+
+using namespace BnoteCodec;
+
+constexpr char kMagic[BnoteFile::kMagicSize] = {'B', 'N', 'O', 'T'};
+constexpr int kHeaderSize = 32;
+constexpr quint32 kTocMagic = 0x31434f54; // "TOC1"
+
+enum PageFlags : quint8 {
+  PageBookmarked = 1,
+  PagePaperValid = 2,
+};
+
+struct ChunkRef {
+  quint64 offset{0};
+  quint32 size{0};
+  quint32 crc{0};
+};
+
+void putRef(ByteWriter &w, const ChunkRef &r) {
+  w.put<quint64>(r.offset);
+  w.put<quint32>(r.size);
+  w.put<quint32>(r.crc);
+}
+
+bool getRef(ByteReader &r, ChunkRef &out) {
+  return r.get(out.offset) && r.get(out.size) && r.get(out.crc);
+}
+
+struct PageEntry {
+  ChunkRef content;
+  ChunkRef image;
+  qint32 strokeCount{-1}; ///< from the toc; -1 in files written without it
+  /// Bytes pulled into memory before a save replaced the file without
+  /// carrying this page over (e.g. a deleted page kept alive by undo).
+  bool detached{false};
+  QByteArray detachedContent;
+  QByteArray detachedImage;
+};
+
+/// One opened v2 file. Shared by the payloads of all its pages; the mutex
+/// serialises page reads (UI thread) against saves (worker thread) that
+/// replace the file and move the chunks.
+class BnoteSource {
+public:
+  QMutex mutex;
+  QString path; ///< absolute
+  QVector<PageEntry> entries;
+
+  /// Caller holds `mutex`. `verify` = false accepts a full-size chunk whose
+  /// CRC does not match (salvaging a damaged page).
+  bool readChunkLocked(const ChunkRef &ref, QByteArray *out,
+                       bool verify = true) const {
+    out->clear();
+    if (ref.size == 0)
+      return true;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly) || !f.seek(qint64(ref.offset)))
+      return false;
+    *out = f.read(qint64(ref.size));
+    return out->size() == qsizetype(ref.size) &&
+           (!verify || crc32(*out) == ref.crc);
+  }
+
+  /// `image` may be null (content chunk only).
+  bool readRaw(int entry, QByteArray *content, QByteArray *image) {
+    QMutexLocker lock(&mutex);
+    if (entry < 0 || entry >= entries.size())
+      return false;
+    const PageEntry &e = entries[entry];
+    if (e.detached) {
+      *content = e.detachedContent;
+      if (image)
+        *image = e.detachedImage;
+      return true;
+    }
+    return readChunkLocked(e.content, content) &&
+           (!image || readChunkLocked(e.image, image));
+  }
+
+  /// Per chunk and without the CRC check; a chunk that cannot be read in
+  /// full comes back empty.
+  void readUnverified(int entry, QByteArray *content, QByteArray *image) {
+    QMutexLocker lock(&mutex);
+    content->clear();
+    image->clear();
+    if (entry < 0 || entry >= entries.size())
+      return;
+    const PageEntry &e = entries[entry];
+    if (e.detached) {
+      *content = e.detachedContent;
+      *image = e.detachedImage;
+      return;
+    }
+    if (!readChunkLocked(e.content, content, false))
+      content->clear();
+    if (!readChunkLocked(e.image, image, false))
+      image->clear();
+  }
+};
+
+struct SourceRegistry {
+  QMutex mutex;
+  std::vector<std::weak_ptr<BnoteSource>> sources;
+};
+
+SourceRegistry &sourceRegistry() {
+  static SourceRegistry r;
+  return r;
+}
+
+void registerSource(const std::shared_ptr<BnoteSource> &src) {
+  SourceRegistry &r = sourceRegistry();
+  QMutexLocker lock(&r.mutex);
+  r.sources.erase(std::remove_if(r.sources.begin(), r.sources.end(),
+                                 [](const std::weak_ptr<BnoteSource> &w) {
+                                   return w.expired();
+                                 }),
+                  r.sources.end());
+  r.sources.push_back(src);
+}
+
+/// Every live source still reading from `absPath` (including ones only
+/// referenced by undo snapshots).
+std::vector<std::shared_ptr<BnoteSource>> sourcesForPath(const QString &absPath) {
+  std::vector<std::shared_ptr<BnoteSource>> out;
+  SourceRegistry &r = sourceRegistry();
+  QMutexLocker lock(&r.mutex);
+  for (const auto &w : r.sources) {
+    if (auto s = w.lock()) {
+      if (s->path == absPath)
+        out.push_back(std::move(s));
+    }
+  }
+  std::sort(out.begin(), out.end()); // fixed lock order
+  return out;
+}
+
+class BnotePagePayload : public NotePagePayload {
+public:
+  BnotePagePayload(std::shared_ptr<BnoteSource> source, int entry)
+      : m_source(std::move(source)), m_entry(entry) {}
+
+  bool loadInto(NotePage &page) const override {
+    QByteArray content;
+    QByteArray image;
+    if (!readRaw(&content, &image) || !decodeContent(content, page)) {
+      qWarning() << "BnoteFile: page chunk unreadable" << m_source->path
+                 << m_entry;
+      return false;
+    }
+    page.backgroundImage = QImage();
+    if (!image.isEmpty() && !page.backgroundImage.loadFromData(image, "PNG"))
+      qWarning() << "BnoteFile: background image unreadable" << m_source->path
+                 << m_entry;
+    return true;
+  }
+
+  bool loadContent(NotePage &page) const override {
+    QByteArray content;
+    return m_source->readRaw(m_entry, &content, nullptr) &&
+           decodeContent(content, page);
+  }
+
+  bool readRaw(QByteArray *content, QByteArray *image) const {
+    return m_source->readRaw(m_entry, content, image);
+  }
+  void readUnverified(QByteArray *content, QByteArray *image) const {
+    m_source->readUnverified(m_entry, content, image);
+  }
+
+  int strokeCount() const override {
+    QMutexLocker lock(&m_source->mutex);
+    if (m_entry < 0 || m_entry >= m_source->entries.size())
+      return -1;
+    return m_source->entries[m_entry].strokeCount;
+  }
+
+  quint64 revision() const override {
+    QMutexLocker lock(&m_source->mutex);
+    if (m_entry < 0 || m_entry >= m_source->entries.size())
+      return 0;
+    const PageEntry &e = m_source->entries[m_entry];
+    if (e.detached)
+      return (quint64(crc32(e.detachedContent)) << 32) | crc32(e.detachedImage);
+    return (quint64(e.content.crc) << 32) | e.image.crc;
+  }
+  const std::shared_ptr<BnoteSource> &source() const { return m_source; }
+  int entry() const { return m_entry; }
+
+private:
+  std::shared_ptr<BnoteSource> m_source;
+  int m_entry;
+};
+
+/// A page that so far is only its background (PDF import). Keeps the PNG
+/// instead of the decoded image; write() stores the bytes as they are.
+class EncodedImagePayload : public NotePagePayload {
+public:
+  explicit EncodedImagePayload(QByteArray png)
+      : m_png(std::move(png)), m_crc(crc32(m_png)) {}
+
+  bool loadInto(NotePage &page) const override {
+    loadContent(page);
+    page.backgroundImage = QImage();
+    if (!m_png.isEmpty() && !page.backgroundImage.loadFromData(m_png, "PNG")) {
+      qWarning() << "BnoteFile: imported background unreadable";
+      return false;
+    }
+    return true;
+  }
+
+  bool loadContent(NotePage &page) const override {
+    page.strokes.clear();
+    page.graphs.clear();
+    page.stickies.clear();
+    page.texts.clear();
+    return true;
+  }
+
+  quint64 revision() const override { return m_crc ? m_crc : 1; }
+  int strokeCount() const override { return 0; }
+  QByteArray backgroundPng() const override { return m_png; }
+
+private:
+  QByteArray m_png;
+  quint32 m_crc;
+};
+
+} // namespace
+
+bool BnoteFile::isChunked(const QByteArray &head) {
+  return head.size() >= kMagicSize &&
+         std::memcmp(head.constData(), kMagic, kMagicSize) == 0;
+}
+
+bool BnoteFile::peekCover(const QString &path, int *backgroundType,
+                          QColor *paper) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  const QByteArray head = f.read(kHeaderSize);
+  if (head.size() < kHeaderSize || !isChunked(head))
+    return false;
+  const char *d = head.constData();
+  if (backgroundType)
+    *backgroundType = quint8(d[24]);
+  if (paper && (quint8(d[25]) & PagePaperValid))
+    *paper = QColor::fromRgba(qFromLittleEndian<quint32>(d + 26));
+  return true;
+}
+
+quint64 BnoteFile::stamp(const QString &path) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly))
+    return 0;
+  const QByteArray head = f.read(kHeaderSize);
+  if (head.size() < kHeaderSize || !isChunked(head))
+    return 0;
+  const quint64 tocOffset = qFromLittleEndian<quint64>(head.constData() + 8);
+  const quint32 tocCrc = qFromLittleEndian<quint32>(head.constData() + 20);
+  // Content only: a sync client touching the file must not orphan the
+  // journal.
+  const quint64 s = (quint64(tocCrc) << 32) ^ tocOffset;
+  return s ? s : 1;
+}
+
+std::shared_ptr<const NotePagePayload>
+BnoteFile::imagePayload(QByteArray png) {
+  return std::make_shared<EncodedImagePayload>(std::move(png));
+}
+
+bool BnoteFile::read(const QString &path, Note &out) {
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  const qint64 fileSize = f.size();
+  const QByteArray head = f.read(kHeaderSize);
+  if (head.size() < kHeaderSize || !isChunked(head))
+    return false;
+  const char *d = head.constData();
+  const quint16 version = qFromLittleEndian<quint16>(d + 4);
+  if (version > kVersion) {
+    qWarning() << "BnoteFile: unsupported version" << version << path;
+    return false;
+  }
+  const quint64 tocOffset = qFromLittleEndian<quint64>(d + 8);
+  const quint32 tocSize = qFromLittleEndian<quint32>(d + 16);
+  const quint32 tocCrc = qFromLittleEndian<quint32>(d + 20);
+  if (tocOffset < quint64(kHeaderSize) || tocOffset + tocSize > quint64(fileSize) ||
+      !f.seek(qint64(tocOffset)))
+    return false;
+  const QByteArray toc = f.read(qint64(tocSize));
+  if (toc.size() != qsizetype(tocSize) || crc32(toc) != tocCrc) {
+    qWarning() << "BnoteFile: damaged table of contents" << path;
+    return false;
+  }
+
+  ByteReader r(toc.constData(), toc.size());
+  quint32 magic = 0;
+  quint32 tagCount = 0;
+  if (!r.get(magic) || magic != kTocMagic || !r.getString(out.id) ||
+      !r.getString(out.title) || !r.get(tagCount))
+    return false;
+  out.tags.clear();
+  for (quint32 i = 0; i < tagCount; ++i) {
+    QString t;
+    if (!r.getString(t))
+      return false;
+    out.tags.append(t);
+  }
+  quint32 pageCount = 0;
+  if (!r.get(pageCount) || pageCount > quint32(toc.size()))
+    return false;
+
+  auto source = std::make_shared<BnoteSource>();
+  source->path = QFileInfo(path).absoluteFilePath();
+  source->entries.resize(int(pageCount));
+  out.pages.clear();
+  out.pages.resize(int(pageCount));
+  for (quint32 i = 0; i < pageCount; ++i) {
+    NotePage &pg = out.pages[int(i)];
+    PageEntry &e = source->entries[int(i)];
+    qint32 bg = 2;
+    quint32 paper = 0;
+    qint32 rot = 0;
+    quint8 flags = 0;
+    if (!r.getString(pg.title) || !r.get(bg) || !r.get(paper) || !r.get(rot) ||
+        !r.get(flags))
+      return false;
+    if (version >= 3) {
+      qint32 pdfPage = -1;
+      if (!r.getBytes(pg.pdf.doc) || !r.get(pdfPage))
+        return false;
+      pg.pdf.page = pdfPage;
+    }
+    if (!getRef(r, e.content) || !getRef(r, e.image))
+      return false;
+    if (e.content.offset + e.content.size > quint64(fileSize) ||
+        e.image.offset + e.image.size > quint64(fileSize))
+      return false;
+    pg.backgroundType = bg;
+    if (flags & PagePaperValid)
+      pg.paperColor = QColor::fromRgba(paper);
+    pg.rotationDegrees = rot;
+    pg.bookmarked = flags & PageBookmarked;
+    if (e.content.size > 0 || e.image.size > 0)
+      pg.pendingPayload = std::make_shared<BnotePagePayload>(source, int(i));
+  }
+  // Stroke counts trail the page entries; absent in older files.
+  if (!r.atEnd()) {
+    for (PageEntry &e : source->entries) {
+      quint32 strokes = 0;
+      if (!r.get(strokes))
+        return false;
+      e.strokeCount = qint32(qMin<quint32>(strokes, quint32(INT_MAX)));
+    }
+  }
+  registerSource(source);
+  return true;
+}
+
+bool BnoteFile::write(const Note &note, const QString &path,
+                      QStringList *problems) {
+  const QString absPath = QFileInfo(path).absoluteFilePath();
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  if (file.write(QByteArray(kHeaderSize, '\0')) != kHeaderSize)
+    return false;
+
+  quint64 pos = kHeaderSize;
+  auto writeChunk = [&](const QByteArray &bytes, ChunkRef &ref) {
+    ref = ChunkRef();
+    if (bytes.isEmpty())
+      return true;
+    ref.offset = pos;
+    ref.size = quint32(bytes.size());
+    ref.crc = crc32(bytes);
+    pos += ref.size;
+    return file.write(bytes) == bytes.size();
+  };
+
+  const bool withPdf =
+      std::any_of(note.pages.cbegin(), note.pages.cend(),
+                  [](const NotePage &p) { return p.pdf.isValid(); });
+  const quint16 version = withPdf ? 3 : 2;
+
+  ByteWriter toc;
+  toc.put<quint32>(kTocMagic);
+  toc.putString(note.id);
+  toc.putString(note.title);
+  toc.put<quint32>(quint32(note.tags.size()));
+  for (const QString &t : note.tags)
+    toc.putString(t);
+  toc.put<quint32>(quint32(note.pages.size()));
+
+  // Chunks copied verbatim from a source that this save is about to replace.
+  std::map<BnoteSource *, QHash<int, PageEntry>> moved;
+  QVector<quint32> strokeCounts;
+  strokeCounts.reserve(note.pages.size());
+  for (int pageIndex = 0; pageIndex < note.pages.size(); ++pageIndex) {
+    const NotePage &page = note.pages[pageIndex];
+    QByteArray content;
+    QByteArray image;
+    const auto lazy =
+        std::dynamic_pointer_cast<const BnotePagePayload>(page.pendingPayload);
+    const QByteArray png =
+        page.pendingPayload ? page.pendingPayload->backgroundPng() : QByteArray();
+    if (lazy) {
+      if (!lazy->readRaw(&content, &image)) {
+        // Damaged on disk. Failing the save would fail every later save and
+        // fold of this note too, so keep what still decodes and report it.
+        lazy->readUnverified(&content, &image);
+        NotePage probe;
+        QImage background;
+        QString problem;
+        if (!decodeContent(content, probe)) {
+          content = encodeContent(page);
+          problem = QStringLiteral("page %1: content unreadable, saved empty")
+                        .arg(pageIndex + 1);
+        } else {
+          problem = QStringLiteral("page %1: checksum mismatch, content kept")
+                        .arg(pageIndex + 1);
+        }
+        if (!image.isEmpty() && !background.loadFromData(image, "PNG")) {
+          image.clear();
+          problem += QStringLiteral(", background image dropped");
+        }
+        qWarning() << "BnoteFile: damaged page in" << lazy->source()->path
+                   << problem;
+        if (problems)
+          problems->append(problem);
+      }
+    } else if (!png.isEmpty()) {
+      content = encodeContent(page);
+      image = png;
+    } else if (page.pendingPayload) {
+      NotePage loaded = page;
+      if (!loaded.ensureLoaded())
+        return false;
+      content = encodeContent(loaded);
+      image = encodeImage(loaded.backgroundImage);
+    } else {
+      content = encodeContent(page);
+      image = encodeImage(page.backgroundImage);
+    }
+    PageEntry e;
+    if (!writeChunk(content, e.content) || !writeChunk(image, e.image))
+      return false;
+    // The content chunk leads with its stroke count (see encodeContent), so
+    // raw copies of unloaded pages need no decoding either.
+    e.strokeCount = content.size() >= 4
+                        ? qint32(qMin<quint32>(
+                              qFromLittleEndian<quint32>(content.constData()),
+                              quint32(INT_MAX)))
+                        : 0;
+    strokeCounts.append(quint32(e.strokeCount));
+    if (lazy && lazy->source()->path == absPath)
+      moved[lazy->source().get()].insert(lazy->entry(), e);
+
+    quint8 flags = 0;
+    if (page.bookmarked)
+      flags |= PageBookmarked;
+    if (page.paperColor.isValid())
+      flags |= PagePaperValid;
+    toc.putString(page.title);
+    toc.put<qint32>(page.backgroundType);
+    toc.put<quint32>(page.paperColor.isValid() ? page.paperColor.rgba() : 0u);
+    toc.put<qint32>(page.rotationDegrees);
+    toc.put<quint8>(flags);
+    if (version >= 3) {
+      toc.putBytes(page.pdf.isValid() ? page.pdf.doc : QByteArray());
+      toc.put<qint32>(page.pdf.isValid() ? page.pdf.page : -1);
+    }
+    putRef(toc, e.content);
+    putRef(toc, e.image);
+  }
+  for (quint32 strokes : strokeCounts)
+    toc.put<quint32>(strokes);
+  if (file.write(toc.buf) != toc.buf.size())
+    return false;
+
+  ByteWriter header;
+  header.buf.append(kMagic, kMagicSize);
+  header.put<quint16>(version);
+  header.put<quint16>(0);
+  header.put<quint64>(pos);
+  header.put<quint32>(quint32(toc.buf.size()));
+  header.put<quint32>(crc32(toc.buf));
+  const NotePage *cover = note.pages.isEmpty() ? nullptr : &note.pages.first();
+  header.put<quint8>(cover ? quint8(qBound(0, cover->backgroundType, 255)) : 2);
+  header.put<quint8>(cover && cover->paperColor.isValid() ? PagePaperValid : 0);
+  header.put<quint32>(cover && cover->paperColor.isValid()
+                          ? cover->paperColor.rgba()
+                          : 0u);
+  header.buf.append(QByteArray(kHeaderSize - header.buf.size(), '\0'));
+  if (!file.seek(0) || file.write(header.buf) != kHeaderSize)
+    return false;
+
+  // commit() replaces the file the old offsets point into. Hold every source
+  // of this path across the swap: carried-over entries get their new
+  // offsets, everything else is pulled into memory while it is still there.
+  const auto sources = sourcesForPath(absPath);
+  for (const auto &src : sources)
+    src->mutex.lock();
+  for (const auto &src : sources) {
+    const auto it = moved.find(src.get());
+    for (int i = 0; i < src->entries.size(); ++i) {
+      PageEntry &e = src->entries[i];
+      if (e.detached || (it != moved.end() && it->second.contains(i)))
+        continue;
+      if (src->readChunkLocked(e.content, &e.detachedContent) &&
+          src->readChunkLocked(e.image, &e.detachedImage))
+        e.detached = true;
+    }
+  }
+  const bool ok = file.commit();
+  if (ok) {
+    for (const auto &src : sources) {
+      const auto it = moved.find(src.get());
+      if (it == moved.end())
+        continue;
+      for (auto e = it->second.cbegin(); e != it->second.cend(); ++e) {
+        PageEntry &entry = src->entries[e.key()];
+        entry.content = e.value().content;
+        entry.image = e.value().image;
+        entry.strokeCount = e.value().strokeCount;
+        entry.detached = false;
+        entry.detachedContent.clear();
+        entry.detachedImage.clear();
+      }
+    }
+  }
+  for (const auto &src : sources)
+    src->mutex.unlock();
+  return ok;
+}
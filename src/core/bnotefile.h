@@ -0,0 +1,51 @@
+#pragma once
+#include "Note.h"
+#include <QByteArray>
+#include <QColor>
+#include <QString>
+#include <QStringList>
+
+/// Chunked binary .bnote container (format v2).
+///
+///   header  "BNOT" u16 version u16 flags (0) u64 tocOffset u32 tocSize
+///           u32 tocCrc u8 coverBg u8 coverFlags (page flags of the first
+///           page, PagePaperValid only) u32 coverPaper (ARGB), zero padded
+///           -- fixed 32 bytes
+///   chunks  per page: content chunk (strokes as packed float32 x/y/pressure
+///           arrays + graphs/stickies/texts as CBOR), optional PNG blob
+///   toc     note id/title/tags, per page: metadata + offset/size/CRC32 of
+///           its chunk and image blob; v3 adds the page's PDF source
+///           (document hash, page) after the metadata. Then one u32 stroke
+///           count per page, which older readers never get to (files
+///           without it report unknown counts)
+///
+/// All integers little endian. read() only parses header and toc; page
+/// content becomes NotePage::pendingPayload and is read on first access.
+/// v1 notes (one JSON document) are handled by NoteManager.
+class BnoteFile {
+public:
+    static constexpr int kMagicSize = 4;
+    /// Newest version read. Notes without PDF pages are still written as
+    /// v2, so older builds keep opening them.
+    static constexpr quint16 kVersion = 3;
+
+    static bool isChunked(const QByteArray& head);
+    /// Cover look (first page) straight from the header, for library tiles.
+    static bool peekCover(const QString& path, int* backgroundType, QColor* paper);
+    /// Identifies one written state of the file (toc position and CRC);
+    /// 0 if `path` is no v2 file. NoteJournal ties its records to it.
+    static quint64 stamp(const QString& path);
+
+    /// Pending content of a page that holds nothing but a PNG background
+    /// (PDF import): decoded on first access, saved without re-encoding.
+    static std::shared_ptr<const NotePagePayload> imagePayload(QByteArray png);
+
+    static bool read(const QString& path, Note& out);
+    /// Writes atomically (QSaveFile). Unloaded pages are copied as raw chunks;
+    /// when overwriting their own source file, their payloads are re-pointed
+    /// at the new file. A page whose chunk no longer reads back is salvaged
+    /// (or saved empty) instead of failing the save; `problems` gets one
+    /// line per such page.
+    static bool write(const Note& note, const QString& path,
+                      QStringList* problems = nullptr);
+};
@@ -84,12 +84,16 @@ void NoteEditor::showOverflowMenuFromAnchor(QWidget *anchor) {
                           const QString path = dir + QStringLiteral("/Blop_%1.pdf")
                               .arg(QDateTime::currentDateTime().toString(
                                   QStringLiteral("yyyyMMdd_HHmmss")));
-                          const bool ok = safeNote->canvas_->exportNoteToPdf(path);
-                          BlopDialogs::notify(
-                              safeNote, ok ? QStringLiteral("Exportiert")
-                                           : QStringLiteral("Fehler"),
-                              ok ? QStringLiteral("PDF gespeichert:\n%1").arg(path)
-                                 : QStringLiteral("PDF konnte nicht gespeichert werden."));
+                          const auto report = [safeNote, path](bool ok) {
+                              if (!safeNote) return;
+                              BlopDialogs::notify(
+                                  safeNote, ok ? QStringLiteral("Exportiert")
+                                               : QStringLiteral("Fehler"),
+                                  ok ? QStringLiteral("PDF gespeichert:\n%1").arg(path)
+                                     : QStringLiteral("PDF konnte nicht gespeichert werden."));
+                          };
+                          if (!safeNote->canvas_->exportNoteToPdf(path, report))
+                              report(false);
                       },
                       false, false});
         items.append({QStringLiteral("Als Bild exportieren"),
@@ -102,12 +106,16 @@ void NoteEditor::showOverflowMenuFromAnchor(QWidget *anchor) {
                           const QString path = dir + QStringLiteral("/Blop_%1.png")
                               .arg(QDateTime::currentDateTime().toString(
                                   QStringLiteral("yyyyMMdd_HHmmss")));
-                          const bool ok = safeNote->canvas_->exportNoteToPng(path);
-                          BlopDialogs::notify(
-                              safeNote, ok ? QStringLiteral("Exportiert")
-                                           : QStringLiteral("Fehler"),
-                              ok ? QStringLiteral("Bild gespeichert:\n%1").arg(path)
-                                 : QStringLiteral("Bild konnte nicht gespeichert werden."));
+                          const auto report = [safeNote, path](bool ok) {
+                              if (!safeNote) return;
+                              BlopDialogs::notify(
+                                  safeNote, ok ? QStringLiteral("Exportiert")
+                                               : QStringLiteral("Fehler"),
+                                  ok ? QStringLiteral("Bild gespeichert:\n%1").arg(path)
+                                     : QStringLiteral("Bild konnte nicht gespeichert werden."));
+                          };
+                          if (!safeNote->canvas_->exportNoteToPng(path, report))
+                              report(false);
                       },
                       false, false});
         items.append({QStringLiteral("PDF importieren"),
@@ -119,18 +127,14 @@ void NoteEditor::showOverflowMenuFromAnchor(QWidget *anchor) {
                               [safeNote](const QString &localPath) {
                                   if (localPath.isEmpty() || !safeNote || !safeNote->canvas_)
                                       return;
-                                  const bool ok = safeNote->canvas_->importPdfPages(localPath);
-                                  BlopDialogs::notify(
-                                      safeNote,
-                                      ok ? QStringLiteral("Importiert")
-                                         : QStringLiteral("Fehler"),
-                                      ok ? QStringLiteral(
-                                               "PDF wurde seitenweise importiert.\n"
-                                               "Jede PDF-Seite erscheint als eigene Notizseite.")
-                                         : QStringLiteral(
-                                               "PDF konnte nicht importiert werden.\n"
-                                               "Bitte stelle sicher, dass Qt mit "
-                                               "PDF-Unterstützung kompiliert ist."));
+                                  // Success shows as the import's own progress card.
+                                  if (!safeNote->canvas_->importPdfPages(localPath))
+                                      BlopDialogs::notify(
+                                          safeNote, QStringLiteral("Fehler"),
+                                          QStringLiteral(
+                                              "PDF konnte nicht importiert werden.\n"
+                                              "Bitte stelle sicher, dass Qt mit "
+                                              "PDF-Unterstützung kompiliert ist."));
                               });
                       },
                       false, false});
@@ -220,13 +224,18 @@ void NoteEditor::showOverflowMenuFromAnchor(QWidget *anchor) {
             QStringLiteral("PDF Dokument (*.pdf)"));
         if (path.isEmpty() || !safe || !safe->canvas_)
             return;
-        bool ok = safe->canvas_->exportNoteToPdf(path);
-        if (ok)
-            QMessageBox::information(safe, QStringLiteral("Exportiert"),
-                                     QStringLiteral("PDF wurde gespeichert!"));
-        else
-            QMessageBox::warning(safe, QStringLiteral("Fehler"),
-                                 QStringLiteral("PDF konnte nicht gespeichert werden."));
+        const auto report = [safe](bool ok) {
+            if (!safe)
+                return;
+            if (ok)
+                QMessageBox::information(safe, QStringLiteral("Exportiert"),
+                                         QStringLiteral("PDF wurde gespeichert!"));
+            else
+                QMessageBox::warning(safe, QStringLiteral("Fehler"),
+                                     QStringLiteral("PDF konnte nicht gespeichert werden."));
+        };
+        if (!safe->canvas_->exportNoteToPdf(path, report))
+            report(false);
     });
 
     QAction *actExportImg =
@@ -241,13 +250,18 @@ void NoteEditor::showOverflowMenuFromAnchor(QWidget *anchor) {
             QStringLiteral("Bilder (*.png *.jpg)"));
         if (path.isEmpty() || !safe || !safe->canvas_)
             return;
-        bool ok = safe->canvas_->exportNoteToPng(path);
-        if (ok)
-            QMessageBox::information(safe, QStringLiteral("Exportiert"),
-                                     QStringLiteral("Bild wurde gespeichert!"));
-        else
-            QMessageBox::warning(safe, QStringLiteral("Fehler"),
-                                 QStringLiteral("Bild konnte nicht gespeichert werden."));
+        const auto report = [safe](bool ok) {
+            if (!safe)
+                return;
+            if (ok)
+                QMessageBox::information(safe, QStringLiteral("Exportiert"),
+                                         QStringLiteral("Bild wurde gespeichert!"));
+            else
+                QMessageBox::warning(safe, QStringLiteral("Fehler"),
+                                     QStringLiteral("Bild konnte nicht gespeichert werden."));
+        };
+        if (!safe->canvas_->exportNoteToPng(path, report))
+            report(false);
     });
 
     menu->addSeparator();
@@ -262,14 +276,8 @@ void NoteEditor::showOverflowMenuFromAnchor(QWidget *anchor) {
             QStringLiteral("PDF Dokument (*.pdf)"));
         if (path.isEmpty() || !safe || !safe->canvas_)
             return;
-        bool ok = safe->canvas_->importPdfPages(path);
-        if (ok)
-            QMessageBox::information(
-                safe, QStringLiteral("Importiert"),
-                QStringLiteral(
-                    "PDF wurde seitenweise importiert.\nJede PDF-Seite erscheint als "
-                    "eigene Notizseite."));
-        else
+        // Success shows as the import's own progress card.
+        if (!safe->canvas_->importPdfPages(path))
             QMessageBox::warning(
                 safe, QStringLiteral("Fehler"),
                 QStringLiteral(
@@ -0,0 +1,638 @@
+#include "notejournal.h"
+#include "bnotecodec.h"
+#include "bnotefile.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+
+using namespace BnoteCodec;
+
+constexpr quint32 kJournalMagic = 0x314a4e42; // "BNJ1"
+constexpr qint64 kHeaderSize = 12;
+constexpr qint64 kRecordHeaderSize = 8;
+/// Fold once the journal exceeds half the main file, within these bounds.
+constexpr qint64 kMinFoldBytes = 256 * 1024;
+constexpr qint64 kMaxFoldBytes = 8 * 1024 * 1024;
+
+enum OpType : quint8 {
+  OpNoteMeta = 1,     // title, tags
+  OpPageTable = 2,    // u32 count, i32 previous index per page (-1 = blank)
+  OpPageMeta = 3,     // u32 page, title, bg, paper, rotation, flags
+  OpStrokeSplice = 4, // u32 page, u32 at, u32 removed, chunk of inserted strokes
+  OpPageObjects = 5,  // u32 page, CBOR objects
+  OpPageImage = 6,    // u32 page, PNG
+  OpPageContent = 7,  // u32 page, content chunk, PNG
+  OpPagePdf = 8,      // u32 page, PDF document hash, i32 PDF page
+};
+
+enum PageFlags : quint8 {
+  PageBookmarked = 1,
+  PagePaperValid = 2,
+};
+
+/// Canonical form of `path`, also once it has been moved away: the deepest
+/// folder that still exists is resolved, the rest is appended as it is.
+QString canonicalNotePath(const QString &path) {
+  const QString abs = QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+  QString head = abs;
+  QString tail;
+  while (!QFileInfo::exists(head)) {
+    const qsizetype slash = head.lastIndexOf(QLatin1Char('/'));
+    if (slash <= 0)
+      return abs;
+    tail.prepend(head.mid(slash));
+    head.truncate(slash);
+  }
+  const QString canonical = QFileInfo(head).canonicalFilePath();
+  return canonical.isEmpty() ? abs : canonical + tail;
+}
+
+/// Every .bnote at or below `path`, relative to it ("" for `path` itself).
+QStringList notesAt(const QString &path) {
+  if (!QFileInfo(path).isDir())
+    return {QString()};
+  QStringList out;
+  QDirIterator it(path, {QStringLiteral("*.bnote")}, QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext())
+    out.append(it.next().mid(path.size()));
+  return out;
+}
+
+QByteArray journalHeader(quint64 stamp) {
+  ByteWriter w;
+  w.put<quint32>(kJournalMagic);
+  w.put<quint64>(stamp);
+  return w.buf;
+}
+
+/// Walks the records behind the header until one is torn, damaged or
+/// rejected by `apply`. Returns the length of the good prefix, or -1 if the
+/// journal belongs to another state of the main file.
+template <typename Fn>
+qint64 scanRecords(const QByteArray &data, quint64 stamp, Fn apply) {
+  if (data.size() < kHeaderSize)
+    return -1;
+  const char *d = data.constData();
+  if (qFromLittleEndian<quint32>(d) != kJournalMagic ||
+      qFromLittleEndian<quint64>(d + 4) != stamp)
+    return -1;
+  qint64 pos = kHeaderSize;
+  while (data.size() - pos >= kRecordHeaderSize) {
+    const quint32 size = qFromLittleEndian<quint32>(d + pos);
+    const quint32 crc = qFromLittleEndian<quint32>(d + pos + 4);
+    if (data.size() - pos - kRecordHeaderSize < qint64(size))
+      break;
+    const QByteArray ops =
+        QByteArray::fromRawData(d + pos + kRecordHeaderSize, qsizetype(size));
+    if (crc32(ops) != crc || !apply(ops))
+      break;
+    pos += kRecordHeaderSize + size;
+  }
+  return pos;
+}
+
+template <typename T>
+bool sameBuffer(const QVector<T> &a, const QVector<T> &b) {
+  return a.size() == b.size() && (a.isEmpty() || a.constData() == b.constData());
+}
+
+bool sameStroke(const Stroke &a, const Stroke &b) {
+  if (a.width != b.width || a.color != b.color || a.isEraser != b.isEraser ||
+      a.isHighlighter != b.isHighlighter)
+    return false;
+  return a.points.id() == b.points.id() || a.points == b.points;
+}
+
+bool sameObjects(const NotePage &a, const NotePage &b) {
+  if (sameBuffer(a.graphs, b.graphs) && sameBuffer(a.stickies, b.stickies) &&
+      sameBuffer(a.texts, b.texts))
+    return true;
+  // The view rebuilds these lists on every sync; compare the encoded form.
+  return encodeObjects(a) == encodeObjects(b);
+}
+
+bool sameImage(const QImage &a, const QImage &b) {
+  if (a.isNull() || b.isNull())
+    return a.isNull() == b.isNull();
+  return a.cacheKey() == b.cacheKey() || a == b;
+}
+
+bool sameMeta(const NotePage &a, const NotePage &b) {
+  return a.title == b.title && a.backgroundType == b.backgroundType &&
+         a.paperColor == b.paperColor &&
+         a.rotationDegrees == b.rotationDegrees && a.bookmarked == b.bookmarked;
+}
+
+void putMeta(ByteWriter &w, const NotePage &page) {
+  quint8 flags = 0;
+  if (page.bookmarked)
+    flags |= PageBookmarked;
+  if (page.paperColor.isValid())
+    flags |= PagePaperValid;
+  w.putString(page.title);
+  w.put<qint32>(page.backgroundType);
+  w.put<quint32>(page.paperColor.isValid() ? page.paperColor.rgba() : 0u);
+  w.put<qint32>(page.rotationDegrees);
+  w.put<quint8>(flags);
+}
+
+bool getMeta(ByteReader &r, NotePage &page) {
+  qint32 bg = 2;
+  quint32 paper = 0;
+  qint32 rot = 0;
+  quint8 flags = 0;
+  if (!r.getString(page.title) || !r.get(bg) || !r.get(paper) || !r.get(rot) ||
+      !r.get(flags))
+    return false;
+  page.backgroundType = bg;
+  page.paperColor = (flags & PagePaperValid) ? QColor::fromRgba(paper) : QColor();
+  page.rotationDegrees = rot;
+  page.bookmarked = flags & PageBookmarked;
+  return true;
+}
+
+/// What ties a page to its earlier self across moves: the payload while it
+/// is unread, afterwards the (implicitly shared) stroke buffer.
+const void *pageKey(const NotePage &page) {
+  if (page.pendingPayload)
+    return page.pendingPayload.get();
+  if (!page.strokes.isEmpty())
+    return page.strokes.constData();
+  return nullptr;
+}
+
+/// Ops turning `before` into `after` (page `index`). False if the content
+/// of `after` cannot be read, which leaves only a full save.
+bool diffPage(ByteWriter &w, quint32 index, NotePage before,
+              const NotePage &after) {
+  if (!sameMeta(before, after)) {
+    w.put<quint8>(OpPageMeta);
+    w.put<quint32>(index);
+    putMeta(w, after);
+  }
+  if (before.pdf != after.pdf) {
+    w.put<quint8>(OpPagePdf);
+    w.put<quint32>(index);
+    w.putBytes(after.pdf.doc);
+    w.put<qint32>(after.pdf.page);
+  }
+  auto putContent = [&](const NotePage &page) {
+    w.put<quint8>(OpPageContent);
+    w.put<quint32>(index);
+    w.putBytes(encodeContent(page));
+    w.putBytes(encodeImage(page.backgroundImage));
+  };
+  if (after.pendingPayload) {
+    if (before.pendingPayload == after.pendingPayload)
+      return true;
+    const QByteArray png = after.pendingPayload->backgroundPng();
+    if (!png.isEmpty()) {
+      w.put<quint8>(OpPageContent);
+      w.put<quint32>(index);
+      w.putBytes(encodeContent(after));
+      w.putBytes(png);
+      return true;
+    }
+    NotePage loaded = after;
+    if (!loaded.ensureLoaded())
+      return false;
+    putContent(loaded);
+    return true;
+  }
+  if (!before.ensureLoaded()) {
+    putContent(after);
+    return true;
+  }
+
+  const QVector<Stroke> &bs = before.strokes;
+  const QVector<Stroke> &as = after.strokes;
+  if (!sameBuffer(bs, as)) {
+    const int common = int(qMin(bs.size(), as.size()));
+    int prefix = 0;
+    while (prefix < common && sameStroke(bs[prefix], as[prefix]))
+      ++prefix;
+    int suffix = 0;
+    while (suffix < common - prefix &&
+           sameStroke(bs[bs.size() - 1 - suffix], as[as.size() - 1 - suffix]))
+      ++suffix;
+    const int removed = int(bs.size()) - prefix - suffix;
+    const int inserted = int(as.size()) - prefix - suffix;
+    if (removed > 0 || inserted > 0) {
+      NotePage added;
+      added.strokes = as.mid(prefix, inserted);
+      w.put<quint8>(OpStrokeSplice);
+      w.put<quint32>(index);
+      w.put<quint32>(quint32(prefix));
+      w.put<quint32>(quint32(removed));
+      w.putBytes(encodeContent(added));
+    }
+  }
+  if (!sameObjects(before, after)) {
+    w.put<quint8>(OpPageObjects);
+    w.put<quint32>(index);
+    w.putBytes(encodeObjects(after));
+  }
+  if (!sameImage(before.backgroundImage, after.backgroundImage)) {
+    w.put<quint8>(OpPageImage);
+    w.put<quint32>(index);
+    w.putBytes(encodeImage(after.backgroundImage));
+  }
+  return true;
+}
+
+bool applyPageOp(quint8 type, ByteReader &r, NotePage &page) {
+  if (type == OpPageMeta)
+    return getMeta(r, page);
+  if (type == OpPagePdf) {
+    qint32 pdfPage = -1;
+    if (!r.getBytes(page.pdf.doc) || !r.get(pdfPage))
+      return false;
+    page.pdf.page = pdfPage;
+    return true;
+  }
+  if (type == OpPageContent) {
+    QByteArray content;
+    QByteArray image;
+    if (!r.getBytes(content) || !r.getBytes(image))
+      return false;
+    if (content.isEmpty() && !image.isEmpty()) {
+      // Background only (PDF import): stays encoded until first shown.
+      page.backgroundImage = QImage();
+      page.pendingPayload = BnoteFile::imagePayload(image);
+      return page.pendingPayload->loadContent(page);
+    }
+    page.pendingPayload.reset();
+    page.backgroundImage = QImage();
+    if (!image.isEmpty())
+      page.backgroundImage.loadFromData(image, "PNG");
+    return decodeContent(content, page);
+  }
+  if (!page.ensureLoaded())
+    return false;
+  if (type == OpStrokeSplice) {
+    quint32 at = 0;
+    quint32 removed = 0;
+    QByteArray chunk;
+    NotePage added;
+    if (!r.get(at) || !r.get(removed) || !r.getBytes(chunk) ||
+        quint64(at) + removed > quint64(page.strokes.size()) ||
+        !decodeContent(chunk, added))
+      return false;
+    QVector<Stroke> merged;
+    merged.reserve(page.strokes.size() - qsizetype(removed) +
+                   added.strokes.size());
+    merged += page.strokes.mid(0, qsizetype(at));
+    merged += added.strokes;
+    merged += page.strokes.mid(qsizetype(at) + qsizetype(removed));
+    page.strokes = std::move(merged);
+    return true;
+  }
+  if (type == OpPageObjects) {
+    QByteArray cbor;
+    if (!r.getBytes(cbor))
+      return false;
+    decodeObjects(cbor, page);
+    return true;
+  }
+  if (type == OpPageImage) {
+    QByteArray image;
+    if (!r.getBytes(image))
+      return false;
+    page.backgroundImage = QImage();
+    if (!image.isEmpty())
+      page.backgroundImage.loadFromData(image, "PNG");
+    return true;
+  }
+  return false;
+}
+
+bool applyOps(const QByteArray &ops, Note &note) {
+  ByteReader r(ops.constData(), ops.size());
+  while (!r.atEnd()) {
+    quint8 type = 0;
+    if (!r.get(type))
+      return false;
+    if (type == OpNoteMeta) {
+      quint32 tagCount = 0;
+      if (!r.getString(note.id) || !r.getString(note.title) ||
+          !r.get(tagCount) || tagCount > quint32(ops.size()))
+        return false;
+      note.tags.clear();
+      for (quint32 i = 0; i < tagCount; ++i) {
+        QString t;
+        if (!r.getString(t))
+          return false;
+        note.tags.append(t);
+      }
+      continue;
+    }
+    if (type == OpPageTable) {
+      quint32 count = 0;
+      if (!r.get(count) || count > quint32(ops.size()))
+        return false;
+      QVector<NotePage> pages(int(count));
+      for (quint32 i = 0; i < count; ++i) {
+        qint32 from = -1;
+        if (!r.get(from) || from >= note.pages.size())
+          return false;
+        if (from >= 0)
+          pages[int(i)] = note.pages[from];
+      }
+      note.pages = std::move(pages);
+      continue;
+    }
+    quint32 index = 0;
+    if (!r.get(index) || index >= quint32(note.pages.size()) ||
+        !applyPageOp(type, r, note.pages[int(index)]))
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+NoteJournal::NoteJournal(const QString &notePath) : m_notePath(notePath) {}
+
+QString NoteJournal::journalDir() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+         QStringLiteral("/journals");
+}
+
+QString NoteJournal::journalPath(const QString &noteId,
+                                 const QString &notePath) {
+  if (noteId.isEmpty())
+    return QString();
+  const QByteArray key =
+      QCryptographicHash::hash((noteId + QLatin1Char('\n') +
+                                canonicalNotePath(notePath))
+                                   .toUtf8(),
+                               QCryptographicHash::Sha1)
+          .toHex();
+  return journalDir() + QLatin1Char('/') + QString::fromLatin1(key) +
+         QStringLiteral(".journal");
+}
+
+void NoteJournal::discard(const QString &path) {
+  const auto discardNote = [](const QString &notePath) {
+    QFile::remove(notePath + QStringLiteral(".journal")); // older builds
+    Note note;
+    if (BnoteFile::read(notePath, note) && !note.id.isEmpty())
+      QFile::remove(journalPath(note.id, notePath));
+  };
+  for (const QString &rel : notesAt(path))
+    discardNote(path + rel);
+}
+
+void NoteJournal::remapPath(const QString &fromPath, const QString &toPath) {
+  if (fromPath.isEmpty() || toPath.isEmpty() || fromPath == toPath)
+    return;
+  for (const QString &rel : notesAt(toPath)) {
+    Note note;
+    if (!BnoteFile::read(toPath + rel, note) || note.id.isEmpty())
+      continue;
+    const QString from = journalPath(note.id, fromPath + rel);
+    const QString to = journalPath(note.id, toPath + rel);
+    if (QFile::exists(from) && (!QFile::exists(to) || QFile::remove(to)))
+      QFile::rename(from, to);
+  }
+}
+
+void NoteJournal::replay(const QString &notePath, Note &note) {
+  const quint64 stamp = BnoteFile::stamp(notePath);
+  const QString path = journalPath(note.id, notePath);
+  if (!stamp || path.isEmpty())
+    return;
+  // Older builds kept the journal beside the note, where the library
+  // listed it, and later under the note id alone; take it over once. The
+  // stamp check below still rejects one that belongs to a copy.
+  const QString byId =
+      journalDir() + QLatin1Char('/') +
+      QString::fromLatin1(
+          QCryptographicHash::hash(note.id.toUtf8(), QCryptographicHash::Sha1)
+              .toHex()) +
+      QStringLiteral(".journal");
+  for (const QString &older : {notePath + QStringLiteral(".journal"), byId}) {
+    if (!QFile::exists(older))
+      continue;
+    if (QFile::exists(path) || !QDir().mkpath(journalDir()) ||
+        !QFile::rename(older, path))
+      QFile::remove(older);
+  }
+  QFile f(path);
+  if (!f.exists() || !f.open(QIODevice::ReadOnly))
+    return;
+  const QByteArray data = f.readAll();
+  f.close();
+
+  Note current = note;
+  int applied = 0;
+  const qint64 good = scanRecords(data, stamp, [&](const QByteArray &ops) {
+    Note next = current;
+    if (!applyOps(ops, next))
+      return false;
+    current = std::move(next);
+    ++applied;
+    return true;
+  });
+  if (good < 0)
+    return; // written against an older main file; attach() resets it
+  note = std::move(current);
+  if (good < data.size()) {
+    qWarning() << "NoteJournal: dropping damaged tail of" << path << "after"
+               << applied << "records";
+    QFile::resize(path, good);
+  }
+}
+
+void NoteJournal::attach(const Note &loaded) {
+  m_base = loaded;
+  m_folding = false;
+  m_pendingTail.clear();
+  m_valid = false;
+  m_size = 0;
+  m_path = journalPath(loaded.id, m_notePath);
+  m_stamp = BnoteFile::stamp(m_notePath);
+  m_mainSize = QFileInfo(m_notePath).size();
+  if (!m_stamp || m_path.isEmpty())
+    return; // v1, not written yet or no id: every save is a full one
+
+  QFile f(m_path);
+  if (f.open(QIODevice::ReadOnly) &&
+      scanRecords(f.read(kHeaderSize), m_stamp,
+                  [](const QByteArray &) { return false; }) == kHeaderSize) {
+    m_size = f.size();
+    m_valid = true;
+    return;
+  }
+  f.close();
+  m_valid = resetFile(QByteArray());
+}
+
+NoteJournal::AppendResult NoteJournal::append(const Note &note) {
+  if (!m_valid && !(m_folding && !m_tailOnDisk))
+    return AppendResult::NeedsFullSave;
+
+  ByteWriter ops;
+  if (note.id != m_base.id || note.title != m_base.title ||
+      note.tags != m_base.tags) {
+    ops.put<quint8>(OpNoteMeta);
+    ops.putString(note.id);
+    ops.putString(note.title);
+    ops.put<quint32>(quint32(note.tags.size()));
+    for (const QString &t : note.tags)
+      ops.putString(t);
+  }
+
+  // Match every page to the page it was at the last save.
+  const QVector<NotePage> &base = m_base.pages;
+  const QVector<NotePage> &pages = note.pages;
+  QHash<const void *, int> byKey;
+  for (int j = 0; j < base.size(); ++j) {
+    if (const void *k = pageKey(base[j]))
+      byKey.insert(k, j); // any match is correct; the diff covers the rest
+  }
+  QVector<int> source(pages.size(), -1);
+  QVector<bool> used(base.size(), false);
+  for (int i = 0; i < pages.size(); ++i) {
+    const void *k = pageKey(pages[i]);
+    if (!k)
+      continue;
+    if (i < base.size() && pageKey(base[i]) == k)
+      source[i] = i;
+    else
+      source[i] = byKey.value(k, -1);
+    if (source[i] >= 0)
+      used[source[i]] = true;
+  }
+  for (int i = 0; i < pages.size() && i < base.size(); ++i) {
+    if (source[i] < 0 && !used[i]) {
+      source[i] = i;
+      used[i] = true;
+    }
+  }
+  bool identity = pages.size() == base.size();
+  for (int i = 0; identity && i < pages.size(); ++i)
+    identity = source[i] == i;
+  if (!identity) {
+    ops.put<quint8>(OpPageTable);
+    ops.put<quint32>(quint32(pages.size()));
+    for (const int from : source)
+      ops.put<qint32>(from);
+  }
+
+  for (int i = 0; i < pages.size(); ++i) {
+    const NotePage before = source[i] >= 0 ? base[source[i]] : NotePage();
+    if (!diffPage(ops, quint32(i), before, pages[i]))
+      return AppendResult::NeedsFullSave;
+  }
+
+  if (ops.buf.isEmpty()) {
+    m_base = note; // adopt rebuilt-but-equal buffers for cheaper compares
+    return AppendResult::Unchanged;
+  }
+  if (!writeRecord(ops.buf)) {
+    qWarning() << "NoteJournal: append failed" << m_path;
+    m_valid = false;
+    return AppendResult::NeedsFullSave;
+  }
+  m_base = note;
+  return AppendResult::Appended;
+}
+
+bool NoteJournal::wantsFold() const {
+  return m_valid &&
+         m_size - kHeaderSize > qBound(kMinFoldBytes, m_mainSize / 2, kMaxFoldBytes);
+}
+
+bool NoteJournal::hasUnfolded() const {
+  if (m_folding)
+    return m_size > m_foldStart || !m_pendingTail.isEmpty();
+  return m_valid && m_size > kHeaderSize;
+}
+
+void NoteJournal::beginFold(const Note &note) {
+  // If the journal can first catch up with `note`, it stays a complete
+  // record of it and later appends can keep going to disk; otherwise they
+  // are held back until the main file has `note`.
+  m_tailOnDisk = m_valid && append(note) != AppendResult::NeedsFullSave;
+  m_base = note;
+  m_folding = true;
+  m_foldStart = m_size;
+  m_pendingTail.clear();
+}
+
+void NoteJournal::finishFold(bool ok) {
+  if (!m_folding)
+    return; // re-attached meanwhile (NoteManager::foldNote)
+  m_folding = false;
+  QByteArray tail = m_pendingTail;
+  m_pendingTail.clear();
+  if (!ok) {
+    // Main file unchanged. A journal kept on disk still leads up to m_base;
+    // held-back records do not apply to the old file.
+    if (!m_tailOnDisk)
+      m_valid = false;
+    return;
+  }
+  if (m_tailOnDisk) {
+    if (!m_valid) {
+      tail.clear(); // an append failed mid-fold; the next save is full
+    } else {
+      QFile f(m_path);
+      if (!f.open(QIODevice::ReadOnly) || !f.seek(m_foldStart)) {
+        m_valid = false;
+        return;
+      }
+      tail = f.read(m_size - m_foldStart);
+    }
+  }
+  const bool tailUsable = !m_tailOnDisk || m_valid;
+  m_stamp = BnoteFile::stamp(m_notePath);
+  m_mainSize = QFileInfo(m_notePath).size();
+  m_valid = m_stamp != 0 && resetFile(tail) && tailUsable;
+}
+
+bool NoteJournal::writeRecord(const QByteArray &ops) {
+  ByteWriter rec;
+  rec.buf.reserve(kRecordHeaderSize + ops.size());
+  rec.put<quint32>(quint32(ops.size()));
+  rec.put<quint32>(crc32(ops));
+  rec.buf.append(ops);
+  if (m_folding && !m_tailOnDisk) {
+    m_pendingTail.append(rec.buf);
+    return true;
+  }
+  QFile f(m_path);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Append) || f.size() != m_size)
+    return false;
+  if (f.write(rec.buf) != rec.buf.size() || !f.flush()) {
+    f.resize(m_size);
+    return false;
+  }
+  m_size += rec.buf.size();
+  return true;
+}
+
+bool NoteJournal::resetFile(const QByteArray &tail) {
+  if (m_path.isEmpty() || !QDir().mkpath(journalDir()))
+    return false;
+  QSaveFile f(m_path);
+  if (!f.open(QIODevice::WriteOnly))
+    return false;
+  const QByteArray head = journalHeader(m_stamp);
+  if (f.write(head) != head.size() || f.write(tail) != tail.size() ||
+      !f.commit())
+    return false;
+  m_size = head.size() + tail.size();
+  return true;
+}
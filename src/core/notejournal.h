@@ -0,0 +1,70 @@
+#pragma once
+#include "Note.h"
+#include <QByteArray>
+#include <QString>
+
+/// Append-only edit log of an open v2 note, kept in AppDataLocation/journals
+/// under a hash of the note id and its canonical path: never in the library,
+/// and a copy (same id, other path) never shares it. Moves and renames made
+/// in the library carry it along through remapPath().
+///
+///   header  "BNJ1" u64 BnoteFile::stamp() of the main file it extends
+///   record  u32 size u32 crc32, then ops (u8 type + payload) -- one record
+///           per autosave, so a torn write drops a whole autosave, never half
+///
+/// append() diffs the note against what main file + journal already hold and
+/// writes only the difference: stroke splices, object/metadata/image edits
+/// and page table changes (insert, delete, move, duplicate). Pages are
+/// matched through their implicitly shared buffers, so untouched pages cost
+/// a pointer compare and autosave I/O follows the size of the edit.
+/// Folding the journal back into the main file is driven by NoteManager.
+class NoteJournal {
+public:
+    enum class AppendResult { Unchanged, Appended, NeedsFullSave };
+
+    explicit NoteJournal(const QString& notePath);
+
+    /// Empty for a note without id (no journal; every save is full).
+    static QString journalPath(const QString& noteId, const QString& notePath);
+    /// The note at `path` (or every note below a folder) is being deleted.
+    static void discard(const QString& path);
+    /// The note or folder at `fromPath` has been moved to `toPath`.
+    static void remapPath(const QString& fromPath, const QString& toPath);
+    /// Recovery: applies the journal that belongs to the current state of
+    /// `notePath` to `note` (just read by BnoteFile::read). A torn or
+    /// unusable tail is cut off; journals of an older main file are ignored.
+    static void replay(const QString& notePath, Note& note);
+
+    /// Starts tracking `loaded` (journal already replayed) as the saved state.
+    void attach(const Note& loaded);
+    AppendResult append(const Note& note);
+    /// Journal has outgrown its share of the main file.
+    bool wantsFold() const;
+    bool isFolding() const { return m_folding; }
+    /// Edits recorded that the main file does not have yet, including those
+    /// made during a running fold.
+    bool hasUnfolded() const;
+    /// The note as main file + journal hold it.
+    const Note& base() const { return m_base; }
+    /// `note` is about to be written completely. Appends made until
+    /// finishFold() are relative to it and survive the fold.
+    void beginFold(const Note& note);
+    void finishFold(bool ok);
+
+private:
+    static QString journalDir();
+    bool writeRecord(const QByteArray& ops);
+    bool resetFile(const QByteArray& tail);
+
+    QString m_notePath;
+    QString m_path;
+    Note m_base;             ///< main file + journal as they are on disk
+    quint64 m_stamp{0};
+    qint64 m_size{0};        ///< bytes in the journal file
+    qint64 m_mainSize{0};
+    bool m_valid{false};     ///< journal file matches m_stamp and m_base
+    bool m_folding{false};
+    bool m_tailOnDisk{false};
+    qint64 m_foldStart{0};
+    QByteArray m_pendingTail; ///< records made during a fold, if not on disk
+};
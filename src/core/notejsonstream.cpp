@@ -0,0 +1,477 @@
+#include "notejsonstream.h"
+#include "notemanager.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QVarLengthArray>
+
+namespace {
+
+constexpr qsizetype kChunk = 64 * 1024;
+constexpr int kMaxDepth = 256;
+
+/// Pull parser over a QIODevice, refilled in kChunk blocks. Typed reads
+/// consume the next value; on a type mismatch they skip it and leave the
+/// output untouched (the JSON path used QJsonValue defaults the same way).
+/// Syntax errors latch failed().
+class JsonPullReader {
+public:
+  explicit JsonPullReader(QIODevice &dev) : m_dev(dev) {}
+
+  bool failed() const { return m_failed; }
+  bool atEnd() { return !m_failed && peek() == -1; }
+
+  bool beginObject() { return open('{'); }
+  bool beginArray() { return open('['); }
+
+  /// Advances to the next key of the current object; false (and the
+  /// object closed) at '}'.
+  bool nextKey(QByteArray &key) {
+    if (!next('}'))
+      return false;
+    if (peek() != '"' || !readStringBytes(key) || peek() != ':')
+      return fail();
+    ++m_pos;
+    return true;
+  }
+  /// Advances to the next element of the current array; false at ']'.
+  bool nextElement() { return next(']'); }
+
+  bool readDouble(double &out) {
+    const int c = peek();
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      double v = 0.0;
+      if (!parseNumber(v))
+        return false;
+      out = v;
+      return true;
+    }
+    skipValue();
+    return false;
+  }
+  bool readBool(bool &out) {
+    const int c = peek();
+    if (c == 't' || c == 'f') {
+      if (!literal(c == 't' ? "true" : "false"))
+        return false;
+      out = c == 't';
+      return true;
+    }
+    skipValue();
+    return false;
+  }
+  /// Raw UTF-8 of a string value (base64 image data stays bytes).
+  bool readBytes(QByteArray &out) {
+    if (peek() == '"')
+      return readStringBytes(out);
+    skipValue();
+    return false;
+  }
+  bool readString(QString &out) {
+    if (!readBytes(m_scratch))
+      return false;
+    out = QString::fromUtf8(m_scratch);
+    return true;
+  }
+
+  /// Small subtrees only (graphs, stickies, texts).
+  QJsonValue readValue() {
+    switch (peek()) {
+    case '{': {
+      QJsonObject o;
+      beginObject();
+      QByteArray k;
+      while (nextKey(k))
+        o.insert(QString::fromUtf8(k), readValue());
+      return o;
+    }
+    case '[': {
+      QJsonArray a;
+      beginArray();
+      while (nextElement())
+        a.append(readValue());
+      return a;
+    }
+    case '"': {
+      QByteArray u;
+      readStringBytes(u);
+      return QString::fromUtf8(u);
+    }
+    case 't':
+      literal("true");
+      return true;
+    case 'f':
+      literal("false");
+      return false;
+    case 'n':
+      literal("null");
+      return QJsonValue(QJsonValue::Null);
+    default: {
+      double d = 0.0;
+      if (parseNumber(d))
+        return d;
+      return QJsonValue();
+    }
+    }
+  }
+
+  bool skipValue() {
+    switch (peek()) {
+    case '{': {
+      if (!beginObject())
+        return false;
+      while (nextKey(m_skipKey))
+        skipValue();
+      return !m_failed;
+    }
+    case '[':
+      if (!beginArray())
+        return false;
+      while (nextElement())
+        skipValue();
+      return !m_failed;
+    case '"':
+      return readStringBytes(m_scratch);
+    case 't':
+      return literal("true");
+    case 'f':
+      return literal("false");
+    case 'n':
+      return literal("null");
+    default: {
+      double d = 0.0;
+      return parseNumber(d);
+    }
+    }
+  }
+
+private:
+  bool fail() {
+    m_failed = true;
+    return false;
+  }
+
+  bool fill() {
+    if (m_eof)
+      return false;
+    m_buf.resize(kChunk);
+    const qint64 n = m_dev.read(m_buf.data(), kChunk);
+    m_buf.resize(n > 0 ? qsizetype(n) : 0);
+    m_pos = 0;
+    if (n <= 0)
+      m_eof = true;
+    return n > 0;
+  }
+
+  /// Next non-whitespace byte, not consumed; -1 at the end of input.
+  int peek() {
+    if (m_failed)
+      return -1;
+    for (;;) {
+      if (m_pos >= m_buf.size() && !fill())
+        return -1;
+      const char c = m_buf.constData()[m_pos];
+      if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+        return uchar(c);
+      ++m_pos;
+    }
+  }
+  int get() {
+    if (m_pos >= m_buf.size() && !fill())
+      return -1;
+    return uchar(m_buf.constData()[m_pos++]);
+  }
+
+  bool open(char c) {
+    if (peek() != c)
+      return false;
+    if (m_first.size() >= kMaxDepth)
+      return fail();
+    ++m_pos;
+    m_first.push_back(true);
+    return true;
+  }
+  bool next(char close) {
+    if (m_failed || m_first.isEmpty())
+      return false;
+    const int c = peek();
+    if (c == close) {
+      ++m_pos;
+      m_first.pop_back();
+      return false;
+    }
+    if (!m_first.back()) {
+      if (c != ',')
+        return fail();
+      ++m_pos;
+    }
+    m_first.back() = false;
+    return true;
+  }
+
+  bool literal(const char *word) {
+    for (const char *p = word; *p; ++p) {
+      if (get() != uchar(*p))
+        return fail();
+    }
+    return true;
+  }
+
+  bool parseNumber(double &out) {
+    char tmp[64];
+    int n = 0;
+    for (;;) {
+      if (m_pos >= m_buf.size() && !fill())
+        break;
+      const char c = m_buf.constData()[m_pos];
+      if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+            c == 'e' || c == 'E'))
+        break;
+      if (n == int(sizeof tmp))
+        return fail();
+      tmp[n++] = c;
+      ++m_pos;
+    }
+    bool ok = false;
+    // Locale independent, unlike strtod under a German LC_NUMERIC.
+    out = QByteArray::fromRawData(tmp, n).toDouble(&ok);
+    return ok || fail();
+  }
+
+  bool hex4(uint &out) {
+    out = 0;
+    for (int i = 0; i < 4; ++i) {
+      const int c = get();
+      uint v;
+      if (c >= '0' && c <= '9')
+        v = uint(c - '0');
+      else if (c >= 'a' && c <= 'f')
+        v = uint(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        v = uint(c - 'A' + 10);
+      else
+        return fail();
+      out = (out << 4) | v;
+    }
+    return true;
+  }
+
+  static void appendUtf8(QByteArray &out, uint cp) {
+    if (cp < 0x80) {
+      out.append(char(cp));
+    } else if (cp < 0x800) {
+      out.append(char(0xC0 | (cp >> 6)));
+      out.append(char(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      out.append(char(0xE0 | (cp >> 12)));
+      out.append(char(0x80 | ((cp >> 6) & 0x3F)));
+      out.append(char(0x80 | (cp & 0x3F)));
+    } else {
+      out.append(char(0xF0 | (cp >> 18)));
+      out.append(char(0x80 | ((cp >> 12) & 0x3F)));
+      out.append(char(0x80 | ((cp >> 6) & 0x3F)));
+      out.append(char(0x80 | (cp & 0x3F)));
+    }
+  }
+
+  bool readStringBytes(QByteArray &out) {
+    out.resize(0);
+    if (get() != '"')
+      return fail();
+    for (;;) {
+      if (m_pos >= m_buf.size() && !fill())
+        return fail();
+      const char *d = m_buf.constData();
+      qsizetype end = m_pos;
+      while (end < m_buf.size() && d[end] != '"' && d[end] != '\\')
+        ++end;
+      out.append(d + m_pos, end - m_pos);
+      m_pos = end;
+      if (m_pos >= m_buf.size())
+        continue;
+      if (d[m_pos++] == '"')
+        return true;
+      const int e = get();
+      switch (e) {
+      case '"':
+      case '\\':
+      case '/': out.append(char(e)); break;
+      case 'b': out.append('\b'); break;
+      case 'f': out.append('\f'); break;
+      case 'n': out.append('\n'); break;
+      case 'r': out.append('\r'); break;
+      case 't': out.append('\t'); break;
+      case 'u': {
+        uint cp = 0;
+        if (!hex4(cp))
+          return false;
+        if (cp >= 0xD800 && cp < 0xDC00) {
+          uint lo = 0;
+          if (get() != '\\' || get() != 'u' || !hex4(lo) || lo < 0xDC00 ||
+              lo > 0xDFFF)
+            return fail();
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        }
+        appendUtf8(out, cp);
+        break;
+      }
+      default:
+        return fail();
+      }
+    }
+  }
+
+  QIODevice &m_dev;
+  QByteArray m_buf;
+  qsizetype m_pos{0};
+  bool m_eof{false};
+  bool m_failed{false};
+  QVarLengthArray<bool, 16> m_first;
+  QByteArray m_scratch;
+  QByteArray m_skipKey;
+};
+
+void readStroke(JsonPullReader &r, Stroke &s) {
+  if (!r.beginObject()) {
+    r.skipValue();
+    return;
+  }
+  QByteArray key;
+  while (r.nextKey(key)) {
+    if (key == "w") {
+      r.readDouble(s.width);
+    } else if (key == "c") {
+      QString name;
+      if (r.readString(name))
+        s.color = QColor(name);
+    } else if (key == "e") {
+      r.readBool(s.isEraser);
+    } else if (key == "h") {
+      r.readBool(s.isHighlighter);
+    } else if (key == "pts") {
+      if (!r.beginArray()) {
+        r.skipValue();
+        continue;
+      }
+      while (r.nextElement()) {
+        if (!r.beginArray()) {
+          r.skipValue();
+          continue;
+        }
+        double v[3] = {0.0, 0.0, 1.0};
+        int n = 0;
+        while (r.nextElement()) {
+          if (n < 3)
+            r.readDouble(v[n]);
+          else
+            r.skipValue();
+          ++n;
+        }
+        if (n >= 2)
+          s.points.append(QPointF(v[0], v[1]), v[2]);
+      }
+    } else {
+      r.skipValue();
+    }
+  }
+}
+
+void readPage(JsonPullReader &r, NotePage &page, int index) {
+  page.title = QStringLiteral("Seite %1").arg(index + 1);
+  if (!r.beginObject()) {
+    r.skipValue();
+    return;
+  }
+  QJsonObject objects;
+  QByteArray key;
+  while (r.nextKey(key)) {
+    double v = 0.0;
+    if (key == "bg") {
+      if (r.readDouble(v))
+        page.backgroundType = int(v);
+    } else if (key == "title") {
+      r.readString(page.title);
+    } else if (key == "rot") {
+      if (r.readDouble(v))
+        page.rotationDegrees = int(v);
+    } else if (key == "bm") {
+      r.readBool(page.bookmarked);
+    } else if (key == "paper") {
+      QString name;
+      if (r.readString(name) && !name.isEmpty()) {
+        const QColor c(name);
+        if (c.isValid())
+          page.paperColor = c;
+      }
+    } else if (key == "bgImg") {
+      QByteArray b64;
+      if (r.readBytes(b64)) {
+        const QByteArray raw = QByteArray::fromBase64(b64);
+        if (!raw.isEmpty())
+          page.backgroundImage.loadFromData(raw, "PNG");
+      }
+    } else if (key == "pdf") {
+      const QJsonObject ref = r.readValue().toObject();
+      page.pdf.doc = ref.value(QLatin1String("doc")).toString().toLatin1();
+      page.pdf.page = ref.value(QLatin1String("page")).toInt(-1);
+    } else if (key == "strokes") {
+      if (!r.beginArray()) {
+        r.skipValue();
+        continue;
+      }
+      while (r.nextElement()) {
+        Stroke s;
+        readStroke(r, s);
+        page.strokes.push_back(std::move(s));
+      }
+    } else if (key == "graphs" || key == "stickies" || key == "texts") {
+      objects.insert(QString::fromLatin1(key), r.readValue());
+    } else {
+      r.skipValue();
+    }
+  }
+  NoteManager::pageObjectsFromJson(objects, page);
+}
+
+} // namespace
+
+bool NoteJsonStream::read(QIODevice &in, Note &out) {
+  JsonPullReader r(in);
+  if (!r.beginObject())
+    return false;
+  out.id.clear();
+  out.title.clear();
+  out.tags.clear();
+  out.pages.clear();
+  QByteArray key;
+  while (r.nextKey(key)) {
+    if (key == "id") {
+      r.readString(out.id);
+    } else if (key == "title") {
+      r.readString(out.title);
+    } else if (key == "tags") {
+      if (!r.beginArray()) {
+        r.skipValue();
+        continue;
+      }
+      while (r.nextElement()) {
+        QString t;
+        r.readString(t);
+        out.tags.append(t);
+      }
+    } else if (key == "pages") {
+      if (!r.beginArray()) {
+        r.skipValue();
+        continue;
+      }
+      while (r.nextElement()) {
+        NotePage page;
+        readPage(r, page, int(out.pages.size()));
+        out.pages.push_back(std::move(page));
+      }
+    } else {
+      r.skipValue();
+    }
+  }
+  return r.atEnd();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "Note.h"
+#include <QIODevice>
+
+/// Reads v1 note JSON without a QJsonDocument in between.
+///
+/// read() is a pull parser that fills Note/NotePage/Stroke as it goes. Only
+/// graphs/stickies/texts (small) are read into QJsonValues, to reuse
+/// NoteManager::pageObjectsFromJson. Transient memory stays around the
+/// 64 KiB read buffer plus the largest embedded background image, instead
+/// of the whole file plus a DOM.
+class NoteJsonStream {
+public:
+    static bool read(QIODevice& in, Note& out);
+};
@@ -6,7 +6,12 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QFuture>
+#include <QHash>
 #include <functional>
+#include <memory>
+
+class NoteJournal;
 
 class NoteManager : public QObject {
     Q_OBJECT
@@ -17,11 +22,53 @@ public:
     void saveNoteAsync(const Note& note, const QString& path, std::function<void(bool)> onDone);
     void loadNoteAsync(const QString& path, std::function<void(bool, Note)> onDone);
 
+    /// Open-note journal (see NoteJournal). trackNote() after opening a note
+    /// with `note` as loaded; from then on saveNoteAsync()/foldNote() fold
+    /// the journal into the file instead of racing it.
+    void trackNote(const QString& path, const Note& note);
+    /// Stops tracking; edits only the journal holds are folded into the file
+    /// in the background first (`onFolded` only runs if a fold was needed).
+    void untrackNote(const QString& path,
+                     std::function<void(bool ok)> onFolded = {});
+    /// Autosave: appends only the edits since the last save to the journal
+    /// and folds it into the file in the background once it has grown.
+    /// `rewritten` = the main file itself was replaced (mirror it).
+    void saveNoteIncremental(const Note& note, const QString& path,
+                             std::function<void(bool ok, bool rewritten)> onDone);
+    /// Synchronous full save that also empties the journal (window close).
+    bool foldNote(const Note& note, const QString& path);
+
+    /// Runs on the saving thread after every successful saveNote() (caches
+    /// derived from note content: thumbnails, search index). Register at
+    /// startup.
+    using SaveObserver = std::function<void(const Note& note, const QString& path)>;
+    static void addSaveObserver(SaveObserver observer);
+    /// Runs on the saving thread when a save had to salvage damaged pages
+    /// (see BnoteFile::write); the save itself succeeded. Register at startup.
+    using SaveProblemHandler =
+        std::function<void(const QString& path, const QStringList& problems)>;
+    static void setSaveProblemHandler(SaveProblemHandler handler);
+
     // Sync helpers used inside async
     static bool saveNote(const Note& note, const QString& path);
     static bool loadNote(const QString& path, Note& out);
 
+    /// Graphs, sticky notes and texts of a page in their JSON shape (v1 page
+    /// object keys; v2 chunks embed the same object as CBOR).
+    static QJsonObject pageObjectsToJson(const NotePage& page);
+    static void pageObjectsFromJson(const QJsonObject& pageObj, NotePage& page);
+
 private:
-    static QJsonDocument toJson(const Note& note);
-    static bool fromJson(const QJsonDocument& doc, Note& out);
+    struct QueuedFold {
+        Note note;
+        std::function<void(bool ok, bool rewritten)> onDone;
+    };
+
+    void startFold(const QString& key, const Note& note, const QString& path,
+                   std::function<void(bool ok, bool rewritten)> onDone);
+
+    /// Keyed by absolute note path.
+    QHash<QString, std::shared_ptr<NoteJournal>> m_journals;
+    QHash<QString, QueuedFold> m_queuedFolds;
+    QHash<QString, QFuture<void>> m_foldFutures;
 };
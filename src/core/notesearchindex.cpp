@@ -0,0 +1,463 @@
+#include "notesearchindex.h"
+#include "notemanager.h"
+#include "util/Async.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr quint32 kMagic = 0x42535831; // "BSX1"
+constexpr quint32 kVersion = 2; // 1: no mtime per note
+constexpr int kMinTermLength = 2;
+/// A crawl writes the file (and notifies searches) after this many notes.
+constexpr int kCrawlBatch = 64;
+
+QString indexKey(const QString &path) {
+  return QFileInfo(path).absoluteFilePath();
+}
+
+qint64 modifiedMs(const QString &path) {
+  return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+/// Per library, outside it: sync clients and file managers never see it.
+QString indexFile(const QString &libraryDir) {
+  const QByteArray key =
+      QCryptographicHash::hash(libraryDir.toUtf8(), QCryptographicHash::Sha1)
+          .toHex();
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+         QStringLiteral("/search/") + QString::fromLatin1(key) +
+         QStringLiteral(".index");
+}
+
+bool remapOne(QString &path, const QString &from, const QString &to) {
+  if (path == from) {
+    path = to;
+    return true;
+  }
+  if (path.startsWith(from + QLatin1Char('/'))) {
+    path = to + path.mid(from.size());
+    return true;
+  }
+  return false;
+}
+
+void appendTerms(QStringList &out, const QString &text) {
+  if (!text.isEmpty())
+    out += NoteSearchIndex::tokenize(text);
+}
+
+/// Words of the objects of `page` (title excluded).
+QStringList objectTerms(const NotePage &page) {
+  QStringList terms;
+  for (const TextObject &t : page.texts)
+    appendTerms(terms, t.text);
+  for (const StickyNoteObject &s : page.stickies)
+    appendTerms(terms, s.text);
+  for (const GraphObject &g : page.graphs) {
+    for (const GraphFunction &f : g.functions)
+      appendTerms(terms, f.expression);
+  }
+  terms.removeDuplicates();
+  return terms;
+}
+
+} // namespace
+
+NoteSearchIndex &NoteSearchIndex::instance() {
+  static NoteSearchIndex index;
+  return index;
+}
+
+NoteSearchIndex::NoteSearchIndex() {
+  NoteManager::addSaveObserver(
+      [this](const Note &note, const QString &path) { noteSaved(note, path); });
+}
+
+QStringList NoteSearchIndex::tokenize(const QString &text) {
+  QStringList out;
+  const QString folded = text.toCaseFolded();
+  qsizetype start = -1;
+  for (qsizetype i = 0; i <= folded.size(); ++i) {
+    const bool word = i < folded.size() && folded.at(i).isLetterOrNumber();
+    if (word && start < 0) {
+      start = i;
+    } else if (!word && start >= 0) {
+      if (i - start >= kMinTermLength)
+        out.append(folded.mid(start, i - start));
+      start = -1;
+    }
+  }
+  return out;
+}
+
+QStringList NoteSearchIndex::pageTerms(const NotePage &page) {
+  QStringList terms = tokenize(page.title) + objectTerms(page);
+  terms.removeDuplicates();
+  return terms;
+}
+
+void NoteSearchIndex::open(const QString &libraryDir) {
+  if (libraryDir.isEmpty())
+    return;
+  const QString dir = QDir(libraryDir).absolutePath();
+  const QString file = indexFile(dir);
+  QMutexLocker lock(&m_mutex);
+  if (file == m_file)
+    return;
+  m_file = file;
+  m_docIds.clear();
+  m_docs.clear();
+  m_terms.clear();
+  m_crawlQueue.clear();
+  m_dirty = false;
+  QDir().mkpath(QFileInfo(m_file).absolutePath());
+  // Older builds kept the index in the library itself.
+  const QString inLibrary = dir + QStringLiteral("/.blop-search");
+  if (QFile::exists(inLibrary) &&
+      (QFile::exists(m_file) || !QFile::rename(inLibrary, m_file)))
+    QFile::remove(inLibrary);
+  if (QFile::exists(m_file) && !loadLocked()) {
+    qWarning() << "NoteSearchIndex: index unreadable, starting over" << m_file;
+    m_docIds.clear();
+    m_docs.clear();
+    m_terms.clear();
+  }
+  m_crawlDir = dir;
+  scheduleLocked();
+}
+
+void NoteSearchIndex::noteSaved(const Note &note, const QString &path) {
+  if (path.isEmpty())
+    return;
+  const QString key = indexKey(path);
+  const qint64 modified = modifiedMs(key);
+  QMutexLocker lock(&m_mutex);
+  if (m_file.isEmpty())
+    return;
+  m_queue.insert(key, Queued{note, key, modified});
+  scheduleLocked();
+}
+
+void NoteSearchIndex::removeNote(const QString &path) {
+  QMutexLocker lock(&m_mutex);
+  const QString key = indexKey(path);
+  m_queue.remove(key);
+  m_crawlQueue.removeAll(key);
+  if (!m_docIds.contains(key))
+    return;
+  removeDocLocked(key);
+  m_dirty = true;
+  scheduleLocked();
+}
+
+void NoteSearchIndex::remapPath(const QString &fromPath, const QString &toPath) {
+  if (fromPath.isEmpty() || toPath.isEmpty() || fromPath == toPath)
+    return;
+  const QString from = indexKey(fromPath);
+  const QString to = indexKey(toPath);
+  QMutexLocker lock(&m_mutex);
+  QVector<int> moved;
+  for (auto it = m_docIds.constBegin(); it != m_docIds.constEnd(); ++it) {
+    QString p = it.key();
+    if (remapOne(p, from, to))
+      moved.append(it.value());
+  }
+  if (moved.isEmpty())
+    return;
+  for (int id : moved)
+    m_docIds.remove(m_docs[id].path);
+  for (int id : moved) {
+    remapOne(m_docs[id].path, from, to);
+    if (m_docIds.contains(m_docs[id].path))
+      removeDocLocked(m_docs[id].path); // overwritten by the move
+    m_docIds.insert(m_docs[id].path, id);
+  }
+  m_dirty = true;
+  scheduleLocked();
+}
+
+QHash<QString, QList<int>> NoteSearchIndex::search(const QString &query) const {
+  QStringList words = tokenize(query);
+  words.removeDuplicates();
+  if (words.isEmpty())
+    return {};
+
+  struct Match {
+    QSet<int> all; ///< pages holding every word so far
+    QSet<int> any;
+  };
+  QHash<int, Match> acc;
+
+  QMutexLocker lock(&m_mutex);
+  for (int w = 0; w < words.size(); ++w) {
+    const QString &word = words[w];
+    QHash<int, QSet<int>> hits;
+    for (auto it = m_terms.lowerBound(word);
+         it != m_terms.constEnd() && it.key().startsWith(word); ++it) {
+      for (auto d = it->constBegin(); d != it->constEnd(); ++d) {
+        QSet<int> &pages = hits[d.key()];
+        for (int p : d.value())
+          pages.insert(p);
+      }
+    }
+    if (w == 0) {
+      for (auto h = hits.constBegin(); h != hits.constEnd(); ++h)
+        acc.insert(h.key(), Match{h.value(), h.value()});
+      continue;
+    }
+    for (auto a = acc.begin(); a != acc.end();) {
+      const auto h = hits.constFind(a.key());
+      if (h == hits.constEnd()) {
+        a = acc.erase(a);
+        continue;
+      }
+      a->all.intersect(h.value());
+      a->any.unite(h.value());
+      ++a;
+    }
+    if (acc.isEmpty())
+      break;
+  }
+
+  QHash<QString, QList<int>> out;
+  out.reserve(acc.size());
+  for (auto a = acc.constBegin(); a != acc.constEnd(); ++a) {
+    const QSet<int> &pages = a->all.isEmpty() ? a->any : a->all;
+    QList<int> sorted(pages.cbegin(), pages.cend());
+    std::sort(sorted.begin(), sorted.end());
+    out.insert(m_docs[a.key()].path, sorted);
+  }
+  return out;
+}
+
+void NoteSearchIndex::scheduleLocked() {
+  if (m_draining)
+    return;
+  m_draining = true;
+  fireAndForget([this]() { drain(); });
+}
+
+void NoteSearchIndex::drain() {
+  int sinceSave = 0;
+  for (;;) {
+    QMutexLocker lock(&m_mutex);
+    if (!m_crawlDir.isEmpty()) {
+      const QString dir = m_crawlDir;
+      const QString file = m_file;
+      m_crawlDir.clear();
+      lock.unlock();
+      crawl(dir, file);
+      continue;
+    }
+    const bool idle = m_queue.isEmpty() && m_crawlQueue.isEmpty();
+    if (idle || (m_dirty && sinceSave >= kCrawlBatch)) {
+      if (idle)
+        m_draining = false;
+      if (!m_dirty)
+        return;
+      m_dirty = false;
+      sinceSave = 0;
+      const QString file = m_file;
+      const QVector<Doc> docs = m_docs;
+      lock.unlock();
+      if (!save(file, docs))
+        qWarning() << "NoteSearchIndex: cannot write" << file;
+      emit changed();
+      if (idle)
+        return;
+      continue;
+    }
+    const QString file = m_file;
+    Queued job;
+    if (!m_queue.isEmpty()) {
+      const auto next = m_queue.begin();
+      job = next.value();
+      m_queue.erase(next);
+      lock.unlock();
+    } else {
+      // Saved notes go first; a crawled note is read from its file.
+      job.path = m_crawlQueue.takeLast();
+      lock.unlock();
+      job.modified = modifiedMs(job.path);
+      if (!NoteManager::loadNote(job.path, job.note))
+        continue;
+    }
+
+    QVector<QStringList> pages = extract(job.note);
+
+    lock.relock();
+    if (m_file != file)
+      continue; // library switched meanwhile
+    const int id = m_docIds.value(job.path, -1);
+    if (id >= 0 && m_docs[id].modified > job.modified)
+      continue; // a newer save got there first
+    setDocLocked(job.path, job.modified, std::move(pages));
+    m_dirty = true;
+    ++sinceSave;
+  }
+}
+
+void NoteSearchIndex::crawl(const QString &libraryDir, const QString &file) {
+  QHash<QString, qint64> onDisk;
+  QDirIterator it(libraryDir, {QStringLiteral("*.bnote")}, QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    const QFileInfo fi = it.fileInfo();
+    onDisk.insert(fi.absoluteFilePath(), fi.lastModified().toMSecsSinceEpoch());
+  }
+
+  QMutexLocker lock(&m_mutex);
+  if (m_file != file)
+    return;
+  const QString prefix = libraryDir + QLatin1Char('/');
+  QStringList gone;
+  for (auto d = m_docIds.constBegin(); d != m_docIds.constEnd(); ++d) {
+    if (d.key().startsWith(prefix) && !onDisk.contains(d.key()))
+      gone.append(d.key());
+  }
+  for (const QString &path : std::as_const(gone))
+    removeDocLocked(path);
+  if (!gone.isEmpty())
+    m_dirty = true;
+  for (auto f = onDisk.constBegin(); f != onDisk.constEnd(); ++f) {
+    const int id = m_docIds.value(f.key(), -1);
+    if ((id < 0 || m_docs[id].modified < f.value()) &&
+        !m_queue.contains(f.key()))
+      m_crawlQueue.append(f.key());
+  }
+}
+
+QVector<QStringList> NoteSearchIndex::extract(const Note &note) {
+  QVector<QStringList> pages;
+  pages.reserve(note.pages.size());
+  for (const NotePage &page : note.pages) {
+    if (page.isLoaded()) {
+      pages.append(pageTerms(page));
+      continue;
+    }
+    // Unread page: its content is what the file holds, so decode it once
+    // (without the background image) and reuse the words for later saves.
+    const auto &payload = page.pendingPayload;
+    auto cached = m_payloadTerms.find(payload.get());
+    if (cached == m_payloadTerms.end() || cached->payload.lock() != payload) {
+      NotePage scratch;
+      CachedTerms entry;
+      entry.payload = payload;
+      if (payload->loadContent(scratch))
+        entry.terms = objectTerms(scratch);
+      cached = m_payloadTerms.insert(payload.get(), entry);
+    }
+    QStringList terms = tokenize(page.title) + cached->terms;
+    terms.removeDuplicates();
+    pages.append(terms);
+  }
+  for (auto it = m_payloadTerms.begin(); it != m_payloadTerms.end();) {
+    if (it->payload.expired())
+      it = m_payloadTerms.erase(it);
+    else
+      ++it;
+  }
+  return pages;
+}
+
+void NoteSearchIndex::setDocLocked(const QString &path, qint64 modified,
+                                   QVector<QStringList> pages) {
+  int id = m_docIds.value(path, -1);
+  if (id >= 0) {
+    for (const QStringList &terms : std::as_const(m_docs[id].pages)) {
+      for (const QString &t : terms) {
+        auto it = m_terms.find(t);
+        if (it == m_terms.end())
+          continue;
+        it->remove(id);
+        if (it->isEmpty())
+          m_terms.erase(it);
+      }
+    }
+  } else {
+    id = m_docs.size();
+    m_docs.append(Doc{path, 0, {}});
+    m_docIds.insert(path, id);
+  }
+  m_docs[id].modified = modified;
+  for (int p = 0; p < pages.size(); ++p) {
+    for (const QString &t : std::as_const(pages[p]))
+      m_terms[t][id].append(p);
+  }
+  m_docs[id].pages = std::move(pages);
+}
+
+void NoteSearchIndex::removeDocLocked(const QString &path) {
+  const int id = m_docIds.value(path, -1);
+  if (id < 0)
+    return;
+  setDocLocked(path, 0, {});
+  m_docIds.remove(path);
+  m_docs[id].path.clear();
+}
+
+bool NoteSearchIndex::save(const QString &file, const QVector<Doc> &docs) {
+  QSaveFile f(file);
+  if (!f.open(QIODevice::WriteOnly))
+    return false;
+  QDataStream out(&f);
+  out.setVersion(QDataStream::Qt_6_0);
+  quint32 count = 0;
+  for (const Doc &d : docs)
+    count += d.path.isEmpty() ? 0 : 1;
+  out << kMagic << kVersion << count;
+  for (const Doc &d : docs) {
+    if (d.path.isEmpty())
+      continue;
+    out << d.path << d.modified << quint32(d.pages.size());
+    for (const QStringList &terms : d.pages)
+      out << terms;
+  }
+  return out.status() == QDataStream::Ok && f.commit();
+}
+
+bool NoteSearchIndex::loadLocked() {
+  QFile f(m_file);
+  if (!f.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&f);
+  in.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  quint32 version = 0;
+  quint32 count = 0;
+  in >> magic >> version >> count;
+  if (magic != kMagic || version < 1 || version > kVersion)
+    return false;
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+    QString path;
+    qint64 modified = 0; // v1: stale, the crawl indexes it again
+    quint32 pageCount = 0;
+    in >> path;
+    if (version >= 2)
+      in >> modified;
+    in >> pageCount;
+    QVector<QStringList> pages;
+    for (quint32 p = 0; p < pageCount && in.status() == QDataStream::Ok; ++p) {
+      QStringList terms;
+      in >> terms;
+      pages.append(terms);
+    }
+    if (!path.isEmpty())
+      setDocLocked(path, modified, std::move(pages));
+  }
+  return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Note.h"
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+/// Persistent inverted index over the typed text of the library's notes:
+/// page titles, text boxes, sticky notes and graph expressions.
+///
+///   file  "<AppDataLocation>/search/<hash of library path>.index" --
+///         "BSX1" u32 version, then per note path, file mtime, per page the
+///         list of its (case-folded) words
+///
+/// Only the per-page word lists are stored; the term -> (note, pages) map
+/// is rebuilt from them on open(). Every note written by
+/// NoteManager::saveNote() arrives through a save observer; open() also
+/// crawls the library for notes that are missing or older than the file
+/// (written before the index existed, or by another device). A single
+/// background job re-indexes saved notes first (newest state per path
+/// wins), then crawled ones, and rewrites the file once per batch.
+/// Pages still unread in a note are decoded without their background
+/// image, and only once per payload.
+///
+/// All public functions are thread-safe; changed() is emitted from the
+/// background job.
+class NoteSearchIndex : public QObject {
+    Q_OBJECT
+public:
+    static NoteSearchIndex& instance();
+
+    /// Loads the index stored in `libraryDir` (switching directories drops
+    /// the previous index from memory).
+    void open(const QString& libraryDir);
+
+    /// Queues `note` (just written to `path`) for re-indexing.
+    void noteSaved(const Note& note, const QString& path);
+    void removeNote(const QString& path);
+    /// Keeps entries when notes or folders are moved or renamed.
+    void remapPath(const QString& fromPath, const QString& toPath);
+
+    /// Notes containing every word of `query`; each word matches as a
+    /// prefix. Value: 0-based pages with a hit, ascending (every page that
+    /// holds any of the words when no single page holds all of them).
+    QHash<QString, QList<int>> search(const QString& query) const;
+
+    /// Lower-cased words (letters/digits) of `text`, at least two characters.
+    static QStringList tokenize(const QString& text);
+    /// Distinct words of what can be searched on `page` (must be loaded).
+    static QStringList pageTerms(const NotePage& page);
+
+signals:
+    /// The index was written; search() may answer differently now.
+    void changed();
+
+private:
+    struct Doc {
+        QString path;
+        qint64 modified{0};         ///< file mtime (ms) the words are from
+        QVector<QStringList> pages;
+    };
+    struct Queued {
+        Note note;
+        QString path;
+        qint64 modified{0};
+    };
+    struct CachedTerms {
+        std::weak_ptr<const NotePagePayload> payload;
+        QStringList terms;
+    };
+
+    NoteSearchIndex();
+
+    void drain();
+    /// Notes below `libraryDir` whose entry is missing or stale; drops
+    /// entries of deleted notes.
+    void crawl(const QString& libraryDir, const QString& file);
+    QVector<QStringList> extract(const Note& note);
+    /// Callers hold m_mutex.
+    void setDocLocked(const QString& path, qint64 modified,
+                      QVector<QStringList> pages);
+    void removeDocLocked(const QString& path);
+    void scheduleLocked();
+    bool loadLocked();
+    static bool save(const QString& file, const QVector<Doc>& docs);
+
+    mutable QMutex m_mutex;
+    QString m_file;
+    QHash<QString, int> m_docIds;   ///< path -> index into m_docs
+    QVector<Doc> m_docs;            ///< removed docs leave an empty path
+    /// term -> doc id -> pages
+    QMap<QString, QHash<int, QVector<int>>> m_terms;
+
+    QHash<QString, Queued> m_queue;
+    QString m_crawlDir;             ///< library still to be crawled
+    QStringList m_crawlQueue;       ///< stale notes found by crawl()
+    bool m_draining{false};
+    bool m_dirty{false};            ///< file behind memory
+    QHash<const NotePagePayload*, CachedTerms> m_payloadTerms; ///< drain() only
+};
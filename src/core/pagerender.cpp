@@ -0,0 +1,391 @@
+#include "pagerender.h"
+#include "PageItem.h"
+#include "strokegeometry.h"
+#include "uiscale.h"
+#include <QCache>
+#include <QFont>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPair>
+#include <QtMath>
+#include <QPen>
+
+namespace {
+
+QMutex &rasterizerMutex() {
+  static QMutex m;
+  return m;
+}
+
+PageRender::PdfRasterizer &pdfRasterizer() {
+  static PageRender::PdfRasterizer r;
+  return r;
+}
+
+/// `page`'s PDF source at `size`, if it beats the stored raster.
+QImage pdfBackground(const NotePage &page, const QSize &size) {
+  if (!page.pdf.isValid() || size.isEmpty())
+    return QImage();
+  const QImage &stored = page.backgroundImage;
+  if (!stored.isNull() && stored.width() >= size.width() &&
+      stored.height() >= size.height())
+    return QImage();
+  PageRender::PdfRasterizer rasterizer;
+  {
+    QMutexLocker lock(&rasterizerMutex());
+    rasterizer = pdfRasterizer();
+  }
+  return rasterizer ? rasterizer(page.pdf, size) : QImage();
+}
+
+/// FNV-1a, stable across runs and platforms (qHash is seeded per process).
+struct Fnv {
+  quint64 h{1469598103934665603ull};
+  void bytes(const void *data, qsizetype len) {
+    const auto *p = static_cast<const uchar *>(data);
+    for (qsizetype i = 0; i < len; ++i) {
+      h ^= p[i];
+      h *= 1099511628211ull;
+    }
+  }
+  template <typename T> void value(const T &v) { bytes(&v, sizeof(T)); }
+  void text(const QString &s) {
+    value(qsizetype(s.size()));
+    bytes(s.constData(), s.size() * qsizetype(sizeof(QChar)));
+  }
+};
+
+/// Stickies, graphs and text boxes of `page` (revision() and stamp()).
+void hashObjects(Fnv &f, const NotePage &page) {
+  for (const StickyNoteObject &sn : page.stickies) {
+    f.value(sn.pos);
+    f.value(sn.width);
+    f.value(sn.height);
+    f.value(sn.color.rgba());
+    f.value(sn.fontPointSize);
+    f.text(sn.text);
+  }
+  for (const GraphObject &g : page.graphs)
+    f.value(g.rect);
+  for (const TextObject &t : page.texts) {
+    f.value(t.pos);
+    f.value(t.width);
+    f.value(t.color.rgba());
+    f.value(t.fontPointSize);
+    f.text(t.fontFamily);
+    f.text(t.text);
+  }
+}
+
+/// Vertices closer than this (device pixels) to the last kept one are
+/// skipped in thumbnails.
+constexpr qreal kSimplifyPx = 0.75;
+/// Strokes whose ink box is smaller than this (device pixels) are skipped.
+constexpr qreal kMinInkPx = 0.5;
+/// Below this device size sticky note text is not laid out at all.
+constexpr qreal kMinTextPx = 3.0;
+
+/// Background image reduced by halving steps (2x2 box filter each) to the
+/// smallest level that still covers `target`. Levels are shared by every
+/// thumbnail size and page that use the same image.
+QImage mipLevel(const QImage &image, const QSize &target) {
+  int level = 0;
+  QSize levelSize = image.size();
+  while (levelSize.width() / 2 >= target.width() &&
+         levelSize.height() / 2 >= target.height()) {
+    levelSize /= 2;
+    ++level;
+  }
+  if (level == 0)
+    return image;
+
+  static QMutex mutex;
+  static QCache<QPair<qint64, int>, QImage> cache(32 * 1024); // KB
+  const QPair<qint64, int> key(image.cacheKey(), level);
+  {
+    QMutexLocker lock(&mutex);
+    if (const QImage *hit = cache.object(key))
+      return *hit;
+  }
+  QImage mip = image;
+  for (int i = 0; i < level; ++i)
+    mip = mip.scaled(mip.size() / 2, Qt::IgnoreAspectRatio,
+                     Qt::SmoothTransformation);
+  QMutexLocker lock(&mutex);
+  cache.insert(key, new QImage(mip), qMax<qsizetype>(1, mip.sizeInBytes() / 1024));
+  return mip;
+}
+
+/// Polyline of `pts` without the vertices within `minDist` of the previous
+/// kept one (the first and last vertex are always kept).
+QVector<QPointF> simplified(const StrokePoints &pts, qreal minDist) {
+  QVector<QPointF> out;
+  out.reserve(pts.size());
+  const qreal min2 = minDist * minDist;
+  const int last = pts.size() - 1;
+  int i = 0;
+  for (const QPointF &q : pts) {
+    if (i == 0 || i == last) {
+      out.append(q);
+    } else {
+      const QPointF d = q - out.last();
+      if (d.x() * d.x() + d.y() * d.y() >= min2)
+        out.append(q);
+    }
+    ++i;
+  }
+  return out;
+}
+
+/// Paper and content of one page at `scale` device pixels per page unit.
+/// With `lod` (thumbnails) detail that would not show is dropped: sub-pixel
+/// strokes, polyline vertices closer than kSimplifyPx, text too small to
+/// read; the background image comes from a mip level near the target size.
+/// Without `graphFrames` graphs are left to the caller.
+void paintPage(QPainter &p, const NotePage &page, int pageW, int pageH,
+               qreal scale, bool lod, bool graphFrames = true) {
+  const QColor paper =
+      page.paperColor.isValid() ? page.paperColor : QColor(Qt::white);
+
+  const QSize deviceSize(qCeil(pageW * scale), qCeil(pageH * scale));
+  const QImage fromPdf = pdfBackground(page, deviceSize);
+  if (!fromPdf.isNull()) {
+    p.drawImage(QRectF(0, 0, pageW, pageH), fromPdf);
+  } else if (!page.backgroundImage.isNull()) {
+    const QImage &bg =
+        lod ? mipLevel(page.backgroundImage, deviceSize) : page.backgroundImage;
+    p.drawImage(QRectF(0, 0, pageW, pageH), bg);
+  } else {
+    const int L = paper.lightness();
+    const QColor lineCol =
+        L < 130 ? QColor(255, 255, 255, 50) : QColor(190, 190, 210, 110);
+    const auto type = static_cast<PageBackgroundType>(page.backgroundType);
+    switch (type) {
+    case PageBackgroundType::Blank:
+      break;
+    case PageBackgroundType::Lined:
+    case PageBackgroundType::Legal: {
+      p.setPen(QPen(lineCol, 1));
+      for (int y = 40; y < pageH; y += 40)
+        p.drawLine(0, y, pageW, y);
+      if (type == PageBackgroundType::Legal) {
+        p.setPen(QPen(L < 130 ? QColor(255, 120, 120) : QColor(220, 80, 80), 2));
+        p.drawLine(72, 0, 72, pageH);
+      }
+      break;
+    }
+    case PageBackgroundType::Grid: {
+      p.setPen(QPen(lineCol, 1));
+      for (int x = 40; x < pageW; x += 40)
+        p.drawLine(x, 0, x, pageH);
+      for (int y = 40; y < pageH; y += 40)
+        p.drawLine(0, y, pageW, y);
+      break;
+    }
+    case PageBackgroundType::Dotted: {
+      p.setPen(Qt::NoPen);
+      p.setBrush(lineCol);
+      for (int y = 40; y < pageH; y += 40)
+        for (int x = 40; x < pageW; x += 40)
+          p.drawEllipse(QPointF(x, y), 1.4, 1.4);
+      break;
+    }
+    }
+  }
+
+  const qreal minInk = kMinInkPx / scale;
+  const qreal minStep = kSimplifyPx / scale;
+  for (const auto &s : page.strokes) {
+    QColor c = s.color;
+    if (s.isHighlighter)
+      c.setAlpha(80);
+    else if (!s.isEraser)
+      c.setAlpha(255);
+    QPen pen;
+    if (s.isEraser)
+      pen = QPen(paper, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    else
+      pen = QPen(c, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    p.setPen(pen);
+    p.setBrush(Qt::NoBrush);
+    if (!lod && StrokeGeometry::hasOutline(s)) {
+      p.fillPath(StrokeGeometry::outline(s), c);
+      continue;
+    }
+    if (!lod || s.points.isEmpty()) {
+      p.drawPath(StrokeGeometry::path(s));
+      continue;
+    }
+    const QRectF ink = s.points.boundingRect().adjusted(
+        -s.width / 2, -s.width / 2, s.width / 2, s.width / 2);
+    if (ink.width() < minInk && ink.height() < minInk)
+      continue;
+    const QVector<QPointF> pts = simplified(s.points, minStep);
+    if (pts.size() == 1)
+      p.drawPoint(pts.first());
+    else
+      p.drawPolyline(pts.constData(), int(pts.size()));
+  }
+
+  for (const auto &sn : page.stickies) {
+    const QRectF r(sn.pos, QSizeF(sn.width, sn.height));
+    p.setPen(QPen(QColor(0, 0, 0, 40), 1));
+    p.setBrush(sn.color.isValid() ? sn.color : QColor(255, 236, 120));
+    p.drawRoundedRect(r, 6, 6);
+    const qreal pointSize =
+        qMax(8.0, sn.fontPointSize > 0 ? sn.fontPointSize : 14.0);
+    if (lod && pointSize * scale < kMinTextPx)
+      continue;
+    p.setPen(QColor(40, 40, 40));
+    QFont f = p.font();
+    f.setPointSizeF(pointSize);
+    p.setFont(f);
+    p.drawText(r.adjusted(8, 8, -8, -8), Qt::TextWordWrap | Qt::AlignTop,
+               sn.text);
+  }
+
+  for (const auto &g : page.graphs) {
+    if (!graphFrames)
+      break;
+    p.setPen(QPen(QColor(90, 90, 110), 1.2));
+    p.setBrush(QColor(255, 255, 255, 210));
+    p.drawRect(g.rect);
+    if (lod && 12 * scale < kMinTextPx)
+      continue;
+    p.setPen(QColor(120, 120, 140));
+    p.drawText(g.rect.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop,
+               QStringLiteral("Graph"));
+  }
+
+  const QFont baseFont = p.font();
+  for (const auto &t : page.texts) {
+    const int pointSize = qBound(8, t.fontPointSize, 72);
+    if (lod && pointSize * scale < kMinTextPx)
+      continue;
+    QFont f = baseFont;
+    if (!t.fontFamily.isEmpty())
+      f.setFamily(t.fontFamily);
+    f.setPointSize(pointSize);
+    p.setFont(f);
+    p.setPen(t.color.isValid() ? t.color : QColor(Qt::black));
+    // Laid out like the QGraphicsTextItem: 4 px document margin.
+    const qreal w = qMax(20.0, t.width);
+    p.drawText(QRectF(t.pos.x() + 4, t.pos.y() + 4, w - 8, pageH),
+               Qt::TextWordWrap | Qt::AlignTop | Qt::AlignLeft, t.text);
+  }
+}
+
+} // namespace
+
+namespace PageRender {
+
+QSize a4Size() {
+#ifdef Q_OS_ANDROID
+  const qreal scale = UiScale::dp(100) / 100.0;
+  return QSize(qRound(793 * scale), qRound(1122 * scale));
+#else
+  return QSize(793, 1122);
+#endif
+}
+
+// Full page raster for export. Includes paper, PDF background images,
+// ruled patterns, strokes and sticky notes so imported PDFs no longer
+// export as blank white pages.
+QImage renderPage(const NotePage &page, int pageW, int pageH) {
+  QImage img(pageW, pageH, QImage::Format_ARGB32_Premultiplied);
+  img.fill(page.paperColor.isValid() ? page.paperColor : QColor(Qt::white));
+  QPainter p(&img);
+  p.setRenderHint(QPainter::Antialiasing);
+  p.setRenderHint(QPainter::SmoothPixmapTransform);
+  paintPage(p, page, pageW, pageH, 1.0, false);
+  p.end();
+  return img;
+}
+
+// Painted straight into the target size (no full-page raster to scale
+// down), with the level of detail of that size.
+QImage renderThumbnail(const NotePage &page, int pageW, int pageH,
+                       const QSize &size) {
+  const QSize target = QSize(pageW, pageH).scaled(size, Qt::KeepAspectRatio);
+  if (target.isEmpty() || pageW <= 0 || pageH <= 0)
+    return QImage();
+  QImage img(target, QImage::Format_ARGB32_Premultiplied);
+  img.fill(page.paperColor.isValid() ? page.paperColor : QColor(Qt::white));
+  QPainter p(&img);
+  p.setRenderHint(QPainter::Antialiasing);
+  p.setRenderHint(QPainter::SmoothPixmapTransform);
+  const qreal sx = qreal(target.width()) / pageW;
+  const qreal sy = qreal(target.height()) / pageH;
+  p.scale(sx, sy);
+  paintPage(p, page, pageW, pageH, qMin(sx, sy), true);
+  p.end();
+  return img;
+}
+
+void paintVector(QPainter &p, const NotePage &page, int pageW, int pageH,
+                 bool graphFrames) {
+  p.fillRect(QRectF(0, 0, pageW, pageH),
+             page.paperColor.isValid() ? page.paperColor : QColor(Qt::white));
+  paintPage(p, page, pageW, pageH, 1.0, false, graphFrames);
+}
+
+void setPdfRasterizer(PdfRasterizer rasterizer) {
+  QMutexLocker lock(&rasterizerMutex());
+  pdfRasterizer() = std::move(rasterizer);
+}
+
+quint64 revision(const NotePage &page) {
+  Fnv f;
+  f.value(page.backgroundType);
+  f.value(page.paperColor.rgba());
+  f.value(page.rotationDegrees);
+  if (!page.isLoaded()) {
+    const quint64 stored = page.pendingPayload->revision();
+    if (stored == 0)
+      return 0;
+    f.value(stored);
+    return f.h;
+  }
+  for (const Stroke &s : page.strokes) {
+    f.value(s.points.size());
+    f.bytes(s.points.positionData().constData(), s.points.positionData().size());
+    f.bytes(s.points.pressureData().constData(), s.points.pressureData().size());
+    f.value(s.width);
+    f.value(s.color.rgba());
+    f.value(quint8(s.isEraser | (s.isHighlighter << 1)));
+  }
+  hashObjects(f, page);
+  const QImage &bg = page.backgroundImage;
+  if (!bg.isNull()) {
+    // Every 32nd scanline: imports differ everywhere, hashing all of a
+    // page-sized raster would cost more than the thumbnail.
+    f.value(bg.size());
+    for (int y = 0; y < bg.height(); y += 32)
+      f.bytes(bg.constScanLine(y), bg.bytesPerLine());
+  }
+  return f.h;
+}
+
+quint64 stamp(const NotePage &page) {
+  Fnv f;
+  f.value(page.backgroundType);
+  f.value(page.paperColor.rgba());
+  f.value(page.rotationDegrees);
+  if (!page.isLoaded()) {
+    f.value(quintptr(page.pendingPayload.get()));
+    f.value(page.pendingPayload->revision());
+    return f.h;
+  }
+  for (const Stroke &s : page.strokes) {
+    f.value(s.points.id());
+    f.value(s.width);
+    f.value(s.color.rgba());
+    f.value(quint8(s.isEraser | (s.isHighlighter << 1)));
+  }
+  hashObjects(f, page);
+  f.value(page.backgroundImage.cacheKey());
+  return f.h;
+}
+
+} // namespace PageRender
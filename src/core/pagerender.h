@@ -0,0 +1,49 @@
+#pragma once
+#include "Note.h"
+#include <QImage>
+#include <QSize>
+#include <functional>
+
+class QPainter;
+
+/// Rasterises NotePage content outside the scene (thumbnails, library
+/// covers, image/PDF export). Safe on worker threads.
+namespace PageRender {
+
+/// Page size in page coordinates: A4 at 96 dpi, dp-scaled on Android
+/// (the same frame MultiPageNoteView lays its pages out in).
+QSize a4Size();
+
+/// Full page raster: paper, PDF background image, ruling, strokes, sticky
+/// notes, graph frames and text boxes.
+QImage renderPage(const NotePage &page, int pageW, int pageH);
+/// The page painted straight at the size that fits `size` (no full-size
+/// raster): sub-pixel strokes are skipped, polylines thinned to that
+/// resolution, background images sampled from a reduced level.
+QImage renderThumbnail(const NotePage &page, int pageW, int pageH,
+                       const QSize &size);
+
+/// The same content painted in page coordinates on `p`, without a raster in
+/// between: on a PDF painter paper, ruling, strokes and text stay vectors
+/// and the background image keeps its own resolution. Without
+/// `graphFrames` graphs are left out for callers that plot them.
+void paintVector(QPainter &p, const NotePage &page, int pageW, int pageH,
+                 bool graphFrames = true);
+
+/// Renders the PDF page `ref` at `size` on the calling thread; null when the
+/// document is not on this device. Qt PDF lives in the UI layer, which
+/// registers it at startup. Pages with a PDF source whose stored raster is
+/// coarser than the requested output are drawn from the document.
+using PdfRasterizer = std::function<QImage(const PdfPageRef &ref, const QSize &size)>;
+void setPdfRasterizer(PdfRasterizer rasterizer);
+
+/// Hash of what renderPage() draws, for caches that outlive the process.
+/// Unread pages use their payload's revision (no decoding); 0 = unknown.
+/// The same content hashes differently read and unread.
+quint64 revision(const NotePage &page);
+/// Cheap identity of the page state within this process: StrokePoints::id()
+/// and QImage::cacheKey() stand in for the bytes revision() hashes. Changes
+/// whenever revision() would; not stable across runs.
+quint64 stamp(const NotePage &page);
+
+} // namespace PageRender
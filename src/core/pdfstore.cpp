@@ -0,0 +1,120 @@
+#include "pdfstore.h"
+#include "bnotefile.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStandardPaths>
+
+namespace {
+/// Hashes come from note files; never let one name a path outside the store.
+bool isHash(const QByteArray &doc) {
+  if (doc.size() != 40)
+    return false;
+  for (const char c : doc) {
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+      return false;
+  }
+  return true;
+}
+} // namespace
+
+PdfStore &PdfStore::instance() {
+  static PdfStore store;
+  return store;
+}
+
+PdfStore::PdfStore()
+    : m_dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+            QStringLiteral("/pdf")) {}
+
+QString PdfStore::fileFor(const QByteArray &doc) const {
+  return m_dir + QLatin1Char('/') + QString::fromLatin1(doc) +
+         QStringLiteral(".pdf");
+}
+
+QByteArray PdfStore::add(const QString &pdfPath) {
+  QFile in(pdfPath);
+  if (!in.open(QIODevice::ReadOnly)) {
+    qWarning() << "PdfStore: cannot read" << pdfPath;
+    return QByteArray();
+  }
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  if (!hash.addData(&in))
+    return QByteArray();
+  const QByteArray doc = hash.result().toHex();
+  const QString target = fileFor(doc);
+
+  QMutexLocker lock(&m_mutex);
+  const QFileInfo existing(target);
+  if (existing.exists() && existing.size() == in.size()) {
+    // Imported again: the grace period of collectGarbage() starts over.
+    QFile stored(target);
+    if (stored.open(QIODevice::Append))
+      stored.setFileTime(QDateTime::currentDateTime(),
+                         QFileDevice::FileModificationTime);
+    return doc;
+  }
+  if (!QDir().mkpath(m_dir))
+    return QByteArray();
+  // Copy under a temporary name so a torn copy is never taken for the
+  // document.
+  const QString partial = target + QStringLiteral(".part");
+  QFile::remove(partial);
+  if (!QFile::copy(pdfPath, partial)) {
+    qWarning() << "PdfStore: cannot copy" << pdfPath;
+    QFile::remove(partial);
+    return QByteArray();
+  }
+  QFile::remove(target);
+  if (!QFile::rename(partial, target)) {
+    QFile::remove(partial);
+    return QByteArray();
+  }
+  return doc;
+}
+
+QString PdfStore::path(const QByteArray &doc) const {
+  if (!isHash(doc))
+    return QString();
+  const QString file = fileFor(doc);
+  return QFileInfo::exists(file) ? file : QString();
+}
+
+int PdfStore::collectGarbage(const QStringList &libraryDirs) {
+  QSet<QByteArray> referenced;
+  for (const QString &dir : libraryDirs) {
+    if (dir.isEmpty())
+      continue;
+    QDirIterator it(dir, {QStringLiteral("*.bnote")}, QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+      Note note;
+      if (!BnoteFile::read(it.next(), note))
+        continue;
+      for (const NotePage &page : std::as_const(note.pages)) {
+        if (page.pdf.isValid())
+          referenced.insert(page.pdf.doc);
+      }
+    }
+  }
+
+  const QDateTime cutoff = QDateTime::currentDateTime().addDays(-kGraceDays);
+  int removed = 0;
+  QMutexLocker lock(&m_mutex);
+  const QFileInfoList files =
+      QDir(m_dir).entryInfoList({QStringLiteral("*.pdf")}, QDir::Files);
+  for (const QFileInfo &fi : files) {
+    const QByteArray doc = fi.completeBaseName().toLatin1();
+    if (!isHash(doc) || referenced.contains(doc) || fi.lastModified() > cutoff)
+      continue;
+    if (QFile::remove(fi.absoluteFilePath()))
+      ++removed;
+  }
+  return removed;
+}
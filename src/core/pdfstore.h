@@ -0,0 +1,41 @@
+#pragma once
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/// Content-addressed copies of imported PDFs, so pages can keep pointing at
+/// their document (PdfPageRef) after the original file moves or is deleted.
+///
+///   dir   "<AppData>/pdf/<sha1>.pdf"
+///
+/// Documents are shared by every note that imported the same file. A note
+/// opened on a device without the document falls back to the page raster it
+/// keeps. collectGarbage() drops documents no note refers to any more.
+/// Thread-safe.
+class PdfStore {
+public:
+    static PdfStore& instance();
+
+    /// Copies `pdfPath` into the store unless an identical document is
+    /// already there. Returns its hash, empty on failure. Reads the whole
+    /// file; keep it off the UI thread.
+    QByteArray add(const QString& pdfPath);
+    /// Stored file of `doc`, empty if this device does not have it.
+    QString path(const QByteArray& doc) const;
+    /// Removes documents that no .bnote below `libraryDirs` refers to and
+    /// that were not added within the last kGraceDays (an import whose note
+    /// is not saved yet). Reads the table of contents of every note; keep it
+    /// off the UI thread. Returns the number of documents removed.
+    int collectGarbage(const QStringList& libraryDirs);
+
+    static constexpr int kGraceDays = 7;
+
+private:
+    PdfStore();
+
+    QString fileFor(const QByteArray& doc) const;
+
+    QString m_dir;
+    mutable QMutex m_mutex; ///< serialises add()
+};
@@ -0,0 +1,326 @@
+#include "strokegeometry.h"
+#include <QCache>
+#include <QMutex>
+#include <QPolygonF>
+#include <QtMath>
+#include <cmath>
+
+namespace {
+
+/// Pieces shorter than this (page px) are dropped instead of leaving dust.
+constexpr qreal kMinPieceLength = 0.5;
+/// Same floor StrokeItem always used, so light strokes never vanish.
+constexpr qreal kMinPressure = 0.1;
+/// Corners sharper than this (cosine between segments, ~20°) get a round
+/// join; gentler ones a single mitred point per side.
+constexpr qreal kJoinCos = 0.94;
+/// Polygon points per half circle (caps; joins in proportion).
+constexpr int kArcSteps = 8;
+/// Outline cache budget in path elements (24 bytes each): a few MB, enough
+/// for the pages being drawn; the tile cache keeps what they look like.
+constexpr int kOutlineCacheElements = 1 << 18;
+
+struct CachedOutline {
+  QPainterPath path;
+  qreal width;
+};
+
+QMutex &outlineMutex() {
+  static QMutex m;
+  return m;
+}
+
+QCache<quint64, CachedOutline> &outlineCache() {
+  static QCache<quint64, CachedOutline> cache(kOutlineCacheElements);
+  return cache;
+}
+
+struct CutPoint {
+  QPointF pos;
+  qreal pressure{1.0};
+};
+
+bool longerThan(const QVector<QPointF> &pts, qreal min) {
+  qreal len = 0.0;
+  for (int i = 1; i < pts.size(); ++i) {
+    const QPointF d = pts[i] - pts[i - 1];
+    len += std::sqrt(QPointF::dotProduct(d, d));
+    if (len >= min)
+      return true;
+  }
+  return false;
+}
+
+QPointF unit(const QPointF &v) {
+  const qreal len = std::sqrt(QPointF::dotProduct(v, v));
+  return len > 0.0 ? v / len : QPointF();
+}
+
+/// `d` turned by +90°.
+QPointF normal(const QPointF &d) { return QPointF(-d.y(), d.x()); }
+
+/// Points on the circle (`c`, `r`) from direction `from`, turning by
+/// `sweep` radians; the start point is left out.
+void appendArc(QPolygonF &out, const QPointF &c, qreal r, const QPointF &from,
+               qreal sweep) {
+  const int steps =
+      qMax(1, int(std::ceil(std::abs(sweep) / (M_PI / kArcSteps))));
+  const qreal a0 = std::atan2(from.y(), from.x());
+  for (int k = 1; k <= steps; ++k) {
+    const qreal a = a0 + sweep * k / steps;
+    out.append(c + QPointF(std::cos(a), std::sin(a)) * r);
+  }
+}
+
+} // namespace
+
+QPainterPath StrokeGeometry::path(const Stroke &s) {
+  QPainterPath path;
+  auto it = s.points.begin();
+  const auto end = s.points.end();
+  if (it == end)
+    return path;
+  path.reserve(s.points.size());
+  path.moveTo(*it);
+  for (++it; it != end; ++it)
+    path.lineTo(*it);
+  return path;
+}
+
+bool StrokeGeometry::hasOutline(const Stroke &s) {
+  return !s.isEraser && !s.isHighlighter && s.points.hasPressure();
+}
+
+QPainterPath StrokeGeometry::outline(const Stroke &s) {
+  if (!hasOutline(s))
+    return QPainterPath();
+  const quint64 key = s.points.id();
+  {
+    QMutexLocker lock(&outlineMutex());
+    if (const CachedOutline *hit = outlineCache().object(key)) {
+      if (hit->width == s.width)
+        return hit->path;
+    }
+  }
+  const QVector<QPointF> pts = s.points.points();
+  const QVector<qreal> pressures = s.points.pressures();
+  QPainterPath built = pressureOutline(pts.constData(), pressures.constData(),
+                                       int(pts.size()), s.width);
+  QMutexLocker lock(&outlineMutex());
+  outlineCache().insert(key, new CachedOutline{built, s.width},
+                        qMax(1, built.elementCount()));
+  return built;
+}
+
+QPainterPath StrokeGeometry::pressureOutline(const QPointF *points,
+                                             const qreal *pressures, int count,
+                                             qreal width) {
+  QPainterPath outline;
+  outline.setFillRule(Qt::WindingFill);
+  if (count <= 0)
+    return outline;
+
+  // Repeated samples (pen resting) have no direction; keep the widest.
+  QVector<QPointF> pts;
+  QVector<qreal> radii;
+  pts.reserve(count);
+  radii.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    const qreal r = 0.5 * width * qMax(kMinPressure, pressures[i]);
+    if (!pts.isEmpty()) {
+      const QPointF d = points[i] - pts.last();
+      if (QPointF::dotProduct(d, d) < 1e-6) {
+        radii.last() = qMax(radii.last(), r);
+        continue;
+      }
+    }
+    pts.append(points[i]);
+    radii.append(r);
+  }
+  const int n = pts.size();
+  if (n == 1) {
+    outline.addEllipse(pts[0], radii[0], radii[0]);
+    return outline;
+  }
+
+  QVector<QPointF> dirs(n - 1);
+  for (int i = 0; i + 1 < n; ++i)
+    dirs[i] = unit(pts[i + 1] - pts[i]);
+
+  // Left side forward, end cap, right side backward, start cap.
+  QPolygonF left;
+  QPolygonF right;
+  left.reserve(n + 8);
+  right.reserve(n + 8);
+  left.append(pts[0] + normal(dirs[0]) * radii[0]);
+  right.append(pts[0] - normal(dirs[0]) * radii[0]);
+  for (int i = 1; i + 1 < n; ++i) {
+    const QPointF n0 = normal(dirs[i - 1]);
+    const QPointF n1 = normal(dirs[i]);
+    const qreal r = radii[i];
+    if (QPointF::dotProduct(dirs[i - 1], dirs[i]) >= kJoinCos) {
+      const QPointF m = unit(n0 + n1);
+      const QPointF off = m * (r / QPointF::dotProduct(m, n0));
+      left.append(pts[i] + off);
+      right.append(pts[i] - off);
+      continue;
+    }
+    // Both sides turn the same way; the inner arc stays inside the ink.
+    qreal sweep = std::atan2(n1.y(), n1.x()) - std::atan2(n0.y(), n0.x());
+    if (sweep > M_PI)
+      sweep -= 2 * M_PI;
+    else if (sweep < -M_PI)
+      sweep += 2 * M_PI;
+    left.append(pts[i] + n0 * r);
+    appendArc(left, pts[i], r, n0, sweep);
+    right.append(pts[i] - n0 * r);
+    appendArc(right, pts[i], r, -n0, sweep);
+  }
+  const QPointF nLast = normal(dirs[n - 2]);
+  left.append(pts[n - 1] + nLast * radii[n - 1]);
+  right.append(pts[n - 1] - nLast * radii[n - 1]);
+
+  QPolygonF poly = left;
+  poly.reserve(left.size() + right.size() + 2 * kArcSteps);
+  appendArc(poly, pts[n - 1], radii[n - 1], nLast, -M_PI);
+  poly.removeLast(); // == right.last()
+  for (int i = int(right.size()) - 1; i >= 0; --i)
+    poly.append(right[i]);
+  appendArc(poly, pts[0], radii[0], -normal(dirs[0]), -M_PI);
+  poly.removeLast(); // == left.first()
+  outline.addPolygon(poly);
+  outline.closeSubpath();
+  return outline;
+}
+
+bool StrokeGeometry::eraseDisc(const Stroke &s, const QPointF &center,
+                               qreal radius, QVector<Stroke> *pieces,
+                               int firstSegment, int lastSegment) {
+  const int n = s.points.size();
+  if (n == 0)
+    return false;
+  const qreal reach = radius + 0.5 * s.width;
+  const qreal reach2 = reach * reach;
+  auto inside = [&](const QPointF &p) {
+    const QPointF d = p - center;
+    return QPointF::dotProduct(d, d) <= reach2;
+  };
+  if (n == 1) {
+    if (!inside(s.points.first()))
+      return false;
+    if (pieces)
+      pieces->clear();
+    return true;
+  }
+
+  // Decoded once; the pieces are encoded again as they are emitted.
+  const QVector<QPointF> pts = s.points.points();
+  const QVector<qreal> pressures = s.points.pressures();
+  const bool hasPressure = pressures.size() == n;
+
+  QVector<Stroke> out;
+  // Survivor = optional head cut + points[from..to] + optional tail cut.
+  auto emitPiece = [&](const CutPoint *head, int from, int to,
+                       const CutPoint *tail) {
+    const int count = qMax(0, to - from + 1);
+    QVector<QPointF> piece;
+    piece.reserve(count + 2);
+    if (head)
+      piece.append(head->pos);
+    if (count)
+      piece.append(pts.mid(from, count));
+    if (tail)
+      piece.append(tail->pos);
+    if (piece.size() < 2 || !longerThan(piece, kMinPieceLength))
+      return;
+    QVector<qreal> piecePressures;
+    if (hasPressure) {
+      piecePressures.reserve(piece.size());
+      if (head)
+        piecePressures.append(head->pressure);
+      if (count)
+        piecePressures.append(pressures.mid(from, count));
+      if (tail)
+        piecePressures.append(tail->pressure);
+    }
+    Stroke p = s;
+    p.points = StrokePoints(piece, piecePressures);
+    out.append(std::move(p));
+  };
+  auto cutAt = [&](int i, qreal t) {
+    CutPoint c;
+    c.pos = pts[i] + (pts[i + 1] - pts[i]) * t;
+    if (hasPressure)
+      c.pressure = pressures[i] + (pressures[i + 1] - pressures[i]) * t;
+    return c;
+  };
+
+  const int segEnd = lastSegment < 0 ? n - 1 : qMin(lastSegment, n - 1);
+  const int segBegin = qBound(0, firstSegment, segEnd);
+  bool touched = false;
+  bool open = !inside(pts[segBegin]);
+  bool hasHead = false;
+  CutPoint head;
+  int sliceStart = 0;
+  if (!open && segBegin > 0) {
+    // Range hint started inside the circle; keep what lies before it.
+    emitPiece(nullptr, 0, segBegin - 1, nullptr);
+    touched = true;
+  }
+
+  for (int i = segBegin; i < segEnd; ++i) {
+    const QPointF a = pts[i];
+    const QPointF b = pts[i + 1];
+    if (qMax(a.x(), b.x()) < center.x() - reach ||
+        qMin(a.x(), b.x()) > center.x() + reach ||
+        qMax(a.y(), b.y()) < center.y() - reach ||
+        qMin(a.y(), b.y()) > center.y() + reach)
+      continue;
+    // |a + t(b-a) - center|^2 = reach^2
+    const QPointF ab = b - a;
+    const QPointF ac = a - center;
+    const qreal qa = QPointF::dotProduct(ab, ab);
+    const qreal qb = 2.0 * QPointF::dotProduct(ac, ab);
+    const qreal qc = QPointF::dotProduct(ac, ac) - reach2;
+    qreal t1 = 0.0;
+    qreal t2 = 1.0;
+    if (qa <= 1e-12) {
+      if (qc > 0.0)
+        continue;
+    } else {
+      const qreal disc = qb * qb - 4.0 * qa * qc;
+      if (disc <= 0.0)
+        continue; // misses or only grazes the circle
+      const qreal root = std::sqrt(disc);
+      t1 = (-qb - root) / (2.0 * qa);
+      t2 = (-qb + root) / (2.0 * qa);
+    }
+    if (t2 <= 0.0 || t1 >= 1.0)
+      continue;
+    const qreal tIn = qMax<qreal>(t1, 0.0);
+    const qreal tOut = qMin<qreal>(t2, 1.0);
+    touched = true;
+    if (open) {
+      if (tIn > 0.0) {
+        const CutPoint tail = cutAt(i, tIn);
+        emitPiece(hasHead ? &head : nullptr, sliceStart, i, &tail);
+      } else {
+        emitPiece(hasHead ? &head : nullptr, sliceStart, i - 1, nullptr);
+      }
+      open = false;
+    }
+    if (tOut < 1.0) {
+      head = cutAt(i, tOut);
+      hasHead = true;
+      sliceStart = i + 1;
+      open = true;
+    }
+  }
+  if (!touched)
+    return false;
+  if (open)
+    emitPiece(hasHead ? &head : nullptr, sliceStart, n - 1, nullptr);
+  if (pieces)
+    *pieces = std::move(out);
+  return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Note.h"
+#include <QPainterPath>
+#include <QPointF>
+#include <QVector>
+
+/// Point-level stroke edits. Strokes are polylines (Stroke::points, with
+/// optional per-point pressures); the path and the outline are derived from
+/// them when needed and not stored with the stroke.
+namespace StrokeGeometry {
+
+/// moveTo/lineTo over s.points. Built on every call.
+QPainterPath path(const Stroke &s);
+
+/// Whether `s` is drawn as a filled outline(): pressures, not highlighter
+/// or eraser. The others are drawn with a pen of `width` along path().
+bool hasOutline(const Stroke &s);
+
+/// Filled ink of a pressure stroke (pressureOutline()), empty when
+/// !hasOutline(). Built on first use and kept in a size-bounded cache keyed
+/// by StrokePoints::id() and width; safe from any thread.
+QPainterPath outline(const Stroke &s);
+
+/// Closed polygon around `count` points, `width * max(0.1, pressure) / 2`
+/// to either side, with round caps and round joins at sharp corners. Drawn
+/// with one QPainter::fillPath(); tight turns overlap themselves, hence
+/// Qt::WindingFill.
+QPainterPath pressureOutline(const QPointF *points, const qreal *pressures,
+                             int count, qreal width);
+
+/// Cuts the part of `s` whose ink lies within `radius` of `center` (page
+/// coordinates; half the stroke width is added). Returns false when the
+/// stroke is not touched. Otherwise `pieces` receives the surviving runs in
+/// order: exact cut points on the circle, pressures interpolated, all other
+/// fields copied. An empty result means the whole stroke is gone.
+///
+/// Only segments [firstSegment, lastSegment) are examined; callers that know
+/// where the circle can touch the stroke (StrokeSpatialIndex chunks) pass
+/// that range, everything outside is copied as is. lastSegment < 0: all.
+bool eraseDisc(const Stroke &s, const QPointF &center, qreal radius,
+               QVector<Stroke> *pieces, int firstSegment = 0,
+               int lastSegment = -1);
+
+} // namespace StrokeGeometry
@@ -0,0 +1,146 @@
+#include "strokepoints.h"
+#include <QTransform>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+std::atomic<quint64> g_nextId{1};
+
+qint32 toUnits(qreal v) {
+  return qint32(std::lround(v / StrokePoints::kUnit));
+}
+
+quint8 toByte(qreal pressure) {
+  return quint8(std::lround(qBound<qreal>(0.0, pressure, 1.0) * 255.0));
+}
+
+void writeDelta(QByteArray &out, qint32 v) {
+  quint32 u = (quint32(v) << 1) ^ quint32(v >> 31);
+  while (u >= 0x80) {
+    out.append(char((u & 0x7F) | 0x80));
+    u >>= 7;
+  }
+  out.append(char(u));
+}
+
+} // namespace
+
+StrokePoints::StrokePoints(const QVector<QPointF> &points,
+                           const QVector<qreal> &pressures) {
+  reserve(int(points.size()));
+  const bool withPressure = pressures.size() == points.size();
+  for (int i = 0; i < points.size(); ++i)
+    append(points[i], withPressure ? pressures[i] : 1.0);
+}
+
+void StrokePoints::touch() { m_id = g_nextId.fetch_add(1, std::memory_order_relaxed); }
+
+void StrokePoints::append(const QPointF &p, qreal pressure) {
+  const qint32 x = toUnits(p.x());
+  const qint32 y = toUnits(p.y());
+  writeDelta(m_xy, x - m_x);
+  writeDelta(m_xy, y - m_y);
+  const quint8 pr = toByte(pressure);
+  if (pr != 255 && m_pressure.isEmpty())
+    m_pressure.fill(char(255), m_count);
+  if (!m_pressure.isEmpty())
+    m_pressure.append(char(pr));
+  if (m_count == 0) {
+    m_minX = m_maxX = x;
+    m_minY = m_maxY = y;
+  } else {
+    m_minX = qMin(m_minX, x);
+    m_maxX = qMax(m_maxX, x);
+    m_minY = qMin(m_minY, y);
+    m_maxY = qMax(m_maxY, y);
+  }
+  m_x = x;
+  m_y = y;
+  ++m_count;
+  touch();
+}
+
+void StrokePoints::reserve(int n) {
+  // Handwriting: mostly one byte per axis.
+  m_xy.reserve(2 * n + 8);
+}
+
+void StrokePoints::clear() { *this = StrokePoints(); }
+
+void StrokePoints::clearPressures() {
+  if (m_pressure.isEmpty())
+    return;
+  m_pressure.clear();
+  touch();
+}
+
+QPointF StrokePoints::first() const {
+  return m_count ? *begin() : QPointF();
+}
+
+QRectF StrokePoints::boundingRect() const {
+  if (m_count == 0)
+    return QRectF();
+  return QRectF(QPointF(m_minX * kUnit, m_minY * kUnit),
+                QPointF(m_maxX * kUnit, m_maxY * kUnit));
+}
+
+StrokePoints::const_iterator StrokePoints::begin() const {
+  const_iterator it;
+  it.m_count = m_count;
+  if (m_count == 0)
+    return it;
+  it.m_p = m_xy.constData();
+  it.m_pressure = m_pressure.isEmpty() ? nullptr : m_pressure.constData();
+  it.step();
+  return it;
+}
+
+StrokePoints::const_iterator StrokePoints::end() const {
+  const_iterator it;
+  it.m_index = m_count;
+  it.m_count = m_count;
+  return it;
+}
+
+QVector<QPointF> StrokePoints::points() const {
+  QVector<QPointF> out;
+  out.reserve(m_count);
+  for (const QPointF &p : *this)
+    out.append(p);
+  return out;
+}
+
+QVector<QPointF> StrokePoints::points(int start, int end) const {
+  QVector<QPointF> out;
+  start = qMax(0, start);
+  end = qMin(end, m_count);
+  if (start >= end)
+    return out;
+  out.reserve(end - start);
+  auto it = begin();
+  for (int i = 0; i < start; ++i)
+    ++it;
+  for (int i = start; i < end; ++i, ++it)
+    out.append(*it);
+  return out;
+}
+
+QVector<qreal> StrokePoints::pressures() const {
+  QVector<qreal> out;
+  if (m_pressure.isEmpty())
+    return out;
+  out.reserve(m_count);
+  for (const char b : m_pressure)
+    out.append(quint8(b) / 255.0);
+  return out;
+}
+
+StrokePoints StrokePoints::mapped(const QTransform &xf) const {
+  StrokePoints out;
+  out.reserve(m_count);
+  for (auto it = begin(); it != end(); ++it)
+    out.append(xf.map(*it), it.pressure());
+  return out;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <QByteArray>
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+#include <QtGlobal>
+#include <iterator>
+
+class QTransform;
+
+/// Points and pressures of one stroke in compact form: positions rounded to
+/// kUnit page px and stored as zigzag varint deltas (one or two bytes per
+/// axis for handwriting), pressure as one byte per point. About 4 bytes a
+/// point instead of a QPointF plus a qreal plus the path elements built
+/// from them. Implicitly shared: the note model, undo snapshots and
+/// promoted StrokeItems hold the same buffers.
+///
+/// Reading is sequential; iterate, or decode() into plain vectors where an
+/// algorithm indexes. Every change gives the points a new id(), which
+/// caches of derived geometry key on (StrokeGeometry::outline()).
+class StrokePoints {
+public:
+    /// Position quantum in page px. Values on this grid are exact in the
+    /// float32 of .bnote, so saving and loading does not move them.
+    static constexpr qreal kUnit = 1.0 / 16.0;
+
+    /// Yields the positions as QPointF (by value).
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = QPointF;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = QPointF;
+
+        QPointF operator*() const { return QPointF(m_x * kUnit, m_y * kUnit); }
+        /// Pressure of the current point, 1.0 without hasPressure().
+        qreal pressure() const {
+            return m_pressure ? quint8(m_pressure[m_index]) / 255.0 : 1.0;
+        }
+        const_iterator& operator++() {
+            if (++m_index < m_count)
+                step();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const const_iterator& o) const { return m_index == o.m_index; }
+        bool operator!=(const const_iterator& o) const { return m_index != o.m_index; }
+
+    private:
+        friend class StrokePoints;
+        void step() {
+            m_x += readDelta(m_p);
+            m_y += readDelta(m_p);
+        }
+
+        const char* m_p{nullptr};
+        const char* m_pressure{nullptr};
+        int m_index{0};
+        int m_count{0};
+        qint32 m_x{0};
+        qint32 m_y{0};
+    };
+
+    StrokePoints() = default;
+    /// `pressures` parallel to `points`; empty = full pressure everywhere.
+    explicit StrokePoints(const QVector<QPointF>& points,
+                          const QVector<qreal>& pressures = QVector<qreal>());
+
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    /// false while every point has full pressure; such strokes are drawn
+    /// with a pen of the stroke width instead of a pressure outline.
+    bool hasPressure() const { return !m_pressure.isEmpty(); }
+
+    void append(const QPointF& p) { append(p, 1.0); }
+    void append(const QPointF& p, qreal pressure);
+    void push_back(const QPointF& p) { append(p, 1.0); }
+    void reserve(int n);
+    void clear();
+    /// All points at full pressure.
+    void clearPressures();
+
+    QPointF first() const;
+    QPointF last() const { return QPointF(m_x * kUnit, m_y * kUnit); }
+    /// Of the points only; add half the stroke width for the ink.
+    QRectF boundingRect() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    /// Plain copies for code that indexes.
+    QVector<QPointF> points() const;
+    /// Points [start, end) only (clamped); the ones before are stepped
+    /// over, not copied. For code that needs a stretch of a long stroke.
+    QVector<QPointF> points(int start, int end) const;
+    /// Parallel to points(); empty without hasPressure().
+    QVector<qreal> pressures() const;
+
+    /// The same stroke with every point mapped through `xf`.
+    StrokePoints mapped(const QTransform& xf) const;
+
+    /// Changes with every edit; copies share it. 0 for no points.
+    quint64 id() const { return m_id; }
+    /// Encoded form, e.g. for content hashes. Equal content, equal bytes.
+    const QByteArray& positionData() const { return m_xy; }
+    const QByteArray& pressureData() const { return m_pressure; }
+
+    bool operator==(const StrokePoints& o) const {
+        return m_count == o.m_count && m_xy == o.m_xy && m_pressure == o.m_pressure;
+    }
+    bool operator!=(const StrokePoints& o) const { return !(*this == o); }
+
+private:
+    static qint32 readDelta(const char*& p) {
+        quint32 u = 0;
+        int shift = 0;
+        quint8 b;
+        do {
+            b = quint8(*p++);
+            u |= quint32(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        return qint32(u >> 1) ^ -qint32(u & 1);
+    }
+    void touch();
+
+    QByteArray m_xy;       ///< x, y varint deltas per point
+    QByteArray m_pressure; ///< 0..255 per point; empty = all 255
+    int m_count{0};
+    qint32 m_x{0};         ///< last point, in kUnit
+    qint32 m_y{0};
+    qint32 m_minX{0};
+    qint32 m_minY{0};
+    qint32 m_maxX{0};
+    qint32 m_maxY{0};
+    quint64 m_id{0};
+};
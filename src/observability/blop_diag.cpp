@@ -8,6 +8,7 @@
 #include <QString>
 #include <QtGlobal>
 
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <cstdio>
@@ -58,6 +59,13 @@ std::atomic<bool> g_installed{false};
 // Pre-resolved crash file path (UTF-8). Reserved buffer up to 1024 bytes.
 char g_crashPath[1024] = {0};
 
+// Wet-ink latency samples of the current stroke (GUI thread). A long
+// stroke keeps its first kInkSamples frames; plenty for percentiles.
+constexpr int kInkSamples = 4096;
+qint64 g_inkSamples[kInkSamples];
+int g_inkSampleCount = 0;
+QString g_inkSummary;
+
 // Pre-opened crash file descriptor; -1 if open() failed. Best-effort: we
 // rotate a fresh fd on every install() call so a previous crash file is
 // overwritten on next start (after replay).
@@ -436,6 +444,36 @@ void recordUiAction(const QString &tag) {
   writeLineToRing("U", utf8.constData());
 }
 
+void recordInkLatency(qint64 usec) {
+  if (g_inkSampleCount < kInkSamples)
+    g_inkSamples[g_inkSampleCount++] = qMax<qint64>(0, usec);
+}
+
+void flushInkLatency() {
+  const int n = g_inkSampleCount;
+  if (n == 0)
+    return;
+  g_inkSampleCount = 0;
+  qint64 *first = g_inkSamples;
+  qint64 *last = g_inkSamples + n;
+  auto at = [&](int percent) {
+    qint64 *nth = first + qMin(n - 1, n * percent / 100);
+    std::nth_element(first, nth, last);
+    return *nth;
+  };
+  const qint64 p50 = at(50);
+  const qint64 p95 = at(95);
+  const qint64 max = *std::max_element(first, last);
+  g_inkSummary = QStringLiteral("ink_latency_us n=%1 p50=%2 p95=%3 max=%4")
+                     .arg(n)
+                     .arg(p50)
+                     .arg(p95)
+                     .arg(max);
+  writeLineToRing("P", g_inkSummary.toUtf8().constData());
+}
+
+QString inkLatencySummary() { return g_inkSummary; }
+
 QString takeCrashReportIfPresent() {
   // We always read from the rotated previous_crash.txt, written by the
   // previous run and rotated by this run's install().
@@ -17,6 +17,19 @@ void install();
 /// the ring buffer. Cheap. Safe to call from the GUI thread.
 void recordUiAction(const QString &tag);
 
+/// One pen-to-pixel sample of the wet-ink layer: microseconds from a pen
+/// sample reaching the layer to the end of the paint that shows it. Kept
+/// until the next flushInkLatency(). Cheap. GUI thread only.
+void recordInkLatency(qint64 usec);
+
+/// Writes "ink_latency_us n= p50= p95= max=" for the samples since the
+/// last flush to the ring buffer (so it shows up in crash reports) and
+/// starts over. Call on pen-up; does nothing without samples.
+void flushInkLatency();
+
+/// The last flushed summary line; empty before the first stroke.
+QString inkLatencySummary();
+
 /// If a crash dump from the previous run exists, return its contents and
 /// remove the file. Otherwise return an empty string. Call once at startup
 /// after MainWindow is shown.
@@ -291,6 +291,8 @@ void ProgressSession::setValue(int value) {
 }
 
 void ProgressSession::close() {
+  if (modal && bar)
+    QObject::disconnect(modal, &BlopModal::aboutToDismiss, bar, nullptr);
   if (modal)
     modal->dismiss();
   modal.clear();
@@ -299,7 +301,8 @@ void ProgressSession::close() {
 }
 
 ProgressSession presentProgress(QWidget *parent, const QString &title,
-                                const QString &message) {
+                                const QString &message,
+                                std::function<void()> onCancel) {
   ProgressSession session;
   auto *form = new QWidget;
   form->setMinimumWidth(320);
@@ -330,12 +333,26 @@ ProgressSession presentProgress(QWidget *parent, const QString &title,
                                                 BlopTheme::accentPrimary().name())));
   lay->addWidget(lbl);
   lay->addWidget(bar);
+  QPushButton *cancel = nullptr;
+  if (onCancel) {
+    auto *row = new QHBoxLayout;
+    row->addStretch();
+    cancel = new QPushButton(QObject::tr("Abbrechen"), form);
+    row->addWidget(cancel);
+    lay->addLayout(row);
+  }
 
   BlopModal *modal =
       BlopModal::present(parent ? parent->window() : parent, form,
                          BlopModal::Mode::Card, title);
   if (modal)
     modal->setPreferredCardWidth(420);
+  if (modal && onCancel) {
+    // Tied to the bar so close() can drop it before dismissing.
+    QObject::connect(modal, &BlopModal::aboutToDismiss, bar, onCancel);
+    QObject::connect(cancel, &QPushButton::clicked, modal,
+                     &BlopModal::dismiss);
+  }
 
   session.modal = modal;
   session.label = lbl;
@@ -3,6 +3,7 @@
 #include <QPointer>
 #include <QString>
 #include <QStringList>
+#include <functional>
 
 #include "blop_modal.h"
 
@@ -48,7 +49,10 @@ struct ProgressSession {
   bool isOpen() const { return modal != nullptr; }
 };
 
+/// With `onCancel` the card gets a cancel button; dismissing it by hand
+/// cancels as well. close() itself never calls it.
 ProgressSession presentProgress(QWidget *parent, const QString &title,
-                                const QString &message = QString());
+                                const QString &message = QString(),
+                                std::function<void()> onCancel = {});
 
 } // namespace BlopDialogs
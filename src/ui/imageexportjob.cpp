@@ -0,0 +1,125 @@
+#include "imageexportjob.h"
+
+#include "pagerender.h"
+#include "util/Async.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QMetaObject>
+#include <QPointer>
+#include <QThread>
+#include <QThreadPool>
+
+ImageExportJob::ImageExportJob(QVector<NotePage> pages, QStringList paths,
+                               const Options &options, QObject *parent)
+    : QObject(parent), m_pages(std::move(pages)), m_paths(std::move(paths)),
+      m_options(options), m_pageCount(int(m_pages.size())),
+      m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+ImageExportJob::~ImageExportJob() { *m_cancelled = true; }
+
+QStringList ImageExportJob::pagePaths(const QString &basePath, int pageCount,
+                                      QByteArray *format) {
+  const QFileInfo fi(basePath);
+  QString suffix = fi.suffix().toLower();
+  if (suffix != QLatin1String("png") && suffix != QLatin1String("jpg") &&
+      suffix != QLatin1String("jpeg"))
+    suffix = QStringLiteral("png");
+  if (format)
+    *format = suffix == QLatin1String("png") ? QByteArray("PNG")
+                                             : QByteArray("JPEG");
+  if (pageCount == 1)
+    return {basePath};
+  const QString base = fi.dir().absoluteFilePath(fi.completeBaseName());
+  QStringList paths;
+  paths.reserve(pageCount);
+  for (int i = 0; i < pageCount; ++i)
+    paths.append(QStringLiteral("%1_%2.%3").arg(base).arg(i + 1).arg(suffix));
+  return paths;
+}
+
+void ImageExportJob::start() {
+  if (m_started)
+    return;
+  m_started = true;
+  emit progress(0, m_pageCount);
+  QPointer<ImageExportJob> self(this);
+  const std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+  // run() blocks on its own pool; this thread only waits for it.
+  fireAndForget([self, cancelled, pages = std::move(m_pages),
+                 paths = m_paths, options = m_options,
+                 total = m_pageCount]() mutable {
+    const bool ok = run(
+        std::move(pages), paths, options,
+        [self, total](int done) {
+          QMetaObject::invokeMethod(
+              self.data(), [self, done, total]() {
+                if (self && !self->m_finished)
+                  emit self->progress(done, total);
+              },
+              Qt::QueuedConnection);
+        },
+        cancelled.get());
+    QMetaObject::invokeMethod(
+        self.data(), [self, ok]() {
+          if (self)
+            self->finish(ok);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void ImageExportJob::cancel() { *m_cancelled = true; }
+
+void ImageExportJob::finish(bool ok) {
+  if (m_finished)
+    return;
+  m_finished = true;
+  emit finished(ok && !*m_cancelled);
+}
+
+bool ImageExportJob::run(QVector<NotePage> pages, const QStringList &paths,
+                         const Options &options,
+                         const std::function<void(int)> &onPage,
+                         const std::atomic<bool> *cancelled) {
+  if (pages.isEmpty() || pages.size() != paths.size() ||
+      options.pageSize.isEmpty())
+    return false;
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(options.maxThreads > 0
+                             ? options.maxThreads
+                             : qMax(1, QThread::idealThreadCount() - 1));
+  std::atomic<int> written{0};
+  std::atomic<bool> failed{false};
+  const int pageW = options.pageSize.width();
+  const int pageH = options.pageSize.height();
+  for (int i = 0; i < pages.size(); ++i) {
+    pool.start([&, page = pages[i], path = paths[i]]() mutable {
+      if (failed || (cancelled && *cancelled))
+        return;
+      page.ensureLoaded();
+      const QImage img = PageRender::renderPage(page, pageW, pageH);
+      page = NotePage();
+      QImageWriter writer(path, options.format);
+      if (options.quality >= 0)
+        writer.setQuality(options.quality);
+      if (!writer.write(img)) {
+        qWarning() << "ImageExportJob: cannot write" << path
+                   << writer.errorString();
+        failed = true;
+        return;
+      }
+      const int done = ++written;
+      if (onPage)
+        onPage(done);
+    });
+  }
+  // The tasks hold their own copies.
+  pages.clear();
+  pool.waitForDone();
+  return !failed && written == int(paths.size());
+}
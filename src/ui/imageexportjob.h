@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Note.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/// Writes note pages as PNG/JPEG files, several pages at a time.
+///
+/// Each page is loaded, rendered (PageRender::renderPage()) and encoded on
+/// a thread pool of its own, limited to Options::maxThreads so an export
+/// never takes every core from the UI. Pages are copies; only the pages
+/// in flight are ever loaded.
+///
+/// run() is the whole export on the calling thread, without an event loop
+/// (benchmarks, tools); the job wraps it for the GUI with progress() and
+/// finished() on the thread that created it.
+class ImageExportJob : public QObject {
+  Q_OBJECT
+public:
+  struct Options {
+    QSize pageSize;           ///< page coordinates = output pixels
+    QByteArray format{"PNG"}; ///< any QImageWriter format
+    int quality{-1};          ///< QImageWriter quality, -1 = default
+    int maxThreads{0};        ///< 0 = all cores but one
+  };
+
+  ImageExportJob(QVector<NotePage> pages, QStringList paths,
+                 const Options &options, QObject *parent = nullptr);
+  ~ImageExportJob() override;
+
+  void start();
+  /// Pages not started yet are skipped; finished(false) follows.
+  void cancel();
+
+  int pageCount() const { return m_pageCount; }
+
+  /// Output files for `pageCount` pages: `basePath` itself for one page,
+  /// otherwise "<base>_<n>.<suffix>". `format` receives the QImageWriter
+  /// format of the suffix (PNG unless it names JPEG).
+  static QStringList pagePaths(const QString &basePath, int pageCount,
+                               QByteArray *format = nullptr);
+
+  /// Blocking export of `pages[i]` to `paths[i]`. `onPage(done)` is called
+  /// from the workers, once per written page. Stops early when `cancelled`
+  /// is set. False if any page could not be written.
+  static bool run(QVector<NotePage> pages, const QStringList &paths,
+                  const Options &options,
+                  const std::function<void(int)> &onPage = {},
+                  const std::atomic<bool> *cancelled = nullptr);
+
+signals:
+  void progress(int done, int total);
+  /// `ok` is false when cancelled or a page could not be written.
+  void finished(bool ok);
+
+private:
+  void finish(bool ok);
+
+  QVector<NotePage> m_pages; ///< handed to the workers by start()
+  QStringList m_paths;
+  Options m_options;
+  int m_pageCount{0};
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+  bool m_started{false};
+  bool m_finished{false};
+};
@@ -0,0 +1,328 @@
+#include "librarymetastore.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QGuiApplication>
+#include <QSettings>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+constexpr const char *kOrg = "Blop";
+constexpr const char *kApp = "BlopApp";
+constexpr const char *kCatalogKey = "library/tag_catalog";
+constexpr const char *kMapKey = "library/note_tags";
+constexpr const char *kFavKey = "library/favorites";
+constexpr const char *kColorKey = "library/color_labels";
+constexpr const char *kRecentKey = "library/recent_opens";
+constexpr int kWriteDelayMs = 600;
+
+/// `path` below/at `from` moved to `to`; false when it is not affected.
+bool remapOne(QString &path, const QString &from, const QString &to) {
+  if (path == from) {
+    path = to;
+    return true;
+  }
+  if (path.startsWith(from + QLatin1Char('/'))) {
+    path = to + path.mid(from.size());
+    return true;
+  }
+  return false;
+}
+} // namespace
+
+LibraryMetaStore &LibraryMetaStore::instance() {
+  static LibraryMetaStore store;
+  return store;
+}
+
+LibraryMetaStore::LibraryMetaStore() {
+  load();
+  m_writeTimer.setSingleShot(true);
+  m_writeTimer.setInterval(kWriteDelayMs);
+  connect(&m_writeTimer, &QTimer::timeout, this, [this]() { startWrite(); });
+  if (auto *app = QCoreApplication::instance())
+    connect(app, &QCoreApplication::aboutToQuit, this, [this]() { flush(); });
+  // Android/iOS kill suspended apps without aboutToQuit.
+  if (qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+    connect(qGuiApp, &QGuiApplication::applicationStateChanged, this,
+            [this](Qt::ApplicationState state) {
+              if (state != Qt::ApplicationActive)
+                flush();
+            });
+  }
+}
+
+QStringList LibraryMetaStore::uniqueSorted(QStringList tags) {
+  tags.removeAll(QString());
+  tags.removeDuplicates();
+  tags.sort(Qt::CaseInsensitive);
+  return tags;
+}
+
+void LibraryMetaStore::load() {
+  QSettings s(QString::fromLatin1(kOrg), QString::fromLatin1(kApp));
+
+  m_catalog = uniqueSorted(s.value(QString::fromLatin1(kCatalogKey)).toStringList());
+
+  const QVariantMap tagMap = s.value(QString::fromLatin1(kMapKey)).toMap();
+  m_tags.reserve(tagMap.size());
+  for (auto it = tagMap.constBegin(); it != tagMap.constEnd(); ++it) {
+    const QStringList tags = uniqueSorted(it.value().toStringList());
+    if (!tags.isEmpty())
+      m_tags.insert(it.key(), tags);
+  }
+
+  m_favorites = s.value(QString::fromLatin1(kFavKey)).toStringList();
+  m_favorites.removeAll(QString());
+  m_favorites.removeDuplicates();
+  m_favoriteSet = QSet<QString>(m_favorites.cbegin(), m_favorites.cend());
+
+  const QVariantMap colorMap = s.value(QString::fromLatin1(kColorKey)).toMap();
+  for (auto it = colorMap.constBegin(); it != colorMap.constEnd(); ++it) {
+    const int v = it.value().toInt();
+    if (v > 0)
+      m_colors.insert(it.key(), v);
+  }
+
+  const QVariantList recent = s.value(QString::fromLatin1(kRecentKey)).toList();
+  for (const QVariant &v : recent) {
+    const QVariantMap m = v.toMap();
+    RecentEntry e;
+    e.path = m.value(QStringLiteral("path")).toString();
+    e.ts = m.value(QStringLiteral("ts")).toLongLong();
+    if (!e.path.isEmpty())
+      m_recent.append(e);
+  }
+  std::stable_sort(m_recent.begin(), m_recent.end(),
+                   [](const RecentEntry &a, const RecentEntry &b) { return a.ts > b.ts; });
+  rebuildRecentRank();
+}
+
+void LibraryMetaStore::rebuildRecentRank() {
+  m_recentRank.clear();
+  m_recentRank.reserve(m_recent.size());
+  for (int i = 0; i < m_recent.size(); ++i) {
+    // Duplicates after a remap: the newest entry wins.
+    if (!m_recentRank.contains(m_recent[i].path))
+      m_recentRank.insert(m_recent[i].path, i);
+  }
+}
+
+void LibraryMetaStore::setCatalog(const QStringList &tags) {
+  const QStringList next = uniqueSorted(tags);
+  if (next == m_catalog)
+    return;
+  m_catalog = next;
+  markDirty(CatalogKey);
+}
+
+void LibraryMetaStore::setTagsForPath(const QString &absolutePath,
+                                      const QStringList &tags) {
+  const QStringList cleaned = uniqueSorted(tags);
+  if (cleaned != m_tags.value(absolutePath)) {
+    if (cleaned.isEmpty())
+      m_tags.remove(absolutePath);
+    else
+      m_tags.insert(absolutePath, cleaned);
+    markDirty(TagsKey);
+  }
+
+  // Keep catalog in sync with assigned tags.
+  QStringList cat = m_catalog;
+  for (const QString &t : cleaned) {
+    if (!cat.contains(t, Qt::CaseInsensitive))
+      cat.append(t);
+  }
+  if (cat.size() != m_catalog.size())
+    setCatalog(cat);
+}
+
+void LibraryMetaStore::replaceTag(const QString &from, const QString &to) {
+  QStringList cat;
+  bool found = false;
+  for (const QString &t : m_catalog) {
+    if (t.compare(from, Qt::CaseInsensitive) == 0) {
+      found = true;
+      if (!to.isEmpty())
+        cat.append(to);
+    } else {
+      cat.append(t);
+    }
+  }
+  if (!found && !to.isEmpty())
+    cat.append(to);
+  m_catalog = uniqueSorted(cat);
+  markDirty(CatalogKey);
+
+  for (auto it = m_tags.begin(); it != m_tags.end();) {
+    QStringList tags;
+    bool changed = false;
+    for (const QString &t : it.value()) {
+      if (t.compare(from, Qt::CaseInsensitive) == 0) {
+        changed = true;
+        if (!to.isEmpty())
+          tags.append(to);
+      } else {
+        tags.append(t);
+      }
+    }
+    if (changed) {
+      markDirty(TagsKey);
+      tags = uniqueSorted(tags);
+      if (tags.isEmpty()) {
+        it = m_tags.erase(it);
+        continue;
+      }
+      it.value() = tags;
+    }
+    ++it;
+  }
+}
+
+void LibraryMetaStore::setFavorite(const QString &absolutePath, bool favorite) {
+  if (favorite == m_favoriteSet.contains(absolutePath))
+    return;
+  m_favorites.removeAll(absolutePath);
+  if (favorite) {
+    m_favorites.prepend(absolutePath);
+    m_favoriteSet.insert(absolutePath);
+  } else {
+    m_favoriteSet.remove(absolutePath);
+  }
+  markDirty(FavoritesKey);
+}
+
+void LibraryMetaStore::setColorLabel(const QString &absolutePath, int label) {
+  if (m_colors.value(absolutePath, 0) == label)
+    return;
+  if (label <= 0)
+    m_colors.remove(absolutePath);
+  else
+    m_colors.insert(absolutePath, label);
+  markDirty(ColorsKey);
+}
+
+void LibraryMetaStore::touchRecent(const QString &absolutePath, int keep) {
+  for (int i = m_recent.size() - 1; i >= 0; --i) {
+    if (m_recent[i].path == absolutePath)
+      m_recent.removeAt(i);
+  }
+  RecentEntry e;
+  e.path = absolutePath;
+  e.ts = QDateTime::currentMSecsSinceEpoch();
+  m_recent.prepend(e);
+  while (m_recent.size() > keep)
+    m_recent.removeLast();
+  rebuildRecentRank();
+  markDirty(RecentKey);
+}
+
+void LibraryMetaStore::remapPath(const QString &fromPath, const QString &toPath) {
+  unsigned changed = 0;
+
+  QHash<QString, QStringList> tags;
+  tags.reserve(m_tags.size());
+  for (auto it = m_tags.constBegin(); it != m_tags.constEnd(); ++it) {
+    QString key = it.key();
+    if (remapOne(key, fromPath, toPath))
+      changed |= TagsKey;
+    tags.insert(key, it.value());
+  }
+  if (changed & TagsKey)
+    m_tags = std::move(tags);
+
+  for (QString &p : m_favorites) {
+    if (remapOne(p, fromPath, toPath))
+      changed |= FavoritesKey;
+  }
+  if (changed & FavoritesKey) {
+    m_favorites.removeDuplicates();
+    m_favoriteSet = QSet<QString>(m_favorites.cbegin(), m_favorites.cend());
+  }
+
+  QHash<QString, int> colors;
+  for (auto it = m_colors.constBegin(); it != m_colors.constEnd(); ++it) {
+    QString key = it.key();
+    if (remapOne(key, fromPath, toPath))
+      changed |= ColorsKey;
+    colors.insert(key, it.value());
+  }
+  if (changed & ColorsKey)
+    m_colors = std::move(colors);
+
+  for (RecentEntry &e : m_recent) {
+    if (remapOne(e.path, fromPath, toPath))
+      changed |= RecentKey;
+  }
+  if (changed & RecentKey)
+    rebuildRecentRank();
+
+  if (changed)
+    markDirty(changed);
+}
+
+void LibraryMetaStore::markDirty(unsigned keys) {
+  m_dirty |= keys;
+  m_writeTimer.start();
+}
+
+QHash<QString, QVariant> LibraryMetaStore::takeSnapshot() {
+  QHash<QString, QVariant> values;
+  if (m_dirty & CatalogKey)
+    values.insert(QString::fromLatin1(kCatalogKey), m_catalog);
+  if (m_dirty & TagsKey) {
+    QVariantMap raw;
+    for (auto it = m_tags.constBegin(); it != m_tags.constEnd(); ++it)
+      raw.insert(it.key(), it.value());
+    values.insert(QString::fromLatin1(kMapKey), raw);
+  }
+  if (m_dirty & FavoritesKey)
+    values.insert(QString::fromLatin1(kFavKey), m_favorites);
+  if (m_dirty & ColorsKey) {
+    QVariantMap raw;
+    for (auto it = m_colors.constBegin(); it != m_colors.constEnd(); ++it)
+      raw.insert(it.key(), it.value());
+    values.insert(QString::fromLatin1(kColorKey), raw);
+  }
+  if (m_dirty & RecentKey) {
+    QVariantList raw;
+    for (const RecentEntry &e : m_recent) {
+      QVariantMap m;
+      m.insert(QStringLiteral("path"), e.path);
+      m.insert(QStringLiteral("ts"), e.ts);
+      raw.append(m);
+    }
+    values.insert(QString::fromLatin1(kRecentKey), raw);
+  }
+  m_dirty = 0;
+  return values;
+}
+
+void LibraryMetaStore::write(const QHash<QString, QVariant> &values) {
+  QSettings s(QString::fromLatin1(kOrg), QString::fromLatin1(kApp));
+  for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+    s.setValue(it.key(), it.value());
+  s.sync();
+  if (s.status() != QSettings::NoError)
+    qWarning() << "LibraryMetaStore: writing settings failed" << s.status();
+}
+
+void LibraryMetaStore::startWrite() {
+  if (!m_dirty)
+    return;
+  // One write at a time, so an older snapshot never lands last.
+  if (m_writing.isRunning()) {
+    m_writeTimer.start();
+    return;
+  }
+  m_writing = QtConcurrent::run(&LibraryMetaStore::write, takeSnapshot());
+}
+
+void LibraryMetaStore::flush() {
+  m_writeTimer.stop();
+  m_writing.waitForFinished();
+  if (m_dirty)
+    write(takeSnapshot());
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QFuture>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+/// Process-wide, in-memory copy of the library metadata behind
+/// LibraryTagStore and LibraryOrgStore (tag catalog, note tags, favorites,
+/// color labels, recent opens). QSettings is read once on first use; lookups
+/// are hash hits, so the library proxy can ask per row without I/O.
+///
+/// Changes are write-through: they land here immediately and go to
+/// QSettings debounced, on the thread pool. Unchanged values are not written
+/// at all. Pending writes are flushed when the app quits or is suspended.
+/// GUI thread only.
+class LibraryMetaStore : public QObject {
+public:
+  static LibraryMetaStore &instance();
+
+  struct RecentEntry {
+    QString path;
+    qint64 ts{0};
+  };
+
+  const QStringList &catalog() const { return m_catalog; }
+  void setCatalog(const QStringList &tags);
+  QStringList tagsForPath(const QString &absolutePath) const {
+    return m_tags.value(absolutePath);
+  }
+  bool hasTags(const QString &absolutePath) const {
+    return m_tags.contains(absolutePath);
+  }
+  void setTagsForPath(const QString &absolutePath, const QStringList &tags);
+  /// Renames (to non-empty) or removes (to empty) a tag everywhere.
+  void replaceTag(const QString &from, const QString &to);
+
+  bool isFavorite(const QString &absolutePath) const {
+    return m_favoriteSet.contains(absolutePath);
+  }
+  const QStringList &favoritePaths() const { return m_favorites; }
+  void setFavorite(const QString &absolutePath, bool favorite);
+
+  int colorLabel(const QString &absolutePath) const {
+    return m_colors.value(absolutePath, 0);
+  }
+  void setColorLabel(const QString &absolutePath, int label);
+
+  /// Newest first.
+  const QVector<RecentEntry> &recent() const { return m_recent; }
+  /// Position in recent() (0 = newest), -1 when not among the recent opens.
+  int recentRank(const QString &absolutePath) const {
+    return m_recentRank.value(absolutePath, -1);
+  }
+  void touchRecent(const QString &absolutePath, int keep);
+
+  /// Moves every path at or below `fromPath` to `toPath`.
+  void remapPath(const QString &fromPath, const QString &toPath);
+
+  /// Writes pending changes now and waits for writes in flight.
+  void flush();
+
+  static QStringList uniqueSorted(QStringList tags);
+
+private:
+  enum Key : unsigned {
+    CatalogKey = 1u << 0,
+    TagsKey = 1u << 1,
+    FavoritesKey = 1u << 2,
+    ColorsKey = 1u << 3,
+    RecentKey = 1u << 4,
+  };
+
+  LibraryMetaStore();
+  void load();
+  void markDirty(unsigned keys);
+  void startWrite();
+  void rebuildRecentRank();
+  static void write(const QHash<QString, QVariant> &values);
+  QHash<QString, QVariant> takeSnapshot();
+
+  QStringList m_catalog;
+  QHash<QString, QStringList> m_tags;
+  QStringList m_favorites;
+  QSet<QString> m_favoriteSet;
+  QHash<QString, int> m_colors;
+  QVector<RecentEntry> m_recent;
+  QHash<QString, int> m_recentRank;
+
+  unsigned m_dirty{0};
+  QTimer m_writeTimer;
+  QFuture<void> m_writing;
+};
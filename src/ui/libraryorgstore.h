@@ -32,6 +32,8 @@ public:
   /// Record that the user opened this note (drives "Zuletzt").
   static void touchRecent(const QString &absolutePath);
   static QStringList recentPaths(int limit = 24);
+  /// Index in recentPaths() (0 = newest), -1 if not recent. O(1).
+  static int recentRank(const QString &absolutePath);
 
   /// Keep metadata attached when a note/folder is moved or renamed.
   static void remapPath(const QString &fromPath, const QString &toPath);
@@ -34,8 +34,15 @@
 #include "markdowneditor.h"
 #include "multipagenoteview.h"
 #include "noteeditor.h"
+#include "notejournal.h"
 #include "notemanager.h"
+#include "notesearchindex.h"
+#include "thumbnailstore.h"
 #include "pagemanager.h"
+#include "pagerender.h"
+#include "pdfrenderpool.h"
+#include "pdfstore.h"
+#include "util/Async.h"
 #include "blop_scroll.h"
 #include "blopstyle.h"
 #include "blop_dialogs.h"
@@ -345,15 +352,30 @@ public:
       : QSortFilterProxyModel(parent) {
     setDynamicSortFilter(true);
     setSortCaseSensitivity(Qt::CaseInsensitive);
+    // Saves and the library crawl keep the index moving; re-ask it.
+    connect(&NoteSearchIndex::instance(), &NoteSearchIndex::changed, this,
+            [this]() {
+              if (m_search.isEmpty())
+                return;
+              m_contentHits = NoteSearchIndex::instance().search(m_search);
+              refreshFilter();
+            });
   }
 
   void setSearchText(const QString &text) {
     if (m_search == text)
       return;
     m_search = text.trimmed();
+    // One index query per search change; rows then only do hash lookups.
+    m_contentHits = NoteSearchIndex::instance().search(m_search);
     refreshFilter();
   }
 
+  /// Pages of `path` whose text matches the search (empty: none / name hit).
+  QList<int> contentHitPages(const QString &path) const {
+    return m_contentHits.value(path);
+  }
+
   void setRequiredTags(const QStringList &tags) {
     if (m_tags == tags)
       return;
@@ -400,7 +422,8 @@ protected:
     if (isDir)
       return true;
 
-    if (!m_search.isEmpty() && !name.contains(m_search, Qt::CaseInsensitive))
+    if (!m_search.isEmpty() && !name.contains(m_search, Qt::CaseInsensitive) &&
+        !m_contentHits.contains(path))
       return false;
 
     switch (m_smartView) {
@@ -409,8 +432,8 @@ protected:
         return false;
       break;
     case SmartView::Recent: {
-      const QStringList recent = LibraryOrgStore::recentPaths(24);
-      if (!recent.contains(path))
+      const int rank = LibraryOrgStore::recentRank(path);
+      if (rank < 0 || rank >= 24)
         return false;
       break;
     }
@@ -454,17 +477,15 @@ protected:
       return leftDir && !rightDir;
 
     if (m_sortMode == SortMode::Modified || m_smartView == SmartView::Recent) {
-      const QString leftPath = fsm->filePath(left);
-      const QString rightPath = fsm->filePath(right);
       if (m_smartView == SmartView::Recent) {
-        const QStringList recent = LibraryOrgStore::recentPaths(48);
-        const int li = recent.indexOf(leftPath);
-        const int ri = recent.indexOf(rightPath);
+        const int li = LibraryOrgStore::recentRank(fsm->filePath(left));
+        const int ri = LibraryOrgStore::recentRank(fsm->filePath(right));
         if (li >= 0 || ri >= 0)
           return (li >= 0 ? li : 9999) < (ri >= 0 ? ri : 9999);
       }
-      const QDateTime lt = QFileInfo(leftPath).lastModified();
-      const QDateTime rt = QFileInfo(rightPath).lastModified();
+      // The model's cached file info; no stat() per comparison.
+      const QDateTime lt = fsm->lastModified(left);
+      const QDateTime rt = fsm->lastModified(right);
       if (lt != rt)
         return lt > rt; // newest first
     }
@@ -486,6 +507,7 @@ private:
   }
 
   QString m_search;
+  QHash<QString, QList<int>> m_contentHits;
   QStringList m_tags;
   SmartView m_smartView{SmartView::All};
   SortMode m_sortMode{SortMode::Name};
@@ -1576,16 +1598,61 @@ MainWindow::MainWindow(QWidget *parent)
     if (!m_pendingA4SaveNote || m_pendingA4SavePath.isEmpty()) return;
     Note copy = *m_pendingA4SaveNote;
     const QString p = m_pendingA4SavePath;
-    m_noteManager.saveNoteAsync(copy, p, [this, p](bool ok) {
+    // The journal stays on this device. A synced note (cloud folder or
+    // mirror) is folded on every autosave so the synced file has each edit.
+    if (StoragePrefs::mode() != StoragePrefs::Mode::LocalOnly) {
+      m_noteManager.saveNoteAsync(copy, p, [this, p](bool ok) {
+        if (!ok)
+          qWarning() << "A4 async save failed" << p;
+        else
+          mirrorNoteIfNeeded(p);
+      });
+      return;
+    }
+    // Journaled: only the edits since the last save hit the disk. The
+    // mirror follows once the journal is folded into the file.
+    m_noteManager.saveNoteIncremental(copy, p, [this, p](bool ok, bool rewritten) {
       if (!ok)
         qWarning() << "A4 async save failed" << p;
-      else
+      else if (rewritten)
         mirrorNoteIfNeeded(p);
     });
   });
 
+  // Damaged pages are salvaged so autosave keeps working; tell the user
+  // once, since the next save already reads back clean.
+  QPointer<MainWindow> self(this);
+  NoteManager::setSaveProblemHandler(
+      [self](const QString &path, const QStringList &problems) {
+        QMetaObject::invokeMethod(
+            qApp,
+            [self, path, problems]() {
+              if (!self)
+                return;
+              const QString text =
+                  QStringLiteral("\"%1\" war beschädigt und wurde repariert:\n%2")
+                      .arg(QFileInfo(path).completeBaseName(),
+                           problems.join(QLatin1Char('\n')));
+#ifdef Q_OS_ANDROID
+              showAndroidToast(self, text, 5000);
+#else
+              QMessageBox::warning(self, QStringLiteral("Notiz beschädigt"),
+                                   text);
+#endif
+            },
+            Qt::QueuedConnection);
+      });
+
   createDefaultFolder();
 
+  // Thumbnails and exports draw imported pages from their PDF when this
+  // device has it; documents no note uses any more are dropped.
+  PageRender::setPdfRasterizer(&PdfRenderPool::renderPage);
+  fireAndForget([roots = QStringList{m_rootPath,
+                                     StoragePrefs::primaryLinkedCloudPath()}]() {
+    PdfStore::instance().collectGarbage(roots);
+  });
+
   loadWebBookmarksFromSettings();
 
   setupTools(); // <-- WICHTIG: ToolManager Initialisierung hat gefehlt!
@@ -3714,6 +3781,9 @@ void MainWindow::closeEditorTabAt(int index) {
     if (ed->view())
       ed->view()->persistViewState(
           ed->view()->property("viewStateKey").toString());
+    // Its note dies with the tab; save what the debounce still holds.
+    if (ed->property("filePath").toString() == m_pendingA4SavePath)
+      flushPendingA4Save();
   }
   m_editorTabs->removeTab(index);
   if (m_documentTabBar)
@@ -4959,6 +5029,7 @@ void MainWindow::createDefaultFolder() {
   // Always create the device-local library root (phone / laptop / Mac / …).
   // Cloud providers are optional overlays — see StoragePrefs + CloudStorageStore.
   m_rootPath = StoragePrefs::ensureLocalLibraryRoot();
+  NoteSearchIndex::instance().open(m_rootPath);
 }
 
 void MainWindow::setupUi() {
@@ -5722,6 +5793,12 @@ void MainWindow::setupUi() {
 #else
   m_fileListView->setItemDelegate(new ModernItemDelegate(this));
 #endif
+  // Tiles paint the synthetic paper until a note's cover has been loaded.
+  connect(&ThumbnailStore::instance(), &ThumbnailStore::coverReady,
+          m_fileListView->viewport(), [this]() {
+            if (m_fileListView)
+              m_fileListView->viewport()->update();
+          });
   BlopScroll::enableFingerScroll(m_fileListView);
   // Dateien und Ordner: ein Tap / ein Klick öffnet. Kurze Entprellung verhindert
   // doppeltes Öffnen bei schnellem Doppelklick auf dieselbe Notiz.
@@ -8881,13 +8958,30 @@ void MainWindow::openLoadedA4Note(const QString &path, const QString &fileName,
   NoteEditor *editor = new NoteEditor(this);
   editor->setProperty("filePath", path);
   Note *heapNote = new Note(std::move(note));
+  m_noteManager.trackNote(path, *heapNote);
+  connect(editor, &QObject::destroyed, this, [this, path]() {
+    QPointer<MainWindow> self(this);
+    m_noteManager.untrackNote(path, [self, path](bool ok) {
+      if (!ok)
+        qWarning() << "A4 close save failed" << path;
+      else if (self)
+        self->mirrorNoteIfNeeded(path);
+    });
+  });
   editor->setNote(heapNote);
   if (editor->view()) {
     editor->view()->setPenOnlyMode(m_penOnlyMode);
     editor->view()->setProperty("viewStateKey", path);
-    QTimer::singleShot(0, editor->view(), [v = editor->view(), path]() {
-      if (v)
-        v->restoreViewState(path);
+    // Opened from a full-text search hit: show the page with the hit.
+    const int hitPage = m_searchJumpPath == path ? m_searchJumpPage : -1;
+    m_searchJumpPath.clear();
+    m_searchJumpPage = -1;
+    QTimer::singleShot(0, editor->view(), [v = editor->view(), path, hitPage]() {
+      if (!v)
+        return;
+      v->restoreViewState(path);
+      if (hitPage >= 0)
+        v->scrollToPage(hitPage, false);
     });
   }
   editor->onSaveRequested = [this, path, editor](Note *n) {
@@ -10968,6 +11062,16 @@ void MainWindow::onFileDoubleClicked(const QModelIndex &index) {
   } else {
     QString path = m_fileModel->filePath(index);
     LibraryOrgStore::touchRecent(path);
+    m_searchJumpPath.clear();
+    m_searchJumpPage = -1;
+    if (m_libraryProxy) {
+      const QList<int> hits =
+          static_cast<LibraryFilterProxy *>(m_libraryProxy)->contentHitPages(path);
+      if (!hits.isEmpty()) {
+        m_searchJumpPath = path;
+        m_searchJumpPage = hits.first();
+      }
+    }
     QString fileName = index.data().toString();
     bool isBinary = false;
     {
@@ -11669,8 +11773,11 @@ void MainWindow::showContextMenu(const QPoint &globalPos,
               QStringLiteral("Löschen"), QStringLiteral("Abbrechen")))
         return;
       const QString notePath = m_fileModel->filePath(QModelIndex(persistent));
-      if (!m_fileModel->isDir(QModelIndex(persistent)))
+      NoteJournal::discard(notePath);
+      if (!m_fileModel->isDir(QModelIndex(persistent))) {
         StoragePrefs::removeCloudMirrorIfNeeded(notePath);
+        NoteSearchIndex::instance().removeNote(notePath);
+      }
       m_fileModel->remove(QModelIndex(persistent));
     });
   };
@@ -11731,8 +11838,11 @@ void MainWindow::showContextMenu(const QPoint &globalPos,
                     return;
                   const QString notePath =
                       m_fileModel->filePath(QModelIndex(persistent));
-                  if (!m_fileModel->isDir(QModelIndex(persistent)))
+                  NoteJournal::discard(notePath);
+                  if (!m_fileModel->isDir(QModelIndex(persistent))) {
                     StoragePrefs::removeCloudMirrorIfNeeded(notePath);
+                    NoteSearchIndex::instance().removeNote(notePath);
+                  }
                   m_fileModel->remove(QModelIndex(persistent));
                 }, true, false});
   BlopInWindowMenu::show(this, globalPos, items);
@@ -11821,8 +11931,10 @@ void MainWindow::showRenameOverlay(const QString &currentName) {
       }
       const QString newPath =
           QFileInfo(oldPath).absolutePath() + QLatin1Char('/') + newName;
+      NoteJournal::remapPath(oldPath, newPath);
       LibraryTagStore::remapPath(oldPath, newPath);
       LibraryOrgStore::remapPath(oldPath, newPath);
+      NoteSearchIndex::instance().remapPath(oldPath, newPath);
       StoragePrefs::renameCloudMirrorIfNeeded(oldPath, newPath);
       applyLibraryFilters();
     }
@@ -13842,8 +13954,10 @@ void MainWindow::onItemDropped(const QModelIndex &sourceIndex,
       return;
     }
   }
+  NoteJournal::remapPath(sourcePath, newPath);
   LibraryTagStore::remapPath(sourcePath, newPath);
   LibraryOrgStore::remapPath(sourcePath, newPath);
+  NoteSearchIndex::instance().remapPath(sourcePath, newPath);
   applyLibraryFilters();
 }
 
@@ -14068,7 +14182,7 @@ void MainWindow::closeEvent(QCloseEvent *event) {
     const QString p = m_pendingA4SavePath;
     m_pendingA4SaveNote = nullptr;
     m_pendingA4SavePath.clear();
-    if (!m_noteManager.saveNote(copy, p))
+    if (!m_noteManager.foldNote(copy, p))
       qWarning() << "Close A4 save failed" << p;
     else
       mirrorNoteIfNeeded(p);
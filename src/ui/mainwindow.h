@@ -571,6 +571,9 @@ private:
   QListWidget *m_navSidebar{nullptr};
   QFileSystemModel *m_fileModel{nullptr};
   QString m_pendingLibraryRootPath;
+  /// Note opened from a full-text search hit and the page to show.
+  QString m_searchJumpPath;
+  int m_searchJumpPage{-1};
   QPushButton *m_closeSidebarBtn{nullptr};
 
   QPushButton *m_btnSidebarSettings{nullptr};
@@ -7,7 +7,6 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QPainterPath>
 #include <QStandardPaths>
 #include <QUuid>
 
@@ -37,18 +36,12 @@ Stroke strokeFromJson(const QJsonObject &o) {
   s.isEraser = o.value(QStringLiteral("eraser")).toBool(false);
   s.isHighlighter = o.value(QStringLiteral("highlighter")).toBool(false);
   const QJsonArray pts = o.value(QStringLiteral("points")).toArray();
-  QPainterPath path;
+  s.points.reserve(int(pts.size()));
   for (int i = 0; i < pts.size(); ++i) {
     const QJsonObject pt = pts.at(i).toObject();
-    const QPointF p(pt.value(QStringLiteral("x")).toDouble(),
-                    pt.value(QStringLiteral("y")).toDouble());
-    s.points.append(p);
-    if (i == 0)
-      path.moveTo(p);
-    else
-      path.lineTo(p);
+    s.points.append(QPointF(pt.value(QStringLiteral("x")).toDouble(),
+                            pt.value(QStringLiteral("y")).toDouble()));
   }
-  s.path = path;
   return s;
 }
 
@@ -6,6 +6,7 @@
 #include "UIStyles.h"
 #include "toolpickeroverlay.h"
 #include "markuplibrarystore.h"
+#include "strokegeometry.h"
 #include "tools/ToolManager.h"
 #include "tools/ToolUIBridge.h"
 #include "tools/ShapeTool.h"
@@ -1499,6 +1500,13 @@ public:
           apply();
         });
         layout->addWidget(chkPressure);
+        QCheckBox *chkPredict = new QCheckBox("Tinte vorausberechnen");
+        chkPredict->setChecked(m_config.inkPrediction);
+        connect(chkPredict, &QCheckBox::toggled, [this](bool c) {
+          m_config.inkPrediction = c;
+          apply();
+        });
+        layout->addWidget(chkPredict);
 
         layout->addWidget(new QLabel("Halten → Form"));
         layout->addWidget(new QLabel("Empfindlichkeit:"));
@@ -3623,7 +3631,7 @@ void ModernToolbar::showMarkupLibrary() {
         p.fillRect(pm.rect(), NoteChrome::panelBg());
         QRectF bounds;
         for (const Stroke &s : item.strokes)
-          bounds = bounds.united(s.path.boundingRect());
+          bounds = bounds.united(s.points.boundingRect());
         if (!bounds.isEmpty()) {
           const qreal pad = 8.0;
           const qreal sx =
@@ -3641,7 +3649,7 @@ void ModernToolbar::showMarkupLibrary() {
             p.setPen(QPen(c, qMax(1.0, s.width), Qt::SolidLine, Qt::RoundCap,
                           Qt::RoundJoin));
             p.setBrush(Qt::NoBrush);
-            p.drawPath(s.path);
+            p.drawPath(StrokeGeometry::path(s));
           }
         } else {
           p.setPen(QPen(item.previewColor, 3, Qt::SolidLine, Qt::RoundCap));
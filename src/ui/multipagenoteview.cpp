@@ -25,10 +25,19 @@
 #include "graphaxissettingsdialog.h"
 #include "graphlegenddock.h"
 #include "graphquickactionpopup.h"
-#include "tools/math/MathExpressionParser.h"
+#include "tools/math/ExpressionCache.h"
 #include "tools/math/NumericAnalysis.h"
 #include "tools/math/MathInkRecognizer.h"
 #include "tools/GraphFormulaZone.h"
+#include "strokegeometry.h"
+#include "pagerender.h"
+#include "imageexportjob.h"
+#include "pdfexportjob.h"
+#include "pdfimportjob.h"
+#include "pdfrenderpool.h"
+#include "thumbnailstore.h"
+#include "pagetilecache.h"
+#include "wetinkoverlay.h"
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QGraphicsRectItem>
@@ -39,7 +48,6 @@
 #include <QImage>
 #include <QPainter>
 #include <QPainterPath>
-#include <QPdfWriter>
 #include <QPen>
 #include <QPixmapCache>
 #include <QPointer>
@@ -60,6 +68,8 @@
 #endif
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <utility>
 #include <QtGlobal>
 #include <QPushButton>
 #include <QSettings>
@@ -93,6 +103,7 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QTimer>
+#include <QScreen>
 #include <QEventPoint>
 #include <QTouchEvent>
 #include <QUrl>
@@ -301,12 +312,61 @@ void stylePagesBarCard(QFrame *card) {
 }
 } // namespace
 
+namespace {
+/// QGraphicsItem::data key: identity of the model Stroke a promoted item
+/// shows (StrokePoints::id(), shared by the copies in note_->pages[p].strokes).
+constexpr int kStrokeIdentityKey = 1;
+
+quintptr strokeIdentity(const Stroke &s) { return quintptr(s.points.id()); }
+
+/// Writes what was done to the promoted `item` (moved, transformed,
+/// cropped, recoloured) into `s`, its stroke on the page at `pageTopLeft`.
+/// false when the item still shows `s` unchanged.
+bool applyStrokeItemEdits(const QGraphicsPathItem *item,
+                          const QPointF &pageTopLeft, Stroke *s) {
+  const QTransform xf =
+      item->sceneTransform() *
+      QTransform::fromTranslate(-pageTopLeft.x(), -pageTopLeft.y());
+  bool changed = false;
+  // Before the outline is rebuilt for the new geometry.
+  const qreal scale = std::sqrt(qAbs(xf.determinant()));
+  if (!qFuzzyCompare(scale, 1.0))
+    s->width *= scale;
+  if (item->path() != StrokeGeometry::path(*s)) {
+    // Cropped: the path is what is left of the stroke.
+    const QPainterPath path = xf.map(item->path());
+    QVector<QPointF> pts;
+    pts.reserve(path.elementCount());
+    for (int i = 0; i < path.elementCount(); ++i)
+      pts.append(QPointF(path.elementAt(i).x, path.elementAt(i).y));
+    // Pressures only survive when every point did.
+    QVector<qreal> pressures = s->points.pressures();
+    if (pressures.size() != pts.size())
+      pressures.clear();
+    s->points = StrokePoints(pts, pressures);
+    changed = true;
+  } else if (!xf.isIdentity()) {
+    s->points = s->points.mapped(xf);
+    changed = true;
+  }
+  if (!s->isEraser) {
+    // Highlighter items are drawn translucent; the model keeps the colour.
+    QColor color = item->pen().color();
+    color.setAlpha(s->color.alpha());
+    if (color != s->color) {
+      s->color = color;
+      changed = true;
+    }
+  }
+  return changed;
+}
+} // namespace
+
 class StrokeAddUndoCommand : public QUndoCommand {
 public:
   StrokeAddUndoCommand(MultiPageNoteView *view, int pageIdx, Stroke stroke)
       : QUndoCommand(), m_view(view), m_page(pageIdx),
-        m_stroke(std::move(stroke)), m_item(nullptr), m_index(-1) {}
-  ~StrokeAddUndoCommand() override { delete m_item; }
+        m_stroke(std::move(stroke)), m_index(-1) {}
 
   void undo() override {
     if (!m_view || !m_view->note_ || m_page < 0 ||
@@ -316,8 +376,7 @@ public:
     if (m_index < 0 || m_index >= strokes.size())
       return;
     strokes.removeAt(m_index);
-    delete m_item;
-    m_item = nullptr;
+    m_view->replacePageInk(m_page, m_index, 1, {});
     if (m_view->onSaveRequested)
       m_view->onSaveRequested(m_view->note_);
   }
@@ -333,10 +392,7 @@ public:
     } else {
       strokes.insert(m_index, m_stroke);
     }
-    m_item = m_view->createStrokeGraphicsItem(m_stroke);
-    if (m_page >= 0 && m_page < m_view->pageItems_.size() &&
-        m_view->pageItems_[m_page])
-      m_item->setParentItem(m_view->pageItems_[m_page]);
+    m_view->replacePageInk(m_page, m_index, 0, {m_stroke});
     if (m_view->onSaveRequested)
       m_view->onSaveRequested(m_view->note_);
   }
@@ -345,10 +401,76 @@ private:
   MultiPageNoteView *m_view;
   int m_page;
   Stroke m_stroke;
-  QGraphicsPathItem *m_item;
   int m_index;
 };
 
+/// One eraser gesture: strokes cut into pieces or removed by
+/// MultiPageNoteView::eraseStrokesAt(). Applied live while erasing, so the
+/// push at pen-up (first redo) is a no-op.
+class StrokeEraseUndoCommand : public QUndoCommand {
+public:
+  explicit StrokeEraseUndoCommand(MultiPageNoteView *view)
+      : QUndoCommand(), m_view(view) {}
+
+  /// Stroke `strokeIdx` of `page` becomes `pieces`, in the model and the
+  /// page's ink layer.
+  void replace(int page, int strokeIdx, const QVector<Stroke> &pieces) {
+    const Stroke before = m_view->note_->pages[page].strokes[strokeIdx];
+    m_edits.append(Edit{page, strokeIdx, {before}, pieces});
+    splice(page, strokeIdx, 1, pieces);
+  }
+
+  bool isEmpty() const { return m_edits.isEmpty(); }
+
+  void undo() override {
+    if (!m_view || !m_view->note_)
+      return;
+    for (auto it = m_edits.crbegin(); it != m_edits.crend(); ++it)
+      splice(it->page, it->at, it->after.size(), it->before);
+    if (m_view->onSaveRequested)
+      m_view->onSaveRequested(m_view->note_);
+  }
+
+  void redo() override {
+    if (m_firstRedo) {
+      m_firstRedo = false;
+      return;
+    }
+    if (!m_view || !m_view->note_)
+      return;
+    for (const Edit &e : std::as_const(m_edits))
+      splice(e.page, e.at, e.before.size(), e.after);
+    if (m_view->onSaveRequested)
+      m_view->onSaveRequested(m_view->note_);
+  }
+
+private:
+  /// Strokes [at, at + before.size()) of `page` became `after`; replayed
+  /// in order (undone in reverse), so `at` is valid when it is applied.
+  struct Edit {
+    int page;
+    int at;
+    QVector<Stroke> before;
+    QVector<Stroke> after;
+  };
+
+  void splice(int page, int at, int count, const QVector<Stroke> &with) {
+    if (page >= m_view->note_->pages.size())
+      return;
+    auto &strokes = m_view->note_->pages[page].strokes;
+    if (at + count > strokes.size())
+      return;
+    strokes.remove(at, count);
+    for (int k = 0; k < with.size(); ++k)
+      strokes.insert(at + k, with[k]);
+    m_view->replacePageInk(page, at, count, with);
+  }
+
+  MultiPageNoteView *m_view;
+  QVector<Edit> m_edits;
+  bool m_firstRedo{true};
+};
+
 /// Undo/redo a single stroke added to a GraphFormulaZone.
 class FormulaZoneStrokeCommand : public QUndoCommand {
 public:
@@ -415,6 +537,37 @@ private:
   QVector<NotePage> m_after;
 };
 
+/// Structural page undo (insert/remove/move/replace). Holds only the pages
+/// it names and rebuilds only the slots they touch, instead of swapping the
+/// whole page vector and re-hydrating the scene like a snapshot.
+class PageEditUndoCommand : public QUndoCommand {
+public:
+  /// `applied`: the edits are already in the model; the push (first
+  /// redo) leaves it alone.
+  PageEditUndoCommand(MultiPageNoteView *view,
+                      QVector<MultiPageNoteView::PageEdit> edits,
+                      const QString &text, bool applied = false)
+      : QUndoCommand(text), m_view(view), m_edits(std::move(edits)),
+        m_skipRedo(applied) {}
+
+  void undo() override {
+    if (m_view && m_view->note_)
+      m_view->applyPageEdits(m_edits, /*forward=*/false);
+  }
+
+  void redo() override {
+    if (std::exchange(m_skipRedo, false))
+      return;
+    if (m_view && m_view->note_)
+      m_view->applyPageEdits(m_edits, /*forward=*/true);
+  }
+
+private:
+  MultiPageNoteView *m_view;
+  QVector<MultiPageNoteView::PageEdit> m_edits;
+  bool m_skipRedo{false};
+};
+
 class NoteSelectionMenu : public QWidget {
   Q_OBJECT
 public:
@@ -1268,7 +1421,7 @@ private:
       m_extra->hide();
       return;
     }
-    const ParsedExpression p = MathExpressionParser::parseFunctionExpression(f.sourceExpression);
+    const ParsedExpression p = ExpressionCache::parsed(f.sourceExpression);
     if (!p.ok) {
       m_extra->hide();
       return;
@@ -1378,6 +1531,29 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
 
   setScene(&scene_);
   scene_.setItemIndexMethod(QGraphicsScene::NoIndex);
+  connect(&tileCache_, &PageTileCache::tilesReady, this,
+          [this](int page, const QRectF &rect) {
+            if (page >= 0 && page < inkLayers_.size() && inkLayers_[page])
+              inkLayers_[page]->update(rect);
+          });
+  connect(&PdfRenderPool::instance(), &PdfRenderPool::tileReady, this,
+          [this](const QByteArray &doc, int pdfPage) {
+            if (!note_)
+              return;
+            const QVector<NotePage> &pages = std::as_const(note_->pages);
+            for (int i = 0; i < pages.size() && i < pageItems_.size(); ++i) {
+              if (pages[i].pdf.page == pdfPage && pages[i].pdf.doc == doc)
+                pageItems_[i]->update();
+            }
+          });
+  // Radierer schneidet die Strokes im Modell (siehe eraseStrokesAt).
+  strokeIndex_.setEraseHandler(
+      [this](const QPointF &center, qreal radius, bool wholeStrokes) {
+        eraseStrokesAt(center, radius, wholeStrokes);
+      });
+  // Lasso: Striche der Seite werden erst bei der Auswahl zu Items.
+  strokeIndex_.setPromoteHandler(
+      [this](const QPainterPath &area) { promoteStrokesIn(area); });
 #ifdef Q_OS_ANDROID
   applyGraphicsViewCanvasBackground(this);
 #else
@@ -1413,10 +1589,17 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
 
   // v3.16.0: keine nativen Scrollbars, dafuer ein duenner Auto-Hide-Indikator.
   OverlayScrollIndicator::install(this);
+  // Nasse Tinte: der Strich unter dem Stift bis zum Absetzen.
+  wetInk_ = new WetInkOverlay(this);
 
   // NEU: Tool-Handling inkl. Lineal
   connect(&ToolManager::instance(), &ToolManager::toolChanged, this,
           [this](AbstractTool *tool) {
+            // Werkzeugwechsel mitten im Strich: Warteschlange verwerfen.
+            setTabletBatching(false);
+            tabletBatch_.clear();
+            tabletRing_.drain(&tabletBatch_);
+            tabletBatch_.clear();
             // Wenn Lineal gewählt ist, sicherstellen, dass es existiert
             if (tool && tool->mode() == ToolMode::Ruler) {
               RulerTool::ensureRulerExists(&scene_,
@@ -1521,7 +1704,7 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
       }
       return;
     }
-    const ParsedExpression parsed = MathExpressionParser::parseFunctionExpression(expr);
+    const ParsedExpression parsed = ExpressionCache::parsed(expr);
     if (!parsed.ok) {
       m_graphEntryBar->setStatus(QStringLiteral("Eingabe ungueltig"), true);
       return;
@@ -1552,7 +1735,7 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
       m_graphEntryBar->setStatus(QStringLiteral("Bitte einen Ausdruck eingeben"), true);
       return;
     }
-    const ParsedExpression parsed = MathExpressionParser::parseFunctionExpression(expr);
+    const ParsedExpression parsed = ExpressionCache::parsed(expr);
     if (!parsed.ok) {
       m_graphEntryBar->setStatus(QStringLiteral("Ungueltig: %1").arg(parsed.error), true);
       return;
@@ -1617,13 +1800,13 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
           ? base.sourceExpression
           : base.expression;
       const QString innerLabel = base.isDerivativeCurve ? base.expression : src;
-      const QString firstSym = MathExpressionParser::symbolicDerivativeString(src);
+      const QString firstSym = ExpressionCache::derivativeString(src);
       QString plotSource = src;
       QString displayExpr = firstSym;
       if (base.isDerivativeCurve) {
         plotSource = firstSym.isEmpty() ? src : firstSym;
         displayExpr =
-            firstSym.isEmpty() ? QString() : MathExpressionParser::symbolicDerivativeString(firstSym);
+            firstSym.isEmpty() ? QString() : ExpressionCache::derivativeString(firstSym);
       }
       GraphFunction derFn;
       derFn.sourceExpression = plotSource;
@@ -1668,7 +1851,7 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
       return;
     const auto &f = d.functions[idx];
     const QString expr = f.isDerivativeCurve ? f.sourceExpression : f.expression;
-    const ParsedExpression parsed = MathExpressionParser::parseFunctionExpression(expr);
+    const ParsedExpression parsed = ExpressionCache::parsed(expr);
     double x0 = 0.0;
     if (parsed.ok) {
       const QVector<double> roots =
@@ -1777,7 +1960,7 @@ MultiPageNoteView::MultiPageNoteView(QWidget *parent) : QGraphicsView(parent) {
     syncGraphLegendLayout();
     repositionGraphEntryBar();
     // Lazy page hydration on scroll (desktop + Android) so long notes
-    // don't build every StrokeItem up front.
+    // don't load every page up front.
     hydrateVisibleRange();
   });
   auto kickCoalescer = [this]() {
@@ -1877,42 +2060,19 @@ void MultiPageNoteView::hydratePageContent(int i) {
     return;
   m_hydratedPages.insert(i);
 
-  bool wasBlocked = scene_.blockSignals(true);
-  for (const auto &s : note_->pages[i].strokes) {
-    StrokeItem::StrokeStyle type = StrokeItem::Normal;
-    QPen pen;
-    if (s.isEraser) {
-      pen = QPen(UIStyles::PageBackground, s.width);
-      type = StrokeItem::Eraser;
-    } else if (s.isHighlighter) {
-      QColor c = s.color;
-      c.setAlpha(80);
-      pen = QPen(c, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
-      type = StrokeItem::Highlighter;
-    } else {
-      pen = QPen(s.color, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
-      type = StrokeItem::Normal;
-    }
-
-    QVector<StrokePoint> strokePts;
-    if (type == StrokeItem::Normal && s.pressures.size() == s.points.size()) {
-      strokePts.reserve(s.points.size());
-      for (int k = 0; k < s.points.size(); ++k)
-        strokePts.append({s.points[k], s.pressures[k]});
-    }
-    auto item = new StrokeItem(s.path, pen, strokePts, type);
-
-    if (s.isEraser || (!s.isEraser && !s.isHighlighter)) {
-        item->setZValue(1.0);
-    } else if (s.isHighlighter) {
-        item->setZValue(0.5);
-    }
-
-    item->setFlag(QGraphicsItem::ItemIsSelectable, true);
-    item->setFlag(QGraphicsItem::ItemIsMovable, true);
-    scene_.addItem(item);
-    item->setPos(pageRect(i).topLeft());
+  // Chunked notes: page content is read from disk on first hydrate. The
+  // PageItem was laid out from metadata only, so hand it the background now.
+  NotePage &page = note_->pages[i];
+  if (!page.isLoaded()) {
+    page.ensureLoaded();
+    if (!page.backgroundImage.isNull() && pageItems_[i])
+      pageItems_[i]->setBackgroundImage(page.backgroundImage);
   }
+
+  // Strokes stay in the model; the page's ink layer paints and hit-tests
+  // them (promoteStrokesIn() makes items when they are selected).
+  refreshPageInk(i);
+  bool wasBlocked = scene_.blockSignals(true);
   for (const auto& g : note_->pages[i].graphs) {
     auto* gi = new GraphCanvasItem(g.rect);
     gi->fromData(g);
@@ -1950,9 +2110,20 @@ void MultiPageNoteView::hydrateVisibleRange() {
     hydratePageContent(i);
 }
 
+MultiPageNoteView::~MultiPageNoteView() {
+  // Undo commands point at scene items; drop them while scene_ is alive.
+  delete std::exchange(m_eraseCommand, nullptr);
+  if (m_undoStack)
+    m_undoStack->clear();
+  if (m_pageUndoStack)
+    m_pageUndoStack->clear();
+}
+
 void MultiPageNoteView::setNote(Note *note) { setNote(note, true); }
 
 void MultiPageNoteView::setNote(Note *note, bool clearUndoStack) {
+  if (m_pdfImport && note != note_)
+    m_pdfImport->cancel();
   m_textEditOpen = false;
   m_textEditBefore.clear();
   m_activeTextItem.clear();
@@ -1963,8 +2134,13 @@ void MultiPageNoteView::setNote(Note *note, bool clearUndoStack) {
     m_undoStack->clear();
   if (m_pageUndoStack && clearUndoStack)
     m_pageUndoStack->clear();
+  delete std::exchange(m_eraseCommand, nullptr);
+  strokeIndex_.clear();
+  tileCache_.clear();
+  m_promoted.clear();
   scene_.clear();
   pageItems_.clear();
+  inkLayers_.clear();
   m_hydratedPages.clear();
   m_pagesBarAnchorStrip = nullptr;
   resetGraphChromeAfterSceneClear();
@@ -1999,15 +2175,17 @@ QGraphicsPathItem *MultiPageNoteView::createStrokeGraphicsItem(const Stroke &s)
     pen.setColor(QColor(s.color.red(), s.color.green(), s.color.blue(), 100));
   }
   QGraphicsPathItem *pathItem = nullptr;
-  if (!s.isEraser && !s.isHighlighter &&
-      s.pressures.size() == s.points.size() && !s.points.isEmpty()) {
-    QVector<StrokePoint> strokePts;
-    strokePts.reserve(s.points.size());
-    for (int k = 0; k < s.points.size(); ++k)
-      strokePts.append({s.points[k], s.pressures[k]});
-    pathItem = new StrokeItem(s.path, pen, strokePts, StrokeItem::Normal);
+  const QPainterPath path = StrokeGeometry::path(s);
+  if (StrokeGeometry::hasOutline(s)) {
+    // Same points buffer and cached outline as the model stroke.
+    auto *strokeItem = new StrokeItem(path, pen, s.points, StrokeItem::Normal);
+    strokeItem->setOutline(StrokeGeometry::outline(s));
+    pathItem = strokeItem;
   } else {
-    pathItem = new QGraphicsPathItem(s.path);
+    pathItem = new StrokeItem(path, pen, StrokePoints(),
+                              s.isEraser        ? StrokeItem::Eraser
+                              : s.isHighlighter ? StrokeItem::Highlighter
+                                                : StrokeItem::Normal);
   }
   pathItem->setPen(pen);
   pathItem->setFlag(QGraphicsItem::ItemIsSelectable, true);
@@ -2016,6 +2194,163 @@ QGraphicsPathItem *MultiPageNoteView::createStrokeGraphicsItem(const Stroke &s)
   return pathItem;
 }
 
+int MultiPageNoteView::modelStrokeIndex(int page,
+                                        const QGraphicsItem *item) const {
+  if (!note_ || page < 0 || page >= note_->pages.size())
+    return -1;
+  const quintptr id = item->data(kStrokeIdentityKey).value<quintptr>();
+  if (!id)
+    return -1;
+  const QVector<Stroke> &strokes = std::as_const(note_->pages)[page].strokes;
+  for (int k = 0; k < strokes.size(); ++k) {
+    if (strokeIdentity(strokes[k]) == id)
+      return k;
+  }
+  return -1;
+}
+
+PageInkLayer *MultiPageNoteView::loadedInkLayer(int page) const {
+  if (!note_ || page < 0 || page >= note_->pages.size() ||
+      page >= inkLayers_.size() || !inkLayers_[page] ||
+      !std::as_const(note_->pages)[page].isLoaded())
+    return nullptr;
+  return inkLayers_[page];
+}
+
+void MultiPageNoteView::refreshPageInk(int page) {
+  PageInkLayer *layer = loadedInkLayer(page);
+  if (!layer)
+    return;
+  QSet<quintptr> promoted;
+  for (auto it = m_promoted.cbegin(); it != m_promoted.cend(); ++it) {
+    if (it->page == page)
+      promoted.insert(quintptr(it->points.id()));
+  }
+  layer->setStrokes(std::as_const(note_->pages)[page].strokes, promoted);
+}
+
+void MultiPageNoteView::replacePageInk(int page, int at, int count,
+                                       const QVector<Stroke> &with) {
+  if (PageInkLayer *layer = loadedInkLayer(page))
+    layer->replaceStrokes(at, count, with);
+}
+
+void MultiPageNoteView::promoteStrokesIn(const QPainterPath &sceneArea) {
+  if (!note_)
+    return;
+  const QRectF box = sceneArea.boundingRect();
+  for (int p = 0; p < inkLayers_.size() && p < note_->pages.size(); ++p) {
+    const QRectF pr = pageRect(p);
+    if (!inkLayers_[p] || !m_hydratedPages.contains(p) || !pr.intersects(box))
+      continue;
+    const QVector<int> hits =
+        inkLayers_[p]->hitByArea(sceneArea.translated(-pr.topLeft()));
+    if (hits.isEmpty())
+      continue;
+    const QVector<Stroke> &strokes = std::as_const(note_->pages)[p].strokes;
+    for (int k : hits) {
+      const Stroke &s = strokes[k];
+      // Old background-coloured eraser strokes are not selectable ink.
+      if (s.isEraser)
+        continue;
+      QGraphicsPathItem *item = createStrokeGraphicsItem(s);
+      item->setData(kStrokeIdentityKey, QVariant::fromValue(strokeIdentity(s)));
+      item->setParentItem(pageItems_[p]);
+      strokeIndex_.insert(item, p);
+      m_promoted.insert(item, {p, s.points});
+      inkLayers_[p]->setExcluded(k, true);
+    }
+  }
+}
+
+void MultiPageNoteView::demoteStrokes(bool all) {
+  if (m_promoted.isEmpty() || !note_)
+    return;
+  if (!all && (m_transformOverlay || m_cropResizer))
+    return; // they hold the items; applyTransform()/applyCrop() come back
+  if (all) {
+    cancelCrop();
+    if (m_transformOverlay || m_transformGroup)
+      applyTransform();
+  }
+  bool changed = false;
+  bool deselected = false;
+  // Deleting a selected item would re-enter onSelectionChanged() per item.
+  const bool wasBlocked = scene_.blockSignals(true);
+  const QList<QGraphicsPathItem *> items = m_promoted.keys();
+  for (QGraphicsPathItem *item : items) {
+    if (!all && item->isSelected())
+      continue;
+    const int page = m_promoted.take(item).page;
+    const int idx = modelStrokeIndex(page, item);
+    if (idx >= 0) {
+      Stroke &s = note_->pages[page].strokes[idx];
+      PageInkLayer *layer = loadedInkLayer(page);
+      if (applyStrokeItemEdits(item, pageRect(page).topLeft(), &s)) {
+        changed = true;
+        if (layer)
+          layer->replaceStrokes(idx, 1, {s});
+      } else if (layer) {
+        layer->setExcluded(idx, false);
+      }
+    }
+    deselected |= item->isSelected();
+    strokeIndex_.remove(item);
+    delete item;
+  }
+  scene_.blockSignals(wasBlocked);
+  if (changed && onSaveRequested)
+    onSaveRequested(note_);
+  if (deselected)
+    emit scene_.selectionChanged();
+}
+
+void MultiPageNoteView::eraseStrokesAt(const QPointF &scenePos, qreal radius,
+                                       bool wholeStrokes) {
+  if (!note_)
+    return;
+  const QRectF box(scenePos.x() - radius, scenePos.y() - radius, 2 * radius,
+                   2 * radius);
+  for (int p = 0; p < inkLayers_.size() && p < note_->pages.size(); ++p) {
+    const QRectF pr = pageRect(p);
+    if (!inkLayers_[p] || !m_hydratedPages.contains(p) || !pr.intersects(box))
+      continue;
+    const QPointF center = scenePos - pr.topLeft();
+    const QVector<PageInkLayer::DiscHit> hits =
+        inkLayers_[p]->hitByDisc(center, radius);
+    // Back to front: replacing a stroke shifts the ones after it.
+    for (int k = hits.size() - 1; k >= 0; --k) {
+      const PageInkLayer::DiscHit &hit = hits[k];
+      const QVector<Stroke> &strokes = std::as_const(note_->pages)[p].strokes;
+      if (hit.stroke >= strokes.size())
+        continue;
+      const Stroke &s = strokes[hit.stroke];
+      // Old background-coloured eraser strokes are left alone.
+      if (s.isEraser)
+        continue;
+      QVector<Stroke> pieces;
+      if (!wholeStrokes && !StrokeGeometry::eraseDisc(s, center, radius, &pieces,
+                                                      hit.first, hit.last))
+        continue;
+      if (!m_eraseCommand)
+        m_eraseCommand = new StrokeEraseUndoCommand(this);
+      m_eraseCommand->replace(p, hit.stroke, pieces);
+    }
+  }
+}
+
+void MultiPageNoteView::finishEraseGesture() {
+  StrokeEraseUndoCommand *cmd = std::exchange(m_eraseCommand, nullptr);
+  if (!cmd)
+    return;
+  if (m_undoStack)
+    m_undoStack->push(cmd);
+  else
+    delete cmd;
+  if (onSaveRequested)
+    onSaveRequested(note_);
+}
+
 void MultiPageNoteView::pushStrokeUndoCommand(int pageIdx, Stroke stroke) {
   if (!m_undoStack || !note_)
     return;
@@ -2028,6 +2363,8 @@ void MultiPageNoteView::undo() {
     m_activeTextItem->document()->undo();
     return;
   }
+  // The commands work on the model; selected strokes are handed back first.
+  demoteStrokes(true);
   if (m_undoStack && m_undoStack->canUndo()) {
     m_undoStack->undo();
   } else if (m_pageUndoStack && m_pageUndoStack->canUndo()) {
@@ -2041,6 +2378,7 @@ void MultiPageNoteView::redo() {
     m_activeTextItem->document()->redo();
     return;
   }
+  demoteStrokes(true);
   if (m_pageUndoStack && m_pageUndoStack->canRedo()) {
     m_pageUndoStack->redo();
   } else if (m_undoStack && m_undoStack->canRedo()) {
@@ -2070,6 +2408,7 @@ bool MultiPageNoteView::isEditingText() const {
 }
 
 void MultiPageNoteView::layoutPages() {
+  demoteStrokes(true);
   if (m_undoStack)
     m_undoStack->clear();
   if (m_pagesBarAnchorStrip) {
@@ -2078,6 +2417,9 @@ void MultiPageNoteView::layoutPages() {
     m_pagesBarAnchorStrip = nullptr;
   }
   // Vorhandene Seiten-Items entfernen
+  qDeleteAll(inkLayers_);
+  inkLayers_.clear();
+  tileCache_.clear();
   for (auto *item : pageItems_) {
     const QList<QGraphicsItem *> kids = item->childItems();
     for (QGraphicsItem *c : kids)
@@ -2091,34 +2433,62 @@ void MultiPageNoteView::layoutPages() {
     syncPagesBarVisibility();
     return;
   }
-  int n = std::max(1, (int)note_->pages.size());
-  qreal y = 0;
-
+  const int n = std::max(1, (int)note_->pages.size());
   for (int i = 0; i < n; ++i) {
-    auto pageItem = new PageItem(0, 0, a4wPx(), a4hPx());
-    // Seiten ganz unten (Z=0 oder negativ), damit Lineal drüber ist
-    pageItem->setZValue(0);
-    if (i < note_->pages.size()) {
-      const NotePage &pg = note_->pages[i];
-      const int bt = qBound(0, pg.backgroundType,
-                            static_cast<int>(PageBackgroundType::Legal));
-      pageItem->setType(static_cast<PageBackgroundType>(bt));
-      pageItem->setPaperColor(pg.paperColor.isValid() ? pg.paperColor
-                                                       : QColor(Qt::white));
-      if (!pg.backgroundImage.isNull())
-        pageItem->setBackgroundImage(pg.backgroundImage);
-    }
-    scene_.addItem(pageItem);
-    pageItem->setPos(0, y);
-    pageItems_.push_back(pageItem);
-    y += a4hPx() + pageSpacingPx();
-  }
+    addPageSlot();
+    applyPageAppearance(i);
+  }
+  // Hydrated pages stay hydrated; hand their ink to the new layers.
+  for (int i : std::as_const(m_hydratedPages))
+    refreshPageInk(i);
+  placePagesBarStrip();
+}
+
+void MultiPageNoteView::addPageSlot() {
+  const int i = pageItems_.size();
+  auto pageItem = new PageItem(0, 0, a4wPx(), a4hPx());
+  // Seiten ganz unten (Z=0 oder negativ), damit Lineal drüber ist
+  pageItem->setZValue(0);
+  scene_.addItem(pageItem);
+  pageItem->setPos(pageRect(i).topLeft());
+  pageItems_.push_back(pageItem);
+  inkLayers_.push_back(
+      new PageInkLayer(&tileCache_, i, pageItem->rect(), pageItem));
+}
+
+void MultiPageNoteView::applyPageAppearance(int i) {
+  if (!note_ || i < 0 || i >= pageItems_.size())
+    return;
+  PageItem *pageItem = pageItems_[i];
+  if (i >= note_->pages.size()) {
+    pageItem->setType(PageBackgroundType::Grid);
+    pageItem->setPaperColor(QColor(Qt::white));
+    pageItem->setBackgroundImage(QImage());
+    pageItem->setBackgroundSource(nullptr);
+    return;
+  }
+  const NotePage &pg = std::as_const(note_->pages)[i];
+  const int bt =
+      qBound(0, pg.backgroundType, static_cast<int>(PageBackgroundType::Legal));
+  pageItem->setType(static_cast<PageBackgroundType>(bt));
+  pageItem->setPaperColor(pg.paperColor.isValid() ? pg.paperColor
+                                                   : QColor(Qt::white));
+  pageItem->setBackgroundImage(pg.backgroundImage);
+  pageItem->setBackgroundSource(PdfRenderPool::instance().background(pg.pdf));
+}
+
+void MultiPageNoteView::placePagesBarStrip() {
+  const qreal y = pageItems_.size() * (a4hPx() + pageSpacingPx());
   const qreal stripW =
       qMax(320.0, static_cast<qreal>(qRound(a4wPx() * kPagesBarStripWidthRatio)));
   const qreal stripX = (a4wPx() - stripW) / 2.0;
-  m_pagesBarAnchorStrip =
-      new SkeletonPageItem(stripX, y, stripW, kPagesBarStripHeight());
-  scene_.addItem(m_pagesBarAnchorStrip);
+  if (m_pagesBarAnchorStrip) {
+    m_pagesBarAnchorStrip->setPos(stripX, y);
+  } else {
+    m_pagesBarAnchorStrip =
+        new SkeletonPageItem(stripX, y, stripW, kPagesBarStripHeight());
+    scene_.addItem(m_pagesBarAnchorStrip);
+  }
 
   const qreal stripBottom = y + kPagesBarStripHeight();
   const qreal sceneBottom =
@@ -2128,6 +2498,74 @@ void MultiPageNoteView::layoutPages() {
   syncPagesBarVisibility();
 }
 
+void MultiPageNoteView::dehydratePage(int i) {
+  if (i < 0 || i >= pageItems_.size())
+    return;
+  m_hydratedPages.remove(i);
+  if (inkLayers_.value(i))
+    inkLayers_[i]->clear();
+  // The slot may show another page next: promoted strokes are dropped, not
+  // written back.
+  for (auto it = m_promoted.begin(); it != m_promoted.end();) {
+    if (it->page == i)
+      it = m_promoted.erase(it);
+    else
+      ++it;
+  }
+  // Top-level strokes (ungrouped after a transform) first, then everything
+  // parented to the page.
+  const QList<QGraphicsPathItem *> strokes = strokeIndex_.itemsOnPage(i);
+  for (QGraphicsPathItem *item : strokes) {
+    strokeIndex_.remove(item);
+    if (!item->parentItem()) {
+      scene_.removeItem(item);
+      delete item;
+    }
+  }
+  const QList<QGraphicsItem *> kids = pageItems_[i]->childItems();
+  for (QGraphicsItem *c : kids) {
+    if (c == inkLayers_.value(i))
+      continue;
+    strokeIndex_.remove(c);
+    delete c;
+  }
+}
+
+void MultiPageNoteView::relayoutPageRange(int first, int last) {
+  if (!note_)
+    return;
+  const int n = std::max(1, (int)note_->pages.size());
+  const int slots = pageItems_.size();
+  if (last < 0)
+    last = std::max(n, slots) - 1;
+  bool wasBlocked = scene_.blockSignals(true);
+  for (int i = first; i <= std::min(last, slots - 1); ++i)
+    dehydratePage(i);
+  scene_.blockSignals(wasBlocked);
+  // Graph items of these pages may have been bound to the chrome.
+  resetGraphChromeAfterSceneClear();
+
+  while (pageItems_.size() > n) {
+    delete inkLayers_.takeLast();
+    PageItem *pageItem = pageItems_.takeLast();
+    scene_.removeItem(pageItem);
+    delete pageItem;
+  }
+  while (pageItems_.size() < n)
+    addPageSlot();
+  for (int i = first; i <= std::min(last, n - 1); ++i)
+    applyPageAppearance(i);
+  if (slots != n)
+    placePagesBarStrip();
+
+  if (note_->pages.size() > 8) {
+    hydrateVisibleRange();
+  } else {
+    for (int i = first; i <= std::min(last, n - 1); ++i)
+      hydratePageContent(i);
+  }
+}
+
 void MultiPageNoteView::toggleRuler(bool active) {
     if (active) {
         ToolConfig config = ToolManager::instance().config();
@@ -2155,24 +2593,21 @@ int MultiPageNoteView::pageAt(const QPointF &scenePos) const {
 void MultiPageNoteView::addNewPage() {
   if (!note_)
     return;
-  auto before = note_->pages;
-  note_->ensurePage(note_->pages.size());
-  pushPageSnapshotCommand(before, tr("Add page"));
+  PageEdit edit{PageEdit::Insert, int(note_->pages.size())};
+  edit.page.title = QString("Seite %1").arg(edit.index + 1);
+  pushPageEdits({edit}, tr("Add page"));
 }
 
 void MultiPageNoteView::addNewPageWithLayout(int backgroundType,
                                              const QColor &paperColor) {
   if (!note_)
     return;
-  auto before = note_->pages;
-  int idx = note_->pages.size();
-  note_->ensurePage(idx);
-  note_->pages[idx].backgroundType =
+  PageEdit edit{PageEdit::Insert, int(note_->pages.size())};
+  edit.page.title = QString("Seite %1").arg(edit.index + 1);
+  edit.page.backgroundType =
       qBound(0, backgroundType, static_cast<int>(PageBackgroundType::Legal));
-  note_->pages[idx].paperColor =
-      paperColor.isValid() ? paperColor : QColor(Qt::white);
-  note_->pages[idx].backgroundImage = QImage();
-  pushPageSnapshotCommand(before, tr("Add page with layout"));
+  edit.page.paperColor = paperColor.isValid() ? paperColor : QColor(Qt::white);
+  pushPageEdits({edit}, tr("Add page with layout"));
 }
 
 void MultiPageNoteView::showBottomSheetFromPull() {
@@ -2320,15 +2755,18 @@ void MultiPageNoteView::applyLayoutToPage(int pageIndex, int backgroundType,
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size())
     return;
   NotePage &pg = note_->pages[pageIndex];
+  pg.ensureLoaded();
   pg.backgroundType =
       qBound(0, backgroundType, static_cast<int>(PageBackgroundType::Legal));
   pg.paperColor = paperColor.isValid() ? paperColor : QColor(Qt::white);
   pg.backgroundImage = QImage();
+  pg.pdf = PdfPageRef();
   if (pageIndex >= 0 && pageIndex < pageItems_.size() && pageItems_[pageIndex]) {
     PageItem *pi = pageItems_[pageIndex];
     pi->setType(static_cast<PageBackgroundType>(pg.backgroundType));
     pi->setPaperColor(pg.paperColor);
     pi->setBackgroundImage(QImage());
+    pi->setBackgroundSource(nullptr);
   }
   if (onSaveRequested)
     onSaveRequested(note_);
@@ -2441,8 +2879,6 @@ void MultiPageNoteView::pickAndImportPdf() {
               QStringLiteral(
                   "PDF konnte nicht importiert werden (Datei ungültig oder "
                   "PDF-Unterstützung nicht verfügbar)."));
-        } else if (self->note_) {
-          self->scrollToPage(self->note_->pages.size() - 1);
         }
       });
   return;
@@ -2458,8 +2894,6 @@ void MultiPageNoteView::pickAndImportPdf() {
         QStringLiteral(
             "PDF konnte nicht importiert werden (Datei ungültig oder PDF-Unterstützung "
             "nicht verfügbar)."));
-  } else if (note_) {
-    scrollToPage(note_->pages.size() - 1);
   }
 #endif
 }
@@ -3222,10 +3656,14 @@ void MultiPageNoteView::mouseMoveEvent(QMouseEvent *e) {
 void MultiPageNoteView::commitPendingStrokeItemsToNote(AbstractTool *tool) {
   if (!tool || !note_)
     return;
+  // The drawing tools register their live StrokeItems with strokeIndex_;
+  // walking scene_.items() here cost O(scene) per pen-up.
+  finishEraseGesture();
+  const QList<StrokeItem *> pending = strokeIndex_.takePending();
   QList<QGraphicsItem *> itemsToRemove;
-  for (QGraphicsItem *item : scene_.items()) {
-    if (!item->parentItem() && item->type() == QGraphicsItem::UserType + 1) {
-      auto *strokeItem = static_cast<StrokeItem *>(item);
+  for (StrokeItem *strokeItem : pending) {
+    if (strokeItem->scene() == &scene_ && !strokeItem->parentItem()) {
+      QGraphicsItem *item = strokeItem;
       auto points = strokeItem->points();
       if (!points.isEmpty()) {
         // ── Formula-zone eraser: must happen BEFORE the pageAt() check ──────
@@ -3244,6 +3682,12 @@ void MultiPageNoteView::commitPendingStrokeItemsToNote(AbstractTool *tool) {
                 zoneEraserPath, strokeItem->pen().widthF());
           }
         }
+        // The eraser already cut the note strokes (eraseStrokesAt); its
+        // trail is not stored as a background-coloured stroke any more.
+        if (strokeItem->strokeStyle() == StrokeItem::Eraser) {
+          itemsToRemove.append(item);
+          continue;
+        }
 
         int pIdx = pageAt(points.first().pos);
         if (pIdx >= 0 && note_) {
@@ -3258,32 +3702,17 @@ void MultiPageNoteView::commitPendingStrokeItemsToNote(AbstractTool *tool) {
           s.isHighlighter =
               (strokeItem->strokeStyle() == StrokeItem::Highlighter);
 
-          QPainterPath localPath;
+          // Full pressure everywhere stores no pressures (StrokePoints).
           QPainterPath scenePath;
+          s.points.reserve(int(points.size()));
           for (int i = 0; i < points.size(); ++i) {
             QPointF sceneP = points[i].pos;
-            QPointF localP = sceneP - pageTopLeft;
-            s.points.append(localP);
-            s.pressures.append(points[i].pressure);
-            if (i == 0) {
-              localPath.moveTo(localP);
+            s.points.append(sceneP - pageTopLeft, points[i].pressure);
+            if (i == 0)
               scenePath.moveTo(sceneP);
-            } else {
-              localPath.lineTo(localP);
+            else
               scenePath.lineTo(sceneP);
-            }
           }
-          s.path = localPath;
-
-          bool uniformPressure = true;
-          for (qreal pr : s.pressures) {
-            if (pr < 1.0) {
-              uniformPressure = false;
-              break;
-            }
-          }
-          if (uniformPressure)
-            s.pressures.clear();
 
           bool capturedByZone = false;
           if (m_activeFormulaZone && !s.isEraser) {
@@ -3505,28 +3934,41 @@ void MultiPageNoteView::tabletEvent(QTabletEvent *e) {
 
   AbstractTool *tool = ToolManager::instance().activeTool();
 
-  // ── Live eraser → formula zone ────────────────────────────────────
-  // Formula zone strokes are NOT QGraphicsScene items — the EraserTool's
-  // eraseAt() never sees them.  We intercept every eraser move/press here
-  // and forward it directly to the formula zone.
+  // A batching stroke is under way: moves only go into the ring; press and
+  // release first hand over what is queued so the order stays intact.
+  if (tabletBatching_) {
+    if (e->type() == QEvent::TabletMove) {
+      lastTabletTimestamp_ =
+          qMax<qint64>(lastTabletTimestamp_, qint64(e->timestamp()));
+      // Mapped now, at full precision: the view may scroll or zoom before
+      // the frame hands the sample over.
+      const QPointF pos = viewportTransform().inverted().map(e->position());
+      tabletRing_.push(TabletSample{pos, e->pressure(), e->xTilt(),
+                                    e->yTilt(), lastTabletTimestamp_});
+      if (tabletFrameWindow_)
+        tabletFrameWindow_->requestUpdate();
+      else
+        flushTabletSamples();
+      e->accept();
+      return;
+    }
+    flushTabletSamples();
+  }
+
+  // Live eraser → formula zone, see eraseFormulaZoneAt().
   if (tool && m_activeFormulaZone
       && tool->mode() == ToolMode::Eraser
       && (e->type() == QEvent::TabletPress || e->type() == QEvent::TabletMove))
-  {
-      const QRectF zoneScene = m_activeFormulaZone->catchAreaSceneRect();
-      const qreal r = 12.0; // eraser radius
-      if (zoneScene.adjusted(-r, -r, r, r).contains(scenePos)) {
-          QPainterPath ep;
-          ep.addEllipse(scenePos, r, r);
-          m_activeFormulaZone->eraseStrokesIntersecting(ep, r * 2.0);
-      }
-  }
+    eraseFormulaZoneAt(scenePos);
 
   if (tool && note_ && mode_ != ToolMode::Lasso) {
     tool->setStrokeSceneForTablet(&scene_);
     if (tool->handleTabletEvent(e, scenePos)) {
       e->accept();
+      if (e->type() == QEvent::TabletPress && tool->acceptsTabletBatches())
+        setTabletBatching(true);
       if (e->type() == QEvent::TabletRelease) {
+        setTabletBatching(false);
         GraphCanvasItem *newGraph = qgraphicsitem_cast<GraphCanvasItem *>(tool->lastCompletedItem());
         commitPendingStrokeItemsToNote(tool);
         syncGraphItemsToNote();
@@ -3582,8 +4024,7 @@ void MultiPageNoteView::tabletEvent(QTabletEvent *e) {
     }
 
     currentStroke_.points.push_back(local);
-    currentStroke_.path = QPainterPath(local);
-    currentPathItem_ = new QGraphicsPathItem();
+    currentPathItem_ = new QGraphicsPathItem(QPainterPath(local));
     QPen pen(currentStroke_.color, currentStroke_.width, Qt::SolidLine,
              Qt::RoundCap, Qt::RoundJoin);
     currentPathItem_->setPen(pen);
@@ -3595,8 +4036,9 @@ void MultiPageNoteView::tabletEvent(QTabletEvent *e) {
     e->accept();
   } else if (e->type() == QEvent::TabletMove && drawing_) {
     currentStroke_.points.push_back(local);
-    currentStroke_.path.lineTo(local);
-    currentPathItem_->setPath(currentStroke_.path);
+    QPainterPath path = currentPathItem_->path();
+    path.lineTo(local);
+    currentPathItem_->setPath(path);
     e->accept();
   } else if (e->type() == QEvent::TabletRelease && drawing_) {
     drawing_ = false;
@@ -3613,107 +4055,81 @@ void MultiPageNoteView::tabletEvent(QTabletEvent *e) {
   }
 }
 
-namespace {
-// Full page raster for thumbnails + PDF export. Includes paper, PDF
-// background images, ruled patterns, strokes and sticky notes so imported
-// PDFs no longer export as blank white pages.
-QImage renderFullPageImage(const NotePage &page, int pageW, int pageH) {
-  QImage img(pageW, pageH, QImage::Format_ARGB32_Premultiplied);
-  const QColor paper =
-      page.paperColor.isValid() ? page.paperColor : QColor(Qt::white);
-  img.fill(paper);
-  QPainter p(&img);
-  p.setRenderHint(QPainter::Antialiasing);
-  p.setRenderHint(QPainter::SmoothPixmapTransform);
-
-  if (!page.backgroundImage.isNull()) {
-    p.drawImage(QRectF(0, 0, pageW, pageH), page.backgroundImage);
-  } else {
-    const int L = paper.lightness();
-    const QColor lineCol =
-        L < 130 ? QColor(255, 255, 255, 50) : QColor(190, 190, 210, 110);
-    const auto type = static_cast<PageBackgroundType>(page.backgroundType);
-    switch (type) {
-    case PageBackgroundType::Blank:
-      break;
-    case PageBackgroundType::Lined:
-    case PageBackgroundType::Legal: {
-      p.setPen(QPen(lineCol, 1));
-      for (int y = 40; y < pageH; y += 40)
-        p.drawLine(0, y, pageW, y);
-      if (type == PageBackgroundType::Legal) {
-        p.setPen(QPen(L < 130 ? QColor(255, 120, 120) : QColor(220, 80, 80), 2));
-        p.drawLine(72, 0, 72, pageH);
-      }
-      break;
-    }
-    case PageBackgroundType::Grid: {
-      p.setPen(QPen(lineCol, 1));
-      for (int x = 40; x < pageW; x += 40)
-        p.drawLine(x, 0, x, pageH);
-      for (int y = 40; y < pageH; y += 40)
-        p.drawLine(0, y, pageW, y);
-      break;
-    }
-    case PageBackgroundType::Dotted: {
-      p.setPen(Qt::NoPen);
-      p.setBrush(lineCol);
-      for (int y = 40; y < pageH; y += 40)
-        for (int x = 40; x < pageW; x += 40)
-          p.drawEllipse(QPointF(x, y), 1.4, 1.4);
-      break;
-    }
-    }
+void MultiPageNoteView::setTabletBatching(bool on) {
+  tabletBatching_ = on;
+  QWindow *window = on ? this->window()->windowHandle() : nullptr;
+  if (window != tabletFrameWindow_) {
+    if (tabletFrameWindow_)
+      tabletFrameWindow_->removeEventFilter(this);
+    tabletFrameWindow_ = window;
+    if (window)
+      window->installEventFilter(this);
   }
+  if (on)
+    lastTabletTimestamp_ = 0;
+}
 
-  for (const auto &s : page.strokes) {
-    QColor c = s.color;
-    if (s.isHighlighter)
-      c.setAlpha(80);
-    else if (!s.isEraser)
-      c.setAlpha(255);
-    QPen pen;
-    if (s.isEraser)
-      pen = QPen(paper, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
-    else
-      pen = QPen(c, s.width, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
-    p.setPen(pen);
-    p.setBrush(Qt::NoBrush);
-    p.drawPath(s.path);
-  }
+bool MultiPageNoteView::eventFilter(QObject *obj, QEvent *e) {
+  // The window is about to paint a frame (QWindow::requestUpdate(), paced
+  // by the display where the platform can): what the queued moves change
+  // still makes it into this frame.
+  if (obj == tabletFrameWindow_ && e->type() == QEvent::UpdateRequest)
+    flushTabletSamples();
+  return QGraphicsView::eventFilter(obj, e);
+}
 
-  for (const auto &sn : page.stickies) {
-    const QRectF r(sn.pos, QSizeF(sn.width, sn.height));
-    p.setPen(QPen(QColor(0, 0, 0, 40), 1));
-    p.setBrush(sn.color.isValid() ? sn.color : QColor(255, 236, 120));
-    p.drawRoundedRect(r, 6, 6);
-    p.setPen(QColor(40, 40, 40));
-    QFont f = p.font();
-    f.setPointSizeF(qMax(8.0, sn.fontPointSize > 0 ? sn.fontPointSize : 14.0));
-    p.setFont(f);
-    p.drawText(r.adjusted(8, 8, -8, -8), Qt::TextWordWrap | Qt::AlignTop,
-               sn.text);
+void MultiPageNoteView::flushTabletSamples() {
+  tabletBatch_.clear();
+  if (tabletRing_.drain(&tabletBatch_) == 0)
+    return;
+  AbstractTool *tool = ToolManager::instance().activeTool();
+  if (!tool || !note_ || mode_ == ToolMode::Lasso) {
+    tabletBatch_.clear();
+    return;
+  }
+  // Pens report faster than the screen shows; samples that land on the
+  // same spot (under half a viewport pixel) are merged into the newest,
+  // keeping the firmest pressure.
+  constexpr qreal kMergePx = 0.35;
+  const qreal scale = std::sqrt(qAbs(viewportTransform().determinant()));
+  const qreal merge = kMergePx / qMax<qreal>(scale, 1e-6);
+  int kept = 0;
+  for (int i = 0; i < tabletBatch_.size(); ++i) {
+    const TabletSample &s = tabletBatch_[i];
+    if (kept > 0) {
+      TabletSample &prev = tabletBatch_[kept - 1];
+      const QPointF d = s.pos - prev.pos;
+      if (qAbs(d.x()) < merge && qAbs(d.y()) < merge) {
+        const qreal pressure = qMax(prev.pressure, s.pressure);
+        prev = s;
+        prev.pressure = pressure;
+        continue;
+      }
+    }
+    tabletBatch_[kept++] = s;
   }
+  tabletBatch_.resize(kept);
 
-  for (const auto &g : page.graphs) {
-    p.setPen(QPen(QColor(90, 90, 110), 1.2));
-    p.setBrush(QColor(255, 255, 255, 210));
-    p.drawRect(g.rect);
-    p.setPen(QColor(120, 120, 140));
-    p.drawText(g.rect.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop,
-               QStringLiteral("Graph"));
+  if (m_activeFormulaZone && tool->mode() == ToolMode::Eraser) {
+    for (const TabletSample &s : std::as_const(tabletBatch_))
+      eraseFormulaZoneAt(s.pos);
   }
-
-  p.end();
-  return img;
+  tool->setStrokeSceneForTablet(&scene_);
+  tool->handleTabletMoves(tabletBatch_);
 }
 
-QImage renderThumbnailImage(const NotePage &page, int pageW, int pageH,
-                            const QSize &size) {
-  return renderFullPageImage(page, pageW, pageH)
-      .scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+void MultiPageNoteView::eraseFormulaZoneAt(const QPointF &scenePos) {
+  // Formula zone strokes are NOT QGraphicsScene items — the EraserTool's
+  // eraseAt() never sees them, so every eraser press/move is forwarded to
+  // the formula zone directly.
+  const QRectF zoneScene = m_activeFormulaZone->catchAreaSceneRect();
+  const qreal r = 12.0; // eraser radius
+  if (zoneScene.adjusted(-r, -r, r, r).contains(scenePos)) {
+    QPainterPath ep;
+    ep.addEllipse(scenePos, r, r);
+    m_activeFormulaZone->eraseStrokesIntersecting(ep, r * 2.0);
+  }
 }
-} // namespace
 
 QPixmap MultiPageNoteView::generateThumbnail(int pageIndex, const QSize &size) {
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size()) {
@@ -3722,26 +4138,42 @@ QPixmap MultiPageNoteView::generateThumbnail(int pageIndex, const QSize &size) {
     return empty;
   }
   // v3.17.6: try cache first (populated by both sync + async paths).
-  const QString key = thumbnailCacheKey(pageIndex, size);
+  const QString key =
+      thumbnailCacheKey(pageIndex, thumbnailRevision(pageIndex), size);
   QPixmap cached;
   if (QPixmapCache::find(key, &cached))
     return cached;
-  QImage scaled = renderThumbnailImage(note_->pages[pageIndex], a4wPx(),
-                                       a4hPx(), size);
+  note_->pages[pageIndex].ensureLoaded();
+  QImage scaled = PageRender::renderThumbnail(note_->pages[pageIndex], a4wPx(),
+                                              a4hPx(), size);
   QPixmap pm = QPixmap::fromImage(scaled);
   QPixmapCache::insert(key, pm);
   return pm;
 }
 
-QString MultiPageNoteView::thumbnailCacheKey(int pageIndex,
+quint64 MultiPageNoteView::thumbnailRevision(int pageIndex) const {
+  // revision() hashes every stroke byte; redo it only when the page's
+  // in-process stamp says something changed.
+  const NotePage &page = std::as_const(note_->pages)[pageIndex];
+  const quint64 stamp = PageRender::stamp(page);
+  const auto it = m_thumbnailRevisions.constFind(pageIndex);
+  if (it != m_thumbnailRevisions.cend() && it->first == stamp)
+    return it->second;
+  const quint64 revision = PageRender::revision(page);
+  m_thumbnailRevisions.insert(pageIndex, {stamp, revision});
+  return revision;
+}
+
+QString MultiPageNoteView::thumbnailCacheKey(int pageIndex, quint64 revision,
                                              const QSize &size) const {
   // Cache-bust on note identity + page revision so a stroke edit invalidates
   // its thumbnail entry. Note* pointer alone is fine for the cache lifetime
   // since QPixmapCache is process-wide and entries get evicted on memory
   // pressure anyway.
-  return QStringLiteral("blop_thumb_%1_%2_%3x%4")
+  return QStringLiteral("blop_thumb_%1_%2_%3_%4x%5")
       .arg(reinterpret_cast<quintptr>(note_))
       .arg(pageIndex)
+      .arg(revision, 16, 16, QLatin1Char('0'))
       .arg(size.width())
       .arg(size.height());
 }
@@ -3758,7 +4190,8 @@ void MultiPageNoteView::generateThumbnailAsync(
     return;
   }
   // Hit-cache fast path keeps the synchronous behaviour for repeat asks.
-  const QString key = thumbnailCacheKey(pageIndex, size);
+  const quint64 revision = thumbnailRevision(pageIndex);
+  const QString key = thumbnailCacheKey(pageIndex, revision, size);
   QPixmap cached;
   if (QPixmapCache::find(key, &cached)) {
     callback(cached);
@@ -3766,8 +4199,12 @@ void MultiPageNoteView::generateThumbnailAsync(
   }
   const int pageW = a4wPx();
   const int pageH = a4hPx();
-  // Deep-copy the page into the worker (QImage is implicitly shared).
-  const NotePage pageCopy = note_->pages[pageIndex];
+  // Earlier runs may have left this very page state on disk.
+  const ThumbnailStore::Key diskKey{note_->id, pageIndex, revision,
+                                    ThumbnailStore::sizeBucket(size)};
+  // Deep-copy the page into the worker (QImage is implicitly shared). An
+  // unloaded page is read there, off the UI thread, and not kept in memory.
+  NotePage pageCopy = note_->pages[pageIndex];
   QPointer<MultiPageNoteView> guard(this);
   auto *watcher = new QFutureWatcher<QImage>(this);
   connect(watcher, &QFutureWatcher<QImage>::finished, this,
@@ -3783,8 +4220,30 @@ void MultiPageNoteView::generateThumbnailAsync(
             callback(pm);
           });
   watcher->setFuture(QtConcurrent::run(
-      [pageW, pageH, size, pageCopy]() {
-        return renderThumbnailImage(pageCopy, pageW, pageH, size);
+      [pageW, pageH, size, pageCopy, diskKey]() mutable {
+        // Stored at the full size of the bucket, so every request of the
+        // bucket is a scale down; larger than the largest bucket: not stored.
+        const int side = qMax(size.width(), size.height());
+        if (side > diskKey.bucket) {
+          pageCopy.ensureLoaded();
+          return PageRender::renderThumbnail(pageCopy, pageW, pageH, size);
+        }
+        const auto fit = [&size](const QImage &img) {
+          const QSize target = img.size().scaled(size, Qt::KeepAspectRatio);
+          return img.size() == target
+                     ? img
+                     : img.scaled(target, Qt::IgnoreAspectRatio,
+                                  Qt::SmoothTransformation);
+        };
+        ThumbnailStore &store = ThumbnailStore::instance();
+        const QImage stored = store.find(diskKey);
+        if (!stored.isNull())
+          return fit(stored);
+        pageCopy.ensureLoaded();
+        const QImage img = PageRender::renderThumbnail(
+            pageCopy, pageW, pageH, QSize(diskKey.bucket, diskKey.bucket));
+        store.insert(diskKey, img);
+        return fit(img);
       }));
 }
 
@@ -3793,85 +4252,91 @@ bool MultiPageNoteView::exportPageToPng(int pageIndex, const QString &path) {
   return pm.save(path, "PNG");
 }
 
-bool MultiPageNoteView::exportNoteToPng(const QString &basePath) {
-  if (!note_ || note_->pages.isEmpty())
+bool MultiPageNoteView::exportNoteToPng(const QString &basePath,
+                                        std::function<void(bool)> done) {
+  if (!note_ || note_->pages.isEmpty() || basePath.isEmpty() || m_imageExport)
     return false;
-  const QSize fullSize(a4wPx(), a4hPx());
-  if (note_->pages.size() == 1) {
-    QPixmap pm = generateThumbnail(0, fullSize);
-    return pm.save(basePath, "PNG");
-  }
-  QFileInfo fi(basePath);
-  QString suffix = fi.suffix().toLower();
-  if (suffix != QLatin1String("png") && suffix != QLatin1String("jpg") &&
-      suffix != QLatin1String("jpeg"))
-    suffix = QStringLiteral("png");
-  const QString base = fi.dir().absoluteFilePath(fi.completeBaseName());
-  const QByteArray format = suffix.toUpper().toUtf8();
-  for (int i = 0; i < note_->pages.size(); ++i) {
-    QPixmap pm = generateThumbnail(i, fullSize);
-    if (!pm.save(QStringLiteral("%1_%2.%3").arg(base).arg(i + 1).arg(suffix), format.constData()))
-      return false;
-  }
+  ImageExportJob::Options options;
+  options.pageSize = QSize(a4wPx(), a4hPx());
+  const QStringList paths = ImageExportJob::pagePaths(
+      basePath, note_->pages.size(), &options.format);
+  auto *job = new ImageExportJob(note_->pages, paths, options, this);
+  QPointer<ImageExportJob> guard(job);
+  auto progress = std::make_shared<BlopDialogs::ProgressSession>(
+      BlopDialogs::presentProgress(window(), QStringLiteral("Bilder exportieren"),
+                                   QStringLiteral("Seiten werden vorbereitet…"),
+                                   [guard]() {
+                                     if (guard)
+                                       guard->cancel();
+                                   }));
+  connect(job, &ImageExportJob::progress, this,
+          [progress](int done, int total) {
+            progress->setRange(0, total);
+            progress->setValue(done);
+            progress->setMessage(
+                QStringLiteral("%1 von %2 Seiten…").arg(done).arg(total));
+          });
+  connect(job, &ImageExportJob::finished, this,
+          [job, progress, done = std::move(done)](bool ok) {
+            progress->close();
+            job->deleteLater();
+            if (done)
+              done(ok);
+          });
+  m_imageExport = job;
+  job->start();
   return true;
 }
 
-bool MultiPageNoteView::exportPageToPdf(int pageIndex, const QString &path) {
+bool MultiPageNoteView::exportPageToPdf(int pageIndex, const QString &path,
+                                        std::function<void(bool)> done) {
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size())
     return false;
-  QPdfWriter pdf(path);
-  pdf.setPageSize(QPageSize(QPageSize::A4));
-  pdf.setResolution(150);
-  pdf.setCreator(QStringLiteral("Blop Notes"));
-  QPainter p(&pdf);
-  if (!p.isActive())
-    return false;
-  const QRectF target = pdf.pageLayout().paintRectPixels(pdf.resolution());
-  const QImage pageImg =
-      renderFullPageImage(note_->pages[pageIndex], a4wPx(), a4hPx());
-  p.fillRect(target, Qt::white);
-  p.drawImage(target, pageImg);
-  p.end();
-  return true;
+  return startPdfExport({std::as_const(note_->pages)[pageIndex]}, path,
+                        std::move(done));
 }
 
-bool MultiPageNoteView::exportNoteToPdf(const QString &path) {
-  if (!note_ || note_->pages.isEmpty() || path.isEmpty())
+bool MultiPageNoteView::exportNoteToPdf(const QString &path,
+                                        std::function<void(bool)> done) {
+  if (!note_ || note_->pages.isEmpty())
     return false;
+  return startPdfExport(note_->pages, path, std::move(done));
+}
 
-  auto progress = BlopDialogs::presentProgress(
-      window(), QStringLiteral("PDF exportieren"),
-      QStringLiteral("Seiten werden vorbereitet…"));
-  progress.setRange(0, note_->pages.size());
-
-  QPdfWriter pdf(path);
-  pdf.setPageSize(QPageSize(QPageSize::A4));
-  pdf.setResolution(150);
-  pdf.setCreator(QStringLiteral("Blop Notes"));
-  QPainter p(&pdf);
-  if (!p.isActive()) {
-    progress.close();
+bool MultiPageNoteView::startPdfExport(QVector<NotePage> pages,
+                                       const QString &path,
+                                       std::function<void(bool)> done) {
+  if (path.isEmpty() || m_pdfExport)
     return false;
-  }
-
-  const QRectF target = pdf.pageLayout().paintRectPixels(pdf.resolution());
-  const int pageW = a4wPx();
-  const int pageH = a4hPx();
-  for (int i = 0; i < note_->pages.size(); ++i) {
-    progress.setValue(i);
-    progress.setMessage(
-        QStringLiteral("Seite %1 von %2…").arg(i + 1).arg(note_->pages.size()));
-    if (i > 0)
-      pdf.newPage();
-    const QImage pageImg =
-        renderFullPageImage(note_->pages[i], pageW, pageH);
-    p.fillRect(target, Qt::white);
-    p.drawImage(target, pageImg);
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-  }
-  p.end();
-  progress.setValue(note_->pages.size());
-  progress.close();
+  // The job writes copies: the note stays editable meanwhile, and pages not
+  // loaded yet are read on the worker, one at a time.
+  auto *job =
+      new PdfExportJob(std::move(pages), QSize(a4wPx(), a4hPx()), path, this);
+  QPointer<PdfExportJob> guard(job);
+  auto progress = std::make_shared<BlopDialogs::ProgressSession>(
+      BlopDialogs::presentProgress(window(), QStringLiteral("PDF exportieren"),
+                                   QStringLiteral("Seiten werden vorbereitet…"),
+                                   [guard]() {
+                                     if (guard)
+                                       guard->cancel();
+                                   }));
+  connect(job, &PdfExportJob::progress, this,
+          [progress](int done, int total) {
+            progress->setRange(0, total);
+            progress->setValue(done);
+            progress->setMessage(QStringLiteral("Seite %1 von %2…")
+                                     .arg(qMin(done + 1, total))
+                                     .arg(total));
+          });
+  connect(job, &PdfExportJob::finished, this,
+          [job, progress, done = std::move(done)](bool ok) {
+            progress->close();
+            job->deleteLater();
+            if (done)
+              done(ok);
+          });
+  m_pdfExport = job;
+  job->start();
   return true;
 }
 
@@ -3879,24 +4344,25 @@ void MultiPageNoteView::movePage(int fromIndex, int toIndex) {
   if (!note_ || fromIndex < 0 || fromIndex >= note_->pages.size() ||
       toIndex < 0 || toIndex >= note_->pages.size())
     return;
-  auto before = note_->pages;
-  note_->pages.move(fromIndex, toIndex);
-  pushPageSnapshotCommand(before, tr("Move page"));
+  if (fromIndex == toIndex)
+    return;
+  PageEdit edit{PageEdit::Move, fromIndex};
+  edit.to = toIndex;
+  pushPageEdits({edit}, tr("Move page"));
 }
 void MultiPageNoteView::duplicatePage(int pageIndex) {
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size())
     return;
-  auto before = note_->pages;
-  NotePage newPage = note_->pages[pageIndex];
-  note_->pages.insert(pageIndex + 1, newPage);
-  pushPageSnapshotCommand(before, tr("Duplicate page"));
+  PageEdit edit{PageEdit::Insert, pageIndex + 1};
+  edit.page = std::as_const(note_->pages)[pageIndex];
+  pushPageEdits({edit}, tr("Duplicate page"));
 }
 void MultiPageNoteView::deletePage(int pageIndex) {
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size())
     return;
-  auto before = note_->pages;
-  note_->pages.removeAt(pageIndex);
-  pushPageSnapshotCommand(before, tr("Delete page"));
+  PageEdit edit{PageEdit::Remove, pageIndex};
+  edit.page = std::as_const(note_->pages)[pageIndex];
+  pushPageEdits({edit}, tr("Delete page"));
 }
 
 void MultiPageNoteView::rotatePage(int pageIndex, int quarterTurns) {
@@ -3906,8 +4372,11 @@ void MultiPageNoteView::rotatePage(int pageIndex, int quarterTurns) {
   if (quarterTurns == 0)
     return;
 
-  auto before = note_->pages;
-  NotePage &page = note_->pages[pageIndex];
+  note_->pages[pageIndex].ensureLoaded();
+  PageEdit edit{PageEdit::Replace, pageIndex};
+  edit.page = std::as_const(note_->pages)[pageIndex];
+  edit.after = edit.page;
+  NotePage &page = edit.after;
   const qreal cx = a4wPx() * 0.5;
   const qreal cy = a4hPx() * 0.5;
   auto rotPoint = [&](QPointF p) {
@@ -3919,21 +4388,25 @@ void MultiPageNoteView::rotatePage(int pageIndex, int quarterTurns) {
     return p;
   };
 
-  for (Stroke &s : page.strokes) {
-    for (QPointF &pt : s.points)
-      pt = rotPoint(pt);
-    s.path = QPainterPath();
-    if (!s.points.isEmpty()) {
-      s.path.moveTo(s.points.first());
-      for (int i = 1; i < s.points.size(); ++i)
-        s.path.lineTo(s.points[i]);
-    }
-  }
+  QTransform rot;
+  for (int i = 0; i < quarterTurns; ++i)
+    rot *= QTransform(0, 1, -1, 0, cx + cy, cy - cx); // 90° CW, as rotPoint
+  for (Stroke &s : page.strokes)
+    s.points = s.points.mapped(rot);
   for (GraphObject &g : page.graphs) {
     const QPointF c = rotPoint(g.rect.center());
     // Keep size; recentre after rotation.
     g.rect.moveCenter(c);
   }
+  if (page.pdf.isValid()) {
+    // The document cannot be drawn rotated; the page keeps a full-size
+    // raster of it instead of the preview.
+    const QImage full =
+        PdfRenderPool::renderPage(page.pdf, QSize(a4wPx(), a4hPx()));
+    if (!full.isNull())
+      page.backgroundImage = full;
+    page.pdf = PdfPageRef();
+  }
   if (!page.backgroundImage.isNull()) {
     QTransform t;
     t.translate(page.backgroundImage.width() / 2.0,
@@ -3945,7 +4418,7 @@ void MultiPageNoteView::rotatePage(int pageIndex, int quarterTurns) {
         page.backgroundImage.transformed(t, Qt::SmoothTransformation);
   }
   page.rotationDegrees = (page.rotationDegrees + 90 * quarterTurns) % 360;
-  pushPageSnapshotCommand(before, tr("Rotate page"));
+  pushPageEdits({edit}, tr("Rotate page"));
 }
 
 bool MultiPageNoteView::isPageBookmarked(int pageIndex) const {
@@ -3971,7 +4444,14 @@ void MultiPageNoteView::togglePageBookmark(int pageIndex) {
 int MultiPageNoteView::strokeCountOnPage(int pageIndex) const {
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size())
     return 0;
-  return note_->pages[pageIndex].strokes.size();
+  NotePage &page = note_->pages[pageIndex];
+  if (page.pendingPayload) {
+    const int stored = page.pendingPayload->strokeCount();
+    if (stored >= 0)
+      return stored;
+  }
+  page.ensureLoaded();
+  return page.strokes.size();
 }
 
 int MultiPageNoteView::undoDepth() const { return m_undoHistory.size(); }
@@ -4013,37 +4493,49 @@ QString MultiPageNoteView::pageTitle(int pageIndex) const {
 void MultiPageNoteView::renamePage(int pageIndex, const QString &title) {
   if (!note_ || pageIndex < 0 || pageIndex >= note_->pages.size())
     return;
-  auto before = note_->pages;
-  note_->pages[pageIndex].title = title;
-  pushPageSnapshotCommand(before, tr("Rename page"));
+  PageEdit edit{PageEdit::Replace, pageIndex};
+  edit.page = std::as_const(note_->pages)[pageIndex];
+  edit.after = edit.page;
+  edit.after.title = title;
+  edit.content = false;
+  pushPageEdits({edit}, tr("Rename page"));
 }
 
 void MultiPageNoteView::duplicatePages(const QList<int> &pageIndices) {
   if (!note_ || pageIndices.isEmpty())
     return;
-  auto before = note_->pages;
   QList<int> sorted = pageIndices;
   std::sort(sorted.begin(), sorted.end());
+  // Back to front, so the indices ahead stay valid while applying.
+  QVector<PageEdit> edits;
   for (int i = sorted.size() - 1; i >= 0; --i) {
     const int idx = sorted[i];
     if (idx < 0 || idx >= note_->pages.size())
       continue;
-    note_->pages.insert(idx + 1, note_->pages[idx]);
+    PageEdit edit{PageEdit::Insert, idx + 1};
+    edit.page = std::as_const(note_->pages)[idx];
+    edits.append(edit);
   }
-  pushPageSnapshotCommand(before, tr("Duplicate pages"));
+  pushPageEdits(std::move(edits), tr("Duplicate pages"));
 }
 
 void MultiPageNoteView::deletePages(const QList<int> &pageIndices) {
   if (!note_ || pageIndices.isEmpty())
     return;
-  auto before = note_->pages;
   QList<int> sorted = pageIndices;
   std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  QVector<PageEdit> edits;
+  int remaining = note_->pages.size();
   for (int idx : sorted) {
-    if (idx >= 0 && idx < note_->pages.size() && note_->pages.size() > 1)
-      note_->pages.removeAt(idx);
+    if (idx < 0 || idx >= note_->pages.size() || remaining <= 1)
+      continue;
+    PageEdit edit{PageEdit::Remove, idx};
+    edit.page = std::as_const(note_->pages)[idx];
+    edits.append(edit);
+    --remaining;
   }
-  pushPageSnapshotCommand(before, tr("Delete pages"));
+  pushPageEdits(std::move(edits), tr("Delete pages"));
 }
 
 void MultiPageNoteView::applyLayoutToPages(const QList<int> &pageIndices,
@@ -4051,10 +4543,24 @@ void MultiPageNoteView::applyLayoutToPages(const QList<int> &pageIndices,
                                            const QColor &paperColor) {
   if (!note_ || pageIndices.isEmpty())
     return;
-  auto before = note_->pages;
-  for (int idx : pageIndices)
-    applyLayoutToPage(idx, backgroundType, paperColor);
-  pushPageSnapshotCommand(before, tr("Apply page layout"));
+  QVector<PageEdit> edits;
+  for (int idx : pageIndices) {
+    if (idx < 0 || idx >= note_->pages.size())
+      continue;
+    note_->pages[idx].ensureLoaded();
+    PageEdit edit{PageEdit::Replace, idx};
+    edit.page = std::as_const(note_->pages)[idx];
+    edit.after = edit.page;
+    edit.after.backgroundType =
+        qBound(0, backgroundType, static_cast<int>(PageBackgroundType::Legal));
+    edit.after.paperColor =
+        paperColor.isValid() ? paperColor : QColor(Qt::white);
+    edit.after.backgroundImage = QImage();
+    edit.after.pdf = PdfPageRef();
+    edit.content = false;
+    edits.append(edit);
+  }
+  pushPageEdits(std::move(edits), tr("Apply page layout"));
 }
 
 void MultiPageNoteView::drawForeground(QPainter *painter, const QRectF &rect) {
@@ -4074,72 +4580,72 @@ void MultiPageNoteView::drawForeground(QPainter *painter, const QRectF &rect) {
 
 // ─── PDF Import ─────────────────────────────────────────────────────────────
 bool MultiPageNoteView::importPdfPages(const QString &pdfPath) {
-  if (!note_ || pdfPath.isEmpty())
+  if (!note_ || pdfPath.isEmpty() || m_pdfImport)
     return false;
 
 #ifdef BLOP_HAS_PDF
-  auto progress = BlopDialogs::presentProgress(
-      window(), QStringLiteral("PDF importieren"),
-      QStringLiteral("PDF wird geladen…"));
-
-  const int pageW = a4wPx();
-  const int pageH = a4hPx();
-
-  // Render off the UI thread — one QPdfDocument owned by the worker.
-  QEventLoop loop;
-  QVector<QImage> images;
-  bool loadOk = false;
-  auto *watcher = new QFutureWatcher<QVector<QImage>>(this);
-  QObject::connect(watcher, &QFutureWatcher<QVector<QImage>>::finished, &loop,
-                   &QEventLoop::quit);
-  watcher->setFuture(QtConcurrent::run([pdfPath, pageW, pageH]() {
-    QVector<QImage> out;
-    QPdfDocument doc;
-    if (doc.load(pdfPath) != QPdfDocument::Error::None)
-      return out;
-    const int count = doc.pageCount();
-    out.reserve(count);
-    for (int i = 0; i < count; ++i) {
-      // Screen-DPI A4 raster; keeps import responsive while remaining sharp.
-      QImage img = doc.render(i, QSize(pageW, pageH));
-      if (!img.isNull() && img.format() != QImage::Format_RGB32)
-        img = img.convertToFormat(QImage::Format_RGB32);
-      out.append(img);
-    }
-    return out;
-  }));
-  loop.exec();
-  images = watcher->result();
-  watcher->deleteLater();
-  loadOk = !images.isEmpty();
-  if (!loadOk) {
-    progress.close();
+  // Pages stream in behind the progress card and stay editable meanwhile;
+  // each one is a PNG until it is first shown.
+  auto *job = new PdfImportJob(pdfPath, QSize(a4wPx(), a4hPx()), this);
+  QPointer<PdfImportJob> guard(job);
+  auto progress = std::make_shared<BlopDialogs::ProgressSession>(
+      BlopDialogs::presentProgress(window(), QStringLiteral("PDF importieren"),
+                                   QStringLiteral("PDF wird geladen…"),
+                                   [guard]() {
+                                     if (guard)
+                                       guard->cancel();
+                                   }));
+  const Note *target = note_;
+  // Imported pages: one undo step once the import is done.
+  auto imported = std::make_shared<QVector<int>>();
+  connect(job, &PdfImportJob::pageReady, this,
+          [this, target, imported](int pdfPage, const NotePage &page) {
+            if (note_ != target)
+              return;
+            const int idx = note_->pages.size();
+            note_->pages.append(page);
+            imported->append(idx);
+            relayoutPageRange(idx, idx);
+            if (pdfPage == 0)
+              scrollToPage(idx);
+          });
+  connect(job, &PdfImportJob::progress, this,
+          [progress](int done, int total) {
+            progress->setRange(0, total);
+            progress->setValue(done);
+            progress->setMessage(QStringLiteral("Seite %1 von %2…")
+                                     .arg(qMin(done + 1, total))
+                                     .arg(total));
+          });
+  connect(job, &PdfImportJob::finished, this,
+          [this, job, progress, target, imported](bool) {
+            progress->close();
+            job->deleteLater();
+            if (note_ != target || job->pagesDone() == 0)
+              return;
+            // Without a record, undoing an older page step would restore
+            // its snapshot and drop the imported pages.
+            QVector<PageEdit> edits;
+            for (int idx : std::as_const(*imported)) {
+              if (idx >= note_->pages.size())
+                continue;
+              PageEdit edit;
+              edit.kind = PageEdit::Insert;
+              edit.index = idx;
+              edit.page = note_->pages[idx];
+              edits.append(edit);
+            }
+            recordPageEdits(std::move(edits), tr("Import PDF"));
+            if (onSaveRequested)
+              onSaveRequested(note_);
+            emit pagesChanged();
+          });
+  if (!job->start()) {
+    progress->close();
+    delete job;
     return false;
   }
-
-  progress.setRange(0, images.size());
-  for (int i = 0; i < images.size(); ++i) {
-    progress.setValue(i);
-    progress.setMessage(
-        QStringLiteral("Seite %1 von %2 einfügen…")
-            .arg(i + 1)
-            .arg(images.size()));
-    const int pageIdx = note_->pages.size();
-    note_->ensurePage(pageIdx);
-    note_->pages[pageIdx].title = QStringLiteral("PDF S.%1").arg(i + 1);
-    note_->pages[pageIdx].backgroundType =
-        static_cast<int>(PageBackgroundType::Blank);
-    note_->pages[pageIdx].paperColor = Qt::white;
-    if (!images[i].isNull())
-      note_->pages[pageIdx].backgroundImage = images[i];
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-  }
-  progress.setValue(images.size());
-  progress.close();
-
-  setNote(note_);
-  if (onSaveRequested)
-    onSaveRequested(note_);
+  m_pdfImport = job;
   return true;
 #else
   Q_UNUSED(pdfPath);
@@ -4148,6 +4654,11 @@ bool MultiPageNoteView::importPdfPages(const QString &pdfPath) {
 }
 
 void MultiPageNoteView::onSelectionChanged() {
+  // Strokes that left the selection go back into their ink layer.
+  demoteStrokes();
+  // Selected strokes may be dragged/transformed by Qt: live bounds in the
+  // index until they are deselected, then re-entered where they ended up.
+  strokeIndex_.setVolatile(scene_.selectedItems());
   // v3.18.0: während einer Crop-Session kein Selektionsmenü über dem
   // Resizer aufpoppen lassen (der CropResizer selbst ist selektierbar).
   if (m_cropResizer) {
@@ -4254,6 +4765,20 @@ void MultiPageNoteView::deleteSelection() {
             m_textEditOpen = false;
             m_textEditBefore.clear();
         }
+        // Promoted strokes leave the model too.
+        if (auto *pathItem = dynamic_cast<QGraphicsPathItem *>(item)) {
+            const auto promoted = m_promoted.constFind(pathItem);
+            if (promoted != m_promoted.cend()) {
+                const int page = promoted->page;
+                const int idx = modelStrokeIndex(page, item);
+                if (idx >= 0) {
+                    note_->pages[page].strokes.removeAt(idx);
+                    replacePageInk(page, idx, 1, {});
+                }
+                m_promoted.remove(pathItem);
+            }
+        }
+        strokeIndex_.remove(item);
         scene_.removeItem(item);
         delete item;
     }
@@ -4414,9 +4939,9 @@ void MultiPageNoteView::duplicateSelection() {
     if (s.isHighlighter)
       color.setAlpha(255);
     s.color = color;
-    s.path = scenePath.translated(-pageTopLeft);
-    for (int i = 0; i < s.path.elementCount(); ++i)
-      s.points.append(QPointF(s.path.elementAt(i).x, s.path.elementAt(i).y));
+    const QPainterPath local = scenePath.translated(-pageTopLeft);
+    for (int i = 0; i < local.elementCount(); ++i)
+      s.points.append(QPointF(local.elementAt(i).x, local.elementAt(i).y));
 
     pushStrokeUndoCommand(pIdx, std::move(s));
   }
@@ -4488,9 +5013,9 @@ void MultiPageNoteView::addSelectionToMarkupLibrary() {
       color.setAlpha(255);
     s.color = color;
     preview = color;
-    s.path = scenePath;
-    for (int i = 0; i < s.path.elementCount(); ++i)
-      s.points.append(QPointF(s.path.elementAt(i).x, s.path.elementAt(i).y));
+    for (int i = 0; i < scenePath.elementCount(); ++i)
+      s.points.append(
+          QPointF(scenePath.elementAt(i).x, scenePath.elementAt(i).y));
     strokes.append(s);
   }
   if (strokes.isEmpty())
@@ -4534,11 +5059,8 @@ void MultiPageNoteView::insertMarkupLibraryItem(const QString &itemId) {
     m_undoStack->beginMacro(tr("Markup einfügen"));
   for (Stroke s : found.strokes) {
     s.pageIndex = pIdx;
-    QPainterPath path = s.path.translated(insertAt - pageTopLeft);
-    s.path = path;
-    s.points.clear();
-    for (int i = 0; i < path.elementCount(); ++i)
-      s.points.append(QPointF(path.elementAt(i).x, path.elementAt(i).y));
+    const QPointF shift = insertAt - pageTopLeft;
+    s.points = s.points.mapped(QTransform::fromTranslate(shift.x(), shift.y()));
     pushStrokeUndoCommand(pIdx, std::move(s));
   }
   if (useMacro)
@@ -4620,6 +5142,7 @@ void MultiPageNoteView::applyTransform() {
     scene_.destroyItemGroup(m_transformGroup);
     m_transformGroup = nullptr;
   }
+  demoteStrokes();
   syncGraphItemsToNote();
   if (onSaveRequested) onSaveRequested(note_);
 }
@@ -4688,6 +5211,7 @@ void MultiPageNoteView::applyCrop() {
     m_cropMenu->hide();
   if (clipPath.isEmpty()) {
     m_cropTargets.clear();
+    demoteStrokes();
     return;
   }
   for (QGraphicsItem *item : std::as_const(m_cropTargets)) {
@@ -4695,12 +5219,15 @@ void MultiPageNoteView::applyCrop() {
       QPainterPath localClip = pathItem->mapFromScene(clipPath);
       localClip.setFillRule(Qt::WindingFill);
       pathItem->setPath(pathItem->path().intersected(localClip));
+      strokeIndex_.update(pathItem);
     }
   }
   m_cropTargets.clear();
   scene_.update();
   if (m_selectionMenu)
     m_selectionMenu->hide();
+  // Cropped strokes reach the model when they are deselected.
+  demoteStrokes();
   if (onSaveRequested)
     onSaveRequested(note_);
 }
@@ -4714,6 +5241,7 @@ void MultiPageNoteView::cancelCrop() {
   if (m_cropMenu)
     m_cropMenu->hide();
   m_cropTargets.clear();
+  demoteStrokes();
 }
 
 namespace {
@@ -5320,6 +5848,104 @@ void MultiPageNoteView::pushPageSnapshotCommand(const QVector<NotePage> &before,
       new PageSnapshotUndoCommand(this, before, note_->pages, text));
 }
 
+void MultiPageNoteView::pushPageEdits(QVector<PageEdit> edits,
+                                      const QString &text) {
+  if (!note_ || edits.isEmpty())
+    return;
+  auto *cmd = new PageEditUndoCommand(this, std::move(edits), text);
+  if (m_pageUndoStack) {
+    m_pageUndoStack->push(cmd); // redo() applies the edits
+  } else {
+    cmd->redo();
+    delete cmd;
+  }
+}
+
+void MultiPageNoteView::recordPageEdits(QVector<PageEdit> edits,
+                                        const QString &text) {
+  if (!note_ || edits.isEmpty() || !m_pageUndoStack)
+    return;
+  m_pageUndoStack->push(
+      new PageEditUndoCommand(this, std::move(edits), text, /*applied=*/true));
+}
+
+void MultiPageNoteView::applyPageEdits(const QVector<PageEdit> &edits,
+                                       bool forward) {
+  if (!note_)
+    return;
+  // Pending debounced edits belong to the current layout; commit them
+  // before items are torn down. Live gestures and sessions end here.
+  if (m_stickySyncTimer && m_stickySyncTimer->isActive())
+    flushStickyNoteSync();
+  finishEraseGesture();
+  cancelCrop();
+  if (m_transformOverlay)
+    applyTransform();
+  scene_.clearSelection();
+  // Stroke commands address pages by index.
+  if (m_undoStack)
+    m_undoStack->clear();
+
+  QVector<NotePage> &pages = note_->pages;
+  int first = std::numeric_limits<int>::max();
+  int last = -2; // -1: up to the end
+  bool content = false;
+  auto touch = [&](int lo, int hi) {
+    first = std::min(first, lo);
+    last = (hi < 0 || last == -1) ? -1 : std::max(last, hi);
+  };
+  auto apply = [&](const PageEdit &e) {
+    switch (e.kind) {
+    case PageEdit::Insert:
+      if (forward)
+        pages.insert(e.index, e.page);
+      else
+        pages.removeAt(e.index);
+      touch(e.index, -1);
+      content = true;
+      break;
+    case PageEdit::Remove:
+      if (forward)
+        pages.removeAt(e.index);
+      else
+        pages.insert(e.index, e.page);
+      touch(e.index, -1);
+      content = true;
+      break;
+    case PageEdit::Move:
+      if (forward)
+        pages.move(e.index, e.to);
+      else
+        pages.move(e.to, e.index);
+      touch(std::min(e.index, e.to), std::max(e.index, e.to));
+      content = true;
+      break;
+    case PageEdit::Replace:
+      pages[e.index] = forward ? e.after : e.page;
+      if (e.content) {
+        touch(e.index, e.index);
+        content = true;
+      } else {
+        applyPageAppearance(e.index);
+      }
+      break;
+    }
+  };
+  if (forward) {
+    for (const PageEdit &e : edits)
+      apply(e);
+  } else {
+    for (int k = edits.size() - 1; k >= 0; --k)
+      apply(edits[k]);
+  }
+  if (content)
+    relayoutPageRange(first, last);
+
+  if (onSaveRequested)
+    onSaveRequested(note_);
+  emit pagesChanged();
+}
+
 void MultiPageNoteView::syncStickyNotesToNote() {
   if (!note_)
     return;
@@ -5583,7 +6209,7 @@ void MultiPageNoteView::openGraphFormulaZone(GraphCanvasItem *gi) {
   connect(zone, &GraphFormulaZone::expressionRecognized, this,
           [this, gi](const QString &expr) {
     if (!gi) return;
-    const ParsedExpression parsed = MathExpressionParser::parseFunctionExpression(expr);
+    const ParsedExpression parsed = ExpressionCache::parsed(expr);
     if (!parsed.ok) return;
 
     auto fns = gi->data().functions;
@@ -5608,7 +6234,7 @@ void MultiPageNoteView::openGraphFormulaZone(GraphCanvasItem *gi) {
   connect(zone, &GraphFormulaZone::commitRequested, this,
           [this, gi](const QString &expr) {
     if (!gi) return;
-    const ParsedExpression parsed = MathExpressionParser::parseFunctionExpression(expr);
+    const ParsedExpression parsed = ExpressionCache::parsed(expr);
     if (!parsed.ok) return;
 
     const QVector<NotePage> before = note_ ? note_->pages : QVector<NotePage>{};
@@ -11,10 +11,15 @@
 #include <QShowEvent>
 #include <QGestureEvent>
 #include <QUndoStack>
+#include <QWindow>
 #include <functional>
 #include "Note.h"
 #include "ToolMode.h"
 #include "PageItem.h"
+#include "tools/StrokeSpatialIndex.h"
+#include "tools/TabletSampleRing.h"
+#include "pageinklayer.h"
+#include "pagetilecache.h"
 
 class QFrame;
 class QTimer;
@@ -31,21 +36,47 @@ class GraphQuickActionPopup;
 class GraphFormulaEntryBar;
 class GraphTangentXPopup;
 class StrokeAddUndoCommand;
+class StrokeEraseUndoCommand;
+class PageEditUndoCommand;
+class ImageExportJob;
+class PdfExportJob;
+class PdfImportJob;
 class AbstractTool;
 class GraphFormulaZone;
+class WetInkOverlay;
 
 class MultiPageNoteView : public QGraphicsView {
     Q_OBJECT
     friend class StrokeAddUndoCommand;
+    friend class StrokeEraseUndoCommand;
     friend class PageSnapshotUndoCommand;
+    friend class PageEditUndoCommand;
 public:
     explicit MultiPageNoteView(QWidget* parent=nullptr);
+    ~MultiPageNoteView() override;
 
     void setNote(Note* note);
 private:
     void setNote(Note* note, bool clearUndoStack);
     void pushPageSnapshotCommand(const QVector<NotePage> &before,
                                  const QString &text);
+    /// Page-level step of a PageEditUndoCommand. Pages are implicitly
+    /// shared, so an edit costs about the pages it names, not the note.
+    struct PageEdit {
+        enum Kind { Insert, Remove, Move, Replace };
+        Kind kind;
+        int index;
+        int to{-1};      ///< Move: target index
+        NotePage page;   ///< Insert/Remove: the page; Replace: before
+        NotePage after;  ///< Replace: after
+        bool content{true}; ///< Replace: strokes/objects changed, not just looks
+    };
+    /// Pushes `edits` as one undo step (applied by the push); only the
+    /// page slots they touch are rebuilt.
+    void pushPageEdits(QVector<PageEdit> edits, const QString &text);
+    /// Pushes `edits` that are already in the model as one undo step.
+    void recordPageEdits(QVector<PageEdit> edits, const QString &text);
+    void applyPageEdits(const QVector<PageEdit> &edits, bool forward);
 public:
     Note* note() const { return note_; }
     /// Stop any pending sticky-note debounce and sync immediately.
@@ -68,9 +99,17 @@ public:
 
     // Methoden für Export / Thumbnails
     bool exportPageToPng(int pageIndex, const QString &path);
-    bool exportNoteToPng(const QString &basePath);
-    bool exportPageToPdf(int pageIndex, const QString &path);
-    bool exportNoteToPdf(const QString &path);
+    /// Every page as an image (ImageExportJob), in the background like the
+    /// PDF export below.
+    bool exportNoteToPng(const QString &basePath,
+                         std::function<void(bool)> done = {});
+    // PDF export runs in the background (PdfExportJob); these return once
+    // it has started (false: nothing to export, export running) and call
+    // `done` with the outcome.
+    bool exportPageToPdf(int pageIndex, const QString &path,
+                         std::function<void(bool)> done = {});
+    bool exportNoteToPdf(const QString &path,
+                         std::function<void(bool)> done = {});
 
     // Methoden für PageManager
     QPixmap generateThumbnail(int pageIndex, const QSize& size);
@@ -78,7 +117,8 @@ public:
     /// v3.17.6: async sibling of generateThumbnail. Renders + scales the
     /// thumbnail on a QtConcurrent worker thread, posts the QPixmap back
     /// to the caller via `callback` on the UI thread. If the thumbnail is
-    /// already in QPixmapCache the callback is invoked synchronously.
+    /// already in QPixmapCache the callback is invoked synchronously; the
+    /// worker reuses a ThumbnailStore image of the same page revision.
     void generateThumbnailAsync(int pageIndex, const QSize& size,
                                 std::function<void(QPixmap)> callback);
     void movePage(int fromIndex, int toIndex);
@@ -119,7 +159,9 @@ public:
 
     std::function<void(Note*)> onSaveRequested;
 
-    // PDF Import: renders each PDF page as a note page background image
+    // PDF Import: renders each PDF page as a note page background image.
+    // Pages are appended as they are rendered; returns once the import has
+    // started (false: unreadable PDF, no PDF support, import running).
     bool importPdfPages(const QString &pdfPath);
 
     /// Dialog wie „Neue Seite von Vorlage“ für die aktuell sichtbare Seite (Farbe + Muster)
@@ -176,6 +218,33 @@ public:
 
 private:
     QGraphicsScene scene_;
+    /// Promoted strokes, shapes and the tools' live strokes; the lasso and
+    /// pen-up commit query it instead of the whole scene. Declared after
+    /// scene_ so it is gone before the scene deletes its items.
+    StrokeSpatialIndex strokeIndex_{&scene_};
+    PageTileCache tileCache_;
+    /// Committed ink, one layer per page slot; no item per stroke.
+    QVector<PageInkLayer*> inkLayers_;
+    /// The pen's stroke until pen-up (child widget, owned by the view).
+    WetInkOverlay* wetInk_{nullptr};
+    /// Pen moves for a tool that takes them in batches
+    /// (AbstractTool::acceptsTabletBatches()): tabletEvent() maps them to
+    /// the scene and queues them; they are handed over when
+    /// tabletFrameWindow_ is about to paint its next frame.
+    TabletSampleRing tabletRing_;
+    bool tabletBatching_{false};
+    QPointer<QWindow> tabletFrameWindow_;
+    qint64 lastTabletTimestamp_{0};
+    QVector<TabletSample> tabletBatch_;
+    struct PromotedStroke {
+        int page;
+        /// Model points (shared, not copied); their id() identifies the
+        /// stroke in the ink layer's exclude set.
+        StrokePoints points;
+    };
+    /// Strokes taken out of their ink layer as StrokeItems (parented to the
+    /// page) while they are selected; see promoteStrokesIn().
+    QHash<QGraphicsPathItem*, PromotedStroke> m_promoted;
     Note* note_{nullptr};
     ToolMode mode_{ToolMode::Pen};
     qreal zoom_{1.0};
@@ -243,12 +312,47 @@ private:
 
     QUndoStack *m_undoStack{nullptr};
     QUndoStack *m_pageUndoStack{nullptr};
+    QPointer<PdfImportJob> m_pdfImport;
+    QPointer<PdfExportJob> m_pdfExport;
+    QPointer<ImageExportJob> m_imageExport;
+    bool startPdfExport(QVector<NotePage> pages, const QString &path,
+                        std::function<void(bool)> done);
 
     void layoutPages();
+    void addPageSlot();
+    void applyPageAppearance(int i);
+    void placePagesBarStrip();
+    /// Rebuilds page slots [first, last] (last < 0: to the end) after the
+    /// pages there changed; other pages keep their items.
+    void relayoutPageRange(int first, int last);
+    void dehydratePage(int i);
     /// Scene rect must cover mapToScene(viewport) or letterbox margins show wrong color until scroll.
     void ensureSceneRectCoversViewport();
     QGraphicsPathItem *createStrokeGraphicsItem(const Stroke &s);
     void pushStrokeUndoCommand(int pageIdx, Stroke stroke);
+    /// Eraser (StrokeSpatialIndex handler): cuts the stroke points of the
+    /// model against the eraser circle, or drops whole strokes. Collected
+    /// into m_eraseCommand until pen-up.
+    void eraseStrokesAt(const QPointF& scenePos, qreal radius, bool wholeStrokes);
+    void finishEraseGesture();
+    StrokeEraseUndoCommand *m_eraseCommand{nullptr};
+    /// Index of the model stroke `item` shows on `page`, -1 if none.
+    int modelStrokeIndex(int page, const QGraphicsItem *item) const;
+    /// Ink layer of `page` if its strokes are in the model, else null.
+    PageInkLayer *loadedInkLayer(int page) const;
+    /// Hands all of the page's strokes to its ink layer (hydrate, layout).
+    void refreshPageInk(int page);
+    /// Strokes [at, at + count) of `page` were replaced by `with` in the
+    /// model; the ink layer re-indexes and re-renders only those.
+    void replacePageInk(int page, int at, int count,
+                        const QVector<Stroke> &with);
+    /// Lasso (StrokeSpatialIndex handler): strokes of the ink layers inside
+    /// `sceneArea` become selectable StrokeItems.
+    void promoteStrokesIn(const QPainterPath &sceneArea);
+    /// Promoted strokes that are no longer selected (`all`: every one) go
+    /// back into their layer; moves, crops and colour changes are written
+    /// to the model first.
+    void demoteStrokes(bool all = false);
     // void ensureOverscrollPage(); // Entfernt/Ersetzt durch Pull-Logik
     int pageAt(const QPointF& scenePos) const;
     QRectF pageRect(int idx) const;
@@ -279,6 +383,15 @@ private:
 #endif
     void pushUndoSnapshot(const QVector<NotePage>& beforeState);
 
+    /// Starts or stops the per-frame hand-over of tabletRing_ (pen down/up).
+    void setTabletBatching(bool on);
+    /// QEvent::UpdateRequest of tabletFrameWindow_: flushTabletSamples().
+    bool eventFilter(QObject* obj, QEvent* e) override;
+    /// Gives the queued pen moves to the active tool as one batch.
+    void flushTabletSamples();
+    /// Live eraser over the formula zone; its strokes are not scene items.
+    void eraseFormulaZoneAt(const QPointF& scenePos);
+
     /// After a stroke tool finishes (mouse or tablet), move StrokeItems from the scene into the note model.
     void commitPendingStrokeItemsToNote(AbstractTool* tool);
     void syncGraphItemsToNote();
@@ -369,7 +482,11 @@ private:
     QSet<int> m_hydratedPages;
     void hydratePageContent(int pageIdx);
     void hydrateVisibleRange();
-    QString thumbnailCacheKey(int pageIndex, const QSize& size) const;
+    QString thumbnailCacheKey(int pageIndex, quint64 revision, const QSize& size) const;
+    /// PageRender::revision() of page `pageIndex`, recomputed only when its
+    /// PageRender::stamp() changed.
+    quint64 thumbnailRevision(int pageIndex) const;
+    mutable QHash<int, QPair<quint64, quint64>> m_thumbnailRevisions; ///< page -> stamp, revision
 
     /// Currently active inline formula input zone (created by "+" tap).
     QPointer<GraphFormulaZone> m_activeFormulaZone;
@@ -1,4 +1,6 @@
 #include "notepreviewicon.h"
+#include "bnotefile.h"
+#include "thumbnailstore.h"
 
 #include <QCache>
 #include <QDataStream>
@@ -20,14 +22,25 @@ struct CacheKey {
   qint64 mtime{0};
   qint64 size{0};
   int px{0};
+  qint64 cover{0}; ///< QImage::cacheKey() of the cover, 0 = none yet
   bool operator==(const CacheKey &o) const {
-    return path == o.path && mtime == o.mtime && size == o.size && px == o.px;
+    return path == o.path && mtime == o.mtime && size == o.size && px == o.px &&
+           cover == o.cover;
   }
 };
 
 inline size_t qHash(const CacheKey &k, size_t seed = 0) noexcept {
   return ::qHash(k.path, seed) ^ size_t(k.mtime) ^ size_t(k.size) ^
-         size_t(uint(k.px) * 2654435761u);
+         size_t(uint(k.px) * 2654435761u) ^ size_t(k.cover);
+}
+
+/// Cover image fitted into `sheet` (already clipped by the caller).
+void paintCover(QPainter *p, const QRectF &sheet, const QImage &cover) {
+  const QSizeF fitted =
+      QSizeF(cover.size()).scaled(sheet.size(), Qt::KeepAspectRatioByExpanding);
+  const QRectF target(sheet.center().x() - fitted.width() / 2, sheet.top(),
+                      fitted.width(), fitted.height());
+  p->drawImage(target, cover);
 }
 
 QCache<CacheKey, QPixmap> &pixmapCache() {
@@ -119,8 +132,11 @@ void paintA4(QPainter *p, const QRect &full, const Spec &spec) {
   clip.addRoundedRect(sheet.adjusted(1, 1, -1, -1), s * 0.04, s * 0.04);
   p->save();
   p->setClipPath(clip);
-  paintPattern(p, sheet.adjusted(s * 0.02, s * 0.04, -s * 0.02, -s * 0.04),
-               spec.backgroundType, paper);
+  if (!spec.cover.isNull())
+    paintCover(p, sheet, spec.cover);
+  else
+    paintPattern(p, sheet.adjusted(s * 0.02, s * 0.04, -s * 0.02, -s * 0.04),
+                 spec.backgroundType, paper);
   p->restore();
 }
 
@@ -219,6 +235,15 @@ int fromBlopPageStyle(int style) {
 }
 
 bool peekBnote(const QString &path, Spec *out) {
+  int coverBg = 2;
+  QColor coverPaper;
+  if (BnoteFile::peekCover(path, &coverBg, &coverPaper)) {
+    out->kind = Kind::A4;
+    out->backgroundType = clampBg(coverBg);
+    if (coverPaper.isValid())
+      out->paper = coverPaper;
+    return true;
+  }
   QFile f(path);
   if (!f.open(QIODevice::ReadOnly))
     return false;
@@ -304,6 +329,7 @@ Spec specForPath(const QString &path, bool isDirectory) {
   if (path.endsWith(QLatin1String(".bnote"), Qt::CaseInsensitive)) {
     s.kind = Kind::A4;
     peekBnote(path, &s);
+    s.cover = ThumbnailStore::instance().cover(path);
     return s;
   }
   if (path.endsWith(QLatin1String(".blop"), Qt::CaseInsensitive)) {
@@ -347,6 +373,7 @@ QPixmap pixmapForPath(const QString &path, bool isDirectory, int px) {
     const QFileInfo fi(path);
     key.mtime = fi.lastModified().toMSecsSinceEpoch();
     key.size = fi.size();
+    key.cover = ThumbnailStore::instance().cover(path).cacheKey();
   }
   if (QPixmap *hit = pixmapCache().object(key))
     return *hit;
@@ -386,9 +413,13 @@ void paintHero(QPainter *p, const QRect &r, const Spec &spec) {
   clip.addRoundedRect(QRectF(sheet).adjusted(1, 1, -1, -1), rad - 1, rad - 1);
   p->save();
   p->setClipPath(clip);
-  const int inset = qMax(6, sheet.width() / 18);
-  paintPattern(p, QRectF(sheet).adjusted(inset, inset, -inset, -inset),
-               spec.backgroundType, paper);
+  if (!spec.cover.isNull()) {
+    paintCover(p, QRectF(sheet), spec.cover);
+  } else {
+    const int inset = qMax(6, sheet.width() / 18);
+    paintPattern(p, QRectF(sheet).adjusted(inset, inset, -inset, -inset),
+                 spec.backgroundType, paper);
+  }
   p->restore();
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QColor>
+#include <QImage>
 #include <QPixmap>
 #include <QRect>
 #include <QString>
@@ -17,6 +18,8 @@ struct Spec {
   /// PageBackgroundType: 0 Blank, 1 Lined, 2 Grid, 3 Dotted, 4 Legal
   int backgroundType{2};
   QColor paper{QColor(252, 250, 245)};
+  /// Rendered first page (ThumbnailStore); drawn instead of the pattern.
+  QImage cover;
 };
 
 Spec specForPath(const QString &path, bool isDirectory);
@@ -0,0 +1,304 @@
+#include "pageinklayer.h"
+#include "pagetilecache.h"
+#include <QLineF>
+#include <QPainterPathStroker>
+#include <QRect>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr qreal kCellSize = 64.0;
+/// Points per chunk; neighbouring chunks share one, so the joining segment
+/// is covered by both (same layout as StrokeSpatialIndex).
+constexpr int kChunkPoints = 16;
+
+qreal segmentDistance(const QPointF &p, const QPointF &a, const QPointF &b) {
+  const QPointF ab = b - a;
+  const qreal len2 = QPointF::dotProduct(ab, ab);
+  const qreal t =
+      len2 > 0.0 ? qBound(0.0, QPointF::dotProduct(p - a, ab) / len2, 1.0)
+                 : 0.0;
+  return QLineF(p, a + ab * t).length();
+}
+
+} // namespace
+
+PageInkLayer::PageInkLayer(PageTileCache *cache, int page, const QRectF &rect,
+                           QGraphicsItem *parent)
+    : QGraphicsItem(parent), m_cache(cache), m_page(page), m_rect(rect) {
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+  setAcceptedMouseButtons(Qt::NoButton);
+  // Below strokes, stickies and text boxes parented to the same page.
+  setZValue(-1.0);
+  m_cols = qMax(1, int(std::ceil(rect.width() / kCellSize)));
+  m_rows = qMax(1, int(std::ceil(rect.height() / kCellSize)));
+}
+
+void PageInkLayer::setStrokes(const QVector<Stroke> &strokes,
+                              const QSet<quintptr> &exclude) {
+  m_entries.clear();
+  m_slotEntry.clear();
+  m_freeSlots.clear();
+  m_marks.clear();
+  m_mark = 0;
+  m_cells = QVector<QVector<ChunkRef>>(m_cols * m_rows);
+  m_entries.reserve(strokes.size());
+  for (const Stroke &s : strokes) {
+    Entry e = makeEntry(s, !exclude.isEmpty() &&
+                               exclude.contains(quintptr(s.points.id())));
+    m_slotEntry[e.slot] = m_entries.size();
+    if (!e.excluded)
+      indexEntry(e);
+    m_entries.append(std::move(e));
+  }
+  m_cache->setPageInk(m_page, strokes, exclude);
+  update();
+}
+
+void PageInkLayer::replaceStrokes(int at, int count,
+                                  const QVector<Stroke> &with) {
+  if (at < 0 || count < 0 || at + count > m_entries.size())
+    return;
+  for (int i = at; i < at + count; ++i) {
+    const Entry &e = m_entries[i];
+    if (!e.excluded)
+      unindexEntry(e);
+    m_slotEntry[e.slot] = -1;
+    m_freeSlots.append(e.slot);
+  }
+  m_entries.remove(at, count);
+  for (int k = 0; k < with.size(); ++k) {
+    Entry e = makeEntry(with[k], false);
+    indexEntry(e);
+    m_entries.insert(at + k, std::move(e));
+  }
+  // The strokes after the edit moved; their slots (and grid cells) did not.
+  for (int i = at; i < m_entries.size(); ++i)
+    m_slotEntry[m_entries[i].slot] = i;
+
+  const QRectF dirty = m_cache->replaceStrokes(m_page, at, count, with);
+  if (!dirty.isNull())
+    update(dirty);
+}
+
+void PageInkLayer::setExcluded(int index, bool excluded) {
+  if (index < 0 || index >= m_entries.size() ||
+      m_entries[index].excluded == excluded)
+    return;
+  Entry &e = m_entries[index];
+  e.excluded = excluded;
+  if (excluded)
+    unindexEntry(e);
+  else
+    indexEntry(e);
+  const QRectF dirty = m_cache->setStrokeHidden(m_page, index, excluded);
+  if (!dirty.isNull())
+    update(dirty);
+}
+
+void PageInkLayer::clear() {
+  m_entries.clear();
+  m_slotEntry.clear();
+  m_freeSlots.clear();
+  m_cells.clear();
+  m_marks.clear();
+  m_cache->removePage(m_page);
+  update();
+}
+
+PageInkLayer::Entry PageInkLayer::makeEntry(const Stroke &s, bool excluded) {
+  Entry e;
+  e.stroke = s;
+  e.excluded = excluded;
+  e.halfWidth = qMax<qreal>(1.0, s.width) * 0.5;
+  if (m_freeSlots.isEmpty()) {
+    e.slot = m_slotEntry.size();
+    m_slotEntry.append(-1);
+    m_marks.append(0);
+  } else {
+    e.slot = m_freeSlots.takeLast();
+  }
+  const int n = s.points.size();
+  if (n == 0)
+    return e;
+  const qreal pad = e.halfWidth + 1.0;
+  // One pass over the encoded points; a chunk's box includes the first
+  // point of the next chunk so the joining segment is covered.
+  auto it = s.points.begin();
+  QPointF q = *it;
+  for (int start = 0;; start += kChunkPoints) {
+    const int end = qMin(n, start + kChunkPoints + 1);
+    qreal x0 = q.x(), x1 = x0, y0 = q.y(), y1 = y0;
+    for (int k = start + 1; k < end; ++k) {
+      q = *++it;
+      x0 = qMin(x0, q.x());
+      x1 = qMax(x1, q.x());
+      y0 = qMin(y0, q.y());
+      y1 = qMax(y1, q.y());
+    }
+    e.chunks.append(
+        QRectF(QPointF(x0, y0), QPointF(x1, y1)).adjusted(-pad, -pad, pad, pad));
+    if (end >= n)
+      break;
+  }
+  return e;
+}
+
+void PageInkLayer::indexEntry(const Entry &e) {
+  for (int k = 0; k < e.chunks.size(); ++k) {
+    const QRect span = cellSpan(e.chunks[k]);
+    for (int cy = span.top(); cy <= span.bottom(); ++cy) {
+      for (int cx = span.left(); cx <= span.right(); ++cx)
+        m_cells[cy * m_cols + cx].append(ChunkRef{e.slot, k});
+    }
+  }
+}
+
+void PageInkLayer::unindexEntry(const Entry &e) {
+  const auto ofEntry = [&e](const ChunkRef &ref) { return ref.slot == e.slot; };
+  for (const QRectF &box : e.chunks) {
+    const QRect span = cellSpan(box);
+    for (int cy = span.top(); cy <= span.bottom(); ++cy) {
+      for (int cx = span.left(); cx <= span.right(); ++cx)
+        m_cells[cy * m_cols + cx].removeIf(ofEntry);
+    }
+  }
+}
+
+QRect PageInkLayer::cellSpan(const QRectF &r) const {
+  // Ink past the page edge goes into the border cells.
+  auto cell = [](qreal v, int count) {
+    return qBound(0, int(std::floor(v / kCellSize)), count - 1);
+  };
+  return QRect(QPoint(cell(r.left(), m_cols), cell(r.top(), m_rows)),
+               QPoint(cell(r.right(), m_cols), cell(r.bottom(), m_rows)));
+}
+
+QVector<int> PageInkLayer::candidates(const QRectF &rect) const {
+  QVector<int> out;
+  if (m_entries.isEmpty() || !rect.isValid())
+    return out;
+  if (++m_mark == 0) {
+    m_marks.fill(0);
+    m_mark = 1;
+  }
+  const QRect span = cellSpan(rect);
+  for (int cy = span.top(); cy <= span.bottom(); ++cy) {
+    for (int cx = span.left(); cx <= span.right(); ++cx) {
+      for (const ChunkRef &ref : m_cells[cy * m_cols + cx]) {
+        if (m_marks[ref.slot] == m_mark)
+          continue;
+        const int index = m_slotEntry[ref.slot];
+        if (!m_entries[index].chunks[ref.chunk].intersects(rect))
+          continue;
+        m_marks[ref.slot] = m_mark;
+        out.append(index);
+      }
+    }
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+QVector<PageInkLayer::DiscHit>
+PageInkLayer::hitByDisc(const QPointF &center, qreal radius) const {
+  QVector<DiscHit> hits;
+  const QRectF box(center.x() - radius, center.y() - radius, 2 * radius,
+                   2 * radius);
+  for (int index : candidates(box)) {
+    const Entry &e = m_entries[index];
+    const int n = e.stroke.points.size();
+    int lo = -1;
+    int hi = -1;
+    for (int k = 0; k < e.chunks.size(); ++k) {
+      if (!e.chunks[k].intersects(box))
+        continue;
+      if (lo < 0)
+        lo = k;
+      hi = k;
+    }
+    if (lo < 0)
+      continue;
+    // Only the points of the chunks near the disc are decoded.
+    const int base = lo * kChunkPoints;
+    const QVector<QPointF> pts = e.stroke.points.points(
+        base, qMin(n, hi * kChunkPoints + kChunkPoints + 1));
+    const qreal reach = radius + e.halfWidth;
+    bool hit = n == 1 && QLineF(center, pts[0]).length() <= reach;
+    for (int k = lo; !hit && k <= hi; ++k) {
+      if (!e.chunks[k].intersects(box))
+        continue;
+      const int start = k * kChunkPoints - base;
+      const int end = qMin(int(pts.size()), start + kChunkPoints + 1);
+      for (int i = start + 1; !hit && i < end; ++i)
+        hit = segmentDistance(center, pts[i - 1], pts[i]) <= reach;
+    }
+    if (hit)
+      hits.append({index, base, hi * kChunkPoints + kChunkPoints});
+  }
+  return hits;
+}
+
+QVector<int> PageInkLayer::hitByArea(const QPainterPath &area) const {
+  QVector<int> hits;
+  QVector<bool> touched;
+  for (int index : candidates(area.boundingRect())) {
+    const Entry &e = m_entries[index];
+    const int n = e.stroke.points.size();
+    touched.fill(false, e.chunks.size());
+    int lo = -1;
+    int hi = -1;
+    for (int k = 0; k < e.chunks.size(); ++k) {
+      if (!area.intersects(e.chunks[k]))
+        continue;
+      touched[k] = true;
+      if (lo < 0)
+        lo = k;
+      hi = k;
+    }
+    if (lo < 0)
+      continue;
+    const int base = lo * kChunkPoints;
+    const QVector<QPointF> pts = e.stroke.points.points(
+        base, qMin(n, hi * kChunkPoints + kChunkPoints + 1));
+    bool hit = false;
+    for (int k = lo; !hit && k <= hi; ++k) {
+      if (!touched[k])
+        continue;
+      const int start = k * kChunkPoints - base;
+      const int end = qMin(int(pts.size()), start + kChunkPoints + 1);
+      for (int i = start; !hit && i < end; ++i)
+        hit = area.contains(pts[i]);
+    }
+    if (!hit) {
+      // Crosses the lasso without a point inside: exact test on the whole
+      // stroke, rare.
+      QPainterPath line;
+      bool first = true;
+      for (const QPointF &p : e.stroke.points) {
+        if (first)
+          line.moveTo(p);
+        else
+          line.lineTo(p);
+        first = false;
+      }
+      QPainterPathStroker stroker;
+      stroker.setWidth(2 * e.halfWidth);
+      stroker.setCapStyle(Qt::RoundCap);
+      stroker.setJoinStyle(Qt::RoundJoin);
+      hit = area.intersects(stroker.createStroke(line));
+    }
+    if (hit)
+      hits.append(index);
+  }
+  return hits;
+}
+
+void PageInkLayer::paint(QPainter *painter,
+                         const QStyleOptionGraphicsItem *option,
+                         QWidget *widget) {
+  Q_UNUSED(widget);
+  m_cache->paint(painter, m_page, option->exposedRect & m_rect);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "Note.h"
+#include <QGraphicsItem>
+#include <QPainterPath>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+
+class PageTileCache;
+
+/// Child of a PageItem that holds the committed ink of its page. There is
+/// no item per stroke: the layer paints through a PageTileCache (cached
+/// tiles, or the strokes that intersect the exposed rect) and answers the
+/// eraser and the lasso from a grid over chunks of the stroke points, the
+/// way StrokeSpatialIndex does for items.
+///
+/// Strokes that are being selected or transformed are promoted to
+/// StrokeItems by MultiPageNoteView and left out of the layer (`exclude`)
+/// until they are handed back.
+///
+/// Transparent to hit tests; stacked below the page's other children.
+class PageInkLayer : public QGraphicsItem {
+public:
+  enum { Type = UserType + 40 };
+  int type() const override { return Type; }
+
+  PageInkLayer(PageTileCache *cache, int page, const QRectF &rect,
+               QGraphicsItem *parent = nullptr);
+
+  /// Ink of the page: `strokes` minus those whose StrokePoints::id() is in
+  /// `exclude`. Indexes every stroke and drops all tiles of the page; for
+  /// hydrating and re-laid-out pages. Edits go through replaceStrokes().
+  void setStrokes(const QVector<Stroke> &strokes, const QSet<quintptr> &exclude);
+  /// Strokes [at, at + count) of the page became `with` (a stroke added,
+  /// removed, or cut by the eraser). Only those strokes are indexed again
+  /// and only the tiles under them are dropped.
+  void replaceStrokes(int at, int count, const QVector<Stroke> &with);
+  /// Stroke `index` is promoted to an item (`excluded`) or handed back.
+  void setExcluded(int index, bool excluded);
+  /// Forgets the ink and its tiles (page dehydrated).
+  void clear();
+  int strokeCount() const { return int(m_entries.size()); }
+
+  struct DiscHit {
+    int stroke; ///< index into the page's strokes
+    int first;  ///< segments near the disc (StrokeGeometry::eraseDisc())
+    int last;
+  };
+  /// Strokes whose ink comes within `radius` of `center` (page
+  /// coordinates), by ascending index.
+  QVector<DiscHit> hitByDisc(const QPointF &center, qreal radius) const;
+  /// Strokes whose ink intersects `area` (page coordinates), by ascending
+  /// index.
+  QVector<int> hitByArea(const QPainterPath &area) const;
+
+  QRectF boundingRect() const override { return m_rect; }
+  QPainterPath shape() const override { return QPainterPath(); }
+  bool contains(const QPointF &) const override { return false; }
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+             QWidget *widget) override;
+
+private:
+  /// One stroke of the page, in page order. Its chunks sit in the grid
+  /// under `slot`, which stays put while strokes before it come and go.
+  struct Entry {
+    Stroke stroke; ///< shares the point buffers of the model
+    QVector<QRectF> chunks; ///< chunk k covers points [k*K, k*K+K]; page
+                            ///< space, padded by half the pen width
+    qreal halfWidth{0.5};
+    int slot{-1};
+    bool excluded{false};
+  };
+  struct ChunkRef {
+    int slot;
+    int chunk;
+  };
+
+  QRect cellSpan(const QRectF &r) const;
+  Entry makeEntry(const Stroke &s, bool excluded);
+  /// Puts the chunks of `e` into the grid / takes them out again.
+  void indexEntry(const Entry &e);
+  void unindexEntry(const Entry &e);
+  /// Entries with a chunk touching `rect`, ascending.
+  QVector<int> candidates(const QRectF &rect) const;
+
+  PageTileCache *m_cache;
+  int m_page;
+  QRectF m_rect;
+  QVector<Entry> m_entries;
+  QVector<int> m_slotEntry; ///< slot -> index into m_entries, -1 if free
+  QVector<int> m_freeSlots;
+  int m_cols{0};
+  int m_rows{0};
+  QVector<QVector<ChunkRef>> m_cells; ///< row-major
+  mutable QVector<quint32> m_marks;   ///< per slot
+  mutable quint32 m_mark{0};
+};
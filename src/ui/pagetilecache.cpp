@@ -0,0 +1,394 @@
+#include "pagetilecache.h"
+#include "strokegeometry.h"
+#include <QFutureWatcher>
+#include <QPaintDevice>
+#include <QPainter>
+#include <QPainterPath>
+#include <QThreadPool>
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentRun>
+#include <cmath>
+
+namespace {
+
+// Zoom levels: tiles of level L are rendered at 2^L device px per page px.
+constexpr int kMinLevel = -3;
+constexpr int kMaxLevel = 2;
+// Above this scale the few strokes in view are cheaper than huge tiles.
+constexpr qreal kVectorScale = 5.0;
+// Queued but not started tiles; older requests are dropped (re-requested
+// by the next paint if still visible).
+constexpr int kMaxQueued = 256;
+#ifdef Q_OS_ANDROID
+constexpr int kBudgetKb = 48 * 1024;
+#else
+constexpr int kBudgetKb = 160 * 1024;
+#endif
+
+int keyPage(quint64 key) { return int(key >> 40); }
+int keyLevel(quint64 key) { return int((key >> 36) & 0xF) + kMinLevel; }
+int keyX(quint64 key) { return int((key >> 18) & 0x3FFFF); }
+int keyY(quint64 key) { return int(key & 0x3FFFF); }
+
+void drawStroke(QPainter *p, const Stroke &s, QPen &pen) {
+  // Same look as the StrokeItems strokes are promoted to.
+  QColor c = s.color;
+  QPainter::CompositionMode mode = QPainter::CompositionMode_SourceOver;
+  if (s.isHighlighter) {
+    c.setAlpha(80);
+    mode = QPainter::CompositionMode_Multiply;
+  } else if (s.isEraser) {
+    c = Qt::black;
+    mode = QPainter::CompositionMode_DestinationOut;
+  }
+  if (p->compositionMode() != mode)
+    p->setCompositionMode(mode);
+  if (StrokeGeometry::hasOutline(s)) {
+    // Pressure ink: one fill of the (cached) outline.
+    p->fillPath(StrokeGeometry::outline(s), c);
+    return;
+  }
+  const QVector<QPointF> pts = s.points.points();
+  if (pts.size() == 1) {
+    // A tap: the round cap a zero-length line would have (the eraser and
+    // the lasso hit it as such).
+    QPainterPath dot;
+    dot.addEllipse(pts[0], s.width * 0.5, s.width * 0.5);
+    p->fillPath(dot, c);
+    return;
+  }
+  pen.setColor(c);
+  pen.setWidthF(s.width);
+  p->setPen(pen);
+  p->drawPolyline(pts.constData(), int(pts.size()));
+}
+
+} // namespace
+
+PageTileCache::PageTileCache(QObject *parent) : QObject(parent) {
+  m_tiles.setMaxCost(kBudgetKb);
+}
+
+PageTileCache::~PageTileCache() = default;
+
+quint64 PageTileCache::tileKey(int page, int level, int tx, int ty) {
+  return (quint64(page) << 40) | (quint64(level - kMinLevel) << 36) |
+         (quint64(tx) << 18) | quint64(ty);
+}
+
+qreal PageTileCache::levelScale(int level) { return std::ldexp(1.0, level); }
+
+QRectF PageTileCache::tileRect(int level, int tx, int ty) {
+  const qreal side = kTileSize / levelScale(level);
+  return QRectF(tx * side, ty * side, side, side);
+}
+
+QRectF PageTileCache::inkBounds(const Stroke &s) {
+  const QRectF r = s.points.boundingRect();
+  const qreal pad = s.width * 0.5 + 1.0;
+  return r.adjusted(-pad, -pad, pad, pad);
+}
+
+void PageTileCache::setPageInk(int page, const QVector<Stroke> &strokes,
+                               const QSet<quintptr> &exclude) {
+  auto ink = std::make_shared<PageInk>();
+  ink->strokes.reserve(strokes.size());
+  for (const Stroke &s : strokes) {
+    const bool hidden =
+        !exclude.isEmpty() && exclude.contains(quintptr(s.points.id()));
+    ink->strokes.append(InkStroke{s, inkBounds(s), hidden});
+  }
+  m_ink.insert(page, std::move(ink));
+  // Jobs started before this point render old ink; their tiles are dropped.
+  m_generation.insert(page, ++m_generationCounter);
+
+  const QList<quint64> keys = m_tiles.keys();
+  for (quint64 key : keys) {
+    if (keyPage(key) == page)
+      m_tiles.remove(key);
+  }
+}
+
+QRectF PageTileCache::replaceStrokes(int page, int at, int count,
+                                     const QVector<Stroke> &with) {
+  if (!m_ink.contains(page))
+    return QRectF();
+  PageInk &ink = editInk(page);
+  if (at < 0 || count < 0 || at + count > ink.strokes.size())
+    return QRectF();
+  QRectF dirty;
+  for (int i = at; i < at + count; ++i) {
+    if (!ink.strokes[i].hidden)
+      dirty |= ink.strokes[i].bounds;
+  }
+  ink.strokes.remove(at, count);
+  for (int k = 0; k < with.size(); ++k) {
+    const QRectF bounds = inkBounds(with[k]);
+    dirty |= bounds;
+    ink.strokes.insert(at + k, InkStroke{with[k], bounds, false});
+  }
+  dropTiles(page, dirty);
+  return dirty;
+}
+
+QRectF PageTileCache::setStrokeHidden(int page, int index, bool hidden) {
+  const auto it = m_ink.constFind(page);
+  if (it == m_ink.cend() || index < 0 || index >= (*it)->strokes.size() ||
+      (*it)->strokes[index].hidden == hidden)
+    return QRectF();
+  InkStroke &s = editInk(page).strokes[index];
+  s.hidden = hidden;
+  dropTiles(page, s.bounds);
+  return s.bounds;
+}
+
+PageTileCache::PageInk &PageTileCache::editInk(int page) {
+  std::shared_ptr<PageInk> &ink = m_ink[page];
+  // Render jobs hold the ink they started with; only then is it copied (the
+  // strokes share their point buffers).
+  if (!ink)
+    ink = std::make_shared<PageInk>();
+  else if (ink.use_count() > 1)
+    ink = std::make_shared<PageInk>(*ink);
+  return *ink;
+}
+
+void PageTileCache::dropTiles(int page, const QRectF &dirty) {
+  if (dirty.isNull())
+    return;
+  const QList<quint64> keys = m_tiles.keys();
+  for (quint64 key : keys) {
+    if (keyPage(key) == page &&
+        tileRect(keyLevel(key), keyX(key), keyY(key)).intersects(dirty))
+      m_tiles.remove(key);
+  }
+  for (quint64 key : std::as_const(m_rendering)) {
+    if (keyPage(key) == page &&
+        tileRect(keyLevel(key), keyX(key), keyY(key)).intersects(dirty))
+      m_stale.insert(key);
+  }
+}
+
+void PageTileCache::removePage(int page) {
+  m_ink.remove(page);
+  m_generation.remove(page);
+  const QList<quint64> keys = m_tiles.keys();
+  for (quint64 key : keys) {
+    if (keyPage(key) == page)
+      m_tiles.remove(key);
+  }
+}
+
+void PageTileCache::clear() {
+  m_ink.clear();
+  m_generation.clear();
+  m_tiles.clear();
+  m_inFlight.clear();
+  m_stale.clear();
+  m_queue.clear();
+}
+
+void PageTileCache::drawInk(QPainter *p, const PageInk &ink,
+                            const QRectF &clip) {
+  // Highlighters first: as items they sit at z 0.5, below the ink at 1.0.
+  drawLayer(p, ink, clip, true, false);
+  drawLayer(p, ink, clip, false, true);
+}
+
+void PageTileCache::drawLayer(QPainter *p, const PageInk &ink,
+                              const QRectF &clip, bool highlighters,
+                              bool erasers) {
+  p->setRenderHint(QPainter::Antialiasing, true);
+  p->setBrush(Qt::NoBrush);
+  QPen pen(Qt::black, 1.0, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+  for (const InkStroke &item : ink.strokes) {
+    const Stroke &s = item.stroke;
+    const bool wanted =
+        s.isEraser ? erasers : s.isHighlighter == highlighters;
+    if (item.hidden || !wanted || !item.bounds.intersects(clip))
+      continue;
+    drawStroke(p, s, pen);
+  }
+  p->setCompositionMode(QPainter::CompositionMode_SourceOver);
+}
+
+PageTileCache::Tile PageTileCache::renderTile(const PageInk &ink,
+                                              const QRectF &rect,
+                                              qreal scale) {
+  bool anyHighlight = false;
+  bool anyInk = false;
+  for (const InkStroke &item : ink.strokes) {
+    if (item.hidden || !item.bounds.intersects(rect))
+      continue;
+    const Stroke &s = item.stroke;
+    if (s.isHighlighter)
+      anyHighlight = true;
+    else if (!s.isEraser)
+      anyInk = true;
+  }
+  // Erasers alone leave nothing to draw; both layers null = "nothing here".
+  const auto render = [&](bool highlighters) {
+    QImage img(kTileSize, kTileSize, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+    QPainter p(&img);
+    p.scale(scale, scale);
+    p.translate(-rect.topLeft());
+    drawLayer(&p, ink, rect, highlighters, true);
+    return img;
+  };
+  Tile tile;
+  if (anyHighlight)
+    tile.highlight = render(true);
+  if (anyInk)
+    tile.ink = render(false);
+  return tile;
+}
+
+void PageTileCache::drawTile(QPainter *p, const Tile &tile,
+                             const QRectF &target, const QRectF &source) {
+  if (!tile.highlight.isNull()) {
+    p->setCompositionMode(QPainter::CompositionMode_Multiply);
+    p->drawImage(target, tile.highlight, source);
+    p->setCompositionMode(QPainter::CompositionMode_SourceOver);
+  }
+  if (!tile.ink.isNull())
+    p->drawImage(target, tile.ink, source);
+}
+
+bool PageTileCache::blitFromLevel(QPainter *painter, int page, int level,
+                                  const QRectF &target) {
+  if (level < kMinLevel || level > kMaxLevel)
+    return false;
+  const qreal ls = levelScale(level);
+  const qreal side = kTileSize / ls;
+  const int x0 = int(std::floor(target.left() / side));
+  const int y0 = int(std::floor(target.top() / side));
+  const int x1 = qMax(x0, int(std::ceil(target.right() / side)) - 1);
+  const int y1 = qMax(y0, int(std::ceil(target.bottom() / side)) - 1);
+  QVarLengthArray<const Tile *, 4> tiles;
+  for (int ty = y0; ty <= y1; ++ty) {
+    for (int tx = x0; tx <= x1; ++tx) {
+      const Tile *tile = m_tiles.object(tileKey(page, level, tx, ty));
+      if (!tile)
+        return false;
+      tiles.append(tile);
+    }
+  }
+  int k = 0;
+  for (int ty = y0; ty <= y1; ++ty) {
+    for (int tx = x0; tx <= x1; ++tx) {
+      const Tile *tile = tiles[k++];
+      const QRectF r = tileRect(level, tx, ty);
+      const QRectF part = r & target;
+      drawTile(painter, *tile, part,
+               QRectF((part.topLeft() - r.topLeft()) * ls, part.size() * ls));
+    }
+  }
+  return true;
+}
+
+void PageTileCache::paint(QPainter *painter, int page, const QRectF &exposed) {
+  const auto it = m_ink.constFind(page);
+  if (it == m_ink.cend() || exposed.isEmpty())
+    return;
+  const std::shared_ptr<const PageInk> ink = *it;
+  if (ink->strokes.isEmpty())
+    return;
+
+  const qreal scale = std::sqrt(qAbs(painter->worldTransform().determinant())) *
+                      painter->device()->devicePixelRatioF();
+  // Printing/recording wants vectors, not screen tiles.
+  const int devType = painter->device()->devType();
+  const bool vectorDevice =
+      devType == QInternal::Printer || devType == QInternal::Picture;
+  painter->save();
+  if (vectorDevice || scale > kVectorScale || scale <= 0.0) {
+    drawInk(painter, *ink, exposed);
+    painter->restore();
+    return;
+  }
+  // Slightly undersampled tiles beat a level twice the size.
+  const int level = qBound(kMinLevel, int(std::ceil(std::log2(scale) - 0.1)),
+                           kMaxLevel);
+  const qreal side = kTileSize / levelScale(level);
+  const int x0 = qMax(0, int(std::floor(exposed.left() / side)));
+  const int y0 = qMax(0, int(std::floor(exposed.top() / side)));
+  const int x1 = int(std::ceil(exposed.right() / side)) - 1;
+  const int y1 = int(std::ceil(exposed.bottom() / side)) - 1;
+
+#ifndef Q_OS_ANDROID
+  painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+#endif
+  QPainterPath missing;
+  for (int ty = y0; ty <= y1; ++ty) {
+    for (int tx = x0; tx <= x1; ++tx) {
+      const QRectF r = tileRect(level, tx, ty);
+      if (const Tile *tile = m_tiles.object(tileKey(page, level, tx, ty))) {
+        drawTile(painter, *tile, r, QRectF(0, 0, kTileSize, kTileSize));
+        continue;
+      }
+      request(page, level, tx, ty);
+      // Pinch-zoom: a neighbouring level stands in until this one is done.
+      const QRectF part = r & exposed;
+      if (blitFromLevel(painter, page, level - 1, part) ||
+          blitFromLevel(painter, page, level + 1, part) ||
+          blitFromLevel(painter, page, level - 2, part))
+        continue;
+      missing.addRect(part);
+    }
+  }
+  if (!missing.isEmpty()) {
+    painter->setClipPath(missing, Qt::IntersectClip);
+    drawInk(painter, *ink, missing.boundingRect());
+  }
+  painter->restore();
+  startJobs();
+}
+
+void PageTileCache::request(int page, int level, int tx, int ty) {
+  const quint64 key = tileKey(page, level, tx, ty);
+  if (m_inFlight.contains(key))
+    return;
+  m_inFlight.insert(key);
+  m_queue.append({key, page, level, tileRect(level, tx, ty)});
+  if (m_queue.size() > kMaxQueued)
+    m_inFlight.remove(m_queue.takeFirst().key);
+}
+
+void PageTileCache::startJobs() {
+  // Leave a thread for everything else that runs on the global pool.
+  const int maxJobs =
+      qMax(1, QThreadPool::globalInstance()->maxThreadCount() - 1);
+  while (m_rendering.size() < maxJobs && !m_queue.isEmpty()) {
+    const Job job = m_queue.takeLast();
+    std::shared_ptr<const PageInk> ink = m_ink.value(job.page);
+    if (!ink) {
+      m_inFlight.remove(job.key);
+      continue;
+    }
+    const quint32 generation = m_generation.value(job.page);
+    m_rendering.append(job.key);
+    auto *watcher = new QFutureWatcher<Tile>(this);
+    connect(watcher, &QFutureWatcher<Tile>::finished, this,
+            [this, watcher, job, generation]() {
+              watcher->deleteLater();
+              m_rendering.removeOne(job.key);
+              const bool stale = m_stale.remove(job.key);
+              if (m_inFlight.remove(job.key) && !stale &&
+                  m_generation.value(job.page) == generation) {
+                const Tile tile = watcher->result();
+                const qsizetype bytes =
+                    tile.highlight.sizeInBytes() + tile.ink.sizeInBytes();
+                m_tiles.insert(job.key, new Tile(tile),
+                               qMax(1, int(bytes / 1024)));
+              }
+              emit tilesReady(job.page, job.rect);
+              startJobs();
+            });
+    const qreal scale = levelScale(job.level);
+    watcher->setFuture(QtConcurrent::run(
+        [ink = std::move(ink), rect = job.rect, scale]() {
+          return renderTile(*ink, rect, scale);
+        }));
+  }
+}
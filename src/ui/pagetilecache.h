@@ -0,0 +1,117 @@
+#pragma once
+#include "Note.h"
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QRectF>
+#include <QSet>
+#include <QVector>
+#include <memory>
+
+class QPainter;
+
+/// Rasterised ink of the pages of a MultiPageNoteView: 256x256 tiles per
+/// power-of-two zoom level, rendered on the thread pool from NotePage stroke
+/// data. Pan and zoom blit cached tiles (other levels stand in while a
+/// level is rendered); only tiles under a changed stroke are dropped.
+/// Tiles not cached yet are painted as vectors for that frame.
+///
+/// Highlighters get a layer of their own in each tile, multiplied onto the
+/// page when the tile is painted: the same result as the vector path and
+/// the promoted items, which multiply against the real background.
+///
+/// Each PageInkLayer hands in the ink of its page (setPageInk()) and then
+/// each edit (replaceStrokes(), setStrokeHidden()); strokes promoted to
+/// items for a selection stay out of the tiles and paint themselves. GUI
+/// thread only, apart from the render jobs.
+class PageTileCache : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int kTileSize = 256;
+
+  explicit PageTileCache(QObject *parent = nullptr);
+  ~PageTileCache() override;
+
+  /// Ink of `page`: `strokes` minus those whose StrokePoints::id() is in
+  /// `exclude`. Drops every cached tile of the page.
+  void setPageInk(int page, const QVector<Stroke> &strokes,
+                  const QSet<quintptr> &exclude);
+  /// Strokes [at, at + count) of `page` became `with`. Drops the tiles
+  /// under the old and new strokes and returns that area (page
+  /// coordinates; null if nothing changed).
+  QRectF replaceStrokes(int page, int at, int count,
+                        const QVector<Stroke> &with);
+  /// Leaves stroke `index` of `page` out (promoted) or draws it again;
+  /// returns the area to repaint, as replaceStrokes().
+  QRectF setStrokeHidden(int page, int index, bool hidden);
+  bool hasPage(int page) const { return m_ink.contains(page); }
+  /// Forget the ink and tiles of `page` (its slot now shows another page).
+  void removePage(int page);
+  /// Forget all pages and tiles (note switched, pages re-laid out).
+  void clear();
+
+  /// Paints the ink of `page` inside `exposed` (page coordinates) at the
+  /// painter's current scale and queues the tiles that are missing.
+  void paint(QPainter *painter, int page, const QRectF &exposed);
+
+  /// Page-space box of the ink of `s` (pen width included).
+  static QRectF inkBounds(const Stroke &s);
+
+signals:
+  /// New tiles of `page` are in; `rect` (page coordinates) needs a repaint.
+  void tilesReady(int page, const QRectF &rect);
+
+private:
+  struct InkStroke {
+    Stroke stroke;
+    QRectF bounds;
+    bool hidden{false};
+  };
+  /// Every stroke of the page, in page order (indices as in the model).
+  struct PageInk {
+    QVector<InkStroke> strokes;
+  };
+  /// One tile; a null layer has no ink.
+  struct Tile {
+    QImage highlight;
+    QImage ink;
+  };
+  struct Job {
+    quint64 key;
+    int page;
+    int level;
+    QRectF rect;
+  };
+
+  static quint64 tileKey(int page, int level, int tx, int ty);
+  static qreal levelScale(int level);
+  static QRectF tileRect(int level, int tx, int ty);
+  static void drawInk(QPainter *p, const PageInk &ink, const QRectF &clip);
+  static void drawLayer(QPainter *p, const PageInk &ink, const QRectF &clip,
+                        bool highlighters, bool erasers);
+  static Tile renderTile(const PageInk &ink, const QRectF &rect, qreal scale);
+  static void drawTile(QPainter *p, const Tile &tile, const QRectF &target,
+                       const QRectF &source);
+
+  /// The ink of `page` to edit in place; copied first while a render job
+  /// still reads it.
+  PageInk &editInk(int page);
+  /// Drops the tiles of `page` touching `dirty`; tiles being rendered there
+  /// are dropped when they come in.
+  void dropTiles(int page, const QRectF &dirty);
+  bool blitFromLevel(QPainter *painter, int page, int level,
+                     const QRectF &target);
+  void request(int page, int level, int tx, int ty);
+  void startJobs();
+
+  QHash<int, std::shared_ptr<PageInk>> m_ink;
+  QHash<int, quint32> m_generation;
+  quint32 m_generationCounter{0};
+  QCache<quint64, Tile> m_tiles;
+  QSet<quint64> m_inFlight;
+  QList<Job> m_queue; ///< newest last; started LIFO, so visible tiles first
+  QList<quint64> m_rendering; ///< keys of the running jobs
+  QSet<quint64> m_stale;      ///< running jobs whose ink changed
+};
@@ -0,0 +1,186 @@
+#include "pdfexportjob.h"
+
+#include "pagerender.h"
+#include "pdfstore.h"
+#include "tools/GraphCanvasItem.h"
+#include "util/Async.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QImage>
+#include <QMarginsF>
+#include <QMetaObject>
+#include <QPageSize>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPointer>
+
+#ifdef BLOP_HAS_PDF
+#include <QPdfDocument>
+#endif
+
+namespace {
+
+/// Source documents of imported pages; consecutive pages usually share one,
+/// so it stays open until a page names another.
+class SourcePages {
+public:
+  QImage render(const PdfPageRef &ref, const QSize &size) {
+#ifdef BLOP_HAS_PDF
+    if (!ref.isValid())
+      return QImage();
+    if (ref.doc != m_hash) {
+      m_hash = ref.doc;
+      m_doc.reset();
+      const QString file = PdfStore::instance().path(ref.doc);
+      if (!file.isEmpty()) {
+        m_doc = std::make_unique<QPdfDocument>();
+        if (m_doc->load(file) != QPdfDocument::Error::None)
+          m_doc.reset();
+      }
+    }
+    if (!m_doc || ref.page >= m_doc->pageCount())
+      return QImage();
+    QImage img = m_doc->render(ref.page, size);
+    // Opaque, so the PDF engine may store it JPEG-compressed.
+    if (!img.isNull() && img.format() != QImage::Format_RGB32)
+      img = img.convertToFormat(QImage::Format_RGB32);
+    return img;
+#else
+    Q_UNUSED(ref);
+    Q_UNUSED(size);
+    return QImage();
+#endif
+  }
+
+private:
+  QByteArray m_hash;
+#ifdef BLOP_HAS_PDF
+  std::unique_ptr<QPdfDocument> m_doc;
+#endif
+};
+
+/// Graphs as the editor plots them, minus selection and the "+" button.
+void paintGraphs(QPainter &p, const QVector<GraphObject> &graphs) {
+  for (GraphObject g : graphs) {
+    g.selectedFunction = -1;
+    p.save();
+    p.translate(g.rect.topLeft());
+    paintGraphBody(&p,
+                   QRectF(0, 0, qMax(80.0, g.rect.width()),
+                          qMax(60.0, g.rect.height())),
+                   g);
+    p.restore();
+  }
+}
+
+} // namespace
+
+PdfExportJob::PdfExportJob(QVector<NotePage> pages, const QSize &pageSize,
+                           const QString &path, QObject *parent)
+    : QObject(parent), m_pages(std::move(pages)), m_pageSize(pageSize),
+      m_path(path), m_pageCount(int(m_pages.size())),
+      m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+PdfExportJob::~PdfExportJob() { *m_cancelled = true; }
+
+void PdfExportJob::start() {
+  if (m_started)
+    return;
+  m_started = true;
+  emit progress(0, m_pageCount);
+  QPointer<PdfExportJob> self(this);
+  const std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+  fireAndForget([self, cancelled, pages = std::move(m_pages),
+                 size = m_pageSize, path = m_path,
+                 total = m_pageCount]() mutable {
+    const bool ok = write(std::move(pages), size, path,
+                          [self, cancelled, total](int done) {
+                            QMetaObject::invokeMethod(
+                                self.data(), [self, done, total]() {
+                                  if (self && !self->m_finished)
+                                    emit self->progress(done, total);
+                                },
+                                Qt::QueuedConnection);
+                            return !*cancelled;
+                          });
+    QMetaObject::invokeMethod(
+        self.data(), [self, ok]() {
+          if (self)
+            self->finish(ok);
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void PdfExportJob::cancel() { *m_cancelled = true; }
+
+void PdfExportJob::finish(bool ok) {
+  if (m_finished)
+    return;
+  m_finished = true;
+  emit finished(ok && !*m_cancelled);
+}
+
+bool PdfExportJob::write(QVector<NotePage> pages, const QSize &pageSize,
+                         const QString &path,
+                         const std::function<bool(int)> &onPage) {
+  if (pages.isEmpty() || pageSize.isEmpty() || path.isEmpty())
+    return false;
+
+  const QString partial = path + QStringLiteral(".part");
+  bool ok = true;
+  {
+    const QPageSize a4(QPageSize::A4);
+    const QSizeF inches = a4.size(QPageSize::Inch);
+    QPdfWriter pdf(partial);
+    pdf.setCreator(QStringLiteral("Blop Notes"));
+    pdf.setPageSize(a4);
+    pdf.setPageMargins(QMarginsF());
+    // About one device pixel per page unit, so point sizes come out as in
+    // the editor.
+    pdf.setResolution(qMax(1, qRound(pageSize.width() / inches.width())));
+    QPainter p(&pdf);
+    if (!p.isActive()) {
+      qWarning() << "PdfExportJob: cannot write" << path;
+      ok = false;
+    }
+    const QRectF full = pdf.pageLayout().fullRectPixels(pdf.resolution());
+    const QSize bgSize(qRound(inches.width() * kBackgroundDpi),
+                       qRound(inches.height() * kBackgroundDpi));
+    SourcePages sources;
+    for (int i = 0; ok && i < pages.size(); ++i) {
+      if (i > 0 && !pdf.newPage()) {
+        ok = false;
+        break;
+      }
+      // Taken out of the list so only this page is ever loaded.
+      NotePage page = std::move(pages[i]);
+      pages[i] = NotePage();
+      page.ensureLoaded();
+      const QImage bg = sources.render(page.pdf, bgSize);
+      if (!bg.isNull())
+        page.backgroundImage = bg;
+      p.save();
+      p.scale(full.width() / pageSize.width(),
+              full.height() / pageSize.height());
+      PageRender::paintVector(p, page, pageSize.width(), pageSize.height(),
+                              false);
+      paintGraphs(p, page.graphs);
+      p.restore();
+      if (onPage && !onPage(i + 1))
+        ok = false;
+    }
+    if (p.isActive())
+      p.end();
+  }
+  if (ok && QFile::exists(path) && !QFile::remove(path)) {
+    qWarning() << "PdfExportJob: cannot replace" << path;
+    ok = false;
+  }
+  if (ok && !QFile::rename(partial, path))
+    ok = false;
+  if (!ok)
+    QFile::remove(partial);
+  return ok;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Note.h"
+
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/// Writes note pages to a PDF on a worker thread.
+///
+/// Pages are painted with PageRender::paintVector() straight onto the
+/// QPdfWriter, so paper, ruling, strokes and text become PDF drawing
+/// commands instead of one raster per page; graphs are plotted by
+/// paintGraphBody(). QPdfWriter cannot take over pages of another PDF, so an
+/// imported page (NotePage::pdf) gets its source page from PdfStore,
+/// rendered once at kBackgroundDpi rather than its half-size preview. Other
+/// background images are embedded as stored.
+///
+/// The job owns copies of the pages; each is loaded on the worker and
+/// dropped once written. The file is written under a temporary name and
+/// renamed when complete, so a cancelled or failed export leaves nothing.
+///
+/// GUI thread; only write() runs elsewhere.
+class PdfExportJob : public QObject {
+  Q_OBJECT
+public:
+  PdfExportJob(QVector<NotePage> pages, const QSize &pageSize,
+               const QString &path, QObject *parent = nullptr);
+  ~PdfExportJob() override;
+
+  static constexpr int kBackgroundDpi = 200;
+
+  void start();
+  /// finished(false) follows once the worker has stopped.
+  void cancel();
+
+  int pageCount() const { return m_pageCount; }
+
+  /// The whole export on the calling thread. `onPage(done)` runs after each
+  /// page; returning false stops the export. False if nothing was written.
+  static bool write(QVector<NotePage> pages, const QSize &pageSize,
+                    const QString &path,
+                    const std::function<bool(int)> &onPage = {});
+
+signals:
+  void progress(int done, int total);
+  /// `ok` is false when cancelled or the file could not be written.
+  void finished(bool ok);
+
+private:
+  void finish(bool ok);
+
+  QVector<NotePage> m_pages; ///< handed to the worker by start()
+  QSize m_pageSize;
+  QString m_path;
+  int m_pageCount{0};
+  std::shared_ptr<std::atomic<bool>> m_cancelled;
+  bool m_started{false};
+  bool m_finished{false};
+};
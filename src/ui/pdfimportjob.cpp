@@ -0,0 +1,178 @@
+#include "pdfimportjob.h"
+
+#include "bnotecodec.h"
+#include "bnotefile.h"
+#include "PageItem.h"
+#include "pdfstore.h"
+#include "util/Async.h"
+
+#include <QDebug>
+#include <QImage>
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+#include <vector>
+
+#ifdef BLOP_HAS_PDF
+#include <QPdfDocument>
+#endif
+
+/// Owned jointly by the job and its workers, so workers finishing after the
+/// job is gone still have somewhere to put their document back.
+struct PdfImportJob::Shared {
+  QString path;
+  std::atomic<bool> cancelled{false};
+#ifdef BLOP_HAS_PDF
+  QMutex mutex;
+  std::vector<std::unique_ptr<QPdfDocument>> idle;
+
+  /// One document per concurrent worker, loaded on demand and reused.
+  std::unique_ptr<QPdfDocument> takeDocument() {
+    {
+      QMutexLocker lock(&mutex);
+      if (!idle.empty()) {
+        auto doc = std::move(idle.back());
+        idle.pop_back();
+        return doc;
+      }
+    }
+    auto doc = std::make_unique<QPdfDocument>();
+    if (doc->load(path) != QPdfDocument::Error::None)
+      return nullptr;
+    return doc;
+  }
+
+  void returnDocument(std::unique_ptr<QPdfDocument> doc) {
+    QMutexLocker lock(&mutex);
+    idle.push_back(std::move(doc));
+  }
+#endif
+};
+
+PdfImportJob::PdfImportJob(const QString &pdfPath, const QSize &pageSize,
+                           QObject *parent)
+    : QObject(parent), m_path(pdfPath), m_pageSize(pageSize),
+      m_shared(std::make_shared<Shared>()) {
+  m_shared->path = pdfPath;
+  m_window = qBound(2, QThread::idealThreadCount(), 6);
+}
+
+PdfImportJob::~PdfImportJob() { m_shared->cancelled = true; }
+
+bool PdfImportJob::start() {
+#ifdef BLOP_HAS_PDF
+  // Only the page count is needed here; PDFium reads the rest lazily.
+  QPdfDocument probe;
+  if (probe.load(m_path) != QPdfDocument::Error::None) {
+    qWarning() << "PdfImportJob: cannot open" << m_path;
+    return false;
+  }
+  m_pageCount = probe.pageCount();
+  if (m_pageCount <= 0)
+    return false;
+  emit progress(0, m_pageCount);
+  // Hashing and copying read the whole file; rendering waits for the
+  // outcome, which decides the preview size.
+  const QString path = m_path;
+  QPointer<PdfImportJob> self(this);
+  fireAndForget([self, path]() {
+    const QByteArray doc = PdfStore::instance().add(path);
+    QMetaObject::invokeMethod(
+        self.data(), [self, doc]() {
+          if (self)
+            self->stored(doc);
+        },
+        Qt::QueuedConnection);
+  });
+  return true;
+#else
+  return false;
+#endif
+}
+
+void PdfImportJob::cancel() {
+  if (m_finished || m_shared->cancelled)
+    return;
+  m_shared->cancelled = true;
+  m_done.clear();
+  QPointer<PdfImportJob> self(this);
+  QTimer::singleShot(0, this, [self]() {
+    if (self)
+      self->finish(false);
+  });
+}
+
+void PdfImportJob::stored(const QByteArray &doc) {
+  if (m_finished || m_shared->cancelled)
+    return;
+  m_doc = doc;
+  schedule();
+}
+
+void PdfImportJob::schedule() {
+#ifdef BLOP_HAS_PDF
+  while (!m_shared->cancelled && m_nextIn < m_pageCount &&
+         m_nextIn - m_nextOut < m_window) {
+    const int index = m_nextIn++;
+    const std::shared_ptr<Shared> shared = m_shared;
+    const QSize size = m_pageSize;
+    QPointer<PdfImportJob> self(this);
+    fireAndForget([self, shared, index, size]() {
+      QByteArray png;
+      if (!shared->cancelled) {
+        if (auto doc = shared->takeDocument()) {
+          QImage img = doc->render(index, size);
+          if (!img.isNull() && img.format() != QImage::Format_RGB32)
+            img = img.convertToFormat(QImage::Format_RGB32);
+          png = BnoteCodec::encodeImage(img);
+          shared->returnDocument(std::move(doc));
+        }
+      }
+      QMetaObject::invokeMethod(
+          self.data(), [self, index, png]() {
+            if (self)
+              self->rendered(index, png);
+          },
+          Qt::QueuedConnection);
+    });
+  }
+#endif
+}
+
+void PdfImportJob::rendered(int pdfPage, const QByteArray &png) {
+  if (m_finished || m_shared->cancelled)
+    return;
+  m_done.emplace(pdfPage, png);
+  while (!m_done.empty() && m_done.begin()->first == m_nextOut) {
+    NotePage page;
+    page.title = QStringLiteral("PDF S.%1").arg(m_nextOut + 1);
+    page.backgroundType = static_cast<int>(PageBackgroundType::Blank);
+    page.paperColor = Qt::white;
+    if (!m_doc.isEmpty())
+      page.pdf = PdfPageRef{m_doc, m_nextOut};
+    if (!m_done.begin()->second.isEmpty())
+      page.pendingPayload = BnoteFile::imagePayload(m_done.begin()->second);
+    m_done.erase(m_done.begin());
+    const int index = m_nextOut++;
+    emit pageReady(index, page);
+    // A slot may have cancelled the import.
+    if (m_finished || m_shared->cancelled)
+      return;
+  }
+  emit progress(m_nextOut, m_pageCount);
+  if (m_nextOut == m_pageCount) {
+    finish(true);
+    return;
+  }
+  schedule();
+}
+
+void PdfImportJob::finish(bool completed) {
+  if (m_finished)
+    return;
+  m_finished = true;
+  emit finished(completed);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Note.h"
+
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <atomic>
+#include <map>
+#include <memory>
+
+/// Streams the pages of a PDF into new NotePages.
+///
+/// The document is first copied into PdfStore; pages then reference it
+/// (NotePage::pdf) and are drawn from it at view zoom (PdfRenderPool). The
+/// job renders the full-size raster every page keeps as background image:
+/// the store is per device, so that raster is what thumbnails, exports and
+/// other devices see.
+///
+/// Previews are rendered and PNG-encoded on the thread pool, at most
+/// window() pages ahead of the last one handed out, so memory is bounded by
+/// that window and not by the page count. pageReady() delivers pages in
+/// document order as soon as every earlier page is done; a page keeps the
+/// PNG and decodes it on first access (BnoteFile::imagePayload()). Qt PDF
+/// serialises PDFium itself, so the parallel part is mostly encoding.
+///
+/// GUI thread. Without Qt PDF (BLOP_HAS_PDF) start() always fails.
+class PdfImportJob : public QObject {
+  Q_OBJECT
+public:
+  PdfImportJob(const QString &pdfPath, const QSize &pageSize,
+               QObject *parent = nullptr);
+  ~PdfImportJob() override;
+
+  /// Opens the document; false if it is unreadable or has no pages.
+  bool start();
+  /// Stops scheduling; pages still rendering are dropped. finished(false)
+  /// follows once, from the event loop.
+  void cancel();
+
+  int pageCount() const { return m_pageCount; }
+  int pagesDone() const { return m_nextOut; }
+  int window() const { return m_window; }
+
+signals:
+  void pageReady(int pdfPage, const NotePage &page);
+  void progress(int done, int total);
+  /// `completed` is false when cancelled.
+  void finished(bool completed);
+
+private:
+  struct Shared;
+
+  void stored(const QByteArray &doc);
+  void schedule();
+  void rendered(int pdfPage, const QByteArray &png);
+  void finish(bool completed);
+
+  QString m_path;
+  QSize m_pageSize;
+  QByteArray m_doc;   ///< PdfStore hash, empty if not stored
+  std::shared_ptr<Shared> m_shared; ///< document pool + cancel flag
+  int m_pageCount{0};
+  int m_window{2};
+  int m_nextIn{0};  ///< next page to schedule
+  int m_nextOut{0}; ///< next page to hand out
+  std::map<int, QByteArray> m_done; ///< rendered, waiting for earlier pages
+  bool m_finished{false};
+};
@@ -0,0 +1,225 @@
+#include "pdfrenderpool.h"
+
+#include "pdfstore.h"
+
+#include <QMetaObject>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <cmath>
+
+#ifdef BLOP_HAS_PDF
+#include <QPdfDocument>
+#include <QPdfDocumentRenderOptions>
+#endif
+
+namespace {
+
+#ifdef Q_OS_ANDROID
+constexpr int kBudgetMb = 32;
+#else
+constexpr int kBudgetMb = 96;
+#endif
+
+#ifdef BLOP_HAS_PDF
+/// Each worker keeps the document it rendered last open; a thread's
+/// document dies with the thread, on that thread.
+QPdfDocument *threadDocument(const QString &file) {
+  struct Open {
+    QString file;
+    std::unique_ptr<QPdfDocument> doc;
+  };
+  thread_local Open open;
+  if (open.doc && open.file == file)
+    return open.doc.get();
+  open.file = file;
+  open.doc = std::make_unique<QPdfDocument>();
+  if (open.doc->load(file) != QPdfDocument::Error::None) {
+    open.doc.reset();
+    open.file.clear();
+  }
+  return open.doc.get();
+}
+
+class PdfPageBackground : public PageBackgroundSource {
+public:
+  PdfPageBackground(const PdfPageRef &ref, const QString &file)
+      : m_ref(ref), m_file(file) {}
+
+  bool paint(QPainter *painter, const QRectF &target, const QRectF &exposed,
+             qreal scale, const QImage &fallback) override {
+    // Zoomed out far enough, the preview is as sharp as a render would be.
+    if (!fallback.isNull() && scale * target.width() <= fallback.width() * 1.05)
+      return false;
+    const int bucket = PdfRenderPool::bucketFor(scale);
+    const QSize pageSize(qCeil(target.width() * bucket),
+                         qCeil(target.height() * bucket));
+    const QRectF area = exposed.intersected(target).translated(-target.topLeft());
+    if (area.isEmpty())
+      return true;
+    const int tile = PdfRenderPool::kTilePx;
+    const int maxCol = (pageSize.width() - 1) / tile;
+    const int maxRow = (pageSize.height() - 1) / tile;
+    const int col0 = std::clamp(int(area.left() * bucket) / tile, 0, maxCol);
+    const int col1 = std::clamp(int(std::ceil(area.right() * bucket)) / tile, 0, maxCol);
+    const int row0 = std::clamp(int(area.top() * bucket) / tile, 0, maxRow);
+    const int row1 = std::clamp(int(std::ceil(area.bottom() * bucket)) / tile, 0, maxRow);
+    const qreal fx = fallback.isNull() ? 0.0 : fallback.width() / qreal(pageSize.width());
+    const qreal fy = fallback.isNull() ? 0.0 : fallback.height() / qreal(pageSize.height());
+    PdfRenderPool &pool = PdfRenderPool::instance();
+    for (int row = row0; row <= row1; ++row) {
+      for (int col = col0; col <= col1; ++col) {
+        const QRect px = QRect(col * tile, row * tile, tile, tile)
+                             .intersected(QRect(QPoint(), pageSize));
+        const QRectF dst(target.left() + px.x() / qreal(bucket),
+                         target.top() + px.y() / qreal(bucket),
+                         px.width() / qreal(bucket), px.height() / qreal(bucket));
+        const QImage img = pool.tile(m_ref, m_file, pageSize, col, row);
+        if (!img.isNull())
+          painter->drawImage(dst, img);
+        else if (!fallback.isNull())
+          painter->drawImage(dst, fallback,
+                             QRectF(px.x() * fx, px.y() * fy,
+                                    px.width() * fx, px.height() * fy));
+      }
+    }
+    return true;
+  }
+
+private:
+  PdfPageRef m_ref;
+  QString m_file;
+};
+#endif
+
+} // namespace
+
+PdfRenderPool &PdfRenderPool::instance() {
+  static PdfRenderPool pool;
+  return pool;
+}
+
+PdfRenderPool::PdfRenderPool() {
+  // Qt PDF serialises PDFium calls; more threads would only wait.
+  m_threads.setMaxThreadCount(2);
+  m_tiles.setMaxCost(kBudgetMb * 1024);
+}
+
+int PdfRenderPool::bucketFor(qreal scale) {
+  int bucket = 1;
+  while (bucket < scale && bucket < 8)
+    bucket *= 2;
+  return bucket;
+}
+
+std::shared_ptr<PageBackgroundSource>
+PdfRenderPool::background(const PdfPageRef &ref) {
+#ifdef BLOP_HAS_PDF
+  if (!ref.isValid())
+    return nullptr;
+  const QString file = PdfStore::instance().path(ref.doc);
+  if (file.isEmpty())
+    return nullptr;
+  return std::make_shared<PdfPageBackground>(ref, file);
+#else
+  Q_UNUSED(ref);
+  return nullptr;
+#endif
+}
+
+QImage PdfRenderPool::tile(const PdfPageRef &ref, const QString &file,
+                           const QSize &pageSize, int col, int row) {
+  const QString key = QStringLiteral("%1:%2:%3x%4:%5:%6")
+                          .arg(QString::fromLatin1(ref.doc))
+                          .arg(ref.page)
+                          .arg(pageSize.width())
+                          .arg(pageSize.height())
+                          .arg(col)
+                          .arg(row);
+  if (const QImage *hit = m_tiles.object(key))
+    return *hit;
+  if (m_queued.contains(key)) {
+    // Asked again: still wanted, so render it before older requests.
+    const auto it = std::find_if(m_queue.begin(), m_queue.end(),
+                                 [&](const Job &j) { return j.key == key; });
+    if (it != m_queue.end() && it != m_queue.begin()) {
+      Job job = std::move(*it);
+      m_queue.erase(it);
+      m_queue.push_front(std::move(job));
+    }
+    return QImage();
+  }
+  const QRect clip = QRect(col * kTilePx, row * kTilePx, kTilePx, kTilePx)
+                         .intersected(QRect(QPoint(), pageSize));
+  if (clip.isEmpty())
+    return QImage();
+  m_queue.push_front(Job{key, ref, file, pageSize, clip});
+  m_queued.insert(key);
+  while (int(m_queue.size()) > kMaxQueued) {
+    m_queued.remove(m_queue.back().key);
+    m_queue.pop_back();
+  }
+  pump();
+  return QImage();
+}
+
+void PdfRenderPool::pump() {
+  while (m_running < m_threads.maxThreadCount() && !m_queue.empty()) {
+    Job job = std::move(m_queue.front());
+    m_queue.pop_front();
+    ++m_running;
+    QtConcurrent::run(&m_threads, [this, job]() {
+      const QImage img = render(job.file, job.ref.page, job.pageSize, job.clip);
+      QMetaObject::invokeMethod(
+          this, [this, job, img]() { finished(job, img); },
+          Qt::QueuedConnection);
+    });
+  }
+}
+
+void PdfRenderPool::finished(const Job &job, const QImage &image) {
+  --m_running;
+  m_queued.remove(job.key);
+  if (!image.isNull()) {
+    m_tiles.insert(job.key, new QImage(image),
+                   qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+    emit tileReady(job.ref.doc, job.ref.page);
+  }
+  pump();
+}
+
+QImage PdfRenderPool::render(const QString &file, int page,
+                             const QSize &pageSize, const QRect &clip) {
+#ifdef BLOP_HAS_PDF
+  QPdfDocument *doc = threadDocument(file);
+  if (!doc || page < 0 || page >= doc->pageCount())
+    return QImage();
+  QPdfDocumentRenderOptions options;
+  options.setScaledSize(pageSize);
+  options.setScaledClipRect(clip);
+  return doc->render(page, clip.size(), options);
+#else
+  Q_UNUSED(file);
+  Q_UNUSED(page);
+  Q_UNUSED(pageSize);
+  Q_UNUSED(clip);
+  return QImage();
+#endif
+}
+
+QImage PdfRenderPool::renderPage(const PdfPageRef &ref, const QSize &size) {
+#ifdef BLOP_HAS_PDF
+  const QString file = PdfStore::instance().path(ref.doc);
+  if (file.isEmpty())
+    return QImage();
+  QPdfDocument doc;
+  if (doc.load(file) != QPdfDocument::Error::None || ref.page < 0 ||
+      ref.page >= doc.pageCount())
+    return QImage();
+  return doc.render(ref.page, size);
+#else
+  Q_UNUSED(ref);
+  Q_UNUSED(size);
+  return QImage();
+#endif
+}
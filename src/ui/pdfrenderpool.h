@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Note.h"
+#include "PageItem.h"
+
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QRect>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <deque>
+#include <memory>
+
+/// Draws imported PDF pages (NotePage::pdf) from the document itself, at the
+/// zoom they are shown at, so text stays sharp where the stored preview
+/// would blur.
+///
+/// Pages are cut into kTilePx tiles of a zoom bucket (1, 2, 4 or 8 device
+/// pixels per page unit) and rendered on a pool of their own, each worker
+/// thread keeping its document open. Tiles are cached per document, page,
+/// bucket and position up to a byte budget. Newest requests render first
+/// and older ones are dropped past kMaxQueued, so pages scrolled past cost
+/// nothing. tileReady() names the page to repaint.
+///
+/// GUI thread; only the rendering runs elsewhere. Without Qt PDF
+/// (BLOP_HAS_PDF) there are no backgrounds and pages show their preview.
+class PdfRenderPool : public QObject {
+  Q_OBJECT
+public:
+  static constexpr int kTilePx = 512;
+  static constexpr int kMaxQueued = 48;
+
+  static PdfRenderPool &instance();
+
+  /// Background for `ref`; null when this device does not have the document.
+  std::shared_ptr<PageBackgroundSource> background(const PdfPageRef &ref);
+
+  /// Smallest bucket that is at least as sharp as `scale`.
+  static int bucketFor(qreal scale);
+
+  /// Cached tile of `ref` rendered at `pageSize` (device pixels of the whole
+  /// page); null after queueing it.
+  QImage tile(const PdfPageRef &ref, const QString &file, const QSize &pageSize,
+              int col, int row);
+
+  /// The whole page at `size`, on the calling thread. Null if unavailable.
+  static QImage renderPage(const PdfPageRef &ref, const QSize &size);
+
+signals:
+  void tileReady(const QByteArray &doc, int page);
+
+private:
+  struct Job {
+    QString key;
+    PdfPageRef ref;
+    QString file;
+    QSize pageSize;
+    QRect clip;
+  };
+
+  PdfRenderPool();
+  void pump();
+  void finished(const Job &job, const QImage &image);
+  static QImage render(const QString &file, int page, const QSize &pageSize,
+                       const QRect &clip);
+
+  QThreadPool m_threads;
+  QCache<QString, QImage> m_tiles; ///< cost in KiB
+  std::deque<Job> m_queue;         ///< newest first
+  QSet<QString> m_queued;          ///< queued or rendering
+  int m_running{0};
+};
@@ -0,0 +1,269 @@
+#include "thumbnailstore.h"
+
+#include "Note.h"
+#include "notemanager.h"
+#include "pagerender.h"
+#include "util/Async.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <iterator>
+
+namespace {
+constexpr const char *kOrg = "Blop";
+constexpr const char *kApp = "BlopApp";
+constexpr const char *kBudgetKey = "thumbnails/cache_mb";
+#ifdef Q_OS_ANDROID
+constexpr int kDefaultBudgetMb = 48;
+#else
+constexpr int kDefaultBudgetMb = 128;
+#endif
+/// Longest side of a library cover.
+constexpr int kCoverPx = 384;
+constexpr int kBuckets[] = {96, 192, 384, 768, 1536};
+
+QString shortHash(const QString &s) {
+  return QString::fromLatin1(
+      QCryptographicHash::hash(s.toUtf8(), QCryptographicHash::Sha1)
+          .toHex()
+          .left(16));
+}
+
+bool isBnote(const QString &path) {
+  return path.endsWith(QLatin1String(".bnote"), Qt::CaseInsensitive);
+}
+
+QImage renderCover(const NotePage &page) {
+  const QSize pageSize = PageRender::a4Size();
+  return PageRender::renderThumbnail(page, pageSize.width(), pageSize.height(),
+                                     QSize(kCoverPx, kCoverPx));
+}
+} // namespace
+
+ThumbnailStore &ThumbnailStore::instance() {
+  static ThumbnailStore store;
+  return store;
+}
+
+ThumbnailStore::ThumbnailStore() : m_covers(16 * 1024) {
+  m_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+          QStringLiteral("/thumbnails");
+  QDir().mkpath(m_dir);
+  QSettings s(QString::fromLatin1(kOrg), QString::fromLatin1(kApp));
+  m_budget = qint64(s.value(QString::fromLatin1(kBudgetKey), kDefaultBudgetMb)
+                        .toInt()) *
+             1024 * 1024;
+  NoteManager::addSaveObserver(
+      [this](const Note &note, const QString &path) { noteSaved(note, path); });
+}
+
+int ThumbnailStore::sizeBucket(const QSize &size) {
+  const int side = qMax(size.width(), size.height());
+  for (int b : kBuckets) {
+    if (side <= b)
+      return b;
+  }
+  return kBuckets[std::size(kBuckets) - 1];
+}
+
+QString ThumbnailStore::pageFileName(const Key &key) {
+  return QStringLiteral("p%1_%2_%3_%4.png")
+      .arg(shortHash(key.noteId))
+      .arg(key.page)
+      .arg(key.revision, 16, 16, QLatin1Char('0'))
+      .arg(key.bucket);
+}
+
+QString ThumbnailStore::coverFileName(const QString &path) {
+  return QStringLiteral("c%1.png").arg(shortHash(QFileInfo(path).absoluteFilePath()));
+}
+
+QImage ThumbnailStore::find(const Key &key) {
+  if (!isCacheable(key))
+    return QImage();
+  return readFile(pageFileName(key));
+}
+
+void ThumbnailStore::insert(const Key &key, const QImage &image) {
+  if (!isCacheable(key) || image.isNull())
+    return;
+  writeFile(pageFileName(key), image);
+}
+
+QImage ThumbnailStore::readFile(const QString &name) {
+  {
+    QMutexLocker lock(&m_mutex);
+    scanLocked();
+    auto it = m_files.find(name);
+    if (it == m_files.end())
+      return QImage();
+    it->lastUse = QDateTime::currentMSecsSinceEpoch();
+  }
+  QImage img;
+  if (!img.load(m_dir + QLatin1Char('/') + name, "PNG")) {
+    // Torn or foreign file: forget it, the caller renders again.
+    QMutexLocker lock(&m_mutex);
+    m_totalBytes -= m_files.value(name).bytes;
+    m_files.remove(name);
+    QFile::remove(m_dir + QLatin1Char('/') + name);
+  }
+  return img;
+}
+
+void ThumbnailStore::writeFile(const QString &name, const QImage &image) {
+  const QString filePath = m_dir + QLatin1Char('/') + name;
+  QSaveFile f(filePath);
+  if (!f.open(QIODevice::WriteOnly) || !image.save(&f, "PNG") || !f.commit()) {
+    qWarning() << "ThumbnailStore: cannot write" << filePath;
+    return;
+  }
+  QMutexLocker lock(&m_mutex);
+  scanLocked();
+  FileEntry &e = m_files[name];
+  m_totalBytes -= e.bytes;
+  e.bytes = QFileInfo(filePath).size();
+  e.lastUse = QDateTime::currentMSecsSinceEpoch();
+  m_totalBytes += e.bytes;
+  evictLocked();
+}
+
+void ThumbnailStore::scanLocked() {
+  if (m_scanned)
+    return;
+  m_scanned = true;
+  const QFileInfoList files =
+      QDir(m_dir).entryInfoList({QStringLiteral("*.png")}, QDir::Files);
+  m_files.reserve(files.size());
+  for (const QFileInfo &fi : files) {
+    // Last use across runs is approximated by the write time.
+    m_files.insert(fi.fileName(),
+                   FileEntry{fi.size(), fi.lastModified().toMSecsSinceEpoch()});
+    m_totalBytes += fi.size();
+  }
+}
+
+void ThumbnailStore::evictLocked() {
+  while (m_totalBytes > m_budget && !m_files.isEmpty()) {
+    auto oldest = m_files.begin();
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+      if (it->lastUse < oldest->lastUse)
+        oldest = it;
+    }
+    QFile::remove(m_dir + QLatin1Char('/') + oldest.key());
+    m_totalBytes -= oldest->bytes;
+    m_files.erase(oldest);
+  }
+}
+
+qint64 ThumbnailStore::byteBudget() const {
+  QMutexLocker lock(&m_mutex);
+  return m_budget;
+}
+
+void ThumbnailStore::setByteBudget(qint64 bytes) {
+  QSettings s(QString::fromLatin1(kOrg), QString::fromLatin1(kApp));
+  s.setValue(QString::fromLatin1(kBudgetKey), int(bytes / (1024 * 1024)));
+  QMutexLocker lock(&m_mutex);
+  m_budget = qMax<qint64>(bytes, 0);
+  scanLocked();
+  evictLocked();
+}
+
+QImage ThumbnailStore::cover(const QString &path) {
+  if (!isBnote(path))
+    return QImage();
+  if (const QImage *hit = m_covers.object(path))
+    return *hit;
+  if (m_coverPending.contains(path) || m_coverFailed.contains(path))
+    return QImage();
+  m_coverPending.insert(path);
+  QPointer<ThumbnailStore> self(this);
+  fireAndForget([self, path]() {
+    if (!self)
+      return;
+    // A cover older than the note was drawn before someone else wrote it
+    // (sync, another device); render it again from the file.
+    const QString name = coverFileName(path);
+    const QFileInfo coverInfo(self->m_dir + QLatin1Char('/') + name);
+    QImage img;
+    if (coverInfo.exists() &&
+        coverInfo.lastModified() >= QFileInfo(path).lastModified())
+      img = self->readFile(name);
+    if (img.isNull()) {
+      Note note;
+      if (NoteManager::loadNote(path, note) && !note.pages.isEmpty()) {
+        NotePage first = note.pages.first();
+        first.ensureLoaded();
+        img = renderCover(first);
+        if (!img.isNull())
+          self->writeFile(name, img);
+      }
+    }
+    QMetaObject::invokeMethod(
+        self.data(), [self, path, img]() {
+          if (self)
+            self->coverLoaded(path, img);
+        },
+        Qt::QueuedConnection);
+  });
+  return QImage();
+}
+
+void ThumbnailStore::coverLoaded(const QString &path, const QImage &image) {
+  m_coverPending.remove(path);
+  if (image.isNull()) {
+    m_coverFailed.insert(path);
+    return;
+  }
+  m_coverFailed.remove(path);
+  m_covers.insert(path, new QImage(image),
+                  qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+  emit coverReady(path);
+}
+
+void ThumbnailStore::noteSaved(const Note &note, const QString &path) {
+  if (!isBnote(path) || note.pages.isEmpty())
+    return;
+  NotePage first = note.pages.first();
+  const quint64 rev = PageRender::revision(first);
+  {
+    QMutexLocker lock(&m_mutex);
+    if (rev != 0 && m_coverRevisions.value(path) == rev)
+      return;
+    m_coverRevisions.insert(path, rev);
+  }
+  // Observers run inside saveNote(), which may be on the UI thread (close,
+  // flush): only the page (shared buffers) is captured here, the render
+  // and the write happen on the pool like cover().
+  QPointer<ThumbnailStore> self(this);
+  fireAndForget([self, first = std::move(first), path, rev]() mutable {
+    if (!self)
+      return;
+    first.ensureLoaded();
+    const QImage img = renderCover(first);
+    if (img.isNull())
+      return;
+    {
+      // A later save's cover may already be on its way.
+      QMutexLocker lock(&self->m_mutex);
+      if (self->m_coverRevisions.value(path) != rev)
+        return;
+    }
+    self->writeFile(coverFileName(path), img);
+    QMetaObject::invokeMethod(
+        self.data(), [self, path, img]() {
+          if (self)
+            self->coverLoaded(path, img);
+        },
+        Qt::QueuedConnection);
+  });
+}
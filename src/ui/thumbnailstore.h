@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSize>
+#include <QString>
+
+struct Note;
+
+/// Disk-backed page thumbnails that survive restarts, plus the library
+/// covers (first page) built from them.
+///
+/// Page thumbnails are keyed by note id, page index, PageRender::revision()
+/// and a size bucket, so an edit never hits an old image. Covers are keyed
+/// by note path: written by the save path (NoteManager save observer) and
+/// rendered from the file for notes saved elsewhere. Files live in the
+/// cache directory and are evicted least recently used first once they
+/// exceed the byte budget ("thumbnails/cache_mb" in QSettings).
+///
+/// find()/insert() do file I/O and are meant for worker threads; cover()
+/// and the signal are GUI thread.
+class ThumbnailStore : public QObject {
+  Q_OBJECT
+public:
+  struct Key {
+    QString noteId;
+    int page{0};
+    quint64 revision{0};
+    int bucket{0};
+  };
+
+  static ThumbnailStore &instance();
+
+  /// Size class of a thumbnail request (longest side rounded up).
+  static int sizeBucket(const QSize &size);
+  /// Keys without a note id or revision are never stored.
+  static bool isCacheable(const Key &key) {
+    return !key.noteId.isEmpty() && key.revision != 0;
+  }
+
+  QImage find(const Key &key);
+  void insert(const Key &key, const QImage &image);
+
+  /// Cover of the .bnote at `path` when it is in memory. Otherwise null;
+  /// loading or rendering it is queued and coverReady() follows.
+  QImage cover(const QString &path);
+
+  qint64 byteBudget() const;
+  void setByteBudget(qint64 bytes);
+
+signals:
+  void coverReady(const QString &path);
+
+private:
+  struct FileEntry {
+    qint64 bytes{0};
+    qint64 lastUse{0};
+  };
+
+  ThumbnailStore();
+
+  QString dir() const { return m_dir; }
+  static QString pageFileName(const Key &key);
+  static QString coverFileName(const QString &path);
+  QImage readFile(const QString &name);
+  void writeFile(const QString &name, const QImage &image);
+  void noteSaved(const Note &note, const QString &path);
+  void coverLoaded(const QString &path, const QImage &image);
+  /// Callers hold m_mutex.
+  void scanLocked();
+  void evictLocked();
+
+  QString m_dir;
+  mutable QMutex m_mutex;
+  bool m_scanned{false};
+  QHash<QString, FileEntry> m_files; ///< file name -> size, last use
+  qint64 m_totalBytes{0};
+  qint64 m_budget{0};
+  QHash<QString, quint64> m_coverRevisions; ///< path -> revision drawn
+
+  // GUI thread
+  QCache<QString, QImage> m_covers;
+  QSet<QString> m_coverPending;
+  QSet<QString> m_coverFailed;
+};
@@ -0,0 +1,228 @@
+#include "wetinkoverlay.h"
+#include "blop_diag.h"
+#include "strokegeometry.h"
+#include <QEvent>
+#include <QGraphicsView>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QVarLengthArray>
+#include <QtMath>
+#include <cmath>
+
+namespace {
+
+/// Samples younger than this give the pen velocity for the prediction.
+constexpr qint64 kPredictWindowNs = 30 * 1000 * 1000;
+/// How far ahead the prediction reaches, about one frame at 60-90 Hz.
+constexpr qint64 kPredictHorizonNs = 12 * 1000 * 1000;
+/// Longest predicted segment (viewport px); far guesses look worse than lag.
+constexpr qreal kMaxAheadPx = 24.0;
+
+} // namespace
+
+WetInkOverlay::WetInkOverlay(QGraphicsView *view)
+    : QWidget(view), m_view(view), m_scene(view->scene()) {
+  // Sibling of the viewport, not a child: QWidget::scroll() on the viewport
+  // would move it along with the content.
+  setAttribute(Qt::WA_TransparentForMouseEvents, true);
+  setAttribute(Qt::WA_NoSystemBackground, true);
+  setFocusPolicy(Qt::NoFocus);
+  view->viewport()->installEventFilter(this);
+  setGeometry(view->viewport()->geometry());
+  raise();
+  m_clock.start();
+  setForScene(m_scene, this);
+}
+
+WetInkOverlay::~WetInkOverlay() {
+  if (forScene(m_scene) == this)
+    setForScene(m_scene, nullptr);
+}
+
+bool WetInkOverlay::beginStroke(const QPen &pen, const StrokePoint &first,
+                                bool predict) {
+  if (!m_view || pen.style() != Qt::SolidLine ||
+      pen.brush().style() != Qt::SolidPattern || pen.color().alpha() < 255)
+    return false;
+  if (m_active)
+    endStroke();
+  const qreal dpr = devicePixelRatioF();
+  const QSize px(qCeil(width() * dpr), qCeil(height() * dpr));
+  if (px.isEmpty())
+    return false;
+  if (m_ink.size() != px) {
+    m_ink = QImage(px, QImage::Format_ARGB32_Premultiplied);
+    m_ink.fill(Qt::transparent);
+  }
+  m_ink.setDevicePixelRatio(dpr);
+  m_xf = m_view->viewportTransform();
+  m_pen = pen;
+  m_pen.setCapStyle(Qt::RoundCap);
+  m_pen.setJoinStyle(Qt::RoundJoin);
+  m_predict = predict;
+  m_points = {first};
+  m_times = {m_clock.nsecsElapsed()};
+  m_drawn = 0;
+  m_inkRect = QRect();
+  m_hasPrediction = false;
+  m_predictionRect = QRect();
+  m_oldestUnpainted = m_times.first();
+  m_active = true;
+  update(segmentRect(first.pos, first.pos));
+  return true;
+}
+
+void WetInkOverlay::appendPoint(const StrokePoint &point) {
+  appendPoints({point}, {});
+}
+
+void WetInkOverlay::appendPoints(const QVector<StrokePoint> &points,
+                                 const QVector<qint64> &timestampsMs) {
+  if (!m_active || points.isEmpty())
+    return;
+  const qint64 now = m_clock.nsecsElapsed();
+  const bool timed = timestampsMs.size() == points.size();
+  QRect dirty = m_predictionRect;
+  for (int i = 0; i < points.size(); ++i) {
+    dirty |= segmentRect(m_points.last().pos, points[i].pos);
+    // Spaced as the pen reported them, the newest arriving now; keeps the
+    // prediction's velocity right for a frame's batch.
+    const qint64 t =
+        timed ? now - (timestampsMs.last() - timestampsMs[i]) * 1000000 : now;
+    m_points.append(points[i]);
+    m_times.append(qMax(m_times.last(), t));
+  }
+  if (m_oldestUnpainted < 0)
+    m_oldestUnpainted = m_times[m_times.size() - points.size()];
+  updatePrediction();
+  update(dirty | m_predictionRect);
+}
+
+void WetInkOverlay::endStroke() {
+  if (!m_active)
+    return;
+  m_active = false;
+  const QRect dirty = m_inkRect | m_predictionRect;
+  if (!m_inkRect.isNull() && !m_ink.isNull()) {
+    QPainter p(&m_ink);
+    p.setCompositionMode(QPainter::CompositionMode_Clear);
+    p.fillRect(m_inkRect, Qt::transparent);
+  }
+  m_points.clear();
+  m_times.clear();
+  m_drawn = 0;
+  m_inkRect = QRect();
+  m_hasPrediction = false;
+  m_predictionRect = QRect();
+  m_oldestUnpainted = -1;
+  update(dirty);
+  BlopDiag::flushInkLatency();
+}
+
+QRect WetInkOverlay::segmentRect(const QPointF &a, const QPointF &b) const {
+  const qreal scale = std::sqrt(qAbs(m_xf.determinant()));
+  const qreal pad = m_pen.widthF() * scale * 0.5 + 2.0;
+  return QRectF(m_xf.map(a), m_xf.map(b))
+      .normalized()
+      .adjusted(-pad, -pad, pad, pad)
+      .toAlignedRect();
+}
+
+void WetInkOverlay::updatePrediction() {
+  m_hasPrediction = false;
+  m_predictionRect = QRect();
+  const int n = m_points.size();
+  if (!m_predict || n < 3)
+    return;
+  int k = n - 1;
+  while (k > 0 && m_times[n - 1] - m_times[k - 1] <= kPredictWindowNs)
+    --k;
+  const qint64 dt = m_times[n - 1] - m_times[k];
+  if (k == n - 1 || dt <= 0)
+    return;
+  QPointF ahead = (m_points[n - 1].pos - m_points[k].pos) *
+                  (qreal(kPredictHorizonNs) / qreal(dt));
+  const qreal scale = std::sqrt(qAbs(m_xf.determinant()));
+  const qreal len = std::hypot(ahead.x(), ahead.y()) * scale;
+  if (len < 0.5)
+    return;
+  if (len > kMaxAheadPx)
+    ahead *= kMaxAheadPx / len;
+  m_predicted = m_points[n - 1].pos + ahead;
+  m_hasPrediction = true;
+  m_predictionRect = segmentRect(m_points[n - 1].pos, m_predicted);
+}
+
+void WetInkOverlay::drawNewSegments() {
+  const int n = m_points.size();
+  if (m_drawn >= n || m_ink.isNull())
+    return;
+  // The committed stroke is one fill of its pressure outline; the new tail
+  // is filled the same way, so nothing changes shape at pen-up. It starts
+  // two points back for the joins at the old end (drawn twice, opaque).
+  const int from = qMax(0, m_drawn - 2);
+  QVarLengthArray<QPointF, 32> pts;
+  QVarLengthArray<qreal, 32> pressures;
+  for (int i = from; i < n; ++i) {
+    pts.append(m_points[i].pos);
+    pressures.append(m_points[i].pressure);
+  }
+  const QPainterPath outline = StrokeGeometry::pressureOutline(
+      pts.constData(), pressures.constData(), int(pts.size()), m_pen.widthF());
+  QPainter p(&m_ink);
+  p.setRenderHint(QPainter::Antialiasing);
+  p.setTransform(m_xf);
+  p.fillPath(outline, m_pen.color());
+  m_inkRect |=
+      m_xf.mapRect(outline.boundingRect()).toAlignedRect().adjusted(-2, -2, 2, 2);
+  m_drawn = n;
+}
+
+void WetInkOverlay::paintEvent(QPaintEvent *e) {
+  if (!m_active || !m_view)
+    return;
+  const qreal dpr = devicePixelRatioF();
+  const QSize px(qCeil(width() * dpr), qCeil(height() * dpr));
+  if (m_view->viewportTransform() != m_xf || m_ink.size() != px) {
+    // Scrolled, zoomed or resized mid-stroke: draw it again from scratch.
+    if (m_ink.size() != px)
+      m_ink = QImage(px, QImage::Format_ARGB32_Premultiplied);
+    m_ink.setDevicePixelRatio(dpr);
+    m_ink.fill(Qt::transparent);
+    m_xf = m_view->viewportTransform();
+    m_drawn = 0;
+    m_inkRect = QRect();
+    updatePrediction();
+    update();
+  }
+  drawNewSegments();
+
+  QPainter p(this);
+  const QRect r = e->rect();
+  p.drawImage(QRectF(r), m_ink,
+              QRectF(QPointF(r.topLeft()) * dpr, QSizeF(r.size()) * dpr));
+  if (m_hasPrediction) {
+    const QPointF ends[2] = {m_points.last().pos, m_predicted};
+    const qreal pressures[2] = {m_points.last().pressure,
+                                m_points.last().pressure};
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setTransform(m_xf);
+    p.fillPath(
+        StrokeGeometry::pressureOutline(ends, pressures, 2, m_pen.widthF()),
+        m_pen.color());
+  }
+  if (m_oldestUnpainted >= 0) {
+    BlopDiag::recordInkLatency((m_clock.nsecsElapsed() - m_oldestUnpainted) /
+                               1000);
+    m_oldestUnpainted = -1;
+  }
+}
+
+bool WetInkOverlay::eventFilter(QObject *obj, QEvent *e) {
+  if (m_view && obj == m_view->viewport() &&
+      (e->type() == QEvent::Resize || e->type() == QEvent::Move)) {
+    setGeometry(m_view->viewport()->geometry());
+    raise();
+  }
+  return QWidget::eventFilter(obj, e);
+}
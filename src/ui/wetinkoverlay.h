@@ -0,0 +1,64 @@
+#pragma once
+#include "tools/WetInkSink.h"
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPointer>
+#include <QTransform>
+#include <QVector>
+#include <QWidget>
+
+class QGraphicsScene;
+class QGraphicsView;
+
+/// Wet ink: the stroke under the pen, drawn over the view's viewport
+/// instead of by a growing StrokeItem. Each paint rasterises only the
+/// segments that arrived since the last one into a persistent image and
+/// repaints just their rect, so the cost per frame does not grow with the
+/// stroke. With prediction a short extrapolated segment (not kept) runs
+/// ahead of the pen.
+///
+/// Only opaque solid pens are taken; highlighter and textured pencil ink
+/// stays on the item. Pen-to-pixel latency goes to BlopDiag per frame and
+/// is flushed per stroke.
+class WetInkOverlay : public QWidget, public WetInkSink {
+  Q_OBJECT
+public:
+  /// Registers for `view`'s scene; sits over its viewport.
+  explicit WetInkOverlay(QGraphicsView *view);
+  ~WetInkOverlay() override;
+
+  bool beginStroke(const QPen &pen, const StrokePoint &first,
+                   bool predict) override;
+  void appendPoint(const StrokePoint &point) override;
+  void appendPoints(const QVector<StrokePoint> &points,
+                    const QVector<qint64> &timestampsMs) override;
+  void endStroke() override;
+
+protected:
+  void paintEvent(QPaintEvent *e) override;
+  bool eventFilter(QObject *obj, QEvent *e) override;
+
+private:
+  /// Fills the outline of points [m_drawn - 2, end) into m_ink.
+  void drawNewSegments();
+  /// Viewport rect of the segment a-b, pen included.
+  QRect segmentRect(const QPointF &a, const QPointF &b) const;
+  void updatePrediction();
+
+  QPointer<QGraphicsView> m_view;
+  const QGraphicsScene *m_scene{nullptr}; ///< registered for
+  QImage m_ink;
+  QTransform m_xf; ///< scene -> overlay at stroke start
+  QPen m_pen;
+  bool m_active{false};
+  bool m_predict{false};
+  QVector<StrokePoint> m_points;
+  QVector<qint64> m_times; ///< arrival per point, m_clock ns
+  int m_drawn{0};          ///< points already in m_ink
+  QRect m_inkRect;         ///< everything drawn this stroke
+  QPointF m_predicted;
+  bool m_hasPrediction{false};
+  QRect m_predictionRect;
+  QElapsedTimer m_clock;
+  qint64 m_oldestUnpainted{-1};
+};
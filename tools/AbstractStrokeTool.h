@@ -3,6 +3,8 @@
 #include "RulerItem.h"
 #include "RulerTool.h"
 #include "StrokeItem.h"
+#include "StrokeSpatialIndex.h"
+#include "WetInkSink.h"
 #include <QElapsedTimer>
 #include <QGraphicsPathItem>
 #include <QLineF>
@@ -39,11 +41,18 @@ public:
 
     int holdStillMs() const { return qBound(200, m_config.holdStillDelayMs, 900); }
 
+    /// Smoothing is set per sample at this report rate (a 240 Hz pen); tablet
+    /// batches scale it by their timestamps, so it is the same per time at
+    /// any rate.
+    static constexpr qreal kSmoothingSampleMs = 1000.0 / 240.0;
+
     // We store the last pressure so that mouseMove events (if synthesized) have a fallback,
     // though native TabletEvents will use their own pressure.
     qreal m_lastPressure{1.0};
     // EMA state for blopPressureResponse(); -1 = no sample yet this stroke.
     qreal m_pressureFilter{-1.0};
+    /// QInputEvent::timestamp() of the last tablet sample of the stroke.
+    qint64 m_lastSampleMs{0};
 
     /// Call from the view before each tablet gesture event so strokes are added to the scene
     /// (tablet callbacks pass no QGraphicsScene* to handleMoveOrPress).
@@ -54,8 +63,10 @@ public:
 
     bool handleTabletEvent(QTabletEvent* event, const QPointF& scenePos) override {
         // Tablet events give us robust pressure [0.0 - 1.0]
-        if (event->type() == QEvent::TabletPress)
+        if (event->type() == QEvent::TabletPress) {
             m_pressureFilter = -1.0;
+            m_lastSampleMs = qint64(event->timestamp());
+        }
         m_lastPressure = blopPressureResponse(event->pressure());
 
         QGraphicsScene* sc = m_sceneRef;
@@ -71,6 +82,33 @@ public:
         return false;
     }
 
+    bool acceptsTabletBatches() const override { return true; }
+
+    bool handleTabletMoves(const QVector<TabletSample>& moves) override {
+        if (!m_currentItem)
+            return true;
+        // Freehand samples only go into the buffers here; the frame's new
+        // points are shown once at the end (one wet-ink repaint, one path).
+        const int from = int(m_pointsBuffer.size());
+        QVector<qint64> times;
+        times.reserve(moves.size());
+        for (const TabletSample& s : moves) {
+            if (!m_currentItem)
+                break;
+            m_lastPressure = blopPressureResponse(s.pressure);
+            const qreal dtMs = qreal(s.timestampMs - m_lastSampleMs);
+            m_lastSampleMs = s.timestampMs;
+            trackMotion(s.pos);
+            if (handleShapedMove(s.pos))
+                continue;
+            if (appendFreehandPoint(s.pos, dtMs))
+                times.append(s.timestampMs);
+        }
+        if (m_currentItem)
+            showNewPoints(from, times);
+        return true;
+    }
+
     /// Blop pressure curve: soft-knee response (never below 30% width, gentle
     /// gamma so mid pressure feels natural) plus a small EMA against sensor
     /// jitter. Full pressure maps to exactly 1.0 so mouse strokes and the
@@ -109,6 +147,7 @@ public:
             // the very last setPath() call. Force a final commit here so
             // the stroke always renders complete to its release point.
             m_currentItem->setPath(m_currentPath);
+            handWetInkToItem();
             m_pathPaintTimer.invalidate();
             m_currentItem->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
             m_lastCompletedItem = m_currentItem;
@@ -137,6 +176,7 @@ private slots:
         if (QLineF(m_lastKnownScenePos, m_pressStartPos).length() < 5.0)
             return;
         m_longPressStraightMode = true;
+        handWetInkToItem();
         if (!commitHoldShapeIfReady(m_lastKnownScenePos)) {
             m_holdShapeKind = HoldShapeKind::None;
             m_holdShapeConfidence = 0.0;
@@ -175,6 +215,8 @@ protected:
     bool m_isSnapping{false};
     RulerItem* m_rulerRef{nullptr};
     QGraphicsScene* m_sceneRef{nullptr};
+    /// The scene's WetInkSink shows the stroke; m_currentItem is hidden.
+    bool m_wetInk{false};
 
     QPointF m_holdStrokeStart;
     QPointF m_holdStrokeEnd;
@@ -224,6 +266,21 @@ protected:
             m_currentItem->setZValue(getZValue());
 
             if (m_sceneRef) m_sceneRef->addItem(m_currentItem);
+            // Hand the live stroke to the scene's index so the view can
+            // commit it on pen-up without walking every scene item.
+            if (auto* index = StrokeSpatialIndex::forScene(m_sceneRef))
+                index->addPending(typedItem);
+            // Freehand ink is drawn by the wet-ink layer until pen-up; the
+            // item is only updated when it takes the stroke back.
+            m_wetInk = false;
+            if (!m_isSnapping && strokeStyle() == StrokeItem::Normal) {
+                if (auto* sink = WetInkSink::forScene(m_sceneRef)) {
+                    m_wetInk = sink->beginStroke(m_currentItem->pen(), {startPos, m_lastPressure},
+                                                 m_config.inkPrediction);
+                    if (m_wetInk)
+                        m_currentItem->setVisible(false);
+                }
+            }
             m_lastKnownScenePos = startPos;
             // v119 perf: reset the per-stroke paint throttle so the
             // very first move event triggers a setPath immediately.
@@ -233,82 +290,121 @@ protected:
             return true;
         } else {
             if (m_currentItem) {
-                m_lastKnownScenePos = scenePos;
-                QPointF newPos = scenePos;
-                if (!m_longPressStraightMode && m_lastMotionTimer.isValid()) {
-                    const qreal movementSinceLastSample = QLineF(scenePos, m_lastMotionPos).length();
-                    if (movementSinceLastSample > 4.0) {
-                        m_lastMotionPos = scenePos;
-                        m_lastMotionTimer.restart();
-                        if (m_holdStillTimer)
-                            m_holdStillTimer->start(holdStillMs());
-                    }
-                    const bool heldLongEnough = m_lastMotionTimer.elapsed() >= holdStillMs();
-                    const bool draggedEnough = QLineF(scenePos, m_pressStartPos).length() >= 5.0;
-                    if (heldLongEnough && draggedEnough) {
-                        m_longPressStraightMode = true;
-                    }
-                }
-                if (m_isSnapping && m_rulerRef) {
-                    QPointF start = m_pointsBuffer.first().pos;
-                    newPos = m_rulerRef->snapPoint(newPos, start);
-                    
-                    // Bei Snapping wollen wir keine Glättung und den Punkt normal hinzufügen
-                    if (m_pointsBuffer.isEmpty() || QLineF(newPos, m_pointsBuffer.last().pos).length() > 0.5) {
-                        m_pointsBuffer.append({newPos, m_lastPressure});
-                        m_currentPath.lineTo(newPos);
-                        m_currentItem->setPath(m_currentPath);
-                        auto* typedItem = static_cast<StrokeItem*>(m_currentItem);
-                        typedItem->addPoint({newPos, m_lastPressure});
-                    }
+                trackMotion(scenePos);
+                if (handleShapedMove(scenePos))
                     return true;
-                }
+                const int from = int(m_pointsBuffer.size());
+                if (appendFreehandPoint(scenePos, kSmoothingSampleMs))
+                    showNewPoints(from);
+                return true;
+            }
+        }
+        return false;
+    }
 
-                if (m_longPressStraightMode && !m_pointsBuffer.isEmpty()) {
-                    if (m_holdShapeCommitted) {
-                        adjustHoldShape(scenePos);
-                        return true;
-                    }
-                    if (commitHoldShapeIfReady(scenePos))
-                        return true;
-                    m_holdShapeKind = HoldShapeKind::None;
-                    m_holdShapeConfidence = 0.0;
-                    m_longPressStraightMode = false;
-                    rebuildFreehandPathFromPoints();
-                    return true;
-                }
+    /// Hold-still detection for a move to `scenePos`: resting long enough
+    /// switches to straight mode (hold shapes).
+    void trackMotion(QPointF scenePos) {
+        m_lastKnownScenePos = scenePos;
+        if (m_longPressStraightMode || !m_lastMotionTimer.isValid())
+            return;
+        const qreal movementSinceLastSample = QLineF(scenePos, m_lastMotionPos).length();
+        if (movementSinceLastSample > 4.0) {
+            m_lastMotionPos = scenePos;
+            m_lastMotionTimer.restart();
+            if (m_holdStillTimer)
+                m_holdStillTimer->start(holdStillMs());
+        }
+        const bool heldLongEnough = m_lastMotionTimer.elapsed() >= holdStillMs();
+        const bool draggedEnough = QLineF(scenePos, m_pressStartPos).length() >= 5.0;
+        if (heldLongEnough && draggedEnough) {
+            m_longPressStraightMode = true;
+        }
+    }
 
-                if (m_config.smoothing > 0) {
-                    double factor = m_config.smoothing / 120.0;
-                    if (factor > 0.95) factor = 0.95;
-                    QPointF lastPos = m_pointsBuffer.last().pos;
-                    newPos = lastPos * factor + newPos * (1.0 - factor);
-                }
+    /// Ruler snapping and hold shapes, which redraw the item per move;
+    /// false for a freehand move.
+    bool handleShapedMove(QPointF scenePos) {
+        if (m_isSnapping && m_rulerRef) {
+            QPointF start = m_pointsBuffer.first().pos;
+            QPointF newPos = m_rulerRef->snapPoint(scenePos, start);
+
+            // Bei Snapping wollen wir keine Glättung und den Punkt normal hinzufügen
+            if (m_pointsBuffer.isEmpty() || QLineF(newPos, m_pointsBuffer.last().pos).length() > 0.5) {
+                m_pointsBuffer.append({newPos, m_lastPressure});
+                m_currentPath.lineTo(newPos);
+                m_currentItem->setPath(m_currentPath);
+                auto* typedItem = static_cast<StrokeItem*>(m_currentItem);
+                typedItem->addPoint({newPos, m_lastPressure});
+            }
+            return true;
+        }
 
-                if (m_pointsBuffer.isEmpty() || QLineF(newPos, m_pointsBuffer.last().pos).length() > 1.5) {
-                    m_pointsBuffer.append({newPos, m_lastPressure});
-                    m_currentPath.lineTo(newPos);
-                    auto* typedItem = static_cast<StrokeItem*>(m_currentItem);
-                    typedItem->addPoint({newPos, m_lastPressure});
-
-                    // v119 perf: throttle the visible setPath() to ~60fps.
-                    // Appending to the points buffer is cheap; the cost is
-                    // QGraphicsPathItem::setPath which recomputes the
-                    // boundingRect + queues a paint. On a 240Hz tablet
-                    // this used to fire 4 times per vsync; now we batch.
-                    // The release path always commits the final path so
-                    // the last few points are never lost.
-                    if (!m_pathPaintTimer.isValid() || m_pathPaintTimer.elapsed() >= 16) {
-                        m_currentItem->setPath(m_currentPath);
-                        m_pathPaintTimer.restart();
-                    }
-                }
+        if (m_longPressStraightMode && !m_pointsBuffer.isEmpty()) {
+            handWetInkToItem();
+            if (m_holdShapeCommitted) {
+                adjustHoldShape(scenePos);
                 return true;
             }
+            if (commitHoldShapeIfReady(scenePos))
+                return true;
+            m_holdShapeKind = HoldShapeKind::None;
+            m_holdShapeConfidence = 0.0;
+            m_longPressStraightMode = false;
+            rebuildFreehandPathFromPoints();
+            return true;
         }
         return false;
     }
 
+    /// Smooths a freehand move (`dtMs` after the previous sample) and adds
+    /// it to the buffer, the path and the item if it got far enough from
+    /// the last point. Not shown yet: showNewPoints().
+    bool appendFreehandPoint(QPointF scenePos, qreal dtMs) {
+        QPointF newPos = scenePos;
+        if (m_config.smoothing > 0) {
+            double factor = m_config.smoothing / 120.0;
+            if (factor > 0.95) factor = 0.95;
+            factor = std::pow(factor, qBound(0.25, dtMs / kSmoothingSampleMs, 12.0));
+            QPointF lastPos = m_pointsBuffer.last().pos;
+            newPos = lastPos * factor + newPos * (1.0 - factor);
+        }
+
+        if (!m_pointsBuffer.isEmpty() && QLineF(newPos, m_pointsBuffer.last().pos).length() <= 1.5)
+            return false;
+        m_pointsBuffer.append({newPos, m_lastPressure});
+        m_currentPath.lineTo(newPos);
+        auto* typedItem = static_cast<StrokeItem*>(m_currentItem);
+        typedItem->addPoint({newPos, m_lastPressure});
+        return true;
+    }
+
+    /// Shows m_pointsBuffer from `from` on: the wet ink takes them in one
+    /// go (`timestampsMs` per point, may be empty), else the item's path.
+    void showNewPoints(int from, const QVector<qint64>& timestampsMs = {}) {
+        if (from >= m_pointsBuffer.size())
+            return;
+        if (m_wetInk) {
+            if (auto* sink = WetInkSink::forScene(m_sceneRef)) {
+                sink->appendPoints(m_pointsBuffer.mid(from), timestampsMs);
+                return;
+            }
+            handWetInkToItem();
+        }
+
+        // v119 perf: throttle the visible setPath() to ~60fps.
+        // Appending to the points buffer is cheap; the cost is
+        // QGraphicsPathItem::setPath which recomputes the
+        // boundingRect + queues a paint. On a 240Hz tablet
+        // this used to fire 4 times per vsync; now we batch.
+        // The release path always commits the final path so
+        // the last few points are never lost.
+        if (!m_pathPaintTimer.isValid() || m_pathPaintTimer.elapsed() >= 16) {
+            m_currentItem->setPath(m_currentPath);
+            m_pathPaintTimer.restart();
+        }
+    }
+
     bool commitHoldShapeIfReady(QPointF scenePos) {
         if (!m_currentItem || m_pointsBuffer.size() < 6)
             return false;
@@ -1062,6 +1158,19 @@ protected:
         return best;
     }
 
+    /// The live item shows the stroke again (pen-up, hold shape, sink gone).
+    void handWetInkToItem() {
+        if (!m_wetInk)
+            return;
+        m_wetInk = false;
+        if (m_currentItem) {
+            m_currentItem->setPath(m_currentPath);
+            m_currentItem->setVisible(true);
+        }
+        if (auto* sink = WetInkSink::forScene(m_sceneRef))
+            sink->endStroke();
+    }
+
     void rebuildFreehandPathFromPoints() {
         if (!m_currentItem || m_pointsBuffer.isEmpty()) return;
         m_currentPath = QPainterPath();
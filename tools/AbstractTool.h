@@ -4,8 +4,10 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsScene>
 #include <QPainter>
+#include "TabletSampleRing.h"
 #include "ToolMode.h"
 #include "ToolSettings.h"
+#include <QVector>
 
 class AbstractTool : public QObject {
     Q_OBJECT
@@ -26,6 +28,12 @@ public:
     virtual bool handleMouseRelease(QGraphicsSceneMouseEvent* event, QGraphicsScene* scene) { return false; }
 
     virtual bool handleTabletEvent(QTabletEvent* event, const QPointF& scenePos) { return false; }
+    /// Tools that take pen moves in per-frame batches; the view then queues
+    /// TabletMove events instead of calling handleTabletEvent() for each.
+    virtual bool acceptsTabletBatches() const { return false; }
+    /// Queued moves of one frame, oldest first, `pos` in scene coordinates.
+    /// Press and release still arrive through handleTabletEvent().
+    virtual bool handleTabletMoves(const QVector<TabletSample>& moves) { return false; }
     virtual void setStrokeSceneForTablet(QGraphicsScene* scene) {}
     virtual void drawOverlay(QPainter* painter, const QRectF& rect) {}
 
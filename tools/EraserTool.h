@@ -1,6 +1,7 @@
 #pragma once
 #include "AbstractStrokeTool.h"
 #include "StrokeItem.h"
+#include "StrokeSpatialIndex.h"
 #include "UIStyles.h"
 #include <QGraphicsScene>
 #include <QGraphicsItem>
@@ -43,6 +44,14 @@ public:
         return AbstractStrokeTool::handleTabletEvent(event, scenePos);
     }
 
+    bool handleTabletMoves(const QVector<TabletSample>& moves) override {
+        if (m_sceneRef) {
+            for (const TabletSample& s : moves)
+                eraseAt(s.pos, m_sceneRef);
+        }
+        return AbstractStrokeTool::handleTabletMoves(moves);
+    }
+
 protected:
     QPen createPen() const override { return QPen(Qt::white, m_config.penWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin); }
     StrokeItem::StrokeStyle strokeStyle() const override { return StrokeItem::Eraser; }
@@ -54,14 +63,33 @@ private:
         // Radius
         double r = (m_config.eraserMode == EraserMode::Pixel) ? (m_config.penWidth / 2.0) : 5.0;
 
+        // Szenen mit Stroke-Modell (MultiPageNoteView) radieren dort: die
+        // Punktliste wird am Kreis geschnitten, Druckwerte bleiben erhalten,
+        // statt die Striche in Outline-Flächen zu verwandeln.
+        StrokeSpatialIndex* index = StrokeSpatialIndex::forScene(scene);
+        if (index && index->eraseThroughModel(pos, r, m_config.eraserMode == EraserMode::Object))
+            return;
+
         // Bereich um die Maus
         QRectF rect(pos.x() - r, pos.y() - r, 2*r, 2*r);
 
+        // Where the view keeps a StrokeSpatialIndex, it answers with the
+        // strokes whose ink really comes within r of the pointer (chunk grid,
+        // then segment distance) - no shape() per candidate. Other scenes:
         // v119 perf: bbox prefilter first (cheap O(log N) tree query),
         // then the precise IntersectsItemShape test only on the
         // candidates. On dense scenes the difference adds up - the
         // shape test allocates a QPainterPath per item.
-        QList<QGraphicsItem*> items = scene->items(rect, Qt::IntersectsItemBoundingRect);
+        QList<QGraphicsPathItem*> items;
+        if (index) {
+            items = index->hitByDisc(pos, r);
+        } else {
+            for (QGraphicsItem* item : scene->items(rect, Qt::IntersectsItemBoundingRect)) {
+                // Wir bearbeiten nur GraphicsPathItems (unsere Striche)
+                if (auto* pathItem = dynamic_cast<QGraphicsPathItem*>(item))
+                    items.append(pathItem);
+            }
+        }
 
         // Radierer-Form (Kreis)
         QPainterPath eraserShape;
@@ -74,10 +102,8 @@ private:
         QList<QGraphicsItem*> toDelete;
         QSet<QGraphicsItem*> toDeleteSet;
 
-        for (QGraphicsItem* item : items) {
-            // Wir bearbeiten nur GraphicsPathItems (unsere Striche)
-            QGraphicsPathItem* pathItem = dynamic_cast<QGraphicsPathItem*>(item);
-            if (!pathItem) continue;
+        for (QGraphicsPathItem* pathItem : items) {
+            QGraphicsItem* item = pathItem;
 
             // Verhindere, dass der Radierer seinen eigenen visuellen Pfad löscht
             if (m_currentItem && pathItem == m_currentItem) continue;
@@ -87,8 +113,8 @@ private:
 
             // Precise hit test (replaces the IntersectsItemShape on
             // scene->items): only continue if the eraser ellipse
-            // actually intersects the item's shape.
-            if (!item->shape().intersects(item->mapFromScene(eraserShape))) continue;
+            // actually intersects the item's shape (index hits are exact).
+            if (!index && !item->shape().intersects(item->mapFromScene(eraserShape))) continue;
 
             // FEATURE: "Nur Textmarker löschen"
             // Marker liegen auf Z <= 5 (DrawBehind=-10, Normal=5). Tinte >= 10.
@@ -134,6 +160,8 @@ private:
                     pathItem->setPath(newPath);
                 }
 
+                if (index) index->update(pathItem);
+
                 // Wenn nichts mehr übrig ist -> Item zum Löschen vormerken
                 if (pathItem->path().isEmpty()) {
                     // Pressure-Punkte erst leeren wenn wir es wirklich löschen
@@ -148,6 +176,7 @@ private:
         // Erst NACH der Schleife löschen – verhindert Absturz durch Zugriff auf
         // bereits gelöschte Pointer während der Iteration.
         for (QGraphicsItem* item : toDelete) {
+            if (index) index->remove(item);
             scene->removeItem(item);
             delete item;
         }
@@ -1,7 +1,8 @@
 #include "GraphCanvasItem.h"
 #include "uiscale.h"
+#include "math/AdaptiveCurveSampler.h"
+#include "math/ExpressionCache.h"
 #include "math/MathEvaluator.h"
-#include "math/MathExpressionParser.h"
 #include "math/NumericAnalysis.h"
 
 #include <QGraphicsScene>
@@ -9,11 +10,16 @@
 #include <QLineF>
 #include <QPainter>
 #include <QFontMetricsF>
+#include <QVarLengthArray>
+#include <algorithm>
 #include <cmath>
 
 namespace {
 
 constexpr qreal kCurveHitPx = 16.0;
+/// Root search resolution, shared by the markers and the drag handles.
+constexpr int kRootSamples = 360;
+constexpr int kExtremaSamples = 300;
 
 double niceTickStep(double range, int targetDivisions) {
     if (range <= 0 || targetDivisions < 2)
@@ -31,6 +37,100 @@ double niceTickStep(double range, int targetDivisions) {
     return nf * p10;
 }
 
+/// f' samples for derivative curves: the cached symbolic derivative wherever f
+/// itself is defined (so log(x)' stays undefined for x <= 0), otherwise the
+/// central difference.
+void sampleDerivative(const CompiledExpression& c, const double* xs, double* ys, int n) {
+    if (!c.derivative.ok) {
+        NumericAnalysis::derivativeCentralMany(c.expr, xs, ys, n);
+        return;
+    }
+    QVarLengthArray<double, 512> fx(n);
+    MathEvaluator::evalMany(c.expr, xs, fx.data(), static_cast<size_t>(n));
+    MathEvaluator::evalMany(c.derivative, xs, ys, static_cast<size_t>(n));
+    for (int k = 0; k < n; ++k) {
+        if (!qIsFinite(fx[k]))
+            ys[k] = qQNaN();
+    }
+}
+
+double derivativeAt(const CompiledExpression& c, double x) {
+    if (!c.derivative.ok)
+        return NumericAnalysis::derivativeCentral(c.expr, x);
+    if (!qIsFinite(MathEvaluator::evalAt(c.expr, x)))
+        return qQNaN();
+    return MathEvaluator::evalAt(c.derivative, x);
+}
+
+/// Clips the segment a–b to the horizontal band lo <= y <= hi. False if it lies
+/// completely outside.
+bool clipSegmentY(QPointF& a, QPointF& b, qreal lo, qreal hi) {
+    if ((a.y() < lo && b.y() < lo) || (a.y() > hi && b.y() > hi))
+        return false;
+    auto cut = [](QPointF& p, const QPointF& q, qreal edge) {
+        const qreal t = (edge - p.y()) / (q.y() - p.y());
+        p = QPointF(p.x() + t * (q.x() - p.x()), edge);
+    };
+    if (a.y() < lo)
+        cut(a, b, lo);
+    else if (a.y() > hi)
+        cut(a, b, hi);
+    if (b.y() < lo)
+        cut(b, a, lo);
+    else if (b.y() > hi)
+        cut(b, a, hi);
+    return true;
+}
+
+/// Adaptively sampled curve as a path in local plot coordinates. Segments are
+/// clipped to a band of a few plot heights, so values near poles never hand
+/// huge coordinates to the raster engine.
+QPainterPath buildCurvePath(const QRectF& pr, const GraphObject& d, const AdaptiveCurveSampler::BatchEval& eval) {
+    AdaptiveCurveSampler::Options opt;
+    opt.xMin = d.xMin;
+    opt.xMax = d.xMax;
+    opt.yMin = d.yMin;
+    opt.yMax = d.yMax;
+    opt.widthPx = pr.width();
+    opt.heightPx = pr.height();
+    // Local units; a little under half a pixel keeps curves smooth up to ~2x view zoom.
+    opt.tolerancePx = 0.2;
+    const std::vector<CurveSample> samples = AdaptiveCurveSampler::sample(opt, eval);
+
+    const double sx = pr.width() / qMax(1e-6, d.xMax - d.xMin);
+    const double sy = pr.height() / qMax(1e-6, d.yMax - d.yMin);
+    const qreal lo = pr.top() - 2.0 * pr.height();
+    const qreal hi = pr.bottom() + 2.0 * pr.height();
+    QPainterPath path;
+    QPointF prev;
+    bool havePrev = false;
+    bool penAtPrev = false;
+    for (const CurveSample& s : samples) {
+        const QPointF pt(pr.left() + (s.x - d.xMin) * sx, pr.bottom() - (s.y - d.yMin) * sy);
+        if (!qIsFinite(pt.y())) {
+            havePrev = false;
+            continue;
+        }
+        if (havePrev && !s.breakBefore) {
+            QPointF a = prev;
+            QPointF b = pt;
+            if (clipSegmentY(a, b, lo, hi)) {
+                if (!penAtPrev || a != prev)
+                    path.moveTo(a);
+                path.lineTo(b);
+                penAtPrev = (b == pt);
+            } else {
+                penAtPrev = false;
+            }
+        } else {
+            penAtPrev = false;
+        }
+        prev = pt;
+        havePrev = true;
+    }
+    return path;
+}
+
 QString formatAxisTick(double v) {
     const double av = std::abs(v);
     if (!std::isfinite(v))
@@ -44,12 +144,26 @@ QString formatAxisTick(double v) {
     return QString::number(v, 'g', 4);
 }
 
+/// Drops `g` when it was built for another expression.
+GraphCurveGeometry& validCurveGeometry(GraphCurveGeometry& g, const GraphFunction& f) {
+    const QString& expression = f.isDerivativeCurve ? f.sourceExpression : f.expression;
+    if (g.expression != expression || g.derivativeCurve != f.isDerivativeCurve) {
+        g = GraphCurveGeometry();
+        g.expression = expression;
+        g.derivativeCurve = f.isDerivativeCurve;
+    }
+    return g;
+}
+
 } // namespace
 
 GraphCanvasItem::GraphCanvasItem(const QRectF& rect, QGraphicsItem* parent)
     : QGraphicsObject(parent), m_rect(0, 0, qMax(80.0, rect.width()), qMax(60.0, rect.height())) {
     setPos(rect.topLeft());
     setFlags(ItemIsSelectable | ItemIsMovable | ItemSendsGeometryChanges);
+    // Curves come from m_curveCache, so a repaint is cheap; the device cache
+    // additionally turns panning into a plain pixmap blit.
+    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
     m_data.rect = m_rect;
     m_committedPlusCount = 0;
 }
@@ -164,60 +278,44 @@ void GraphCanvasItem::requestPlusTap() {
     emit plusTapped();
 }
 
-void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidget*) {
+void paintGraphBody(QPainter* p, const QRectF& rect, const GraphObject& d, QVector<GraphCurveGeometry>* curves) {
     p->setRenderHint(QPainter::Antialiasing, true);
-    if (isSelected()) {
-        p->save();
-        p->setPen(Qt::NoPen);
-        const bool hasCurves = !m_data.functions.isEmpty();
-        const int maxLayer = hasCurves ? 2 : 1;
-        for (int layer = maxLayer; layer >= 1; --layer) {
-            const qreal d = static_cast<qreal>(layer) * 1.25;
-            const int alpha = hasCurves ? (24 - layer * 6) : 14;
-            p->setBrush(QColor(76, 58, 168, alpha));
-            p->drawRoundedRect(m_rect.translated(d, d), 8, 8);
-        }
-        p->setPen(QPen(QColor(107, 92, 230, 100), 2.0));
-        p->setBrush(Qt::NoBrush);
-        p->drawRoundedRect(m_rect.adjusted(-3, -3, 3, 3), 9, 9);
-        p->restore();
-    }
     p->setPen(QPen(QColor(98, 98, 104, 1), 1.2));
     p->setBrush(QColor(188, 190, 198, 120));
-    p->drawRoundedRect(m_rect, 8, 8);
+    p->drawRoundedRect(rect, 8, 8);
 
-    const QRectF pr = m_rect.adjusted(10, 10, -10, -10);
+    const QRectF pr = rect.adjusted(10, 10, -10, -10);
     p->setBrush(QColor(248, 248, 249, 220));
     p->setPen(QPen(QColor(20, 20, 22), 1.1));
     p->drawRect(pr);
 
-    auto mapX = [&](double x) { return pr.left() + (x - m_data.xMin) / qMax(1e-6, (m_data.xMax - m_data.xMin)) * pr.width(); };
-    auto mapY = [&](double y) { return pr.bottom() - (y - m_data.yMin) / qMax(1e-6, (m_data.yMax - m_data.yMin)) * pr.height(); };
+    auto mapX = [&](double x) { return pr.left() + (x - d.xMin) / qMax(1e-6, (d.xMax - d.xMin)) * pr.width(); };
+    auto mapY = [&](double y) { return pr.bottom() - (y - d.yMin) / qMax(1e-6, (d.yMax - d.yMin)) * pr.height(); };
 
-    const double xSpan = m_data.xMax - m_data.xMin;
-    const double ySpan = m_data.yMax - m_data.yMin;
+    const double xSpan = d.xMax - d.xMin;
+    const double ySpan = d.yMax - d.yMin;
     const int xDivsAuto = qBound(3, int(pr.width() / 48.0), 12);
     const int yDivsAuto = qBound(3, int(pr.height() / 44.0), 10);
     double xStep = niceTickStep(xSpan, xDivsAuto);
     double yStep = niceTickStep(ySpan, yDivsAuto);
-    if (m_data.xTickMode == 1 && m_data.xTickStep > 0.0)
-        xStep = m_data.xTickStep;
-    else if (m_data.xTickMode == 2) {
-        const int c = qBound(2, m_data.xTickCount, 32);
+    if (d.xTickMode == 1 && d.xTickStep > 0.0)
+        xStep = d.xTickStep;
+    else if (d.xTickMode == 2) {
+        const int c = qBound(2, d.xTickCount, 32);
         xStep = niceTickStep(xSpan, c);
     }
-    if (m_data.yTickMode == 1 && m_data.yTickStep > 0.0)
-        yStep = m_data.yTickStep;
-    else if (m_data.yTickMode == 2) {
-        const int c = qBound(2, m_data.yTickCount, 32);
+    if (d.yTickMode == 1 && d.yTickStep > 0.0)
+        yStep = d.yTickStep;
+    else if (d.yTickMode == 2) {
+        const int c = qBound(2, d.yTickCount, 32);
         yStep = niceTickStep(ySpan, c);
     }
 
     p->setPen(QPen(QColor(72, 72, 77), 1));
     if (xStep > 0 && std::isfinite(xStep)) {
-        const double xStart = std::ceil(m_data.xMin / xStep - 1e-12) * xStep;
-        for (double xv = xStart; xv <= m_data.xMax + xStep * 1e-9; xv += xStep) {
-            if (xv < m_data.xMin - 1e-12)
+        const double xStart = std::ceil(d.xMin / xStep - 1e-12) * xStep;
+        for (double xv = xStart; xv <= d.xMax + xStep * 1e-9; xv += xStep) {
+            if (xv < d.xMin - 1e-12)
                 continue;
             const qreal px = mapX(xv);
             if (px < pr.left() || px > pr.right())
@@ -227,9 +325,9 @@ void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidge
         }
     }
     if (yStep > 0 && std::isfinite(yStep)) {
-        const double yStart = std::ceil(m_data.yMin / yStep - 1e-12) * yStep;
-        for (double yv = yStart; yv <= m_data.yMax + yStep * 1e-9; yv += yStep) {
-            if (yv < m_data.yMin - 1e-12)
+        const double yStart = std::ceil(d.yMin / yStep - 1e-12) * yStep;
+        for (double yv = yStart; yv <= d.yMax + yStep * 1e-9; yv += yStep) {
+            if (yv < d.yMin - 1e-12)
                 continue;
             const qreal py = mapY(yv);
             if (py < pr.top() || py > pr.bottom())
@@ -256,9 +354,9 @@ void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidge
         constexpr qreal kTick = 5.0;
         p->setPen(QPen(QColor(12, 12, 12), 1));
         if (xStep > 0 && std::isfinite(xStep)) {
-            const double xStart = std::ceil(m_data.xMin / xStep - 1e-12) * xStep;
-            for (double xv = xStart; xv <= m_data.xMax + xStep * 1e-9; xv += xStep) {
-                if (xv < m_data.xMin - 1e-12)
+            const double xStart = std::ceil(d.xMin / xStep - 1e-12) * xStep;
+            for (double xv = xStart; xv <= d.xMax + xStep * 1e-9; xv += xStep) {
+                if (xv < d.xMin - 1e-12)
                     continue;
                 const qreal px = mapX(xv);
                 if (px < pr.left() || px > pr.right())
@@ -267,16 +365,16 @@ void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidge
                 const QString txt = formatAxisTick(xv);
                 const qreal tw = fm.horizontalAdvance(txt);
                 qreal tx = px - tw * 0.5;
-                tx = qBound(m_rect.left() + 2.0, tx, m_rect.right() - tw - 2.0);
+                tx = qBound(rect.left() + 2.0, tx, rect.right() - tw - 2.0);
                 const qreal ty = pr.bottom() + kTick + 2.0;
-                if (ty + fm.height() <= m_rect.bottom() - 1.0)
+                if (ty + fm.height() <= rect.bottom() - 1.0)
                     p->drawText(QPointF(tx, ty + fm.ascent()), txt);
             }
         }
         if (yStep > 0 && std::isfinite(yStep)) {
-            const double yStart = std::ceil(m_data.yMin / yStep - 1e-12) * yStep;
-            for (double yv = yStart; yv <= m_data.yMax + yStep * 1e-9; yv += yStep) {
-                if (yv < m_data.yMin - 1e-12)
+            const double yStart = std::ceil(d.yMin / yStep - 1e-12) * yStep;
+            for (double yv = yStart; yv <= d.yMax + yStep * 1e-9; yv += yStep) {
+                if (yv < d.yMin - 1e-12)
                     continue;
                 const qreal py = mapY(yv);
                 if (py < pr.top() || py > pr.bottom())
@@ -285,7 +383,7 @@ void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidge
                 const QString txt = formatAxisTick(yv);
                 const qreal tw = fm.horizontalAdvance(txt);
                 qreal tx = pr.left() - kTick - tw - 3.0;
-                tx = qBound(m_rect.left() + 2.0, tx, pr.left() - 2.0);
+                tx = qBound(rect.left() + 2.0, tx, pr.left() - 2.0);
                 const qreal th = fm.height();
                 p->drawText(QRectF(tx, py - th * 0.5, tw, th), Qt::AlignRight | Qt::AlignVCenter, txt);
             }
@@ -299,88 +397,73 @@ void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidge
     p->save();
     p->setClipRect(pr);
 
-    for (int i = 0; i < m_data.functions.size(); ++i) {
-        const auto& f = m_data.functions[i];
+    const qreal bandLo = pr.top() - 2.0 * pr.height();
+    const qreal bandHi = pr.bottom() + 2.0 * pr.height();
+    for (int i = 0; i < d.functions.size(); ++i) {
+        const auto& f = d.functions[i];
         if (!f.visible)
             continue;
-        const ParsedExpression expr = MathExpressionParser::parseFunctionExpression(f.isDerivativeCurve ? f.sourceExpression : f.expression);
+        const auto compiled = ExpressionCache::instance().get(f.isDerivativeCurve ? f.sourceExpression : f.expression);
+        const ParsedExpression& expr = compiled->expr;
         if (!expr.ok)
             continue;
-        const bool isActiveFn = (i == m_data.selectedFunction);
-        QPainterPath path;
-        bool started = false;
-        constexpr int N = 260;
-        for (int k = 0; k <= N; ++k) {
-            const double x = m_data.xMin + (m_data.xMax - m_data.xMin) * (static_cast<double>(k) / N);
-            const double y = f.isDerivativeCurve
-                ? NumericAnalysis::derivativeCentral(expr, x)
-                : MathEvaluator::evalAt(expr, x);
-            if (!qIsFinite(y)) {
-                started = false;
-                continue;
-            }
-            const QPointF pt(mapX(x), mapY(y));
-            if (!started) { path.moveTo(pt); started = true; }
-            else path.lineTo(pt);
+        const AdaptiveCurveSampler::BatchEval evalF = [&](const double* xs, double* ys, int n) {
+            MathEvaluator::evalMany(expr, xs, ys, static_cast<size_t>(n));
+        };
+        const AdaptiveCurveSampler::BatchEval evalDf = [&](const double* xs, double* ys, int n) {
+            sampleDerivative(*compiled, xs, ys, n);
+        };
+        GraphCurveGeometry scratch;
+        GraphCurveGeometry& g = curves ? validCurveGeometry((*curves)[i], f) : scratch;
+        if (!g.hasPath) {
+            g.path = buildCurvePath(pr, d, f.isDerivativeCurve ? evalDf : evalF);
+            g.hasPath = true;
         }
+
+        const bool isActiveFn = (i == d.selectedFunction);
         if (isActiveFn) {
             QColor glow = f.color;
             glow.setAlpha(100);
             p->setPen(QPen(glow, 7.0, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-            p->drawPath(path);
+            p->drawPath(g.path);
         }
         p->setPen(QPen(f.color, isActiveFn ? 3.4 : 1.35, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-        p->drawPath(path);
+        p->drawPath(g.path);
 
         if (f.showDerivative) {
-            p->setPen(QPen(f.color.lighter(145), 1.2, Qt::DashLine));
-            QPainterPath dPath;
-            bool dStarted = false;
-            for (int k = 0; k <= N; ++k) {
-                const double x = m_data.xMin + (m_data.xMax - m_data.xMin) * (static_cast<double>(k) / N);
-                const double y = NumericAnalysis::derivativeCentral(expr, x);
-                if (!qIsFinite(y)) {
-                    dStarted = false;
-                    continue;
-                }
-                const QPointF pt(mapX(x), mapY(y));
-                if (!dStarted) { dPath.moveTo(pt); dStarted = true; }
-                else dPath.lineTo(pt);
+            if (!g.hasDerivativePath) {
+                g.derivativePath = buildCurvePath(pr, d, evalDf);
+                g.hasDerivativePath = true;
             }
-            p->drawPath(dPath);
+            p->setPen(QPen(f.color.lighter(145), 1.2, Qt::DashLine));
+            p->drawPath(g.derivativePath);
         }
 
         if (f.showTangent) {
-            const double x0f = qBound(m_data.xMin, f.tangentX, m_data.xMax);
+            const double x0f = qBound(d.xMin, f.tangentX, d.xMax);
             const double y0f = MathEvaluator::evalAt(expr, x0f);
-            const double mf = NumericAnalysis::derivativeCentral(expr, x0f);
+            const double mf = derivativeAt(*compiled, x0f);
             if (qIsFinite(y0f) && qIsFinite(mf)) {
-                p->setPen(QPen(f.color.darker(110), 1.1, Qt::DashDotLine));
-                QPainterPath tPath;
-                bool tStarted = false;
-                for (int k = 0; k <= N; ++k) {
-                    const double x = m_data.xMin + (m_data.xMax - m_data.xMin) * (static_cast<double>(k) / N);
-                    const double y = y0f + mf * (x - x0f);
-                    if (!qIsFinite(y)) {
-                        tStarted = false;
-                        continue;
-                    }
-                    const QPointF pt(mapX(x), mapY(y));
-                    if (!tStarted) { tPath.moveTo(pt); tStarted = true; }
-                    else tPath.lineTo(pt);
+                QPointF a(mapX(d.xMin), mapY(y0f + mf * (d.xMin - x0f)));
+                QPointF b(mapX(d.xMax), mapY(y0f + mf * (d.xMax - x0f)));
+                if (qIsFinite(a.y()) && qIsFinite(b.y()) && clipSegmentY(a, b, bandLo, bandHi)) {
+                    p->setPen(QPen(f.color.darker(110), 1.1, Qt::DashDotLine));
+                    p->drawLine(a, b);
                 }
-                p->drawPath(tPath);
                 p->setPen(Qt::NoPen);
                 p->setBrush(f.color.darker(120));
                 p->drawEllipse(QPointF(mapX(x0f), mapY(y0f)), 2.7, 2.7);
             }
         }
 
-        if (f.showRoots || i == m_data.selectedFunction) {
+        if (f.showRoots || i == d.selectedFunction) {
             const QColor rootColor = f.rootMarkerColor;
-            const QVector<double> roots = NumericAnalysis::findRootsBisection(expr, m_data.xMin, m_data.xMax, 300);
-            const bool selected = (i == m_data.selectedFunction);
-            for (double rx : roots) {
+            if (!g.hasRoots) {
+                g.roots = NumericAnalysis::findRootsBisection(expr, d.xMin, d.xMax, kRootSamples);
+                g.hasRoots = true;
+            }
+            const bool selected = (i == d.selectedFunction);
+            for (double rx : g.roots) {
                 const QPointF c(mapX(rx), mapY(0.0));
                 if (selected) {
                     p->setPen(QPen(QColor(255, 255, 255, 230), 2.0));
@@ -403,19 +486,44 @@ void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidge
         }
 
         if (f.showExtrema) {
-            p->setPen(Qt::NoPen);
-            const QColor extColor = f.extremaMarkerColor;
-            p->setBrush(extColor);
-            const QVector<double> ex = NumericAnalysis::findExtrema(expr, m_data.xMin, m_data.xMax, 300);
-            for (double exx : ex) {
-                const double y = MathEvaluator::evalAt(expr, exx);
-                if (!qIsFinite(y))
-                    continue;
-                p->drawEllipse(QPointF(mapX(exx), mapY(y)), 2.8, 2.8);
+            if (!g.hasExtrema) {
+                g.extrema.clear();
+                for (double exx : NumericAnalysis::findExtrema(expr, d.xMin, d.xMax, kExtremaSamples)) {
+                    const double y = MathEvaluator::evalAt(expr, exx);
+                    if (qIsFinite(y))
+                        g.extrema.push_back(QPointF(exx, y));
+                }
+                g.hasExtrema = true;
             }
+            p->setPen(Qt::NoPen);
+            p->setBrush(f.extremaMarkerColor);
+            for (const QPointF& e : g.extrema)
+                p->drawEllipse(QPointF(mapX(e.x()), mapY(e.y())), 2.8, 2.8);
         }
     }
     p->restore();
+}
+
+void GraphCanvasItem::paint(QPainter* p, const QStyleOptionGraphicsItem*, QWidget*) {
+    p->setRenderHint(QPainter::Antialiasing, true);
+    if (isSelected()) {
+        p->save();
+        p->setPen(Qt::NoPen);
+        const bool hasCurves = !m_data.functions.isEmpty();
+        const int maxLayer = hasCurves ? 2 : 1;
+        for (int layer = maxLayer; layer >= 1; --layer) {
+            const qreal d = static_cast<qreal>(layer) * 1.25;
+            const int alpha = hasCurves ? (24 - layer * 6) : 14;
+            p->setBrush(QColor(76, 58, 168, alpha));
+            p->drawRoundedRect(m_rect.translated(d, d), 8, 8);
+        }
+        p->setPen(QPen(QColor(107, 92, 230, 100), 2.0));
+        p->setBrush(Qt::NoBrush);
+        p->drawRoundedRect(m_rect.adjusted(-3, -3, 3, 3), 9, 9);
+        p->restore();
+    }
+    syncCurveGeometryView();
+    paintGraphBody(p, m_rect, m_data, &m_curveCache);
 
     if (!m_plusSuppressed) {
         const QRectF plusRect = plusButtonLocalRect();
@@ -494,10 +602,32 @@ QVector<double> GraphCanvasItem::selectedRoots() const {
     const auto &f = m_data.functions[m_data.selectedFunction];
     if (f.isDerivativeCurve)
         return {};
-    const ParsedExpression expr = MathExpressionParser::parseFunctionExpression(f.expression);
-    if (!expr.ok)
-        return {};
-    return NumericAnalysis::findRootsBisection(expr, m_data.xMin, m_data.xMax, 360);
+    CurveGeometry &g = curveGeometry(m_data.selectedFunction);
+    if (!g.hasRoots) {
+        const auto compiled = ExpressionCache::instance().get(f.expression);
+        if (!compiled->expr.ok)
+            return {};
+        g.roots = NumericAnalysis::findRootsBisection(compiled->expr, m_data.xMin, m_data.xMax, kRootSamples);
+        g.hasRoots = true;
+    }
+    return g.roots;
+}
+
+void GraphCanvasItem::syncCurveGeometryView() const {
+    const QRectF pr = plotAreaLocalRect();
+    const double range[4] = {m_data.xMin, m_data.xMax, m_data.yMin, m_data.yMax};
+    if (pr != m_curveCachePlotRect || !std::equal(range, range + 4, m_curveCacheRange)) {
+        m_curveCache.clear();
+        m_curveCachePlotRect = pr;
+        std::copy(range, range + 4, m_curveCacheRange);
+    }
+    if (m_curveCache.size() != m_data.functions.size())
+        m_curveCache.resize(m_data.functions.size());
+}
+
+GraphCurveGeometry& GraphCanvasItem::curveGeometry(int index) const {
+    syncCurveGeometryView();
+    return validCurveGeometry(m_curveCache[index], m_data.functions[index]);
 }
 
 int GraphCanvasItem::hitRootHandleAtScene(const QPointF &scenePos, double *outRootX) const {
@@ -550,8 +680,8 @@ int GraphCanvasItem::nearestFunctionAtScenePos(const QPointF& scenePos, qreal* o
         const auto& f = m_data.functions[i];
         if (!f.visible)
             continue;
-        const ParsedExpression expr = MathExpressionParser::parseFunctionExpression(f.isDerivativeCurve ? f.sourceExpression : f.expression);
-        if (!expr.ok)
+        const auto compiled = ExpressionCache::instance().get(f.isDerivativeCurve ? f.sourceExpression : f.expression);
+        if (!compiled->expr.ok)
             continue;
         qreal fnBest = 1e9;
         for (qreal dx : kSampleDx) {
@@ -560,8 +690,8 @@ int GraphCanvasItem::nearestFunctionAtScenePos(const QPointF& scenePos, qreal* o
                 continue;
             const double x = m_data.xMin + (lx - pr.left()) * invW * xSpan;
             const double y = f.isDerivativeCurve
-                ? NumericAnalysis::derivativeCentral(expr, x)
-                : MathEvaluator::evalAt(expr, x);
+                ? derivativeAt(*compiled, x)
+                : MathEvaluator::evalAt(compiled->expr, x);
             if (!qIsFinite(y))
                 continue;
             const QPointF onCurve = mapToLocalPlot(x, y);
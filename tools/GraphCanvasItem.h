@@ -3,6 +3,30 @@
 #include "Note.h"
 #include <QElapsedTimer>
 #include <QGraphicsObject>
+#include <QPainterPath>
+
+/// Per-function plot geometry in local coordinates. Rebuilt only when the
+/// expression, the axis ranges or the plot size change, so repaints (pan,
+/// selection, hover) just stroke the cached paths.
+struct GraphCurveGeometry {
+    QString expression;
+    bool derivativeCurve{false};
+    bool hasPath{false};
+    QPainterPath path;
+    bool hasDerivativePath{false};
+    QPainterPath derivativePath;
+    bool hasRoots{false};
+    QVector<double> roots;
+    bool hasExtrema{false};
+    QVector<QPointF> extrema; ///< data coordinates
+};
+
+/// Frame, grid, ticks and curves of `d` with the frame at `rect` (local
+/// coordinates). Plain data only, so the PDF export draws graphs off the GUI
+/// thread with the editor's look. `curves` holds one entry per function for the
+/// current plot view, or is null to sample from scratch.
+void paintGraphBody(QPainter* p, const QRectF& rect, const GraphObject& d,
+                    QVector<GraphCurveGeometry>* curves = nullptr);
 
 class GraphCanvasItem : public QGraphicsObject {
     Q_OBJECT
@@ -85,6 +109,13 @@ private:
     QVector<double> selectedRoots() const;
     void applyMovedRoot(double oldX, double newX);
 
+    GraphCurveGeometry& curveGeometry(int index) const;
+    void syncCurveGeometryView() const;
+
+    mutable QVector<GraphCurveGeometry> m_curveCache;
+    mutable QRectF m_curveCachePlotRect;
+    mutable double m_curveCacheRange[4]{0.0, 0.0, 0.0, 0.0};
+
     QRectF m_rect{0, 0, 280, 180};
     GraphObject m_data;
     int m_committedPlusCount{0};
@@ -6,6 +6,7 @@
 #include <QPainterPath>
 #include <QTransform>
 #include "ToolManager.h"
+#include "StrokeSpatialIndex.h"
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsItem>
 #include <QObject>
@@ -90,7 +91,30 @@ public:
 
         auto selectionMode = Qt::IntersectsItemShape;
 
-        scene->setSelectionArea(m_currentPath, Qt::ReplaceSelection, selectionMode, QTransform());
+        if (StrokeSpatialIndex* index = StrokeSpatialIndex::forScene(scene)) {
+            // Striche über den Index (nur die Chunks im Lasso), alles andere
+            // (Graphen, Zettel, Text, Bilder) wie bisher über die Szene.
+            // Signale gebündelt: ein selectionChanged statt einem pro Item.
+            const bool wasBlocked = scene->blockSignals(true);
+            scene->clearSelection();
+            // Striche ohne eigenes Item (Seiten-Tinte) werden erst zu Items.
+            index->promote(m_currentPath);
+            for (QGraphicsPathItem* item : index->hitByArea(m_currentPath)) {
+                if (item->flags() & QGraphicsItem::ItemIsSelectable)
+                    item->setSelected(true);
+            }
+            for (QGraphicsItem* item : scene->items(m_currentPath.boundingRect(), Qt::IntersectsItemBoundingRect)) {
+                if (item == m_selectionItem || index->contains(item) ||
+                    !(item->flags() & QGraphicsItem::ItemIsSelectable))
+                    continue;
+                if (item->collidesWithPath(item->mapFromScene(m_currentPath), selectionMode))
+                    item->setSelected(true);
+            }
+            scene->blockSignals(wasBlocked);
+            emit scene->selectionChanged();
+        } else {
+            scene->setSelectionArea(m_currentPath, Qt::ReplaceSelection, selectionMode, QTransform());
+        }
 
         for (QGraphicsItem* item : scene->selectedItems()) {
             if (item->type() == RulerItem::Type) {
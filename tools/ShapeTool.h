@@ -1,6 +1,7 @@
 #pragma once
 #include "AbstractTool.h"
 #include "GraphCanvasItem.h"
+#include "StrokeSpatialIndex.h"
 #include "ToolManager.h"
 #include <QElapsedTimer>
 #include <QGraphicsPathItem>
@@ -267,6 +268,9 @@ public:
                     graphItem->setZValue(4.0);
                     scene->addItem(graphItem);
                     m_lastCompletedItem = graphItem;
+                } else if (auto* index = StrokeSpatialIndex::forScene(scene)) {
+                    // Formen bleiben radier- und lassobar (ohne Seite).
+                    index->insert(static_cast<QGraphicsPathItem*>(m_currentShape));
                 }
                 emit contentModified();
             }
@@ -1,4 +1,5 @@
 #pragma once
+#include "strokegeometry.h"
 #include <QGraphicsPathItem>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
@@ -17,6 +18,10 @@ public:
     enum StrokeStyle { Normal, Highlighter, Eraser };
 
     StrokeItem(QPainterPath path, QPen pen, const QVector<StrokePoint>& points = QVector<StrokePoint>(), StrokeStyle style = Normal)
+        : StrokeItem(path, pen, encode(points), style) {}
+
+    /// Shares `points` with the model stroke it shows (no copy).
+    StrokeItem(QPainterPath path, QPen pen, const StrokePoints& points, StrokeStyle style = Normal)
         : QGraphicsPathItem(path), m_points(points), m_style(style)
     {
         setPen(pen);
@@ -29,14 +34,32 @@ public:
     }
     
     void addPoint(const StrokePoint& p) {
-        m_points.append(p);
+        m_points.append(p.pos, p.pressure);
+        m_outline = QPainterPath();
     }
     
     void setPoints(const QVector<StrokePoint>& points) {
-        m_points = points;
+        m_points = encode(points);
+        m_outline = QPainterPath();
+    }
+
+    /// Outline already built for these points and the pen width
+    /// (StrokeGeometry::outline()), so the first paint does not rebuild it.
+    void setOutline(const QPainterPath& outline) {
+        m_outline = outline;
+        m_outlineWidth = pen().widthF();
     }
     
+    /// Decoded copy; strokePoints() is the stored form.
     QVector<StrokePoint> points() const {
+        QVector<StrokePoint> out;
+        out.reserve(m_points.size());
+        for (auto it = m_points.begin(); it != m_points.end(); ++it)
+            out.append({*it, it.pressure()});
+        return out;
+    }
+
+    const StrokePoints& strokePoints() const {
         return m_points;
     }
 
@@ -53,30 +76,11 @@ public:
         }
 
         if (!m_points.isEmpty() && m_points.size() > 1 && m_style != Highlighter) {
-            // v119 perf: reuse a single QPen across all segments instead
-            // of constructing a fresh pen per segment. setWidthF mutates
-            // the existing pen in-place; the painter only needs to be
-            // re-set when the width actually changes (cuts allocations
-            // and unnecessary state changes by ~Nx for an N-segment
-            // pressure stroke).
-            QPen segPen = pen();
-            const qreal baseWidth = segPen.widthF();
-            qreal lastWidth = -1.0;
-            for (int i = 0; i < m_points.size() - 1; ++i) {
-                const StrokePoint& p1 = m_points[i];
-                const StrokePoint& p2 = m_points[i+1];
-
-                // Pressure usually 0.0 to 1.0. Wir cappen bei 0.1, damit es nicht unsichtbar wird.
-                qreal avgPressure = (p1.pressure + p2.pressure) / 2.0;
-                qreal w = baseWidth * qMax(0.1, avgPressure);
-
-                if (w != lastWidth) {
-                    segPen.setWidthF(w);
-                    painter->setPen(segPen);
-                    lastWidth = w;
-                }
-                painter->drawLine(p1.pos, p2.pos);
-            }
+            // Pressure ink is one filled outline, built once per geometry
+            // and pen width instead of a drawLine per segment and repaint.
+            if (m_outline.isEmpty() || m_outlineWidth != pen().widthF())
+                rebuildOutline();
+            painter->fillPath(m_outline, pen().brush());
         } else {
             QStyleOptionGraphicsItem opt = *option;
             opt.state &= ~(QStyle::State_Selected | QStyle::State_HasFocus);
@@ -85,6 +89,26 @@ public:
     }
 
 private:
-    QVector<StrokePoint> m_points;
+    static StrokePoints encode(const QVector<StrokePoint>& points) {
+        StrokePoints out;
+        out.reserve(int(points.size()));
+        for (const StrokePoint& p : points)
+            out.append(p.pos, p.pressure);
+        return out;
+    }
+
+    void rebuildOutline() {
+        const QVector<QPointF> pos = m_points.points();
+        QVector<qreal> pressures = m_points.pressures();
+        if (pressures.isEmpty())
+            pressures.fill(1.0, pos.size());
+        m_outlineWidth = pen().widthF();
+        m_outline = StrokeGeometry::pressureOutline(pos.constData(), pressures.constData(),
+                                                    int(pos.size()), m_outlineWidth);
+    }
+
+    StrokePoints m_points;
     StrokeStyle m_style;
+    QPainterPath m_outline; ///< empty = stale
+    qreal m_outlineWidth{0.0};
 };
@@ -0,0 +1,399 @@
+#include "StrokeSpatialIndex.h"
+#include "StrokeItem.h"
+
+#include <QGraphicsPathItem>
+#include <QGraphicsScene>
+#include <QLineF>
+#include <QPainterPath>
+#include <QRect>
+#include <QSet>
+#include <QTransform>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr qreal kCellSize = 64.0;
+/// Path elements per chunk. Neighbouring chunks share one element so the
+/// joining segment is covered by both.
+constexpr int kChunkElements = 16;
+/// Items spanning more cells than this stay out of the grid.
+constexpr int kMaxCellsPerItem = 4096;
+
+QHash<const QGraphicsScene*, StrokeSpatialIndex*>& registry() {
+    static QHash<const QGraphicsScene*, StrokeSpatialIndex*> indexes;
+    return indexes;
+}
+
+QRect cellSpan(const QRectF& r) {
+    return QRect(QPoint(int(std::floor(r.left() / kCellSize)), int(std::floor(r.top() / kCellSize))),
+                 QPoint(int(std::floor(r.right() / kCellSize)), int(std::floor(r.bottom() / kCellSize))));
+}
+
+quint64 cellKey(int cx, int cy) {
+    return (quint64(quint32(cy)) << 32) | quint32(cx);
+}
+
+bool isFilled(const QGraphicsPathItem* item) {
+    // Pixel-erased strokes become outlines with a brush and no pen.
+    return item->pen().style() == Qt::NoPen || item->brush().style() != Qt::NoBrush;
+}
+
+qreal halfPenWidth(const QGraphicsPathItem* item, const QTransform& xf) {
+    const QPen pen = item->pen();
+    if (pen.style() == Qt::NoPen)
+        return 0.0;
+    const qreal w = qMax<qreal>(1.0, pen.widthF());
+    return 0.5 * (pen.isCosmetic() ? w : w * std::sqrt(qAbs(xf.determinant())));
+}
+
+QPointF elementPoint(const QPainterPath& path, int i, const QTransform& xf) {
+    const QPainterPath::Element& el = path.elementAt(i);
+    return xf.map(QPointF(el.x, el.y));
+}
+
+qreal segmentDistance(const QPointF& p, const QPointF& a, const QPointF& b) {
+    const QPointF ab = b - a;
+    const qreal len2 = QPointF::dotProduct(ab, ab);
+    const qreal t = len2 > 0.0 ? qBound(0.0, QPointF::dotProduct(p - a, ab) / len2, 1.0) : 0.0;
+    return QLineF(p, a + ab * t).length();
+}
+
+} // namespace
+
+StrokeSpatialIndex::StrokeSpatialIndex(QGraphicsScene* scene) : m_scene(scene) {
+    if (m_scene)
+        registry().insert(m_scene, this);
+}
+
+StrokeSpatialIndex::~StrokeSpatialIndex() {
+    if (m_scene && registry().value(m_scene) == this)
+        registry().remove(m_scene);
+}
+
+StrokeSpatialIndex* StrokeSpatialIndex::forScene(const QGraphicsScene* scene) {
+    return scene ? registry().value(scene, nullptr) : nullptr;
+}
+
+void StrokeSpatialIndex::buildChunks(Entry& e) {
+    e.chunks.clear();
+    e.bounds = QRectF();
+    const QPainterPath path = e.item->path();
+    const int n = path.elementCount();
+    e.filled = isFilled(e.item);
+    if (n == 0)
+        return;
+    const QTransform xf = e.item->sceneTransform();
+    const qreal pad = halfPenWidth(e.item, xf) + 1.0;
+    if (e.filled) {
+        // Inside of an outline is not near any of its elements: one box.
+        e.bounds = xf.mapRect(path.boundingRect()).adjusted(-pad, -pad, pad, pad);
+        e.chunks.append(e.bounds);
+        return;
+    }
+    e.chunks.reserve(n / kChunkElements + 1);
+    for (int start = 0;; start += kChunkElements) {
+        const int end = qMin(n, start + kChunkElements + 1);
+        QPointF p = elementPoint(path, start, xf);
+        qreal x0 = p.x(), x1 = p.x(), y0 = p.y(), y1 = p.y();
+        for (int i = start + 1; i < end; ++i) {
+            p = elementPoint(path, i, xf);
+            x0 = qMin(x0, p.x());
+            x1 = qMax(x1, p.x());
+            y0 = qMin(y0, p.y());
+            y1 = qMax(y1, p.y());
+        }
+        const QRectF box = QRectF(QPointF(x0, y0), QPointF(x1, y1)).adjusted(-pad, -pad, pad, pad);
+        e.chunks.append(box);
+        e.bounds = e.bounds.isNull() ? box : e.bounds.united(box);
+        if (end >= n)
+            break;
+    }
+}
+
+void StrokeSpatialIndex::link(Entry& e) {
+    int cells = 0;
+    for (const QRectF& c : std::as_const(e.chunks)) {
+        const QRect span = cellSpan(c);
+        cells += span.width() * span.height();
+    }
+    e.loose = e.isVolatile || cells > kMaxCellsPerItem;
+    if (e.loose) {
+        m_loose.append(&e);
+        return;
+    }
+    Page& page = m_pages[e.page];
+    page.bounds = page.bounds.isNull() ? e.bounds : page.bounds.united(e.bounds);
+    for (int k = 0; k < e.chunks.size(); ++k) {
+        const QRect span = cellSpan(e.chunks[k]);
+        for (int cy = span.top(); cy <= span.bottom(); ++cy) {
+            for (int cx = span.left(); cx <= span.right(); ++cx)
+                page.cells[cellKey(cx, cy)].append({&e, k});
+        }
+    }
+}
+
+void StrokeSpatialIndex::unlink(Entry& e) {
+    if (e.loose) {
+        m_loose.removeOne(&e);
+        e.loose = false;
+        return;
+    }
+    auto pageIt = m_pages.find(e.page);
+    if (pageIt == m_pages.end())
+        return;
+    QHash<quint64, QVector<Ref>>& cells = pageIt->cells;
+    for (const QRectF& c : std::as_const(e.chunks)) {
+        const QRect span = cellSpan(c);
+        for (int cy = span.top(); cy <= span.bottom(); ++cy) {
+            for (int cx = span.left(); cx <= span.right(); ++cx) {
+                auto cell = cells.find(cellKey(cx, cy));
+                if (cell == cells.end())
+                    continue;
+                cell->removeIf([&e](const Ref& r) { return r.entry == &e; });
+                if (cell->isEmpty())
+                    cells.erase(cell);
+            }
+        }
+    }
+    if (cells.isEmpty())
+        m_pages.erase(pageIt);
+}
+
+void StrokeSpatialIndex::insert(QGraphicsPathItem* item, int page) {
+    if (!item)
+        return;
+    remove(item);
+    auto entry = std::make_unique<Entry>();
+    entry->item = item;
+    entry->page = page;
+    buildChunks(*entry);
+    link(*entry);
+    m_entries.emplace(item, std::move(entry));
+}
+
+void StrokeSpatialIndex::remove(const QGraphicsItem* item) {
+    m_pending.removeIf([item](const StrokeItem* p) { return static_cast<const QGraphicsItem*>(p) == item; });
+    auto it = m_entries.find(item);
+    if (it == m_entries.end())
+        return;
+    unlink(*it->second);
+    m_entries.erase(it);
+}
+
+void StrokeSpatialIndex::update(QGraphicsPathItem* item) {
+    auto it = m_entries.find(item);
+    if (it == m_entries.end())
+        return;
+    Entry& e = *it->second;
+    unlink(e);
+    buildChunks(e);
+    link(e);
+}
+
+bool StrokeSpatialIndex::contains(const QGraphicsItem* item) const {
+    return m_entries.find(item) != m_entries.end();
+}
+
+int StrokeSpatialIndex::pageOf(const QGraphicsItem* item) const {
+    const auto it = m_entries.find(item);
+    return it != m_entries.end() ? it->second->page : -1;
+}
+
+QList<QGraphicsPathItem*> StrokeSpatialIndex::itemsOnPage(int page) const {
+    QList<QGraphicsPathItem*> out;
+    if (page < 0)
+        return out;
+    for (const auto& kv : m_entries) {
+        if (kv.second->page == page)
+            out.append(kv.second->item);
+    }
+    return out;
+}
+
+bool StrokeSpatialIndex::chunkRange(const QGraphicsItem* item, const QRectF& sceneRect, int* first,
+                                    int* last) const {
+    const auto it = m_entries.find(item);
+    if (it == m_entries.end() || it->second->filled || it->second->isVolatile)
+        return false;
+    const QVector<QRectF>& chunks = it->second->chunks;
+    int lo = -1;
+    int hi = -1;
+    for (int k = 0; k < chunks.size(); ++k) {
+        if (!chunks[k].intersects(sceneRect))
+            continue;
+        if (lo < 0)
+            lo = k;
+        hi = k;
+    }
+    if (lo < 0)
+        return false;
+    *first = lo * kChunkElements;
+    *last = hi * kChunkElements + kChunkElements;
+    return true;
+}
+
+void StrokeSpatialIndex::clear() {
+    m_pages.clear();
+    m_loose.clear();
+    m_entries.clear();
+    m_pending.clear();
+}
+
+QList<QGraphicsPathItem*> StrokeSpatialIndex::query(const QRectF& sceneRect) const {
+    QList<QGraphicsPathItem*> out;
+    if (!sceneRect.isValid())
+        return out;
+    if (++m_mark == 0) {
+        for (const auto& kv : m_entries)
+            kv.second->mark = 0;
+        m_mark = 1;
+    }
+    for (auto pageIt = m_pages.cbegin(); pageIt != m_pages.cend(); ++pageIt) {
+        if (!pageIt->bounds.intersects(sceneRect))
+            continue;
+        const QRect span = cellSpan(sceneRect.intersected(pageIt->bounds));
+        const QHash<quint64, QVector<Ref>>& cells = pageIt->cells;
+        for (int cy = span.top(); cy <= span.bottom(); ++cy) {
+            for (int cx = span.left(); cx <= span.right(); ++cx) {
+                const auto cell = cells.constFind(cellKey(cx, cy));
+                if (cell == cells.cend())
+                    continue;
+                for (const Ref& r : *cell) {
+                    if (r.entry->mark == m_mark || !r.entry->chunks[r.chunk].intersects(sceneRect))
+                        continue;
+                    r.entry->mark = m_mark;
+                    out.append(r.entry->item);
+                }
+            }
+        }
+    }
+    for (const Entry* e : m_loose) {
+        if (e->item->sceneBoundingRect().intersects(sceneRect))
+            out.append(e->item);
+    }
+    return out;
+}
+
+bool StrokeSpatialIndex::discHits(const Entry& e, const QPointF& center, qreal radius) const {
+    if (e.filled || e.isVolatile) {
+        QPainterPath disc;
+        disc.addEllipse(center, radius, radius);
+        return e.item->shape().intersects(e.item->mapFromScene(disc));
+    }
+    const QPainterPath path = e.item->path();
+    const int n = path.elementCount();
+    if (n == 0)
+        return false;
+    const QTransform xf = e.item->sceneTransform();
+    const qreal reach = radius + halfPenWidth(e.item, xf);
+    const QRectF box(center.x() - reach, center.y() - reach, 2 * reach, 2 * reach);
+    if (n == 1)
+        return QLineF(center, elementPoint(path, 0, xf)).length() <= reach;
+    // Only the chunks near the pointer; control points count as polyline
+    // vertices, which is what the pen tools produce anyway.
+    for (int k = 0; k < e.chunks.size(); ++k) {
+        if (!e.chunks[k].intersects(box))
+            continue;
+        const int start = k * kChunkElements;
+        const int end = qMin(n, start + kChunkElements + 1);
+        QPointF prev = elementPoint(path, start, xf);
+        for (int i = start + 1; i < end; ++i) {
+            const QPointF cur = elementPoint(path, i, xf);
+            if (!path.elementAt(i).isMoveTo() && segmentDistance(center, prev, cur) <= reach)
+                return true;
+            prev = cur;
+        }
+    }
+    return false;
+}
+
+bool StrokeSpatialIndex::areaHits(const Entry& e, const QPainterPath& area) const {
+    if (e.filled || e.isVolatile)
+        return area.intersects(e.item->mapToScene(e.item->shape()));
+    const QPainterPath path = e.item->path();
+    const int n = path.elementCount();
+    const QTransform xf = e.item->sceneTransform();
+    bool touched = false;
+    for (int k = 0; k < e.chunks.size(); ++k) {
+        if (!area.intersects(e.chunks[k]))
+            continue;
+        touched = true;
+        const int start = k * kChunkElements;
+        const int end = qMin(n, start + kChunkElements + 1);
+        for (int i = start; i < end; ++i) {
+            if (area.contains(elementPoint(path, i, xf)))
+                return true;
+        }
+    }
+    // Crosses the lasso without a vertex inside: exact test, rare.
+    return touched && area.intersects(e.item->mapToScene(e.item->shape()));
+}
+
+QList<QGraphicsPathItem*> StrokeSpatialIndex::hitByDisc(const QPointF& center, qreal radius) const {
+    QList<QGraphicsPathItem*> hits;
+    const QRectF box(center.x() - radius, center.y() - radius, 2 * radius, 2 * radius);
+    for (QGraphicsPathItem* item : query(box)) {
+        const auto it = m_entries.find(item);
+        if (it != m_entries.end() && discHits(*it->second, center, radius))
+            hits.append(item);
+    }
+    return hits;
+}
+
+QList<QGraphicsPathItem*> StrokeSpatialIndex::hitByArea(const QPainterPath& sceneArea) const {
+    QList<QGraphicsPathItem*> hits;
+    for (QGraphicsPathItem* item : query(sceneArea.boundingRect())) {
+        const auto it = m_entries.find(item);
+        if (it != m_entries.end() && areaHits(*it->second, sceneArea))
+            hits.append(item);
+    }
+    return hits;
+}
+
+void StrokeSpatialIndex::setVolatile(const QList<QGraphicsItem*>& selected) {
+    QSet<Entry*> next;
+    for (QGraphicsItem* item : selected) {
+        const auto it = m_entries.find(item);
+        if (it != m_entries.end())
+            next.insert(it->second.get());
+    }
+    // Back into the grid at their current geometry.
+    const QVector<Entry*> loose = m_loose;
+    for (Entry* e : loose) {
+        if (!e->isVolatile || next.contains(e))
+            continue;
+        unlink(*e);
+        e->isVolatile = false;
+        buildChunks(*e);
+        link(*e);
+    }
+    for (Entry* e : std::as_const(next)) {
+        if (e->isVolatile)
+            continue;
+        unlink(*e);
+        e->isVolatile = true;
+        link(*e);
+    }
+}
+
+bool StrokeSpatialIndex::eraseThroughModel(const QPointF& center, qreal radius, bool wholeStrokes) const {
+    if (!m_eraseHandler)
+        return false;
+    m_eraseHandler(center, radius, wholeStrokes);
+    return true;
+}
+
+void StrokeSpatialIndex::promote(const QPainterPath& sceneArea) const {
+    if (m_promoteHandler)
+        m_promoteHandler(sceneArea);
+}
+
+void StrokeSpatialIndex::addPending(StrokeItem* item) {
+    if (item && !m_pending.contains(item))
+        m_pending.append(item);
+}
+
+QList<StrokeItem*> StrokeSpatialIndex::takePending() {
+    return std::exchange(m_pending, {});
+}
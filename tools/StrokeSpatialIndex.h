@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+#include <QtGlobal>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+class QGraphicsItem;
+class QGraphicsPathItem;
+class QGraphicsScene;
+class QPainterPath;
+class StrokeItem;
+
+/// Uniform-grid index over the committed stroke items of one scene,
+/// bucketed per page. Every item is entered as chunks of consecutive path
+/// elements (scene-space boxes padded by half the pen width), so a query
+/// near the pointer only touches strokes that really pass close by -- not
+/// every long stroke whose bounding box happens to cover the spot.
+///
+/// The index registers itself for its scene; tools look it up through
+/// forScene() and keep their plain scene queries where there is none.
+/// Selected items can be dragged or transformed by Qt at any time, so they
+/// are kept out of the grid and tested by their live bounds until the
+/// selection changes again (setVolatile()).
+///
+/// GUI thread only. Items must be remove()d before they are deleted.
+class StrokeSpatialIndex {
+public:
+    explicit StrokeSpatialIndex(QGraphicsScene* scene);
+    ~StrokeSpatialIndex();
+    StrokeSpatialIndex(const StrokeSpatialIndex&) = delete;
+    StrokeSpatialIndex& operator=(const StrokeSpatialIndex&) = delete;
+
+    static StrokeSpatialIndex* forScene(const QGraphicsScene* scene);
+
+    /// `item` is in the scene at its final position. page < 0: items that
+    /// belong to no page (shapes), kept in a bucket of their own.
+    void insert(QGraphicsPathItem* item, int page = -1);
+    /// Never dereferences `item`; safe right before `delete item`.
+    void remove(const QGraphicsItem* item);
+    /// Re-enters `item` after setPath()/setPen()/setBrush() or a move.
+    void update(QGraphicsPathItem* item);
+    bool contains(const QGraphicsItem* item) const;
+    /// Page given to insert(); -1 for loose items and unknown ones.
+    int pageOf(const QGraphicsItem* item) const;
+    /// Every item entered with `page` (page >= 0).
+    QList<QGraphicsPathItem*> itemsOnPage(int page) const;
+    /// Path element range [*first, *last] of the chunks of `item` that touch
+    /// `sceneRect`. false when none does (or for volatile/filled items).
+    bool chunkRange(const QGraphicsItem* item, const QRectF& sceneRect, int* first, int* last) const;
+    /// Drops everything, including pending items (scene is being cleared).
+    void clear();
+    int size() const { return int(m_entries.size()); }
+
+    /// Candidates whose chunks touch `sceneRect`; callers do the exact test.
+    QList<QGraphicsPathItem*> query(const QRectF& sceneRect) const;
+    /// Items whose ink comes within `radius` of `center` (eraser).
+    QList<QGraphicsPathItem*> hitByDisc(const QPointF& center, qreal radius) const;
+    /// Items whose shape intersects `sceneArea` (lasso), like
+    /// Qt::IntersectsItemShape but without a stroker run per item.
+    QList<QGraphicsPathItem*> hitByArea(const QPainterPath& sceneArea) const;
+
+    /// Items of `selected` leave the grid; the previous ones are re-entered
+    /// at wherever they were moved to.
+    void setVolatile(const QList<QGraphicsItem*>& selected);
+
+    /// Scenes whose strokes mirror a model (MultiPageNoteView) erase there:
+    /// the handler cuts the stroke data and swaps the items itself.
+    using EraseHandler = std::function<void(const QPointF& center, qreal radius, bool wholeStrokes)>;
+    void setEraseHandler(EraseHandler handler) { m_eraseHandler = std::move(handler); }
+    /// false: no handler, the caller erases scene items itself.
+    bool eraseThroughModel(const QPointF& center, qreal radius, bool wholeStrokes) const;
+
+    /// Such scenes keep no item per stroke either: the handler turns the
+    /// strokes inside `sceneArea` into indexed items, so the lasso can select
+    /// them like any other.
+    using PromoteHandler = std::function<void(const QPainterPath& sceneArea)>;
+    void setPromoteHandler(PromoteHandler handler) { m_promoteHandler = std::move(handler); }
+    void promote(const QPainterPath& sceneArea) const;
+
+    /// Live strokes of the drawing tools, not indexed yet. The view takes
+    /// them on pen-up instead of scanning the whole scene for them.
+    void addPending(StrokeItem* item);
+    QList<StrokeItem*> takePending();
+
+private:
+    struct Entry {
+        QGraphicsPathItem* item{nullptr};
+        int page{-1};
+        bool filled{false};
+        bool loose{false};      ///< not in the grid: volatile or oversized
+        bool isVolatile{false};
+        QRectF bounds;
+        QVector<QRectF> chunks; ///< chunk k covers elements [k*K, k*K+K]
+        mutable quint32 mark{0};
+    };
+    struct Ref {
+        Entry* entry;
+        int chunk;
+    };
+    struct Page {
+        QRectF bounds;          ///< grows only; cleared with the page
+        QHash<quint64, QVector<Ref>> cells;
+    };
+
+    static void buildChunks(Entry& e);
+    void link(Entry& e);
+    void unlink(Entry& e);
+    bool discHits(const Entry& e, const QPointF& center, qreal radius) const;
+    bool areaHits(const Entry& e, const QPainterPath& area) const;
+
+    const QGraphicsScene* m_scene;
+    std::unordered_map<const QGraphicsItem*, std::unique_ptr<Entry>> m_entries;
+    QHash<int, Page> m_pages;
+    QVector<Entry*> m_loose;
+    QList<StrokeItem*> m_pending;
+    EraseHandler m_eraseHandler;
+    PromoteHandler m_promoteHandler;
+    mutable quint32 m_mark{0};
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QPointF>
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+
+/// One raw pen sample as the tablet delivered it.
+struct TabletSample {
+    QPointF pos;          ///< scene coordinates, mapped when the sample is captured
+    qreal pressure{1.0};
+    qreal xTilt{0.0};     ///< degrees, QTabletEvent::xTilt()
+    qreal yTilt{0.0};
+    qint64 timestampMs{0}; ///< QInputEvent::timestamp(), never decreasing within a stroke
+};
+
+/// Fixed-size single-producer/single-consumer ring of pen samples. The
+/// producer only copies the sample and publishes it with one release
+/// store; the consumer takes everything published so far in one go. No
+/// locks and no allocation, so capture stays cheap however busy the
+/// consumer is. A full ring drops the new sample and counts it.
+class TabletSampleRing {
+public:
+    /// About four seconds of a 240 Hz pen without a drain.
+    static constexpr quint32 kCapacity = 1024;
+
+    bool push(const TabletSample& s) {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        const quint32 tail = m_tail.load(std::memory_order_acquire);
+        if (head - tail >= kCapacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_slots[head % kCapacity] = s;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Appends every published sample to `out`, oldest first; returns how
+    /// many.
+    template <typename Container>
+    int drain(Container* out) {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        const quint32 head = m_head.load(std::memory_order_acquire);
+        for (quint32 i = tail; i != head; ++i)
+            out->push_back(m_slots[i % kCapacity]);
+        m_tail.store(head, std::memory_order_release);
+        return int(head - tail);
+    }
+
+    bool isEmpty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+    quint32 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::array<TabletSample, kCapacity> m_slots{};
+    std::atomic<quint32> m_head{0};
+    std::atomic<quint32> m_tail{0};
+    std::atomic<quint32> m_dropped{0};
+};
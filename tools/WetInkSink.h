@@ -0,0 +1,57 @@
+#pragma once
+
+#include "StrokeItem.h"
+#include <QHash>
+#include <QPen>
+#include <QVector>
+
+class QGraphicsScene;
+
+/// Shows the stroke being drawn while the pen is down, faster than a
+/// growing StrokeItem can (MultiPageNoteView's WetInkOverlay). The drawing
+/// tools hide their live item while a sink has the stroke and hand it back
+/// on pen-up or when the stroke stops being freehand (hold shapes).
+///
+/// A sink registers itself for its scene; tools look it up through
+/// forScene(), like StrokeSpatialIndex. GUI thread only.
+class WetInkSink {
+public:
+    virtual ~WetInkSink() = default;
+
+    static WetInkSink* forScene(const QGraphicsScene* scene) {
+        return scene ? registry().value(scene, nullptr) : nullptr;
+    }
+
+    /// New stroke at `first` (scene coordinates). false when the sink cannot
+    /// draw `pen` the way the item would; the tool keeps its item then.
+    /// `predict`: extend the ink a little ahead of the pen.
+    virtual bool beginStroke(const QPen& pen, const StrokePoint& first, bool predict) = 0;
+    virtual void appendPoint(const StrokePoint& point) = 0;
+    /// A frame's worth of points in one go, repainted once. `timestampsMs`
+    /// (QInputEvent::timestamp() per point) may be empty.
+    virtual void appendPoints(const QVector<StrokePoint>& points,
+                              const QVector<qint64>& timestampsMs) {
+        Q_UNUSED(timestampsMs);
+        for (const StrokePoint& p : points)
+            appendPoint(p);
+    }
+    /// The item shows the stroke again; the wet ink goes.
+    virtual void endStroke() = 0;
+
+protected:
+    /// nullptr: unregisters.
+    static void setForScene(const QGraphicsScene* scene, WetInkSink* sink) {
+        if (!scene)
+            return;
+        if (sink)
+            registry().insert(scene, sink);
+        else
+            registry().remove(scene);
+    }
+
+private:
+    static QHash<const QGraphicsScene*, WetInkSink*>& registry() {
+        static QHash<const QGraphicsScene*, WetInkSink*> sinks;
+        return sinks;
+    }
+};
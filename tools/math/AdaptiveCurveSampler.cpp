@@ -0,0 +1,172 @@
+#include "AdaptiveCurveSampler.h"
+
+#include <QtMath>
+#include <cmath>
+
+namespace {
+
+constexpr int kMaxPasses = 24;
+/// Longest run of samples merged into one straight segment by the coarsening pass.
+constexpr int kMaxMergeRun = 48;
+
+enum IntervalState : unsigned char {
+    Done,
+    Refine,
+    /// Wanted more refinement but hit minStepPx / maxSamples.
+    Unresolved
+};
+
+struct PixelScale {
+    double sx{1.0};
+    double sy{1.0};
+    double yMin{0.0};
+    double heightPx{0.0};
+    double tolerancePx{0.0};
+
+    /// -1 below the plot, +1 above, 0 inside (with tolerance margin).
+    int side(double y) const {
+        const double py = (y - yMin) * sy;
+        if (py < -tolerancePx)
+            return -1;
+        if (py > heightPx + tolerancePx)
+            return 1;
+        return 0;
+    }
+
+    /// Distance of m from the chord segment a–b in pixels (inf on overflow).
+    /// Segment, not line: near a pole the chord is almost vertical and a
+    /// midpoint far beyond either end would otherwise look collinear.
+    double chordDeviation(const CurveSample& a, const CurveSample& m, const CurveSample& b) const {
+        const double dx = (b.x - a.x) * sx;
+        const double dy = (b.y - a.y) * sy;
+        const double mx = (m.x - a.x) * sx;
+        const double my = (m.y - a.y) * sy;
+        const double len2 = dx * dx + dy * dy;
+        double t = len2 > 0.0 ? (mx * dx + my * dy) / len2 : 0.0;
+        t = qBound(0.0, t, 1.0);
+        return std::hypot(mx - t * dx, my - t * dy);
+    }
+};
+
+bool needsRefinement(const PixelScale& s, const CurveSample& a, const CurveSample& m, const CurveSample& b) {
+    const bool fa = qIsFinite(a.y);
+    const bool fm = qIsFinite(m.y);
+    const bool fb = qIsFinite(b.y);
+    if (fa != fm || fm != fb)
+        return true; // Rand des Definitionsbereichs eingrenzen
+    if (!fa)
+        return false;
+    const int sa = s.side(a.y);
+    if (sa != 0 && sa == s.side(m.y) && sa == s.side(b.y))
+        return false; // komplett ausserhalb, wird ohnehin geclippt
+    const double dev = s.chordDeviation(a, m, b);
+    return !qIsFinite(dev) || dev > s.tolerancePx;
+}
+
+} // namespace
+
+std::vector<CurveSample> AdaptiveCurveSampler::sample(const Options& opt, const BatchEval& eval) {
+    std::vector<CurveSample> pts;
+    const double xSpan = opt.xMax - opt.xMin;
+    const double ySpan = opt.yMax - opt.yMin;
+    if (!eval || !(xSpan > 0.0) || !(ySpan > 0.0) || !(opt.widthPx > 0.0) || !(opt.heightPx > 0.0))
+        return pts;
+
+    PixelScale s;
+    s.sx = opt.widthPx / xSpan;
+    s.sy = opt.heightPx / ySpan;
+    s.yMin = opt.yMin;
+    s.heightPx = opt.heightPx;
+    s.tolerancePx = opt.tolerancePx;
+    const double minDx = qMax(opt.minStepPx, 1e-6) / s.sx;
+
+    const int n0 = opt.initialSegments > 0
+        ? opt.initialSegments
+        : qBound(16, static_cast<int>(std::ceil(opt.widthPx / 4.0)), 512);
+    std::vector<double> xs(static_cast<size_t>(n0) + 1);
+    std::vector<double> ys(xs.size());
+    for (int i = 0; i < n0; ++i)
+        xs[i] = opt.xMin + xSpan * (static_cast<double>(i) / n0);
+    xs[n0] = opt.xMax;
+    eval(xs.data(), ys.data(), n0 + 1);
+    pts.resize(xs.size());
+    for (size_t i = 0; i < xs.size(); ++i) {
+        pts[i].x = xs[i];
+        pts[i].y = ys[i];
+    }
+    std::vector<unsigned char> state(static_cast<size_t>(n0), Refine);
+
+    // Breitensuche: pro Durchgang werden alle offenen Intervallmitten in einem
+    // einzigen Batch-Aufruf ausgewertet.
+    for (int pass = 0; pass < kMaxPasses; ++pass) {
+        xs.clear();
+        for (size_t i = 0; i < state.size(); ++i) {
+            if (state[i] == Refine)
+                xs.push_back(0.5 * (pts[i].x + pts[i + 1].x));
+        }
+        if (xs.empty() || pts.size() + xs.size() > static_cast<size_t>(opt.maxSamples))
+            break;
+        ys.resize(xs.size());
+        eval(xs.data(), ys.data(), static_cast<int>(xs.size()));
+
+        std::vector<CurveSample> next;
+        std::vector<unsigned char> nextState;
+        next.reserve(pts.size() + xs.size());
+        nextState.reserve(state.size() + xs.size());
+        size_t k = 0;
+        for (size_t i = 0; i < state.size(); ++i) {
+            next.push_back(pts[i]);
+            if (state[i] != Refine) {
+                nextState.push_back(state[i]);
+                continue;
+            }
+            CurveSample m;
+            m.x = xs[k];
+            m.y = ys[k];
+            ++k;
+            unsigned char half = Done;
+            if (needsRefinement(s, pts[i], m, pts[i + 1]))
+                half = (m.x - pts[i].x) > minDx ? Refine : Unresolved;
+            next.push_back(m);
+            nextState.push_back(half);
+            nextState.push_back(half);
+        }
+        next.push_back(pts.back());
+        pts.swap(next);
+        state.swap(nextState);
+    }
+
+    // Spruenge, die bis zur Aufloesungsgrenze bestehen bleiben (Polstellen wie
+    // bei tan(x) oder 1/x), nicht als senkrechte Linie zeichnen.
+    for (size_t i = 0; i < state.size(); ++i) {
+        if (state[i] == Done || (pts[i + 1].x - pts[i].x) * s.sx > 1.0)
+            continue;
+        const CurveSample& a = pts[i];
+        CurveSample& b = pts[i + 1];
+        if (qIsFinite(a.y) && qIsFinite(b.y) && std::abs(b.y - a.y) * s.sy > opt.heightPx)
+            b.breakBefore = true;
+    }
+
+    // Vergroebern: Stuetzstellen auf (fast) geraden Abschnitten zusammenfassen.
+    std::vector<CurveSample> out;
+    out.reserve(pts.size());
+    out.push_back(pts.front());
+    size_t anchor = 0;
+    const double mergeTol = 0.5 * opt.tolerancePx;
+    for (size_t i = 1; i + 1 < pts.size(); ++i) {
+        const CurveSample& nx = pts[i + 1];
+        bool drop = qIsFinite(pts[anchor].y) && qIsFinite(pts[i].y) && qIsFinite(nx.y)
+            && !pts[i].breakBefore && !nx.breakBefore && (i - anchor) < static_cast<size_t>(kMaxMergeRun);
+        for (size_t j = anchor + 1; drop && j <= i; ++j) {
+            if (!(s.chordDeviation(pts[anchor], pts[j], nx) <= mergeTol))
+                drop = false;
+        }
+        if (drop)
+            continue;
+        out.push_back(pts[i]);
+        anchor = i;
+    }
+    if (pts.size() > 1)
+        out.push_back(pts.back());
+    return out;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+struct CurveSample {
+    double x{0.0};
+    double y{0.0};
+    /// The segment from the previous sample must not be drawn (pole / jump).
+    bool breakBefore{false};
+};
+
+/// Plot sampling of y = f(x) by adaptive subdivision: intervals are split
+/// until their midpoint lies within `tolerancePx` of the chord, so steep and
+/// strongly curved parts get dense samples and straight parts stay coarse.
+/// Jumps that survive down to `minStepPx` are reported as breaks.
+class AdaptiveCurveSampler {
+public:
+    struct Options {
+        double xMin{-10.0};
+        double xMax{10.0};
+        double yMin{-10.0};
+        double yMax{10.0};
+        double widthPx{260.0};
+        double heightPx{160.0};
+        double tolerancePx{0.35};
+        double minStepPx{0.05};
+        /// 0 = one start interval per ~4 px of width.
+        int initialSegments{0};
+        int maxSamples{6000};
+    };
+
+    /// ys[i] = f(xs[i]) for i < n (typically MathEvaluator::evalMany).
+    using BatchEval = std::function<void(const double* xs, double* ys, int n)>;
+
+    static std::vector<CurveSample> sample(const Options& opt, const BatchEval& eval);
+};
@@ -0,0 +1,77 @@
+#include "ExpressionCache.h"
+#include "MathExpressionParser.h"
+
+#include <QMutexLocker>
+
+namespace {
+
+QString cacheKey(const QString& formula) {
+    // Whitespace runs never change the parse, everything else might.
+    return formula.simplified();
+}
+
+} // namespace
+
+ExpressionCache& ExpressionCache::instance() {
+    static ExpressionCache cache;
+    return cache;
+}
+
+ExpressionCache::ExpressionCache(int capacity) : m_cache(qMax(1, capacity)) {}
+
+std::shared_ptr<const CompiledExpression> ExpressionCache::get(const QString& formula) {
+    const QString key = cacheKey(formula);
+    {
+        QMutexLocker lk(&m_mutex);
+        if (Entry* hit = m_cache.object(key)) {
+            ++m_hits;
+            return *hit;
+        }
+        ++m_misses;
+    }
+
+    // Parse outside the lock; a concurrent miss on the same key just parses
+    // twice and the later insert wins, both results are identical.
+    auto compiled = std::make_shared<CompiledExpression>();
+    compiled->expr = MathExpressionParser::parseFunctionExpression(key, &compiled->derivative,
+                                                                  &compiled->derivativeString);
+    Entry entry = std::move(compiled);
+
+    QMutexLocker lk(&m_mutex);
+    m_cache.insert(key, new Entry(entry));
+    return entry;
+}
+
+ParsedExpression ExpressionCache::parsed(const QString& formula) {
+    return instance().get(formula)->expr;
+}
+
+QString ExpressionCache::derivativeString(const QString& formula) {
+    return instance().get(formula)->derivativeString;
+}
+
+ExpressionCache::Stats ExpressionCache::stats() const {
+    QMutexLocker lk(&m_mutex);
+    Stats s;
+    s.hits = m_hits;
+    s.misses = m_misses;
+    s.entries = static_cast<int>(m_cache.size());
+    s.capacity = static_cast<int>(m_cache.maxCost());
+    return s;
+}
+
+void ExpressionCache::resetStats() {
+    QMutexLocker lk(&m_mutex);
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void ExpressionCache::setCapacity(int capacity) {
+    QMutexLocker lk(&m_mutex);
+    m_cache.setMaxCost(qMax(1, capacity));
+}
+
+void ExpressionCache::clear() {
+    QMutexLocker lk(&m_mutex);
+    m_cache.clear();
+}
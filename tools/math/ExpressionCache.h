@@ -0,0 +1,58 @@
+#pragma once
+
+#include "MathTypes.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+#include <memory>
+
+/// A formula compiled once: the expression plus its symbolic derivative.
+/// Immutable after construction; safe to share across threads.
+struct CompiledExpression {
+    ParsedExpression expr;
+    /// Compiled d/dx from differentiate(); ok == false when unsupported.
+    ParsedExpression derivative;
+    /// Simplified display form of the derivative (empty when unsupported).
+    QString derivativeString;
+};
+
+/// Process-wide, thread-safe LRU of compiled formulas keyed by the
+/// whitespace-normalized source text. Graph painting, hit-testing and the
+/// analysis handlers all go through it so each distinct formula is parsed
+/// once instead of on every paint or pointer event.
+class ExpressionCache {
+public:
+    struct Stats {
+        quint64 hits{0};
+        quint64 misses{0};
+        int entries{0};
+        int capacity{0};
+    };
+
+    static ExpressionCache& instance();
+
+    explicit ExpressionCache(int capacity = 256);
+
+    /// Never null; parse errors are cached too (expr.ok == false).
+    std::shared_ptr<const CompiledExpression> get(const QString& formula);
+
+    /// Shorthand for instance().get(formula)->expr. Copies share the program.
+    static ParsedExpression parsed(const QString& formula);
+    /// Shorthand for instance().get(formula)->derivativeString.
+    static QString derivativeString(const QString& formula);
+
+    Stats stats() const;
+    void resetStats();
+    void setCapacity(int capacity);
+    void clear();
+
+private:
+    using Entry = std::shared_ptr<const CompiledExpression>;
+
+    mutable QMutex m_mutex;
+    QCache<QString, Entry> m_cache;
+    quint64 m_hits{0};
+    quint64 m_misses{0};
+};
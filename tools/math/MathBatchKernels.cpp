@@ -0,0 +1,427 @@
+#include "MathBatchKernels.h"
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <QtMath>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLOP_MATH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang only allow AVX2 intrinsics inside functions compiled for that
+// target; MSVC accepts them anywhere and leaves dispatch to us.
+#if defined(BLOP_MATH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BLOP_TARGET_SSE2 __attribute__((target("sse2")))
+#define BLOP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BLOP_TARGET_SSE2
+#define BLOP_TARGET_AVX2
+#endif
+
+namespace {
+
+// ─── Scalar reference (also used for tails and out-of-range lanes) ──────────
+
+inline double scalarDiv(double a, double b) { return qFuzzyIsNull(b) ? qQNaN() : a / b; }
+inline double scalarLog(double v) { return v <= 0.0 ? qQNaN() : std::log(v); }
+inline double scalarSqrt(double v) { return v < 0.0 ? qQNaN() : std::sqrt(v); }
+
+void scalarAdd(double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) a[i] += b[i]; }
+void scalarSub(double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) a[i] -= b[i]; }
+void scalarMul(double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) a[i] *= b[i]; }
+void scalarDivK(double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = scalarDiv(a[i], b[i]); }
+void scalarPow(double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = std::pow(a[i], b[i]); }
+void scalarNeg(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = -a[i]; }
+void scalarAbs(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = std::fabs(a[i]); }
+void scalarSqrtK(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = scalarSqrt(a[i]); }
+void scalarSin(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = std::sin(a[i]); }
+void scalarCos(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = std::cos(a[i]); }
+void scalarTan(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = std::tan(a[i]); }
+void scalarExp(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = std::exp(a[i]); }
+void scalarLogK(double* a, size_t n) { for (size_t i = 0; i < n; ++i) a[i] = scalarLog(a[i]); }
+
+const MathBatchKernels kScalarKernels = {
+    "scalar", scalarAdd, scalarSub, scalarMul, scalarDivK, scalarPow, scalarNeg, scalarAbs,
+    scalarSqrtK, scalarSin, scalarCos, scalarTan, scalarExp, scalarLogK,
+};
+
+#ifdef BLOP_MATH_X86
+
+constexpr double kFuzzyZero = 1e-12; // qFuzzyIsNull(double) threshold
+
+// ─── SSE2: arithmetic only (no blend/round, transcendentals stay scalar) ────
+
+BLOP_TARGET_SSE2 void sse2Add(double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    scalarAdd(a + i, b + i, n - i);
+}
+
+BLOP_TARGET_SSE2 void sse2Sub(double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    scalarSub(a + i, b + i, n - i);
+}
+
+BLOP_TARGET_SSE2 void sse2Mul(double* a, const double* b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    scalarMul(a + i, b + i, n - i);
+}
+
+BLOP_TARGET_SSE2 void sse2Div(double* a, const double* b, size_t n) {
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d eps = _mm_set1_pd(kFuzzyZero);
+    const __m128d nan = _mm_set1_pd(qQNaN());
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d d = _mm_loadu_pd(b + i);
+        const __m128d q = _mm_div_pd(_mm_loadu_pd(a + i), d);
+        const __m128d tiny = _mm_cmple_pd(_mm_andnot_pd(signMask, d), eps);
+        _mm_storeu_pd(a + i, _mm_or_pd(_mm_and_pd(tiny, nan), _mm_andnot_pd(tiny, q)));
+    }
+    scalarDivK(a + i, b + i, n - i);
+}
+
+BLOP_TARGET_SSE2 void sse2Neg(double* a, size_t n) {
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_xor_pd(_mm_loadu_pd(a + i), signMask));
+    scalarNeg(a + i, n - i);
+}
+
+BLOP_TARGET_SSE2 void sse2Abs(double* a, size_t n) {
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_andnot_pd(signMask, _mm_loadu_pd(a + i)));
+    scalarAbs(a + i, n - i);
+}
+
+// IEEE sqrt already yields NaN for negative input and keeps -0 → -0.
+BLOP_TARGET_SSE2 void sse2Sqrt(double* a, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_sqrt_pd(_mm_loadu_pd(a + i)));
+    scalarSqrtK(a + i, n - i);
+}
+
+const MathBatchKernels kSse2Kernels = {
+    "sse2", sse2Add, sse2Sub, sse2Mul, sse2Div, scalarPow, sse2Neg, sse2Abs,
+    sse2Sqrt, scalarSin, scalarCos, scalarTan, scalarExp, scalarLogK,
+};
+
+// ─── AVX2: arithmetic + polynomial sin/cos/exp/log (Cephes / fdlibm) ────────
+
+#define BLOP_AVX2_INLINE BLOP_TARGET_AVX2 inline
+
+BLOP_AVX2_INLINE __m256d avxSplat(double v) { return _mm256_set1_pd(v); }
+BLOP_AVX2_INLINE __m256d avxFloor(__m256d v) {
+    return _mm256_round_pd(v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+BLOP_AVX2_INLINE __m256d avxAbs(__m256d v) { return _mm256_andnot_pd(avxSplat(-0.0), v); }
+BLOP_AVX2_INLINE __m256d avxMulAdd(__m256d a, __m256d b, __m256d c) {
+    return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+}
+
+/// Lanes selected by `mask` are recomputed with the scalar function; used for
+/// arguments outside the polynomial's accurate range (and NaN/Inf).
+template <typename Fn>
+BLOP_AVX2_INLINE __m256d avxScalarFixup(__m256d result, __m256d x, __m256d mask, Fn fn) {
+    const int bits = _mm256_movemask_pd(mask);
+    if (!bits)
+        return result;
+    alignas(32) double r[4];
+    alignas(32) double xv[4];
+    _mm256_store_pd(r, result);
+    _mm256_store_pd(xv, x);
+    for (int lane = 0; lane < 4; ++lane) {
+        if (bits & (1 << lane))
+            r[lane] = fn(xv[lane]);
+    }
+    return _mm256_load_pd(r);
+}
+
+// Cephes sin.c: reduction by pi/4 in extended precision, then one of two
+// degree-6 polynomials. Accurate for |x| well beyond any plotted range.
+constexpr double kTrigMaxArg = 1.0e8;
+constexpr double kFourOverPi = 1.27323954473516268615;
+constexpr double kDP1 = 7.85398125648498535156e-1;
+constexpr double kDP2 = 3.77489470793079817668e-8;
+constexpr double kDP3 = 2.69515142907905952645e-15;
+
+BLOP_AVX2_INLINE __m256d avxSinPoly(__m256d z, __m256d zz) {
+    __m256d p = avxSplat(1.58962301576546568060e-10);
+    p = avxMulAdd(p, zz, avxSplat(-2.50507477628578072866e-8));
+    p = avxMulAdd(p, zz, avxSplat(2.75573136213857245213e-6));
+    p = avxMulAdd(p, zz, avxSplat(-1.98412698295895385996e-4));
+    p = avxMulAdd(p, zz, avxSplat(8.33333333332211858878e-3));
+    p = avxMulAdd(p, zz, avxSplat(-1.66666666666666307295e-1));
+    return _mm256_add_pd(z, _mm256_mul_pd(_mm256_mul_pd(z, zz), p));
+}
+
+BLOP_AVX2_INLINE __m256d avxCosPoly(__m256d zz) {
+    __m256d p = avxSplat(-1.13585365213876817300e-11);
+    p = avxMulAdd(p, zz, avxSplat(2.08757008419747316778e-9));
+    p = avxMulAdd(p, zz, avxSplat(-2.75573141792967388112e-7));
+    p = avxMulAdd(p, zz, avxSplat(2.48015872888517045348e-5));
+    p = avxMulAdd(p, zz, avxSplat(-1.38888888888730564116e-3));
+    p = avxMulAdd(p, zz, avxSplat(4.16666666666665929218e-2));
+    const __m256d zz2 = _mm256_mul_pd(zz, zz);
+    return _mm256_add_pd(_mm256_sub_pd(avxSplat(1.0), _mm256_mul_pd(avxSplat(0.5), zz)),
+                         _mm256_mul_pd(zz2, p));
+}
+
+/// Shared octant reduction. `octant` ends up as 0 or 2 (after folding the
+/// upper half-turn into `upperHalf`), `z` is the reduced argument.
+BLOP_AVX2_INLINE void avxTrigReduce(__m256d ax, __m256d& z, __m256d& upperHalf, __m256d& useCosPoly) {
+    __m256d y = avxFloor(_mm256_mul_pd(ax, avxSplat(kFourOverPi)));
+    const __m256d odd = _mm256_sub_pd(y, _mm256_mul_pd(avxSplat(2.0), avxFloor(_mm256_mul_pd(y, avxSplat(0.5)))));
+    y = _mm256_add_pd(y, odd);
+    __m256d j = _mm256_sub_pd(y, _mm256_mul_pd(avxSplat(8.0), avxFloor(_mm256_mul_pd(y, avxSplat(0.125)))));
+    upperHalf = _mm256_cmp_pd(j, avxSplat(3.5), _CMP_GT_OQ);
+    j = _mm256_sub_pd(j, _mm256_and_pd(upperHalf, avxSplat(4.0)));
+    useCosPoly = _mm256_cmp_pd(j, avxSplat(1.0), _CMP_GT_OQ);
+    z = _mm256_sub_pd(ax, _mm256_mul_pd(y, avxSplat(kDP1)));
+    z = _mm256_sub_pd(z, _mm256_mul_pd(y, avxSplat(kDP2)));
+    z = _mm256_sub_pd(z, _mm256_mul_pd(y, avxSplat(kDP3)));
+}
+
+BLOP_AVX2_INLINE __m256d avxSin(__m256d x) {
+    const __m256d signMask = avxSplat(-0.0);
+    const __m256d ax = avxAbs(x);
+    __m256d z, upperHalf, useCosPoly;
+    avxTrigReduce(ax, z, upperHalf, useCosPoly);
+    const __m256d zz = _mm256_mul_pd(z, z);
+    __m256d r = _mm256_blendv_pd(avxSinPoly(z, zz), avxCosPoly(zz), useCosPoly);
+    const __m256d sign = _mm256_xor_pd(_mm256_and_pd(x, signMask), _mm256_and_pd(upperHalf, signMask));
+    r = _mm256_xor_pd(r, sign);
+    const __m256d outOfRange = _mm256_cmp_pd(ax, avxSplat(kTrigMaxArg), _CMP_NLE_UQ);
+    return avxScalarFixup(r, x, outOfRange, [](double v) { return std::sin(v); });
+}
+
+BLOP_AVX2_INLINE __m256d avxCos(__m256d x) {
+    const __m256d signMask = avxSplat(-0.0);
+    const __m256d ax = avxAbs(x);
+    __m256d z, upperHalf, useSinPoly;
+    avxTrigReduce(ax, z, upperHalf, useSinPoly);
+    const __m256d zz = _mm256_mul_pd(z, z);
+    __m256d r = _mm256_blendv_pd(avxCosPoly(zz), avxSinPoly(z, zz), useSinPoly);
+    const __m256d sign = _mm256_and_pd(_mm256_xor_pd(upperHalf, useSinPoly), signMask);
+    r = _mm256_xor_pd(r, sign);
+    const __m256d outOfRange = _mm256_cmp_pd(ax, avxSplat(kTrigMaxArg), _CMP_NLE_UQ);
+    return avxScalarFixup(r, x, outOfRange, [](double v) { return std::cos(v); });
+}
+
+/// 2^k for integral k in [-1022, 1023], built directly in the exponent field.
+BLOP_AVX2_INLINE __m256d avxPow2i(__m256d k) {
+    const __m256d magic = avxSplat(4503599627370496.0 + 1023.0); // 2^52 + bias
+    const __m256i bits = _mm256_castpd_si256(_mm256_add_pd(k, magic));
+    return _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+}
+
+// Cephes exp.c: x = n·ln2 + r, Padé(3,3) for e^r, then scale by 2^n in two
+// halves so subnormal results round only once.
+constexpr double kExpMax = 709.782712893383996843;
+constexpr double kExpMin = -745.13321910194110842;
+
+BLOP_AVX2_INLINE __m256d avxExp(__m256d x) {
+    const __m256d xc = _mm256_min_pd(_mm256_max_pd(x, avxSplat(kExpMin - 1.0)), avxSplat(kExpMax + 1.0));
+    const __m256d n = avxFloor(avxMulAdd(xc, avxSplat(1.4426950408889634073599), avxSplat(0.5)));
+    __m256d r = _mm256_sub_pd(xc, _mm256_mul_pd(n, avxSplat(6.93145751953125e-1)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(n, avxSplat(1.42860682030941723212e-6)));
+    const __m256d rr = _mm256_mul_pd(r, r);
+    __m256d p = avxSplat(1.26177193074810590878e-4);
+    p = avxMulAdd(p, rr, avxSplat(3.02994407707441961300e-2));
+    p = avxMulAdd(p, rr, avxSplat(9.99999999999999999910e-1));
+    p = _mm256_mul_pd(p, r);
+    __m256d q = avxSplat(3.00198505138664455042e-6);
+    q = avxMulAdd(q, rr, avxSplat(2.52448340349684104192e-3));
+    q = avxMulAdd(q, rr, avxSplat(2.27265548208155028766e-1));
+    q = avxMulAdd(q, rr, avxSplat(2.00000000000000000009e0));
+    __m256d e = _mm256_div_pd(p, _mm256_sub_pd(q, p));
+    e = avxMulAdd(e, avxSplat(2.0), avxSplat(1.0));
+    const __m256d n1 = avxFloor(_mm256_mul_pd(n, avxSplat(0.5)));
+    const __m256d n2 = _mm256_sub_pd(n, n1);
+    e = _mm256_mul_pd(_mm256_mul_pd(e, avxPow2i(n1)), avxPow2i(n2));
+    e = _mm256_blendv_pd(e, avxSplat(HUGE_VAL), _mm256_cmp_pd(x, avxSplat(kExpMax), _CMP_GT_OQ));
+    e = _mm256_blendv_pd(e, _mm256_setzero_pd(), _mm256_cmp_pd(x, avxSplat(kExpMin), _CMP_LT_OQ));
+    return _mm256_blendv_pd(e, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+// fdlibm e_log.c: x = 2^k·m with m in [√2/2, √2), log(m) via s = f/(2+f)
+// and a degree-7 minimax polynomial in s².
+BLOP_AVX2_INLINE __m256d avxLogNormal(__m256d x) {
+    const __m256i bits = _mm256_castpd_si256(x);
+    const __m256i expBits = _mm256_srli_epi64(bits, 52);
+    const __m256d two52 = avxSplat(4503599627370496.0);
+    __m256d k = _mm256_sub_pd(
+        _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(expBits, _mm256_castpd_si256(two52))), two52),
+        avxSplat(1023.0));
+    const __m256i mantMask = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m256i oneBits = _mm256_set1_epi64x(0x3FF0000000000000LL);
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantMask), oneBits));
+    const __m256d big = _mm256_cmp_pd(m, avxSplat(1.41421356237309504880), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, avxSplat(0.5)), big);
+    k = _mm256_add_pd(k, _mm256_and_pd(big, avxSplat(1.0)));
+
+    const __m256d f = _mm256_sub_pd(m, avxSplat(1.0));
+    const __m256d s = _mm256_div_pd(f, _mm256_add_pd(avxSplat(2.0), f));
+    const __m256d z = _mm256_mul_pd(s, s);
+    const __m256d w = _mm256_mul_pd(z, z);
+    __m256d t1 = avxMulAdd(w, avxSplat(1.531383769920937332e-01), avxSplat(2.222219843214978396e-01));
+    t1 = avxMulAdd(w, t1, avxSplat(3.999999999940941908e-01));
+    t1 = _mm256_mul_pd(w, t1);
+    __m256d t2 = avxMulAdd(w, avxSplat(1.479819860511658591e-01), avxSplat(1.818357216161805012e-01));
+    t2 = avxMulAdd(w, t2, avxSplat(2.857142874366239149e-01));
+    t2 = avxMulAdd(w, t2, avxSplat(6.666666666666735130e-01));
+    t2 = _mm256_mul_pd(z, t2);
+    const __m256d R = _mm256_add_pd(t2, t1);
+    const __m256d hfsq = _mm256_mul_pd(avxSplat(0.5), _mm256_mul_pd(f, f));
+    const __m256d inner = avxMulAdd(s, _mm256_add_pd(hfsq, R), _mm256_mul_pd(k, avxSplat(1.90821492927058770002e-10)));
+    return _mm256_sub_pd(_mm256_mul_pd(k, avxSplat(6.93147180369123816490e-01)),
+                         _mm256_sub_pd(_mm256_sub_pd(hfsq, inner), f));
+}
+
+/// Lanes that are not finite, positive normal numbers.
+BLOP_AVX2_INLINE __m256d avxLogOutOfRange(__m256d x) {
+    const __m256d lo = _mm256_cmp_pd(x, avxSplat(2.2250738585072014e-308), _CMP_NGE_UQ);
+    const __m256d hi = _mm256_cmp_pd(x, avxSplat(HUGE_VAL), _CMP_NLT_UQ);
+    return _mm256_or_pd(lo, hi);
+}
+
+BLOP_AVX2_INLINE __m256d avxLog(__m256d x) {
+    return avxScalarFixup(avxLogNormal(x), x, avxLogOutOfRange(x), scalarLog);
+}
+
+/// a^b = e^(b·log a) for positive, normal a; everything else (negative bases
+/// with integral exponents, zero, overflow) goes through std::pow.
+BLOP_AVX2_INLINE __m256d avxPow(__m256d a, __m256d b) {
+    const __m256d t = _mm256_mul_pd(b, avxLogNormal(a));
+    const __m256d r = avxExp(t);
+    __m256d bad = _mm256_or_pd(avxLogOutOfRange(a), _mm256_cmp_pd(avxAbs(t), avxSplat(700.0), _CMP_NLT_UQ));
+    const int bits = _mm256_movemask_pd(bad);
+    if (!bits)
+        return r;
+    alignas(32) double rv[4];
+    alignas(32) double av[4];
+    alignas(32) double bv[4];
+    _mm256_store_pd(rv, r);
+    _mm256_store_pd(av, a);
+    _mm256_store_pd(bv, b);
+    for (int lane = 0; lane < 4; ++lane) {
+        if (bits & (1 << lane))
+            rv[lane] = std::pow(av[lane], bv[lane]);
+    }
+    return _mm256_load_pd(rv);
+}
+
+#define BLOP_AVX2_BINARY(NAME, BODY, TAIL)                                    \
+    BLOP_TARGET_AVX2 void NAME(double* a, const double* b, size_t n) {        \
+        size_t i = 0;                                                         \
+        for (; i + 4 <= n; i += 4) {                                          \
+            const __m256d va = _mm256_loadu_pd(a + i);                        \
+            const __m256d vb = _mm256_loadu_pd(b + i);                        \
+            _mm256_storeu_pd(a + i, BODY);                                    \
+        }                                                                     \
+        TAIL(a + i, b + i, n - i);                                            \
+    }
+
+#define BLOP_AVX2_UNARY(NAME, BODY, TAIL)                                     \
+    BLOP_TARGET_AVX2 void NAME(double* a, size_t n) {                         \
+        size_t i = 0;                                                         \
+        for (; i + 4 <= n; i += 4) {                                          \
+            const __m256d va = _mm256_loadu_pd(a + i);                        \
+            _mm256_storeu_pd(a + i, BODY);                                    \
+        }                                                                     \
+        TAIL(a + i, n - i);                                                   \
+    }
+
+BLOP_AVX2_BINARY(avx2Add, _mm256_add_pd(va, vb), scalarAdd)
+BLOP_AVX2_BINARY(avx2Sub, _mm256_sub_pd(va, vb), scalarSub)
+BLOP_AVX2_BINARY(avx2Mul, _mm256_mul_pd(va, vb), scalarMul)
+BLOP_AVX2_BINARY(avx2Div,
+                 _mm256_blendv_pd(_mm256_div_pd(va, vb), avxSplat(qQNaN()),
+                                  _mm256_cmp_pd(avxAbs(vb), avxSplat(kFuzzyZero), _CMP_LE_OQ)),
+                 scalarDivK)
+BLOP_AVX2_BINARY(avx2Pow, avxPow(va, vb), scalarPow)
+
+BLOP_AVX2_UNARY(avx2Neg, _mm256_xor_pd(va, avxSplat(-0.0)), scalarNeg)
+BLOP_AVX2_UNARY(avx2Abs, avxAbs(va), scalarAbs)
+BLOP_AVX2_UNARY(avx2Sqrt, _mm256_sqrt_pd(va), scalarSqrtK)
+BLOP_AVX2_UNARY(avx2Sin, avxSin(va), scalarSin)
+BLOP_AVX2_UNARY(avx2Cos, avxCos(va), scalarCos)
+BLOP_AVX2_UNARY(avx2Tan, _mm256_div_pd(avxSin(va), avxCos(va)), scalarTan)
+BLOP_AVX2_UNARY(avx2Exp, avxExp(va), scalarExp)
+BLOP_AVX2_UNARY(avx2Log, avxLog(va), scalarLogK)
+
+#undef BLOP_AVX2_BINARY
+#undef BLOP_AVX2_UNARY
+
+const MathBatchKernels kAvx2Kernels = {
+    "avx2", avx2Add, avx2Sub, avx2Mul, avx2Div, avx2Pow, avx2Neg, avx2Abs,
+    avx2Sqrt, avx2Sin, avx2Cos, avx2Tan, avx2Exp, avx2Log,
+};
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool cpuHasSse2() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+    return true;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif // BLOP_MATH_X86
+
+const MathBatchKernels& selectKernels() {
+    // BLOP_MATH_KERNELS=scalar|sse2 pins a lower tier (A/B checks, benchmarks).
+    const QByteArray forced = qgetenv("BLOP_MATH_KERNELS");
+#ifdef BLOP_MATH_X86
+    if (forced == "scalar")
+        return kScalarKernels;
+    if (forced != "sse2" && cpuHasAvx2())
+        return kAvx2Kernels;
+    if (cpuHasSse2())
+        return kSse2Kernels;
+#else
+    Q_UNUSED(forced);
+#endif
+    return kScalarKernels;
+}
+
+} // namespace
+
+const MathBatchKernels& mathBatchKernels() {
+    static const MathBatchKernels& kernels = selectKernels();
+    return kernels;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+/// Column kernels behind MathEvaluator::evalMany. Every kernel works in place
+/// on `a`; binary kernels read the right-hand operand column from `b`.
+/// Semantics match the scalar evaluator (Div → NaN for |b| ≈ 0, Log → NaN for
+/// a ≤ 0, Sqrt → NaN for a < 0); the vectorized transcendentals are accurate
+/// to a few ulp, not bit-identical to libm.
+struct MathBatchKernels {
+    const char* name;
+    void (*add)(double* a, const double* b, size_t n);
+    void (*sub)(double* a, const double* b, size_t n);
+    void (*mul)(double* a, const double* b, size_t n);
+    void (*div)(double* a, const double* b, size_t n);
+    void (*pow)(double* a, const double* b, size_t n);
+    void (*neg)(double* a, size_t n);
+    void (*abs)(double* a, size_t n);
+    void (*sqrt)(double* a, size_t n);
+    void (*sin)(double* a, size_t n);
+    void (*cos)(double* a, size_t n);
+    void (*tan)(double* a, size_t n);
+    void (*exp)(double* a, size_t n);
+    void (*log)(double* a, size_t n);
+};
+
+/// Best kernel set for the running CPU (AVX2 → SSE2 → portable scalar),
+/// resolved once on first use.
+const MathBatchKernels& mathBatchKernels();
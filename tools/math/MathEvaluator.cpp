@@ -1,9 +1,160 @@
 #include "MathEvaluator.h"
+#include "MathBatchKernels.h"
 
 #include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Programs deeper than this (pathological nesting) use a heap stack instead.
+constexpr int kInlineStack = 32;
+// evalMany works through the input in blocks so every stack column stays in L1.
+constexpr size_t kBatchBlock = 256;
+
+double powInt(double base, int n) {
+    const bool invert = n < 0;
+    unsigned int e = invert ? static_cast<unsigned int>(-n) : static_cast<unsigned int>(n);
+    double result = 1.0;
+    while (e) {
+        if (e & 1u)
+            result *= base;
+        base *= base;
+        e >>= 1;
+    }
+    return invert ? 1.0 / result : result;
+}
+
+double run(const ExprInstr* ip, const ExprInstr* end, double x, double* stack) {
+    double* sp = stack; // one past the top element
+    for (; ip != end; ++ip) {
+        switch (ip->op) {
+        case ExprOp::PushConst: *sp++ = ip->value; break;
+        case ExprOp::PushX: *sp++ = x; break;
+        case ExprOp::Neg: sp[-1] = -sp[-1]; break;
+        case ExprOp::Add: --sp; sp[-1] += sp[0]; break;
+        case ExprOp::Sub: --sp; sp[-1] -= sp[0]; break;
+        case ExprOp::Mul: --sp; sp[-1] *= sp[0]; break;
+        case ExprOp::Div: {
+            --sp;
+            const double d = sp[0];
+            sp[-1] = qFuzzyIsNull(d) ? qQNaN() : sp[-1] / d;
+            break;
+        }
+        case ExprOp::Pow: --sp; sp[-1] = std::pow(sp[-1], sp[0]); break;
+        case ExprOp::PowInt: sp[-1] = powInt(sp[-1], static_cast<int>(ip->value)); break;
+        case ExprOp::Sin: sp[-1] = std::sin(sp[-1]); break;
+        case ExprOp::Cos: sp[-1] = std::cos(sp[-1]); break;
+        case ExprOp::Tan: sp[-1] = std::tan(sp[-1]); break;
+        case ExprOp::Exp: sp[-1] = std::exp(sp[-1]); break;
+        case ExprOp::Log: {
+            const double v = sp[-1];
+            sp[-1] = v <= 0.0 ? qQNaN() : std::log(v);
+            break;
+        }
+        case ExprOp::Sqrt: {
+            const double v = sp[-1];
+            sp[-1] = v < 0.0 ? qQNaN() : std::sqrt(v);
+            break;
+        }
+        case ExprOp::Abs: sp[-1] = std::fabs(sp[-1]); break;
+        }
+    }
+    return sp == stack ? qQNaN() : sp[-1];
+}
+
+// Same square-and-multiply sequence as powInt(), one column at a time, so
+// batch and scalar results agree bit for bit.
+void powIntColumn(const MathBatchKernels& k, double* a, double* scratch, int n, size_t len) {
+    const bool invert = n < 0;
+    unsigned int e = invert ? static_cast<unsigned int>(-n) : static_cast<unsigned int>(n);
+    std::memcpy(scratch, a, len * sizeof(double));
+    std::fill(a, a + len, 1.0);
+    while (e) {
+        if (e & 1u)
+            k.mul(a, scratch, len);
+        k.mul(scratch, scratch, len);
+        e >>= 1;
+    }
+    if (invert) {
+        for (size_t i = 0; i < len; ++i)
+            a[i] = 1.0 / a[i];
+    }
+}
+
+void runColumns(const ExprProgram& program, const double* xs, double* ys, size_t n) {
+    const MathBatchKernels& k = mathBatchKernels();
+    const size_t depth = static_cast<size_t>(qMax(1, program.maxStack));
+    // One column per stack slot plus a scratch column for PowInt.
+    std::vector<double> columns((depth + 1) * kBatchBlock);
+    double* scratch = columns.data() + depth * kBatchBlock;
+    auto col = [&](size_t slot) { return columns.data() + slot * kBatchBlock; };
+
+    for (size_t off = 0; off < n; off += kBatchBlock) {
+        const size_t len = std::min(kBatchBlock, n - off);
+        size_t sp = 0;
+        for (const ExprInstr& ins : program.code) {
+            switch (ins.op) {
+            case ExprOp::PushConst: std::fill(col(sp), col(sp) + len, ins.value); ++sp; break;
+            case ExprOp::PushX: std::memcpy(col(sp), xs + off, len * sizeof(double)); ++sp; break;
+            case ExprOp::Neg: k.neg(col(sp - 1), len); break;
+            case ExprOp::Add: k.add(col(sp - 2), col(sp - 1), len); --sp; break;
+            case ExprOp::Sub: k.sub(col(sp - 2), col(sp - 1), len); --sp; break;
+            case ExprOp::Mul: k.mul(col(sp - 2), col(sp - 1), len); --sp; break;
+            case ExprOp::Div: k.div(col(sp - 2), col(sp - 1), len); --sp; break;
+            case ExprOp::Pow: k.pow(col(sp - 2), col(sp - 1), len); --sp; break;
+            case ExprOp::PowInt:
+                powIntColumn(k, col(sp - 1), scratch, static_cast<int>(ins.value), len);
+                break;
+            case ExprOp::Sin: k.sin(col(sp - 1), len); break;
+            case ExprOp::Cos: k.cos(col(sp - 1), len); break;
+            case ExprOp::Tan: k.tan(col(sp - 1), len); break;
+            case ExprOp::Exp: k.exp(col(sp - 1), len); break;
+            case ExprOp::Log: k.log(col(sp - 1), len); break;
+            case ExprOp::Sqrt: k.sqrt(col(sp - 1), len); break;
+            case ExprOp::Abs: k.abs(col(sp - 1), len); break;
+            }
+        }
+        if (sp == 0)
+            std::fill(ys + off, ys + off + len, qQNaN());
+        else
+            std::memcpy(ys + off, col(sp - 1), len * sizeof(double));
+    }
+}
+
+} // namespace
 
 double MathEvaluator::evalAt(const ParsedExpression& expr, double x) {
-    if (!expr.ok || !expr.fn)
+    if (!expr.ok)
         return qQNaN();
-    return expr.fn(x);
+    if (expr.program)
+        return evalProgram(*expr.program, x);
+    return qQNaN();
+}
+
+double MathEvaluator::evalProgram(const ExprProgram& program, double x) {
+    const ExprInstr* begin = program.code.data();
+    const ExprInstr* end = begin + program.code.size();
+    if (program.maxStack <= kInlineStack) {
+        double stack[kInlineStack];
+        return run(begin, end, x, stack);
+    }
+    std::vector<double> stack(static_cast<size_t>(program.maxStack));
+    return run(begin, end, x, stack.data());
+}
+
+void MathEvaluator::evalMany(const ParsedExpression& expr, const double* xs, double* ys, size_t n) {
+    if (n == 0)
+        return;
+    if (!expr.ok) {
+        std::fill(ys, ys + n, qQNaN());
+        return;
+    }
+    if (expr.program) {
+        runColumns(*expr.program, xs, ys, n);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i)
+        ys[i] = evalAt(expr, xs[i]);
 }
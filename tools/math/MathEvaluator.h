@@ -2,7 +2,16 @@
 
 #include "MathTypes.h"
 
+#include <cstddef>
+
 class MathEvaluator {
 public:
     static double evalAt(const ParsedExpression& expr, double x);
+    /// Runs a compiled program on a small stack machine (no heap traffic for
+    /// typical formulas).
+    static double evalProgram(const ExprProgram& program, double x);
+    /// ys[i] = f(xs[i]) for i < n. Compiled programs run column-wise through
+    /// the SIMD kernels in MathBatchKernels; use this whenever a curve or a
+    /// sampling grid is evaluated.
+    static void evalMany(const ParsedExpression& expr, const double* xs, double* ys, size_t n);
 };
@@ -1,4 +1,5 @@
 #include "MathExpressionParser.h"
+#include "MathEvaluator.h"
 
 #include <QtMath>
 #include <QRegularExpression>
@@ -66,61 +67,6 @@ public:
         return ar;
     }
 
-    ParsedExpression parse() {
-        ParsedExpression out;
-        AstParseResult ar = parseRoot();
-        out.normalizedInput = ar.normalizedInput;
-        if (!ar.ok || !ar.root) {
-            out.error = ar.error.isEmpty() ? QStringLiteral("Ungueltige Eingabe") : ar.error;
-            return out;
-        }
-        out.ok = true;
-        // std::function verlangt ein copy-constructible Target.
-        // unique_ptr-Capture macht das Lambda move-only; daher shared_ptr.
-        auto sharedRoot = std::shared_ptr<Node>(ar.root.release());
-        out.fn = [sharedRoot](double x) -> double {
-            std::function<double(const Node*, double)> eval = [&](const Node* n, double xv) -> double {
-                if (!n)
-                    return qQNaN();
-                switch (n->type) {
-                case NodeType::Constant: return n->value;
-                case NodeType::Variable: return xv;
-                case NodeType::UnaryMinus: return -eval(n->left.get(), xv);
-                case NodeType::Add: return eval(n->left.get(), xv) + eval(n->right.get(), xv);
-                case NodeType::Sub: return eval(n->left.get(), xv) - eval(n->right.get(), xv);
-                case NodeType::Mul: return eval(n->left.get(), xv) * eval(n->right.get(), xv);
-                case NodeType::Div: {
-                    const double d = eval(n->right.get(), xv);
-                    if (qFuzzyIsNull(d))
-                        return qQNaN();
-                    return eval(n->left.get(), xv) / d;
-                }
-                case NodeType::Pow: return std::pow(eval(n->left.get(), xv), eval(n->right.get(), xv));
-                case NodeType::FuncSin: return std::sin(eval(n->left.get(), xv));
-                case NodeType::FuncCos: return std::cos(eval(n->left.get(), xv));
-                case NodeType::FuncTan: return std::tan(eval(n->left.get(), xv));
-                case NodeType::FuncExp: return std::exp(eval(n->left.get(), xv));
-                case NodeType::FuncLog: {
-                    const double v = eval(n->left.get(), xv);
-                    if (v <= 0.0)
-                        return qQNaN();
-                    return std::log(v);
-                }
-                case NodeType::FuncSqrt: {
-                    const double v = eval(n->left.get(), xv);
-                    if (v < 0.0)
-                        return qQNaN();
-                    return std::sqrt(v);
-                }
-                case NodeType::FuncAbs: return std::fabs(eval(n->left.get(), xv));
-                }
-                return qQNaN();
-            };
-            return eval(sharedRoot.get(), x);
-        };
-        return out;
-    }
-
 private:
     static QString normalizeInput(const QString& raw) {
         QString s = raw.trimmed();
@@ -688,6 +634,193 @@ std::unique_ptr<Node> simplify(std::unique_ptr<Node> n) {
     return n;
 }
 
+/// Folds subtrees that contain no variable into one constant. Unlike
+/// simplify() it never drops an operand, so 0*ln(x) or x^0 keep the domain
+/// of the formula as typed (NaN where ln(x) is undefined).
+std::unique_ptr<Node> foldConstants(std::unique_ptr<Node> n) {
+    if (!n)
+        return {};
+    n->left = foldConstants(std::move(n->left));
+    n->right = foldConstants(std::move(n->right));
+    auto isConst = [](const Node* c) { return c && c->type == NodeType::Constant; };
+    switch (n->type) {
+    case NodeType::UnaryMinus:
+        if (isConst(n->left.get())) {
+            n->left->value = -n->left->value;
+            return std::move(n->left);
+        }
+        return n;
+    case NodeType::Add:
+    case NodeType::Sub:
+    case NodeType::Mul:
+    case NodeType::Div:
+    case NodeType::Pow: {
+        if (!isConst(n->left.get()) || !isConst(n->right.get()))
+            return n;
+        const double a = n->left->value;
+        const double b = n->right->value;
+        double v = 0.0;
+        switch (n->type) {
+        case NodeType::Add: v = a + b; break;
+        case NodeType::Sub: v = a - b; break;
+        case NodeType::Mul: v = a * b; break;
+        case NodeType::Div:
+            if (qFuzzyIsNull(b))
+                return n;
+            v = a / b;
+            break;
+        default: v = std::pow(a, b); break;
+        }
+        n->left->value = v;
+        return std::move(n->left);
+    }
+    default:
+        return n;
+    }
+}
+
+// ─── Compilation to a flat postfix program ──────────────────────────────────
+
+constexpr double kMaxPowIntExponent = 64.0;
+
+int opArity(ExprOp op) {
+    switch (op) {
+    case ExprOp::PushConst:
+    case ExprOp::PushX:
+        return 0;
+    case ExprOp::Add:
+    case ExprOp::Sub:
+    case ExprOp::Mul:
+    case ExprOp::Div:
+    case ExprOp::Pow:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+class ProgramBuilder {
+public:
+    void emit(ExprOp op, double value = 0.0) {
+        const int arity = opArity(op);
+        m_code.push_back(ExprInstr{op, value});
+        m_depth += 1 - arity;
+        m_maxDepth = qMax(m_maxDepth, m_depth);
+        if (arity > 0)
+            foldTail(arity);
+    }
+
+    std::shared_ptr<const ExprProgram> finish() {
+        auto prog = std::make_shared<ExprProgram>();
+        prog->code = std::move(m_code);
+        prog->maxStack = m_maxDepth;
+        return prog;
+    }
+
+private:
+    // Operands of the op just emitted that are all PushConst get evaluated
+    // now, with the same evaluator as at run time, so the folded value is
+    // bit-identical to what the unfolded program would produce.
+    void foldTail(int arity) {
+        const int n = static_cast<int>(m_code.size());
+        if (n < arity + 1)
+            return;
+        for (int i = n - 1 - arity; i < n - 1; ++i) {
+            if (m_code[static_cast<size_t>(i)].op != ExprOp::PushConst)
+                return;
+        }
+        ExprProgram tail;
+        tail.code.assign(m_code.end() - (arity + 1), m_code.end());
+        tail.maxStack = arity;
+        const double v = MathEvaluator::evalProgram(tail, 0.0);
+        m_code.resize(static_cast<size_t>(n - arity - 1));
+        m_code.push_back(ExprInstr{ExprOp::PushConst, v});
+    }
+
+    std::vector<ExprInstr> m_code;
+    int m_depth{0};
+    int m_maxDepth{0};
+};
+
+ExprOp funcOp(NodeType t) {
+    switch (t) {
+    case NodeType::FuncSin: return ExprOp::Sin;
+    case NodeType::FuncCos: return ExprOp::Cos;
+    case NodeType::FuncTan: return ExprOp::Tan;
+    case NodeType::FuncExp: return ExprOp::Exp;
+    case NodeType::FuncLog: return ExprOp::Log;
+    case NodeType::FuncSqrt: return ExprOp::Sqrt;
+    default: return ExprOp::Abs;
+    }
+}
+
+bool compileNode(const Node* n, ProgramBuilder& b) {
+    if (!n)
+        return false;
+    switch (n->type) {
+    case NodeType::Constant:
+        b.emit(ExprOp::PushConst, n->value);
+        return true;
+    case NodeType::Variable:
+        b.emit(ExprOp::PushX);
+        return true;
+    case NodeType::UnaryMinus:
+        if (!compileNode(n->left.get(), b))
+            return false;
+        b.emit(ExprOp::Neg);
+        return true;
+    case NodeType::Add:
+    case NodeType::Sub:
+    case NodeType::Mul:
+    case NodeType::Div: {
+        if (!compileNode(n->left.get(), b) || !compileNode(n->right.get(), b))
+            return false;
+        const ExprOp op = n->type == NodeType::Add ? ExprOp::Add
+            : n->type == NodeType::Sub             ? ExprOp::Sub
+            : n->type == NodeType::Mul             ? ExprOp::Mul
+                                                   : ExprOp::Div;
+        b.emit(op);
+        return true;
+    }
+    case NodeType::Pow: {
+        if (!compileNode(n->left.get(), b))
+            return false;
+        const Node* e = n->right.get();
+        // x^2, x^3, x^-1 … are by far the most common powers: square-and-multiply
+        // instead of a libm pow() call.
+        if (e && e->type == NodeType::Constant && std::fabs(e->value) <= kMaxPowIntExponent &&
+            e->value == std::trunc(e->value)) {
+            b.emit(ExprOp::PowInt, e->value);
+            return true;
+        }
+        if (!compileNode(e, b))
+            return false;
+        b.emit(ExprOp::Pow);
+        return true;
+    }
+    case NodeType::FuncSin:
+    case NodeType::FuncCos:
+    case NodeType::FuncTan:
+    case NodeType::FuncExp:
+    case NodeType::FuncLog:
+    case NodeType::FuncSqrt:
+    case NodeType::FuncAbs:
+        if (!compileNode(n->left.get(), b))
+            return false;
+        b.emit(funcOp(n->type));
+        return true;
+    }
+    return false;
+}
+
+std::shared_ptr<const ExprProgram> compileProgram(std::unique_ptr<Node> root) {
+    root = foldConstants(std::move(root));
+    ProgramBuilder b;
+    if (!compileNode(root.get(), b))
+        return {};
+    return b.finish();
+}
+
 static QString funcName(NodeType t) {
     switch (t) {
     case NodeType::FuncSin:
@@ -790,8 +923,41 @@ QString nodeToString(const Node* n) {
 } // namespace
 
 ParsedExpression MathExpressionParser::parseFunctionExpression(const QString& input) {
+    return parseFunctionExpression(input, nullptr, nullptr);
+}
+
+ParsedExpression MathExpressionParser::parseFunctionExpression(const QString& input, ParsedExpression* derivative,
+                                                               QString* derivativeString) {
+    ParsedExpression out;
     Parser p(input);
-    return p.parse();
+    AstParseResult ar = p.parseRoot();
+    out.normalizedInput = ar.normalizedInput;
+    if (!ar.ok || !ar.root) {
+        out.error = ar.error.isEmpty() ? QStringLiteral("Ungueltige Eingabe") : ar.error;
+        return out;
+    }
+    if (derivative || derivativeString) {
+        auto d = differentiate(ar.root.get());
+        if (d) {
+            d = simplify(std::move(d));
+            d = simplify(std::move(d));
+            const QString display = nodeToString(d.get());
+            if (derivativeString)
+                *derivativeString = display;
+            if (derivative) {
+                derivative->normalizedInput = display;
+                derivative->program = compileProgram(std::move(d));
+                derivative->ok = derivative->program != nullptr;
+            }
+        }
+    }
+    out.program = compileProgram(std::move(ar.root));
+    if (!out.program) {
+        out.error = QStringLiteral("Ungueltige Eingabe");
+        return out;
+    }
+    out.ok = true;
+    return out;
 }
 
 QString MathExpressionParser::symbolicDerivativeString(const QString& input) {
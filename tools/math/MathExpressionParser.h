@@ -5,6 +5,10 @@
 class MathExpressionParser {
 public:
     static ParsedExpression parseFunctionExpression(const QString& input);
+    /// Same parse, plus the compiled symbolic derivative (ok == false if
+    /// unsupported, e.g. abs or x^x) and its display string, from one AST.
+    static ParsedExpression parseFunctionExpression(const QString& input, ParsedExpression* derivative,
+                                                    QString* derivativeString);
     /// Symbolic d/dx for display (chip labels). Empty if unsupported or parse error.
     static QString symbolicDerivativeString(const QString& input);
 };
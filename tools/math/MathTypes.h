@@ -1,13 +1,48 @@
 #pragma once
 
 #include <QString>
-#include <functional>
+#include <memory>
+#include <vector>
+
+/// Opcode of a compiled expression. Programs are postfix: operands are pushed,
+/// operators pop their arguments and push the result.
+enum class ExprOp : unsigned char {
+    PushConst,
+    PushX,
+    Neg,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Pow,
+    PowInt, ///< base^n with the integer exponent n stored in ExprInstr::value
+    Sin,
+    Cos,
+    Tan,
+    Exp,
+    Log,
+    Sqrt,
+    Abs
+};
+
+struct ExprInstr {
+    ExprOp op{ExprOp::PushConst};
+    double value{0.0};
+};
+
+/// Flat, constant-folded instruction array emitted by MathExpressionParser.
+/// Immutable once built; shared between copies of a ParsedExpression.
+struct ExprProgram {
+    std::vector<ExprInstr> code;
+    int maxStack{0};
+};
 
 struct ParsedExpression {
     bool ok{false};
     QString error;
     QString normalizedInput;
-    std::function<double(double)> fn;
+    /// Compiled form of a parsed formula, run by MathEvaluator.
+    std::shared_ptr<const ExprProgram> program;
 };
 
 struct GraphEvalPoint {
@@ -4,16 +4,18 @@
 
 #include <QRegularExpression>
 #include <QtMath>
+#include <vector>
 
 namespace {
-double bisectRoot(const ParsedExpression& expr, double a, double b, int iters = 28) {
-    double fa = MathEvaluator::evalAt(expr, a);
-    double fb = MathEvaluator::evalAt(expr, b);
+template <typename Fn>
+double bisectRoot(const Fn& f, double a, double b, int iters = 28) {
+    double fa = f(a);
+    double fb = f(b);
     if (!qIsFinite(fa) || !qIsFinite(fb) || fa * fb > 0.0)
         return qQNaN();
     for (int i = 0; i < iters; ++i) {
         const double m = 0.5 * (a + b);
-        const double fm = MathEvaluator::evalAt(expr, m);
+        const double fm = f(m);
         if (!qIsFinite(fm))
             return qQNaN();
         if (fa * fm <= 0.0) {
@@ -26,48 +28,78 @@ double bisectRoot(const ParsedExpression& expr, double a, double b, int iters =
     }
     return 0.5 * (a + b);
 }
-}
 
-double NumericAnalysis::derivativeCentral(const ParsedExpression& expr, double x, double h) {
-    const double f1 = MathEvaluator::evalAt(expr, x + h);
-    const double f0 = MathEvaluator::evalAt(expr, x - h);
-    if (!qIsFinite(f1) || !qIsFinite(f0))
-        return qQNaN();
-    return (f1 - f0) / (2.0 * h);
+QVector<double> sampleGrid(double xmin, double xmax, int samples) {
+    QVector<double> xs(samples + 1);
+    const double dx = (xmax - xmin) / static_cast<double>(samples);
+    xs[0] = xmin;
+    for (int i = 1; i <= samples; ++i)
+        xs[i] = xmin + dx * static_cast<double>(i);
+    return xs;
 }
 
-QVector<double> NumericAnalysis::findRootsBisection(const ParsedExpression& expr, double xmin, double xmax, int samples) {
+/// Sign changes between neighbouring samples, each refined by bisection on f.
+template <typename Fn>
+QVector<double> rootsFromSamples(const QVector<double>& xs, const QVector<double>& ys, const Fn& f) {
     QVector<double> roots;
-    if (samples < 4 || xmax <= xmin)
-        return roots;
-    const double dx = (xmax - xmin) / static_cast<double>(samples);
-    double x0 = xmin;
-    double y0 = MathEvaluator::evalAt(expr, x0);
-    for (int i = 1; i <= samples; ++i) {
-        const double x1 = xmin + dx * static_cast<double>(i);
-        const double y1 = MathEvaluator::evalAt(expr, x1);
+    for (int i = 1; i < xs.size(); ++i) {
+        const double y0 = ys[i - 1];
+        const double y1 = ys[i];
         if (qIsFinite(y0) && qIsFinite(y1) && y0 * y1 <= 0.0) {
-            const double r = bisectRoot(expr, x0, x1);
+            const double r = bisectRoot(f, xs[i - 1], xs[i]);
             if (qIsFinite(r)) {
                 if (roots.isEmpty() || qAbs(roots.back() - r) > 1e-3)
                     roots.push_back(r);
             }
         }
-        x0 = x1;
-        y0 = y1;
     }
     return roots;
 }
+}
+
+double NumericAnalysis::derivativeCentral(const ParsedExpression& expr, double x, double h) {
+    const double f1 = MathEvaluator::evalAt(expr, x + h);
+    const double f0 = MathEvaluator::evalAt(expr, x - h);
+    if (!qIsFinite(f1) || !qIsFinite(f0))
+        return qQNaN();
+    return (f1 - f0) / (2.0 * h);
+}
+
+void NumericAnalysis::derivativeCentralMany(const ParsedExpression& expr, const double* xs, double* ys, int n,
+                                            double h) {
+    if (n <= 0)
+        return;
+    std::vector<double> shifted(static_cast<size_t>(n));
+    std::vector<double> f1(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i)
+        shifted[i] = xs[i] + h;
+    MathEvaluator::evalMany(expr, shifted.data(), f1.data(), static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i)
+        shifted[i] = xs[i] - h;
+    MathEvaluator::evalMany(expr, shifted.data(), ys, static_cast<size_t>(n));
+    const double inv2h = 1.0 / (2.0 * h);
+    for (int i = 0; i < n; ++i) {
+        const double f0 = ys[i];
+        ys[i] = (qIsFinite(f1[i]) && qIsFinite(f0)) ? (f1[i] - f0) * inv2h : qQNaN();
+    }
+}
+
+QVector<double> NumericAnalysis::findRootsBisection(const ParsedExpression& expr, double xmin, double xmax, int samples) {
+    if (samples < 4 || xmax <= xmin)
+        return {};
+    const QVector<double> xs = sampleGrid(xmin, xmax, samples);
+    QVector<double> ys(xs.size());
+    MathEvaluator::evalMany(expr, xs.constData(), ys.data(), static_cast<size_t>(xs.size()));
+    return rootsFromSamples(xs, ys, [&](double x) { return MathEvaluator::evalAt(expr, x); });
+}
 
 QVector<double> NumericAnalysis::findExtrema(const ParsedExpression& expr, double xmin, double xmax, int samples) {
-    QVector<double> ex;
     if (samples < 8 || xmax <= xmin)
-        return ex;
-    ParsedExpression dExpr;
-    dExpr.ok = true;
-    dExpr.fn = [&](double x) { return derivativeCentral(expr, x, 1e-3); };
-    ex = findRootsBisection(dExpr, xmin, xmax, samples);
-    return ex;
+        return {};
+    const QVector<double> xs = sampleGrid(xmin, xmax, samples);
+    QVector<double> ys(xs.size());
+    derivativeCentralMany(expr, xs.constData(), ys.data(), xs.size(), 1e-3);
+    return rootsFromSamples(xs, ys, [&](double x) { return derivativeCentral(expr, x, 1e-3); });
 }
 
 namespace {
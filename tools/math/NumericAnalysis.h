@@ -7,6 +7,9 @@
 class NumericAnalysis {
 public:
     static double derivativeCentral(const ParsedExpression& expr, double x, double h = 1e-3);
+    /// Batch form of derivativeCentral: ys[i] = f'(xs[i]), evaluated through MathEvaluator::evalMany.
+    static void derivativeCentralMany(const ParsedExpression& expr, const double* xs, double* ys, int n,
+                                      double h = 1e-3);
     static QVector<double> findRootsBisection(const ParsedExpression& expr, double xmin, double xmax, int samples = 256);
     static QVector<double> findExtrema(const ParsedExpression& expr, double xmin, double xmax, int samples = 256);
 